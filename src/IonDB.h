@@ -27,6 +27,7 @@
 #include "key_value/kv_system.h"
 #include "cpp_wrapper/Dictionary.h"
 #include "cpp_wrapper/FlatFile.h"
+#include "cpp_wrapper/LinearHash.h"
 #include "cpp_wrapper/OpenAddressFileHash.h"
 #include "cpp_wrapper/OpenAddressHash.h"
 #include "cpp_wrapper/BppTree.h"
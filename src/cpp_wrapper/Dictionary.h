@@ -166,6 +166,17 @@ close(
 	return err;
 }
 
+/**
+@brief	  Writes changes held in memory by a dictionary to its files.
+*/
+ion_err_t
+flush(
+) {
+	ion_err_t err = dictionary_flush(&dict);
+
+	return err;
+}
+
 /**
 @brief	  Sets up cursor and predicate to perform a range query on a
 			dictionary.
@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include "bpp_tree.h"
 
 /*************
@@ -20,13 +21,30 @@
  *	each 3/4 full.  On deletion, if 3 nodes are 1/2 full, they are
  *	joined to create 2 nodes 3/4 full.
  *
- *	A LRR (least-recently-read) buffering scheme for nodes is used to
- *	simplify storage management, and, assuming some locality of reference,
- *	improve performance.
+ *	Nodes are cached in a pool of buffers whose size is chosen at open
+ *	time.  Buffers are found by address through a hash table, and a
+ *	CLOCK (second chance) scheme picks the buffer to reuse, so frequently
+ *	visited internal nodes tend to stay in memory.  The buffers assigned
+ *	most recently are never reused, as insert/delete need simultaneous
+ *	access to several of them.
  *
  *	To simplify matters, both internal nodes and leafs contain the
  *	same fields.
  *
+ *	The index file starts with a header, padded to the size of a node
+ *	so that nodes on disk are aligned to their size.  Node addresses
+ *	are offset by one node, and address 0 remains the root.
+ *	Sectors of nodes freed by joins are chained through their next
+ *	field, starting at the header, and reused before the file grows.
+ *
+ *	A compressed index front codes its nodes on disk: each key is
+ *	written as the length it shares with the key before it, then the
+ *	rest of it less trailing zeros.  Nodes are expanded to the usual
+ *	fixed width when read, so nothing else needs to know.  As keys
+ *	take less room a node spans several sectors, but is written only
+ *	as far as it goes, and read a sector at a time.  Separators made
+ *	by splits are cut short, being any key between the children.
+ *
 */
 
 /* macros for addressing fields */
@@ -53,6 +71,9 @@
 /* shortcuts */
 #define ks(ct)		((ct) * h->ks)
 
+/* comp may return any magnitude, callers of search() expect CC_xx */
+#define ccOf(cc)	(((cc) > 0) - ((cc) < 0))
+
 typedef char ion_bpp_key_t;	/* keys entries are treated as char arrays */
 
 typedef struct {
@@ -74,23 +95,44 @@ typedef struct {
 
 typedef struct ion_bpp_buffer_tag {
 	/* location of node */
-	struct ion_bpp_buffer_tag	*next;	/* next */
-	struct ion_bpp_buffer_tag	*prev;	/* previous */
+	struct ion_bpp_buffer_tag	*hashNext;	/* next buffer in hash chain */
 	ion_bpp_address_t			adr;	/* on disk */
 	ion_bpp_node_t				*p;	/* in memory */
 	ion_bpp_bool_t				valid;		/* true if buffer contents valid */
 	ion_bpp_bool_t				modified;	/* true if buffer modified */
+	ion_bpp_bool_t				referenced;	/* CLOCK reference bit */
 } ion_bpp_buffer_t;
 
+/*
+ * During insert/delete, need simultaneous access to 7 buffers:
+ *  - 4 adjacent child bufs
+ *  - 1 parent buf
+ *  - 1 next sequential link
+ *  - 1 lastGE
+*/
+#define ION_BPP_MIN_BUFFERS 7
+
 /* one node for each open handle */
 typedef struct ion_bpp_h_node_tag {
 	ion_file_handle_t		fp;		/* idx file */
 	int						keySize;/* key length */
 	ion_bpp_bool_t			dupKeys;/* true if duplicate keys */
 	int						sectorSize;	/* block size for idx records */
+	int						nodeSize;	/* size of node, a multiple of sectorSize */
+	ion_bpp_bool_t			compress;	/* true if nodes are compressed on disk */
+	char					*ebuf;	/* compressed node being read or written */
 	ion_bpp_comparison_t	comp;			/* pointer to compare routine */
 	ion_bpp_buffer_t		root;			/* root of b-tree, room for 3 sets */
-	ion_bpp_buffer_t		bufList;		/* head of buf list */
+	int						bufCt;	/* number of buffers in pool */
+	ion_bpp_buffer_t		**bufHash;	/* buffers hashed by address */
+	unsigned int			hashMask;	/* number of hash slots - 1 */
+	int						clockHand;	/* next buffer considered for reuse */
+	int						dirtyCt;/* number of modified buffers in pool */
+	int						dirtyMax;	/* dirtyCt that starts a write back */
+	ion_bpp_buffer_t		**dirty;/* modified buffers, sorted for write back */
+	char					*wbuf;	/* adjacent nodes coalesced into one write */
+	int						wbufSize;	/* size of wbuf, 0 if writes are not coalesced */
+	ion_bpp_buffer_t		*recent[ION_BPP_MIN_BUFFERS - 1];	/* most recently assigned, never reused */
 	void					*malloc1;	/* malloc'd resources */
 	void					*malloc2;	/* malloc'd resources */
 	ion_bpp_buffer_t		gbuf;			/* gather buffer, room for 3 sets */
@@ -99,34 +141,214 @@ typedef struct ion_bpp_h_node_tag {
 	unsigned int			maxCt;	/* minimum # keys in node */
 	int						ks;	/* sizeof key entry */
 	ion_bpp_address_t		nextFreeAdr;/* next free b-tree record address */
+	ion_bpp_address_t		freeAdr;/* first sector on free list, 0 if none */
+	ion_bpp_bool_t			hdrModified;/* true if header needs writing */
+	unsigned long			flushCt;/* number of buffers flushed */
+	ion_bpp_stats_t			stats;	/* statistics */
 } ion_bpp_h_node_t;
 
-#define error(rc) lineError(__LINE__, rc)
+/* header kept at the start of the index file */
+#define ION_BPP_MAGIC 0x42505401L
+
+typedef struct {
+	long				magic;	/* identifies an index file */
+	int					sectorSize;	/* size of sector on disk */
+	int					keySize;/* key length */
+	ion_bpp_address_t	freeAdr;/* first sector on free list, 0 if none */
+	ion_bpp_bool_t		dupKeys;/* true if duplicate keys */
+	ion_bpp_bool_t		compress;	/* true if nodes are compressed */
+} ion_bpp_file_header_t;
+
+/* file offset of node at adr, past the header, which takes a node so nodes are aligned */
+#define fileAdr(adr) ((adr) + h->nodeSize)
+
+#define error(rc) lineError(h, __LINE__, rc)
 
 static ion_bpp_err_t
 lineError(
-	int				lineno,
-	ion_bpp_err_t	rc
+	ion_bpp_h_node_t	*h,
+	int					lineno,
+	ion_bpp_err_t		rc
 ) {
 	if ((rc == bErrIO) || (rc == bErrMemory)) {
-		if (!bErrLineNo) {
-			bErrLineNo = lineno;
+		if ((NULL != h) && !h->stats.errLineNo) {
+			h->stats.errLineNo = lineno;
 		}
 	}
 
 	return rc;
 }
 
-static ion_bpp_address_t
-allocAdr(
-	ion_bpp_handle_t handle
+/* compressed node: length, node fields before fkey, then front coded entries */
+#define nodeHdrLen	offsetof(ion_bpp_node_t, fkey)
+
+static char *
+putLen(
+	ion_bpp_h_node_t	*h,
+	char				*q,
+	int					n
 ) {
-	ion_bpp_h_node_t	*h = handle;
-	ion_bpp_address_t	adr;
+	/* key lengths take 2 bytes if keys are 256 bytes or more */
+	*q++ = (char) n;
+
+	if (h->keySize > 255) {
+		*q++ = (char) (n >> 8);
+	}
+
+	return q;
+}
+
+static char *
+getLen(
+	ion_bpp_h_node_t	*h,
+	char				*q,
+	int					*n
+) {
+	*n = (unsigned char) *q++;
+
+	if (h->keySize > 255) {
+		*n |= (unsigned char) *q++ << 8;
+	}
+
+	return q;
+}
+
+static int
+encodeNode(
+	ion_bpp_h_node_t	*h,
+	ion_bpp_buffer_t	*buf,
+	char				*out
+) {
+	ion_bpp_key_t	*k;
+	ion_bpp_key_t	*pk;	/* previous key */
+	char			*q;
+	uint32_t		len;	/* bytes in compressed node */
+	int				end;	/* key length, less trailing zeros */
+	int				pre;	/* length of prefix shared with previous key */
+	int				i;
+
+	/* compress node in buf to out, returning its length */
+	q = out + sizeof(len);
+	memcpy(q, buf->p, nodeHdrLen);
+	q	+= nodeHdrLen;
+
+	pk	= NULL;
+	k	= fkey(buf);
+
+	for (i = 0; i < ct(buf); i++, k += ks(1)) {
+		for (end = h->keySize; end > 0 && 0 == key(k)[end - 1]; end--) {}
+
+		pre = 0;
+
+		if (NULL != pk) {
+			for (; pre < end && key(k)[pre] == key(pk)[pre]; pre++) {}
+		}
+
+		q	= putLen(h, q, pre);
+		q	= putLen(h, q, end - pre);
+		memcpy(q, key(k) + pre, end - pre);
+		q	+= end - pre;
+		memcpy(q, &rec(k), sizeof(ion_bpp_external_address_t));
+		q	+= sizeof(ion_bpp_external_address_t);
+
+		if (!leaf(buf)) {
+			memcpy(q, &childGE(k), sizeof(ion_bpp_address_t));
+			q += sizeof(ion_bpp_address_t);
+		}
+
+		pk = k;
+	}
+
+	len = q - out;
+	memcpy(out, &len, sizeof(len));
+	return len;
+}
+
+static ion_bpp_err_t
+decodeNode(
+	ion_bpp_h_node_t	*h,
+	char				*in,
+	unsigned int		maxCt,
+	ion_bpp_buffer_t	*buf
+) {
+	ion_bpp_key_t	*k;
+	ion_bpp_key_t	*pk;	/* previous key */
+	char			*q;
+	int				pre;	/* length of prefix shared with previous key */
+	int				n;		/* length of rest of key */
+	int				i;
+
+	/* expand compressed node in to buf, holding at most maxCt keys */
+	q = in + sizeof(uint32_t);
+	memcpy(buf->p, q, nodeHdrLen);
+	q	+= nodeHdrLen;
+
+	if (ct(buf) > maxCt) {
+		return error(bErrIO);
+	}
+
+	pk	= NULL;
+	k	= fkey(buf);
+
+	for (i = 0; i < ct(buf); i++, k += ks(1)) {
+		q	= getLen(h, q, &pre);
+		q	= getLen(h, q, &n);
+
+		if ((pre + n > h->keySize) || ((NULL == pk) && pre)) {
+			return error(bErrIO);
+		}
+
+		if (pre) {
+			memcpy(key(k), key(pk), pre);
+		}
+
+		memcpy(key(k) + pre, q, n);
+		memset(key(k) + pre + n, 0, h->keySize - pre - n);
+		q	+= n;
+		memcpy(&rec(k), q, sizeof(ion_bpp_external_address_t));
+		q	+= sizeof(ion_bpp_external_address_t);
+
+		if (leaf(buf)) {
+			childGE(k) = 0;
+		}
+		else {
+			memcpy(&childGE(k), q, sizeof(ion_bpp_address_t));
+			q += sizeof(ion_bpp_address_t);
+		}
+
+		pk = k;
+	}
+
+	return bErrOk;
+}
 
-	adr				= h->nextFreeAdr;
-	h->nextFreeAdr	+= h->sectorSize;
-	return adr;
+static ion_bpp_err_t
+readCompressed(
+	ion_bpp_h_node_t	*h,
+	ion_bpp_address_t	adr,
+	ion_bpp_buffer_t	*buf
+) {
+	uint32_t		len;	/* bytes in compressed node */
+	unsigned int	n;		/* nodes buf has room for */
+
+	/* read first sector of node, and the rest if it's longer */
+	n = (adr == 0) ? 3 : 1;
+
+	if (err_ok != ion_fread_at(h->fp, fileAdr(adr), h->sectorSize, (ion_byte_t *) h->ebuf)) {
+		return error(bErrIO);
+	}
+
+	memcpy(&len, h->ebuf, sizeof(len));
+
+	if ((len < sizeof(len) + nodeHdrLen) || (len > n * h->nodeSize)) {
+		return error(bErrIO);
+	}
+
+	if ((len > (uint32_t) h->sectorSize) && (err_ok != ion_fread(h->fp, len - h->sectorSize, (ion_byte_t *) h->ebuf + h->sectorSize))) {
+		return error(bErrIO);
+	}
+
+	return decodeNode(h, h->ebuf, n * h->maxCt, buf);
 }
 
 static ion_bpp_err_t
@@ -139,13 +361,26 @@ flush(
 	ion_err_t			err;
 
 	/* flush buffer to disk */
-	len = h->sectorSize;
+	if (h->compress) {
+		len = encodeNode(h, buf, h->ebuf);
 
-	if (buf->adr == 0) {
-		len *= 3;	/* root */
+		/* whole sector, so the first sector of a node can always be read */
+		if (len < h->sectorSize) {
+			memset(h->ebuf + len, 0, h->sectorSize - len);
+			len = h->sectorSize;
+		}
+
+		err = ion_fwrite_at(h->fp, fileAdr(buf->adr), len, (ion_byte_t *) h->ebuf);
 	}
+	else {
+		len = h->nodeSize;
 
-	err = ion_fwrite_at(h->fp, buf->adr, len, (ion_byte_t *) buf->p);
+		if (buf->adr == 0) {
+			len *= 3;	/* root */
+		}
+
+		err = ion_fwrite_at(h->fp, fileAdr(buf->adr), len, (ion_byte_t *) buf->p);
+	}
 
 	if (err_ok != err) {
 		return error(bErrIO);
@@ -191,8 +426,127 @@ flush(
 
 #endif
 
+	if (buf != &h->root) {
+		h->dirtyCt--;
+	}
+
 	buf->modified = boolean_false;
-	nDiskWrites++;
+	h->flushCt++;
+	h->stats.nDiskWrites++;
+	return bErrOk;
+}
+
+static ion_bpp_err_t
+writeHeader(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t		*h = handle;
+	ion_bpp_file_header_t	hdr;
+
+	/* write header to first sector */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic		= ION_BPP_MAGIC;
+	hdr.sectorSize	= h->sectorSize;
+	hdr.keySize		= h->keySize;
+	hdr.freeAdr		= h->freeAdr;
+	hdr.dupKeys		= h->dupKeys;
+	hdr.compress	= h->compress;
+
+	if (err_ok != ion_fwrite_at(h->fp, 0, sizeof(hdr), (ion_byte_t *) &hdr)) {
+		return error(bErrIO);
+	}
+
+	h->hdrModified = boolean_false;
+	return bErrOk;
+}
+
+static int
+compareAdr(
+	const void	*a,
+	const void	*b
+) {
+	ion_bpp_address_t	adrA = (*(ion_bpp_buffer_t **) a)->adr;
+	ion_bpp_address_t	adrB = (*(ion_bpp_buffer_t **) b)->adr;
+
+	return (adrA > adrB) - (adrA < adrB);
+}
+
+static ion_bpp_err_t
+writeBack(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bool_t		withRoot
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_err_t		rc;			/* return code */
+	int					n;	/* number of modified buffers */
+	int					i, j, k;
+	int					len;/* bytes in run */
+	int					size;	/* bytes in node */
+
+	/* write modified buffers in address order, */
+	/* adjacent uncompressed nodes in a single write */
+	n = 0;
+
+	if (withRoot && h->root.modified) {
+		h->dirty[n++] = &h->root;
+	}
+
+	buf = h->malloc1;
+
+	for (i = 0; i < h->bufCt; i++, buf++) {
+		if (buf->modified) {
+			h->dirty[n++] = buf;
+		}
+	}
+
+	qsort(h->dirty, n, sizeof(ion_bpp_buffer_t *), compareAdr);
+
+	for (i = 0; i < n; i = j) {
+		/* find the run of adjacent nodes that fits in wbuf */
+		len = 0;
+
+		for (j = i; j < n && !h->compress; j++) {
+			size = (h->dirty[j]->adr == 0) ? 3 * h->nodeSize : h->nodeSize;
+
+			if ((h->dirty[j]->adr != h->dirty[i]->adr + len) || (len + size > h->wbufSize)) {
+				break;
+			}
+
+			len += size;
+		}
+
+		if (j - i < 2) {
+			if ((rc = flush(handle, h->dirty[i])) != 0) {
+				return rc;
+			}
+
+			j = i + 1;
+			continue;
+		}
+
+		for (k = i, len = 0; k < j; k++) {
+			size = (h->dirty[k]->adr == 0) ? 3 * h->nodeSize : h->nodeSize;
+			memcpy(h->wbuf + len, h->dirty[k]->p, size);
+			len += size;
+		}
+
+		if (err_ok != ion_fwrite_at(h->fp, fileAdr(h->dirty[i]->adr), len, (ion_byte_t *) h->wbuf)) {
+			return error(bErrIO);
+		}
+
+		for (k = i; k < j; k++) {
+			if (h->dirty[k] != &h->root) {
+				h->dirtyCt--;
+			}
+
+			h->dirty[k]->modified = boolean_false;
+		}
+
+		h->flushCt++;
+		h->stats.nDiskWrites++;
+	}
+
 	return bErrOk;
 }
 
@@ -202,26 +556,91 @@ flushAll(
 ) {
 	ion_bpp_h_node_t	*h = handle;
 	ion_bpp_err_t		rc;			/* return code */
+
+	if (h->hdrModified) {
+		if ((rc = writeHeader(handle)) != 0) {
+			return rc;
+		}
+	}
+
+	return writeBack(handle, boolean_true);
+}
+
+#define hashAdr(adr) ((unsigned long) ((adr) / h->nodeSize) & h->hashMask)
+
+static ion_bpp_buffer_t *
+cachedBuf(
+	ion_bpp_handle_t	handle,
+	ion_bpp_address_t	adr
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+
+	/* search hash chain for buf with matching adr */
+	buf = h->bufHash[hashAdr(adr)];
+
+	while (NULL != buf && buf->adr != adr) {
+		buf = buf->hashNext;
+	}
+
+	return buf;
+}
+
+static ion_bpp_err_t
+reuseBuf(
+	ion_bpp_handle_t	handle,
+	ion_bpp_buffer_t	**b
+) {
+	ion_bpp_h_node_t *h = handle;
+	/* pick a buffer to hold a new node */
 	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_buffer_t	**link;				/* link to buf in hash chain */
+	ion_bpp_err_t		rc;			/* return code */
+
+	int					i;
+
+	/* CLOCK: skip referenced buffers, clearing their reference bit */
+	while (1) {
+		buf				= (ion_bpp_buffer_t *) h->malloc1 + h->clockHand;
+		h->clockHand	= (h->clockHand + 1) % h->bufCt;
+
+		/* caller may still be using the most recently assigned buffers */
+		for (i = 0; i < ION_BPP_MIN_BUFFERS - 1 && h->recent[i] != buf; i++) {}
+
+		if (i < ION_BPP_MIN_BUFFERS - 1) {
+			continue;
+		}
+
+		if (buf->referenced) {
+			buf->referenced = boolean_false;
+			continue;
+		}
+
+		break;
+	}
 
-	if (h->root.modified) {
-		if ((rc = flush(handle, &h->root)) != 0) {
+	/* write back every modified buffer at once, rather than the victim alone */
+	if ((buf->valid && buf->modified) || (h->dirtyCt >= h->dirtyMax)) {
+		if ((rc = writeBack(handle, boolean_false)) != 0) {
 			return rc;
 		}
 	}
 
-	buf = h->bufList.next;
+	/* unlink from hash chain of old address */
+	if (-1 != buf->adr) {
+		h->stats.nEvictions++;
+		link = &h->bufHash[hashAdr(buf->adr)];
 
-	while (buf != &h->bufList) {
-		if (buf->modified) {
-			if ((rc = flush(handle, buf)) != 0) {
-				return rc;
-			}
+		while (*link != buf) {
+			link = &(*link)->hashNext;
 		}
 
-		buf = buf->next;
+		*link = buf->hashNext;
 	}
 
+	buf->valid		= boolean_false;
+	buf->modified	= boolean_false;
+	*b				= buf;
 	return bErrOk;
 }
 
@@ -235,56 +654,56 @@ assignBuf(
 	/* assign buf to adr */
 	ion_bpp_buffer_t	*buf;				/* buffer */
 	ion_bpp_err_t		rc;			/* return code */
+	int					i;
 
 	if (adr == 0) {
 		*b = &h->root;
 		return bErrOk;
 	}
 
-	/* search for buf with matching adr */
-	buf = h->bufList.next;
+	buf = cachedBuf(handle, adr);
 
-	while (buf->next != &h->bufList) {
-		if (buf->valid && (buf->adr == adr)) {
-			break;
+	if (NULL != buf) {
+		h->stats.nBufHits++;
+	}
+	else {
+		/* not cached, reuse a buffer */
+		h->stats.nBufMisses++;
+
+		if ((rc = reuseBuf(handle, &buf)) != 0) {
+			return rc;
 		}
 
-		buf = buf->next;
+		buf->adr				= adr;
+		buf->hashNext			= h->bufHash[hashAdr(adr)];
+		h->bufHash[hashAdr(adr)] = buf;
 	}
 
-	/* either buf points to a match, or it's last one in list (LRR) */
-	if (buf->valid) {
-		if (buf->adr != adr) {
-			if (buf->modified) {
-				if ((rc = flush(handle, buf)) != 0) {
-					return rc;
-				}
-			}
+	/* move buf to the front of the recently assigned buffers */
+	for (i = 0; i < ION_BPP_MIN_BUFFERS - 2 && h->recent[i] != buf; i++) {}
 
-			buf->adr	= adr;
-			buf->valid	= boolean_false;
-		}
-	}
-	else {
-		buf->adr = adr;
+	for (; i > 0; i--) {
+		h->recent[i] = h->recent[i - 1];
 	}
 
-	/* remove from current position and place at front of list */
-	buf->next->prev = buf->prev;
-	buf->prev->next = buf->next;
-	buf->next		= h->bufList.next;
-	buf->prev		= &h->bufList;
-	buf->next->prev = buf;
-	buf->prev->next = buf;
+	h->recent[0]	= buf;
+	buf->referenced = boolean_true;
 	*b				= buf;
 	return bErrOk;
 }
 
 static ion_bpp_err_t
 writeDisk(
-	ion_bpp_buffer_t *buf
+	ion_bpp_handle_t	handle,
+	ion_bpp_buffer_t	*buf
 ) {
-	/* write buf to disk */
+	ion_bpp_h_node_t *h = handle;
+
+	/* write buf to disk, later, in writeBack */
+	if (!buf->modified && (buf != &h->root)) {
+		h->dirtyCt++;
+	}
+
 	buf->valid		= boolean_true;
 	buf->modified	= boolean_true;
 	return bErrOk;
@@ -307,21 +726,26 @@ readDisk(
 	}
 
 	if (!buf->valid) {
-		len = h->sectorSize;
-
-		if (adr == 0) {
-			len *= 3;	/* root */
+		if (h->compress) {
+			if ((rc = readCompressed(h, adr, buf)) != 0) {
+				return rc;
+			}
 		}
+		else {
+			len = h->nodeSize;
 
-		ion_err_t err = ion_fread_at(h->fp, adr, len, (ion_byte_t *) buf->p);
+			if (adr == 0) {
+				len *= 3;	/* root */
+			}
 
-		if (err_ok != err) {
-			return error(bErrIO);
+			if (err_ok != ion_fread_at(h->fp, fileAdr(adr), len, (ion_byte_t *) buf->p)) {
+				return error(bErrIO);
+			}
 		}
 
 		buf->modified	= boolean_false;
 		buf->valid		= boolean_true;
-		nDiskReads++;
+		h->stats.nDiskReads++;
 
 #if 0
 		len = 1;
@@ -361,16 +785,53 @@ readDisk(
 		}
 
 #endif
-
-		buf->modified	= boolean_false;
-		buf->valid		= boolean_true;
-		nDiskReads++;
 	}
 
 	*b = buf;
 	return bErrOk;
 }
 
+static ion_bpp_err_t
+allocAdr(
+	ion_bpp_handle_t	handle,
+	ion_bpp_address_t	*adr
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_err_t		rc;			/* return code */
+
+	if (h->freeAdr) {
+		/* take first sector on free list */
+		if ((rc = readDisk(handle, h->freeAdr, &buf)) != 0) {
+			return rc;
+		}
+
+		*adr			= h->freeAdr;
+		h->freeAdr		= next(buf);
+		h->hdrModified	= boolean_true;
+		return bErrOk;
+	}
+
+	*adr			= h->nextFreeAdr;
+	h->nextFreeAdr	+= h->nodeSize;
+	return bErrOk;
+}
+
+static ion_bpp_err_t
+freeAdr(
+	ion_bpp_handle_t	handle,
+	ion_bpp_buffer_t	*buf
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	/* put sector of buf on free list */
+	ct(buf)			= 0;
+	next(buf)		= h->freeAdr;
+	h->freeAdr		= buf->adr;
+	h->hdrModified	= boolean_true;
+	return writeDisk(handle, buf);
+}
+
 typedef enum ION_BPP_MODE { MODE_FIRST, MODE_MATCH, MODE_FGEQ, MODE_LLEQ } ion_bpp_mode_e;
 
 static int
@@ -399,10 +860,10 @@ search(
 	int					m;		/* midpoint of search */
 	int					lb;		/* lower-bound of binary search */
 	int					ub;		/* upper-bound of binary search */
-	ion_bpp_bool_t		foundDup;			/* true if found a duplicate key */
+	int					firstDup;	/* first duplicate key found, -1 if none */
 
 	/* scan current node for key using binary search */
-	foundDup	= boolean_false;
+	firstDup	= -1;
 	lb			= 0;
 	ub			= ct(buf) - 1;
 
@@ -426,7 +887,7 @@ search(
 					case MODE_FIRST:
 						/* backtrack to first key */
 						ub			= m - 1;
-						foundDup	= boolean_true;
+						firstDup	= m;
 						break;
 
 					case MODE_MATCH:
@@ -463,9 +924,9 @@ search(
 		return ION_CC_LT;
 	}
 
-	if (h->dupKeys && (mode == MODE_FIRST) && foundDup) {
-		/* next key is first key in set of duplicates */
-		*mkey += ks(1);
+	if (firstDup >= 0) {
+		/* leftmost match is first key in set of duplicates */
+		*mkey = fkey(buf) + ks(firstDup);
 		return ION_CC_EQ;
 	}
 
@@ -478,7 +939,7 @@ search(
 			cc		= h->comp(key, key(*mkey), (ion_key_size_t) (h->keySize));
 		}
 
-		return cc;
+		return ccOf(cc);
 	}
 
 	if (MODE_FGEQ == mode) {
@@ -490,11 +951,11 @@ search(
 			cc		= h->comp(key, key(*mkey), (ion_key_size_t) (h->keySize));
 		}
 
-		return cc;
+		return ccOf(cc);
 	}
 
 	/* didn't find key */
-	return cc;
+	return ccOf(cc);
 }
 
 static ion_bpp_err_t
@@ -516,6 +977,27 @@ scatterRoot(
 	return bErrOk;
 }
 
+static void
+shortenKey(
+	ion_bpp_h_node_t	*h,
+	ion_bpp_key_t		*sep,
+	ion_bpp_key_t		*lo,
+	ion_bpp_key_t		*hi
+) {
+	int n;
+
+	/* cut separator sep = hi to its shortest prefix still above lo */
+	for (n = 1; n < h->keySize; n++) {
+		memset(key(sep) + n, 0, h->keySize - n);
+
+		if ((h->comp(key(sep), key(lo), (ion_key_size_t) (h->keySize)) > 0) && (h->comp(key(sep), key(hi), (ion_key_size_t) (h->keySize)) <= 0)) {
+			return;
+		}
+
+		key(sep)[n] = key(hi)[n];
+	}
+}
+
 static ion_bpp_err_t
 scatter(
 	ion_bpp_handle_t	handle,
@@ -582,7 +1064,13 @@ scatter(
 	while (1) {
 		if ((iu == 0) || (ct > (k0Max + (iu - 1) * knMax))) {
 			/* add a buffer */
-			if ((rc = assignBuf(handle, allocAdr(handle), &tmp[iu])) != 0) {
+			ion_bpp_address_t adr;
+
+			if ((rc = allocAdr(handle, &adr)) != 0) {
+				return rc;
+			}
+
+			if ((rc = assignBuf(handle, adr, &tmp[iu])) != 0) {
 				return rc;
 			}
 
@@ -602,7 +1090,7 @@ scatter(
 			}
 
 			iu++;
-			nNodesIns++;
+			h->stats.nNodesIns++;
 		}
 		else if ((iu > 1) && (ct < (k0Min + (iu - 1) * knMin))) {
 			/* del a buffer */
@@ -614,10 +1102,15 @@ scatter(
 			}
 
 			next(tmp[iu - 1]) = next(tmp[iu]);
-			nNodesDel++;
-		}
-		else {
-			break;
+
+			if ((rc = freeAdr(handle, tmp[iu])) != 0) {
+				return rc;
+			}
+
+			h->stats.nNodesDel++;
+		}
+		else {
+			break;
 		}
 	}
 
@@ -643,6 +1136,13 @@ scatter(
 	/**************************************
 	 * update sequential links and parent *
 	 **************************************/
+	if (iu > is) {
+		h->stats.nSplits++;
+	}
+	else if (iu < is) {
+		h->stats.nJoins++;
+	}
+
 	if (iu != is) {
 		/* link last node to next */
 		if (leaf(gbuf) && next(tmp[iu - 1])) {
@@ -654,7 +1154,7 @@ scatter(
 
 			prev(buf) = tmp[iu - 1]->adr;
 
-			if ((rc = writeDisk(buf)) != 0) {
+			if ((rc = writeDisk(handle, buf)) != 0) {
 				return rc;
 			}
 		}
@@ -695,6 +1195,11 @@ scatter(
 			}
 			else {
 				memcpy(pkey, gkey, ks(1));
+
+				if (h->compress) {
+					shortenKey(h, pkey, gkey - ks(1), gkey);
+				}
+
 				childGE(pkey)	= tmp[i]->adr;
 				pkey			+= ks(1);
 			}
@@ -730,12 +1235,12 @@ scatter(
 	/************************
 	 * write modified nodes *
 	 ************************/
-	if ((rc = writeDisk(pbuf)) != 0) {
+	if ((rc = writeDisk(handle, pbuf)) != 0) {
 		return rc;
 	}
 
 	for (i = 0; i < iu; i++) {
-		if ((rc = writeDisk(tmp[i])) != 0) {
+		if ((rc = writeDisk(handle, tmp[i])) != 0) {
 			return rc;
 		}
 	}
@@ -754,7 +1259,7 @@ gatherRoot(
 	/* gather root to gbuf */
 	root		= &h->root;
 	gbuf		= &h->gbuf;
-	memcpy(p(gbuf), root->p, 3 * h->sectorSize);
+	memcpy(p(gbuf), root->p, 3 * h->nodeSize);
 	leaf(gbuf)	= leaf(root);
 	ct(root)	= 0;
 	return bErrOk;
@@ -843,59 +1348,212 @@ gather(
 	return bErrOk;
 }
 
+/* frees a handle and its buffers, without writing anything back */
+static void
+freeHandle(
+	ion_bpp_h_node_t *h
+) {
+	if (h->malloc2) {
+		free(h->malloc2);
+	}
+
+	if (h->malloc1) {
+		free(h->malloc1);
+	}
+
+	if (h->bufHash) {
+		free(h->bufHash);
+	}
+
+	if (h->dirty) {
+		free(h->dirty);
+	}
+
+	if (h->wbuf) {
+		free(h->wbuf);
+	}
+
+	free(h);
+}
+
+/* closes the index and frees the handle of an open that failed, returning rc */
+static ion_bpp_err_t
+openFailed(
+	ion_bpp_h_node_t	*h,
+	ion_bpp_err_t		rc
+) {
+/*TODO: Cleanup **/
+#if defined(ARDUINO)
+
+	if (h->fp.file) {
+#else
+
+	if (h->fp) {
+#endif
+		ion_fclose(h->fp);
+	}
+
+	freeHandle(h);
+	return rc;
+}
+
 ion_bpp_err_t
 bOpen(
 	ion_bpp_open_t		info,
 	ion_bpp_handle_t	*handle
 ) {
-	ion_bpp_h_node_t	*h;
+	ion_bpp_h_node_t	*h = NULL;
 	ion_bpp_err_t		rc;			/* return code */
 	int					bufCt;	/* number of tmp buffers */
 	ion_bpp_buffer_t	*buf;				/* buffer */
 	int					maxCt;	/* maximum number of keys in a node */
+	unsigned int		hashCt;	/* number of hash slots */
 	ion_bpp_buffer_t	*root;
 	int					i;
 	ion_bpp_node_t		*p;
+	ion_bpp_bool_t		exists;			/* true if index file exists */
+	ion_file_handle_t	fp;
+	ion_bpp_file_header_t hdr;
+	int					nodeSize;	/* size of node in memory */
+	int					ebufSize;	/* size of compressed node buffer */
+
+	/* an existing index keeps the sector size, key mode and format it was made with */
+	exists = ion_fexists(info.iName);
+
+	if (exists) {
+		fp = ion_fopen(info.iName);
+
+		if (err_ok != ion_fread_at(fp, 0, sizeof(hdr), (ion_byte_t *) &hdr)) {
+			ion_fclose(fp);
+			return error(bErrIO);
+		}
+
+		if (ION_BPP_MAGIC != hdr.magic) {
+			ion_fclose(fp);
+			return bErrFileNotOpen;
+		}
+
+		if (hdr.keySize != info.keySize) {
+			ion_fclose(fp);
+			return bErrSectorSize;
+		}
+
+		info.sectorSize = hdr.sectorSize;
+		info.dupKeys	= hdr.dupKeys;
+		info.compress	= hdr.compress;
+	}
+
+	if ((info.sectorSize < sizeof(ion_bpp_file_header_t)) || (info.sectorSize > ION_BPP_MAX_SECTOR_SIZE) || (0 != info.sectorSize % 4)) {
+		if (exists) {
+			ion_fclose(fp);
+		}
 
-	if ((info.sectorSize < sizeof(ion_bpp_h_node_t)) || (0 != info.sectorSize % 4)) {
 		return bErrSectorSize;
 	}
 
 	/* determine sizes and offsets */
 	/* leaf/n, prev, next, [childLT,key,rec]... childGE */
 	/* ensure that there are at least 3 children/parent for gather/scatter */
-	maxCt	= info.sectorSize - (sizeof(ion_bpp_node_t) - sizeof(ion_bpp_key_t));
-	maxCt	/= sizeof(ion_bpp_address_t) + info.keySize + sizeof(ion_bpp_external_address_t);
+	if (info.compress) {
+		/* room for the longest compressed node, when no key shrinks */
+		nodeSize	= ION_BPP_COMPRESSED_SECTORS * info.sectorSize;
+		maxCt		= nodeSize - sizeof(uint32_t) - nodeHdrLen;
+		maxCt		/= sizeof(ion_bpp_address_t) + info.keySize + sizeof(ion_bpp_external_address_t) + ((info.keySize > 255) ? 4 : 2);
+		ebufSize	= 3 * nodeSize;
+	}
+	else {
+		nodeSize	= info.sectorSize;
+		maxCt		= nodeSize - (sizeof(ion_bpp_node_t) - sizeof(ion_bpp_key_t));
+		maxCt		/= sizeof(ion_bpp_address_t) + info.keySize + sizeof(ion_bpp_external_address_t);
+		ebufSize	= 0;
+	}
+
+	/* root holds 3 nodes of keys, and ct is 15 bits */
+	if (maxCt > 0x7fff / 3) {
+		maxCt = 0x7fff / 3;
+	}
 
 	if (maxCt < 6) {
+		if (exists) {
+			ion_fclose(fp);
+		}
+
 		return bErrSectorSize;
 	}
 
 	/* copy parms to ion_bpp_h_node_t */
 	if ((h = calloc(1, sizeof(ion_bpp_h_node_t))) == NULL) {
+		if (exists) {
+			ion_fclose(fp);
+		}
+
 		return error(bErrMemory);
 	}
 
+	/* from here, failures close the index and free the handle through openFailed() */
+	if (exists) {
+		h->fp = fp;
+	}
+
 	h->keySize		= info.keySize;
 	h->dupKeys		= info.dupKeys;
 	h->sectorSize	= info.sectorSize;
+	h->nodeSize		= nodeSize;
+	h->compress		= info.compress;
 	h->comp			= info.comp;
 
 	/* childLT, key, rec */
 	h->ks			= sizeof(ion_bpp_address_t) + h->keySize + sizeof(ion_bpp_external_address_t);
 	h->maxCt		= maxCt;
 
-	/* Allocate buflist.
-	 * During insert/delete, need simultaneous access to 7 buffers:
-	 *  - 4 adjacent child bufs
-	 *  - 1 parent buf
-	 *  - 1 next sequential link
-	 *  - 1 lastGE
-	*/
-	bufCt			= 7;
+	/* Allocate buffer pool of at most ION_BPP_MAX_BUFFER_BYTES, but at least ION_BPP_MIN_BUFFERS in size. */
+	bufCt = info.bufCt;
+
+	if (bufCt <= 0) {
+		bufCt = ION_BPP_DEFAULT_BUFFER_COUNT;
+	}
+
+	if (bufCt > ION_BPP_MAX_BUFFER_BYTES / nodeSize) {
+		bufCt = (int) (ION_BPP_MAX_BUFFER_BYTES / nodeSize);
+	}
+
+	if (bufCt < ION_BPP_MIN_BUFFERS) {
+		bufCt = ION_BPP_MIN_BUFFERS;
+	}
+
+	h->bufCt = bufCt;
 
 	if ((h->malloc1 = calloc(bufCt, sizeof(ion_bpp_buffer_t))) == NULL) {
-		return error(bErrMemory);
+		return openFailed(h, error(bErrMemory));
+	}
+
+	/* hash table with a power of 2 number of slots, one per buffer or more */
+	for (hashCt = 1; hashCt < (unsigned int) bufCt; hashCt <<= 1) {}
+
+	if ((h->bufHash = calloc(hashCt, sizeof(ion_bpp_buffer_t *))) == NULL) {
+		return openFailed(h, error(bErrMemory));
+	}
+
+	h->hashMask		= hashCt - 1;
+	h->clockHand	= 0;
+
+	/* write back when this many buffers are modified, or a modified one is reused */
+	h->dirtyCt = 0;
+	bSetDirtyMax(h, info.dirtyMax);
+
+	/* pool and root */
+	if ((h->dirty = malloc((bufCt + 1) * sizeof(ion_bpp_buffer_t *))) == NULL) {
+		return openFailed(h, error(bErrMemory));
+	}
+
+	/* coalescing needs room for at least two nodes */
+	h->wbufSize = ION_BPP_WRITE_BACK;
+
+	if (h->compress || (h->wbufSize < 2 * h->nodeSize)) {
+		h->wbufSize = 0;
+	}
+	else if ((h->wbuf = malloc(h->wbufSize)) == NULL) {
+		return openFailed(h, error(bErrMemory));
 	}
 
 	buf = h->malloc1;
@@ -903,62 +1561,69 @@ bOpen(
 	/*
 	 * Allocate bufs.
 	 * We need space for the following:
-	 *  - bufCt buffers, of size sectorSize
-	 *  - 1 buffer for root, of size 3*sectorSize
-	 *  - 1 buffer for gbuf, size 3*sectorsize + 2 extra keys
+	 *  - bufCt buffers, of size nodeSize
+	 *  - 1 buffer for root, of size 3*nodeSize
+	 *  - 1 buffer for gbuf, size 3*nodeSize + 2 extra keys
 	 *	to allow for LT pointers in last 2 nodes when gathering 3 full nodes
+	 *  - ebuf, for a compressed root
 	*/
-	if ((h->malloc2 = malloc((bufCt + 6) * h->sectorSize + 2 * h->ks)) == NULL) {
-		return error(bErrMemory);
+	if ((h->malloc2 = malloc((bufCt + 6) * h->nodeSize + 2 * h->ks + ebufSize)) == NULL) {
+		return openFailed(h, error(bErrMemory));
 	}
 
-	for (i = 0; i < (bufCt + 6) * h->sectorSize + 2 * h->ks; i++) {
+	for (i = 0; i < (bufCt + 6) * h->nodeSize + 2 * h->ks + ebufSize; i++) {
 		((char *) h->malloc2)[i] = 0;
 	}
 
 	p				= h->malloc2;
 
-	/* initialize buflist */
-	h->bufList.next = buf;
-	h->bufList.prev = buf + (bufCt - 1);
-
+	/* initialize buffer pool */
 	for (i = 0; i < bufCt; i++) {
-		buf->next		= buf + 1;
-		buf->prev		= buf - 1;
+		buf->hashNext	= NULL;
+		buf->adr		= -1;
 		buf->modified	= boolean_false;
 		buf->valid		= boolean_false;
+		buf->referenced = boolean_false;
 		buf->p			= p;
-		p				= (ion_bpp_node_t *) ((char *) p + h->sectorSize);
+		p				= (ion_bpp_node_t *) ((char *) p + h->nodeSize);
 		buf++;
 	}
 
-	h->bufList.next->prev	= &h->bufList;
-	h->bufList.prev->next	= &h->bufList;
-
 	/* initialize root */
-	root					= &h->root;
-	root->p					= p;
-	p						= (ion_bpp_node_t *) ((char *) p + 3 * h->sectorSize);
-	h->gbuf.p				= p;/* done last to include extra 2 keys */
+	root		= &h->root;
+	root->p		= p;
+	p			= (ion_bpp_node_t *) ((char *) p + 3 * h->nodeSize);
+	h->gbuf.p	= p;
+	h->ebuf		= (char *) p + 3 * h->nodeSize + 2 * h->ks;
 
 	h->curBuf				= NULL;
 	h->curKey				= NULL;
 
 	/* initialize root */
-	if (ion_fexists(info.iName)) {
+	if (exists) {
 		/* open an existing database */
-		h->fp = ion_fopen(info.iName);
+		h->freeAdr = hdr.freeAdr;
 
 		if ((rc = readDisk(h, 0, &root)) != 0) {
-			return rc;
+			return openFailed(h, rc);
 		}
 
 		if (ion_fseek(h->fp, 0, ION_FILE_END)) {
-			return error(bErrIO);
+			return openFailed(h, error(bErrIO));
 		}
 
 		if ((h->nextFreeAdr = ion_ftell(h->fp)) == -1) {
-			return error(bErrIO);
+			return openFailed(h, error(bErrIO));
+		}
+
+		/* node addresses don't count the header, and */
+		/* the last node of a compressed index may be short */
+		h->nextFreeAdr	-= fileAdr(0);
+		h->nextFreeAdr	= (h->nextFreeAdr + h->nodeSize - 1) / h->nodeSize * h->nodeSize;
+
+		/* a short compressed root still has all 3 nodes */
+		if (h->nextFreeAdr < 3 * h->nodeSize) {
+			h->nextFreeAdr = 3 * h->nodeSize;
 		}
 	}
 
@@ -969,16 +1634,17 @@ bOpen(
 	else if (NULL != (h->fp = ion_fopen(info.iName))) {
 #endif
 		/* initialize root */
-		memset(root->p, 0, 3 * h->sectorSize);
+		memset(root->p, 0, 3 * h->nodeSize);
 		leaf(root)		= 1;
-		h->nextFreeAdr	= 3 * h->sectorSize;
+		h->nextFreeAdr	= 3 * h->nodeSize;
+		h->freeAdr		= 0;
+		h->hdrModified	= boolean_true;
 		root->modified	= 1;
 		flushAll(h);
 	}
 	else {
 		/* something's wrong */
-		free(h);
-		return bErrFileNotOpen;
+		return openFailed(h, bErrFileNotOpen);
 	}
 
 	*handle = h;
@@ -1008,18 +1674,110 @@ bClose(
 		ion_fclose(h->fp);
 	}
 
-	if (h->malloc2) {
-		free(h->malloc2);
+	freeHandle(h);
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bFlush(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_err_t		rc;			/* return code */
+
+	if ((rc = flushAll(handle)) != 0) {
+		return rc;
 	}
 
-	if (h->malloc1) {
-		free(h->malloc1);
+	if (err_ok != ion_fflush(h->fp)) {
+		return error(bErrIO);
 	}
 
-	free(h);
 	return bErrOk;
 }
 
+ion_bpp_err_t
+bStats(
+	ion_bpp_handle_t	handle,
+	ion_bpp_stats_t		*stats
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	*stats = h->stats;
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bSetDirtyMax(
+	ion_bpp_handle_t	handle,
+	int					dirtyMax
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	if ((dirtyMax <= 0) || (dirtyMax > h->bufCt)) {
+		dirtyMax = h->bufCt;
+	}
+
+	h->dirtyMax = dirtyMax;
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bSetDupKeys(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bool_t		dupKeys
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*root;
+
+	root = &h->root;
+
+	/* keys already placed depend on the mode */
+	if (!leaf(root) || ct(root)) {
+		return bErrNotEmpty;
+	}
+
+	h->dupKeys		= dupKeys;
+	h->hdrModified	= boolean_true;
+	return bErrOk;
+}
+
+ion_bpp_bool_t
+bDupKeys(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	return h->dupKeys;
+}
+
+int
+bSectorSize(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	return h->sectorSize;
+}
+
+ion_bpp_bool_t
+bCompressed(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	return h->compress;
+}
+
+int
+bBufferCount(
+	ion_bpp_handle_t handle
+) {
+	ion_bpp_h_node_t *h = handle;
+
+	return h->bufCt;
+}
+
 ion_bpp_err_t
 bFindKey(
 	ion_bpp_handle_t			handle,
@@ -1029,6 +1787,7 @@ bFindKey(
 	ion_bpp_key_t		*mkey;			/* matched key */
 	ion_bpp_buffer_t	*buf;				/* buffer */
 	ion_bpp_err_t		rc;			/* return code */
+	int					cc;		/* condition code */
 
 	ion_bpp_h_node_t *h = handle;
 
@@ -1037,18 +1796,36 @@ bFindKey(
 	/* find key, and return address */
 	while (1) {
 		if (leaf(buf)) {
-			if (search(handle, buf, key, 0, &mkey, MODE_FIRST) == 0) {
-				*rec		= rec(mkey);
-				h->curBuf	= buf;
-				h->curKey	= mkey;
-				return bErrOk;
-			}
-			else {
-				return bErrKeyNotFound;
+			if (search(handle, buf, key, 0, &mkey, MODE_FIRST) != 0) {
+				/*
+				 * Duplicates of key may start in the next leaf, as
+				 * the descent stops left of a separator equal to key.
+				*/
+				if (!h->dupKeys || !next(buf) || (0 == ct(buf)) || (h->comp(key, key(lkey(buf)), (ion_key_size_t) (h->keySize)) <= 0)) {
+					return bErrKeyNotFound;
+				}
+
+				if ((rc = readDisk(handle, next(buf), &buf)) != 0) {
+					return rc;
+				}
+
+				mkey = fkey(buf);
+
+				if ((0 == ct(buf)) || (h->comp(key, key(mkey), (ion_key_size_t) (h->keySize)) != 0)) {
+					return bErrKeyNotFound;
+				}
 			}
+
+			*rec		= rec(mkey);
+			h->curBuf	= buf;
+			h->curKey	= mkey;
+			return bErrOk;
 		}
 		else {
-			if (search(handle, buf, key, 0, &mkey, MODE_FIRST) < 0) {
+			cc = search(handle, buf, key, 0, &mkey, MODE_FIRST);
+
+			/* with duplicates, keys equal to a separator may lie left of it */
+			if ((cc < 0) || ((0 == cc) && h->dupKeys)) {
 				if ((rc = readDisk(handle, childLT(mkey), &buf)) != 0) {
 					return rc;
 				}
@@ -1158,8 +1935,8 @@ bInsertKey(
 		if (leaf(buf)) {
 			/* in leaf, and there' room guaranteed */
 
-			if (height > maxHeight) {
-				maxHeight = height;
+			if (height > h->stats.maxHeight) {
+				h->stats.maxHeight = height;
 			}
 
 			/* set mkey to point to insertion point */
@@ -1200,7 +1977,7 @@ bInsertKey(
 			childGE(mkey)	= 0;
 			ct(buf)++;
 
-			if ((rc = writeDisk(buf)) != 0) {
+			if ((rc = writeDisk(handle, buf)) != 0) {
 				return rc;
 			}
 
@@ -1213,17 +1990,16 @@ bInsertKey(
 					return rc;
 				}
 
-				/* tkey = fkey(tbuf) + lastGEkey; */
-				tkey		= fkey(tbuf);
+				tkey		= fkey(tbuf) + lastGEkey;
 				memcpy(key(tkey), key, h->keySize);
 				rec(tkey)	= rec;
 
-				if ((rc = writeDisk(tbuf)) != 0) {
+				if ((rc = writeDisk(handle, tbuf)) != 0) {
 					return rc;
 				}
 			}
 
-			nKeysIns++;
+			h->stats.nKeysIns++;
 			break;
 		}
 		else {
@@ -1328,8 +2104,8 @@ bUpdateKey(
 		if (leaf(buf)) {
 			/* in leaf, and there' room guaranteed */
 
-			if (height > maxHeight) {
-				maxHeight = height;
+			if (height > h->stats.maxHeight) {
+				h->stats.maxHeight = height;
 			}
 
 			/* set mkey to point to update point */
@@ -1348,6 +2124,11 @@ bUpdateKey(
 
 			/* update key */
 			rec(mkey) = rec;
+
+			if ((rc = writeDisk(handle, buf)) != 0) {
+				return rc;
+			}
+
 			break;
 		}
 		else {
@@ -1418,6 +2199,7 @@ bDeleteKey(
 	unsigned int		lastGEkey;	/* last childGE key traversed */
 	ion_bpp_buffer_t	*root;
 	ion_bpp_buffer_t	*gbuf;
+	int					i;
 
 	ion_bpp_h_node_t *h = handle;
 
@@ -1448,7 +2230,7 @@ bDeleteKey(
 
 			ct(buf)--;
 
-			if ((rc = writeDisk(buf)) != 0) {
+			if ((rc = writeDisk(handle, buf)) != 0) {
 				return rc;
 			}
 
@@ -1465,12 +2247,12 @@ bDeleteKey(
 				memcpy(key(tkey), mkey, h->keySize);
 				rec(tkey)	= rec(mkey);
 
-				if ((rc = writeDisk(tbuf)) != 0) {
+				if ((rc = writeDisk(handle, tbuf)) != 0) {
 					return rc;
 				}
 			}
 
-			nKeysDel++;
+			h->stats.nKeysDel++;
 			break;
 		}
 		else {
@@ -1500,7 +2282,15 @@ bDeleteKey(
 				if ((buf == root) && (ct(root) == 2) && (ct(gbuf) < (3 * (3 * h->maxCt)) / 4)) {
 					/* collapse tree by one level */
 					scatterRoot(handle);
-					nNodesDel += 3;
+
+					for (i = 0; i < 3; i++) {
+						if ((rc = freeAdr(handle, tmp[i])) != 0) {
+							return rc;
+						}
+					}
+
+					h->stats.nNodesDel += 3;
+					h->stats.nJoins++;
 					continue;
 				}
 
@@ -1544,59 +2334,555 @@ bDeleteKey(
 	return bErrOk;
 }
 
-ion_bpp_err_t
-bFindFirstKey(
-	ion_bpp_handle_t			handle,
-	void						*key,
-	ion_bpp_external_address_t	*rec
-) {
-	ion_bpp_err_t		rc;			/* return code */
-	ion_bpp_buffer_t	*buf;				/* buffer */
+/*
+ * Bulk load builds the tree bottom-up from keys supplied in order.
+ * Each level keeps its last two nodes in memory; when a third is
+ * started, the oldest is written and its lowest key is passed up to
+ * the parent level.  At the end the last two nodes of each level are
+ * balanced so neither is less than half full, and the top level is
+ * placed in the root.
+*/
 
-	ion_bpp_h_node_t *h = handle;
+/* deepest tree bulk load will build */
+#define ION_BPP_MAX_LEVELS 16
 
-	buf = &h->root;
+typedef struct {
+	ion_bpp_buffer_t	buf[2];	/* previous and current node */
+	ion_bpp_key_t		*low[2];/* lowest key, and rec, under each node */
+	int					nodeCt;	/* nodes started on this level */
+	void				*malloc1;	/* malloc'd resources */
+} ion_bpp_level_t;
 
-	while (!leaf(buf)) {
-		if ((rc = readDisk(handle, childLT(fkey(buf)), &buf)) != 0) {
-			return rc;
+typedef struct {
+	ion_bpp_level_t		level[ION_BPP_MAX_LEVELS];
+	int					height;	/* levels in use */
+	int					fillCt;	/* keys placed in each node */
+	ion_bpp_address_t	*adrs;	/* sectors allocated, freed again if the load fails */
+	int					adrCt;	/* sectors in adrs */
+	int					adrMax;	/* room in adrs */
+} ion_bpp_bulk_t;
+
+static ion_bpp_err_t
+bulkAlloc(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bulk_t		*bulk,
+	ion_bpp_address_t	*adr
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_address_t	*adrs;
+	ion_bpp_err_t		rc;			/* return code */
+
+	/* allocate a sector, remembering it in case the load fails */
+	if (bulk->adrCt == bulk->adrMax) {
+		if ((adrs = realloc(bulk->adrs, (2 * bulk->adrMax + 16) * sizeof(ion_bpp_address_t))) == NULL) {
+			return error(bErrMemory);
 		}
+
+		bulk->adrs		= adrs;
+		bulk->adrMax	= 2 * bulk->adrMax + 16;
 	}
 
-	if (ct(buf) == 0) {
-		return bErrKeyNotFound;
+	if ((rc = allocAdr(handle, adr)) != 0) {
+		return rc;
 	}
 
-	memcpy(key, key(fkey(buf)), h->keySize);
-	*rec		= rec(fkey(buf));
-	h->curBuf	= buf;
-	h->curKey	= fkey(buf);
+	bulk->adrs[bulk->adrCt++] = *adr;
 	return bErrOk;
 }
 
-/*
- * input:
- *   handle				 handle returned by bOpen
- * output:
- *   key					last key in sequential set
- *   rec					record address
- * returns:
- *   bErrOk				 operation successful
- *   bErrKeyNotFound		key not found
-*/
+static ion_bpp_err_t
+bulkAdd(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bulk_t		*bulk,
+	int					level,
+	ion_bpp_key_t		*ekey,
+	ion_bpp_address_t	child
+);
 
-ion_bpp_err_t
-bFindLastKey(
-	ion_bpp_handle_t			handle,
-	void						*key,
-	ion_bpp_external_address_t	*rec
+static ion_bpp_err_t
+bulkWrite(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bulk_t		*bulk,
+	int					level,
+	int					i,
+	ion_bpp_bool_t		last
 ) {
-	ion_bpp_err_t		rc;			/* return code */
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_level_t		*lv;
+	ion_bpp_buffer_t	*node;	/* node image */
+	ion_bpp_buffer_t	*cur;				/* current node */
 	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_err_t		rc;			/* return code */
 
-	ion_bpp_h_node_t *h = handle;
+	/* write node i of level, and pass its lowest key to the parent */
+	lv		= &bulk->level[level];
+	node	= &lv->buf[i];
+	cur		= &lv->buf[1];
 
-	buf = &h->root;
+	if (!node->adr && ((rc = bulkAlloc(handle, bulk, &node->adr)) != 0)) {
+		return rc;
+	}
+
+	if (leaf(node) && !last) {
+		/* link to the following leaf */
+		if (!cur->adr && ((rc = bulkAlloc(handle, bulk, &cur->adr)) != 0)) {
+			return rc;
+		}
+
+		next(node)	= cur->adr;
+		prev(cur)	= node->adr;
+	}
+
+	if ((rc = bulkAdd(handle, bulk, level + 1, lv->low[i], node->adr)) != 0) {
+		return rc;
+	}
+
+	if ((rc = assignBuf(handle, node->adr, &buf)) != 0) {
+		return rc;
+	}
+
+	memcpy(buf->p, node->p, h->nodeSize);
+	h->stats.nNodesIns++;
+	return writeDisk(handle, buf);
+}
+
+static ion_bpp_err_t
+bulkAdd(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bulk_t		*bulk,
+	int					level,
+	ion_bpp_key_t		*ekey,
+	ion_bpp_address_t	child
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_level_t		*lv;
+	ion_bpp_buffer_t	*cur;				/* current node */
+	ion_bpp_buffer_t	tbuf;
+	ion_bpp_key_t		*tkey;
+	ion_bpp_key_t		*k;
+	ion_bpp_err_t		rc;			/* return code */
+
+	/* add key and rec to level; child is its childGE on internal levels */
+	lv = &bulk->level[level];
+
+	if (level == bulk->height) {
+		/* start a new level */
+		if (level == ION_BPP_MAX_LEVELS) {
+			return error(bErrMemory);
+		}
+
+		if ((lv->malloc1 = malloc(2 * h->nodeSize + 2 * h->ks)) == NULL) {
+			return error(bErrMemory);
+		}
+
+		lv->buf[0].p	= lv->malloc1;
+		lv->buf[1].p	= (ion_bpp_node_t *) ((char *) lv->buf[0].p + h->nodeSize);
+		lv->low[0]		= (char *) lv->buf[1].p + h->nodeSize;
+		lv->low[1]		= lv->low[0] + h->ks;
+		lv->nodeCt		= 0;
+		bulk->height++;
+	}
+
+	cur = &lv->buf[1];
+
+	if ((lv->nodeCt == 0) || (ct(cur) == bulk->fillCt)) {
+		if (lv->nodeCt > 1) {
+			/* two nodes in memory, write the older */
+			if ((rc = bulkWrite(handle, bulk, level, 0, boolean_false)) != 0) {
+				return rc;
+			}
+		}
+
+		if (lv->nodeCt > 0) {
+			/* current node becomes previous */
+			tbuf		= lv->buf[0];
+			lv->buf[0]	= lv->buf[1];
+			lv->buf[1]	= tbuf;
+			tkey		= lv->low[0];
+			lv->low[0]	= lv->low[1];
+			lv->low[1]	= tkey;
+		}
+
+		/* start a new node */
+		memset(cur->p, 0, h->nodeSize);
+		leaf(cur)	= (0 == level);
+		cur->adr	= 0;
+		memcpy(lv->low[1], ekey, h->keySize + sizeof(ion_bpp_external_address_t));
+		lv->nodeCt++;
+
+		if (level > 0) {
+			/* first child goes to the left of all keys */
+			childLT(fkey(cur)) = child;
+			return bErrOk;
+		}
+	}
+
+	k			= fkey(cur) + ks(ct(cur));
+	memcpy(key(k), ekey, h->keySize);
+	rec(k)		= rec(ekey);
+	childGE(k)	= child;
+	ct(cur)++;
+	return bErrOk;
+}
+
+static ion_bpp_bool_t
+bulkBalance(
+	ion_bpp_handle_t	handle,
+	ion_bpp_level_t		*lv
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*prev;				/* previous node */
+	ion_bpp_buffer_t	*cur;				/* current node */
+	ion_bpp_key_t		*pkey;			/* first key moved from prev */
+	ion_bpp_address_t	lt;		/* childLT of cur */
+	ion_bpp_buffer_t	tbuf;
+	int					total;	/* keys in both nodes, with separator */
+	int					n;		/* keys to move from prev to cur */
+
+	/* bring the last node on a level up to half full, */
+	/* returning false if it was joined to the previous node */
+	prev	= &lv->buf[0];
+	cur		= &lv->buf[1];
+
+	if (lv->nodeCt < 2) {
+		return boolean_false;
+	}
+
+	if (ct(cur) >= h->maxCt / 2) {
+		return boolean_true;
+	}
+
+	total = ct(prev) + ct(cur) + !leaf(cur);
+
+	if (total <= (int) h->maxCt) {
+		/* join cur to prev */
+		pkey = fkey(prev) + ks(ct(prev));
+
+		if (!leaf(cur)) {
+			/* separator */
+			memcpy(pkey, lv->low[1], h->keySize + sizeof(ion_bpp_external_address_t));
+			childGE(pkey)	= childLT(fkey(cur));
+			pkey			+= ks(1);
+		}
+
+		memcpy(pkey, fkey(cur), ks(ct(cur)));
+		ct(prev)	= total;
+
+		/* joined node is now the last on the level */
+		tbuf		= lv->buf[1];
+		lv->buf[1]	= lv->buf[0];
+		lv->buf[0]	= tbuf;
+		pkey		= lv->low[1];
+		lv->low[1]	= lv->low[0];
+		lv->low[0]	= pkey;
+		return boolean_false;
+	}
+
+	/* split evenly */
+	n		= (total - !leaf(cur)) / 2 - ct(cur);
+	pkey	= fkey(prev) + ks(ct(prev) - n);
+
+	if (leaf(cur)) {
+		memmove(fkey(cur) + ks(n), fkey(cur), ks(ct(cur)));
+		memcpy(fkey(cur), pkey, ks(n));
+		memcpy(lv->low[1], fkey(cur), h->keySize + sizeof(ion_bpp_external_address_t));
+	}
+	else {
+		/* rotate keys through the separator */
+		lt = childLT(fkey(cur));
+		memmove(fkey(cur) + ks(n), fkey(cur), ks(ct(cur)));
+		memcpy(fkey(cur) + ks(n - 1), lv->low[1], h->keySize + sizeof(ion_bpp_external_address_t));
+		childGE(fkey(cur) + ks(n - 1)) = lt;
+		memcpy(fkey(cur), pkey + ks(1), ks(n - 1));
+		childLT(fkey(cur)) = childGE(pkey);
+		memcpy(lv->low[1], pkey, h->keySize + sizeof(ion_bpp_external_address_t));
+	}
+
+	ct(prev)	-= n;
+	ct(cur)		+= n;
+	return boolean_true;
+}
+
+static ion_bpp_err_t
+bulkRoot(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bulk_t		*bulk,
+	ion_bpp_level_t		*lv
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_buffer_t	*root;
+	ion_bpp_buffer_t	*top;				/* only node on level */
+	ion_bpp_buffer_t	*node[2];	/* nodes placed in root */
+	ion_bpp_key_t		*sep;			/* key separating them */
+	ion_bpp_key_t		*rkey;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_err_t		rc;			/* return code */
+	int					n;		/* number of nodes */
+	int					i;
+	int					j;
+
+	root	= &h->root;
+	top		= &lv->buf[1];
+	sep		= lv->low[1];
+
+	if (lv->nodeCt > 1) {
+		node[0] = &lv->buf[0];
+		node[1] = top;
+		n		= 2;
+	}
+	else if (!leaf(top) && (ct(top) == 1)) {
+		/* root needs 2 keys to gather from, so join its children */
+		if ((rc = readDisk(handle, childLT(fkey(top)), &buf)) != 0) {
+			return rc;
+		}
+
+		node[0] = &lv->buf[0];
+		memcpy(node[0]->p, buf->p, h->nodeSize);
+		node[0]->adr = buf->adr;
+
+		if ((rc = readDisk(handle, childGE(fkey(top)), &buf)) != 0) {
+			return rc;
+		}
+
+		/* separator is the one key of the old top */
+		memcpy(lv->low[0], fkey(top), h->keySize + sizeof(ion_bpp_external_address_t));
+		sep		= lv->low[0];
+		node[1] = top;
+		memcpy(node[1]->p, buf->p, h->nodeSize);
+		node[1]->adr = buf->adr;
+		n		= 2;
+
+		for (i = 0; i < 2; i++) {
+			if ((rc = readDisk(handle, node[i]->adr, &buf)) != 0) {
+				return rc;
+			}
+
+			/* already free, so not freed again if the load fails */
+			for (j = 0; j < bulk->adrCt; j++) {
+				if (bulk->adrs[j] == buf->adr) {
+					bulk->adrs[j] = 0;
+				}
+			}
+
+			if ((rc = freeAdr(handle, buf)) != 0) {
+				return rc;
+			}
+
+			h->stats.nNodesDel++;
+		}
+	}
+	else {
+		node[0]	= top;
+		n		= 1;
+	}
+
+	/* place the top nodes in root */
+	memset(root->p, 0, 3 * h->nodeSize);
+	leaf(root)				= leaf(node[0]);
+	childLT(fkey(root))		= childLT(fkey(node[0]));
+	memcpy(fkey(root), fkey(node[0]), ks(ct(node[0])));
+	ct(root)				= ct(node[0]);
+
+	if (n > 1) {
+		rkey = fkey(root) + ks(ct(root));
+
+		if (!leaf(root)) {
+			memcpy(rkey, sep, h->keySize + sizeof(ion_bpp_external_address_t));
+			childGE(rkey)	= childLT(fkey(node[1]));
+			rkey			+= ks(1);
+			ct(root)++;
+		}
+
+		memcpy(rkey, fkey(node[1]), ks(ct(node[1])));
+		ct(root) += ct(node[1]);
+	}
+
+	return writeDisk(handle, root);
+}
+
+ion_bpp_err_t
+bBulkLoad(
+	ion_bpp_handle_t	handle,
+	int					fillFactor,
+	ion_bpp_bulk_next_t source,
+	void				*arg
+) {
+	ion_bpp_h_node_t			*h = handle;
+	ion_bpp_buffer_t			*root;
+	ion_bpp_buffer_t			*buf;				/* buffer */
+	ion_bpp_bulk_t				*bulk;
+	ion_bpp_stats_t				stats;	/* statistics before the load */
+	ion_bpp_key_t				*ekey;			/* key entry from caller */
+	ion_bpp_key_t				*lastKey;	/* previous key entry */
+	ion_bpp_external_address_t	rec;
+	ion_bpp_err_t				rc;			/* return code */
+	ion_bpp_bool_t				first;
+	int							level;
+	int							cc;		/* condition code */
+	int							i;
+
+	root = &h->root;
+
+	if (!leaf(root) || ct(root)) {
+		return bErrNotEmpty;
+	}
+
+	if ((bulk = calloc(1, sizeof(ion_bpp_bulk_t) + 2 * h->ks)) == NULL) {
+		return error(bErrMemory);
+	}
+
+	ekey	= (ion_bpp_key_t *) (bulk + 1);
+	lastKey = ekey + h->ks;
+
+	/* keys per node */
+	if ((fillFactor <= 0) || (fillFactor > 100)) {
+		fillFactor = 100;
+	}
+
+	bulk->fillCt = (h->maxCt * fillFactor) / 100;
+
+	if (bulk->fillCt < (int) h->maxCt / 2) {
+		bulk->fillCt = h->maxCt / 2;
+	}
+
+	first		= boolean_true;
+	h->curBuf	= NULL;
+	stats		= h->stats;
+
+	while ((rc = source(arg, key(ekey), &rec)) == bErrOk) {
+		rec(ekey) = rec;
+
+		if (!first) {
+			/* keys must ascend; equal keys need dupKeys and ascending recs */
+			cc = ccOf(h->comp(key(ekey), key(lastKey), h->keySize));
+
+			if ((cc == ION_CC_EQ) && h->dupKeys) {
+				cc = (rec > rec(lastKey)) ? ION_CC_GT : ION_CC_LT;
+			}
+
+			if (cc != ION_CC_GT) {
+				rc = (cc == ION_CC_EQ) ? bErrDupKeys : bErrKeyOrder;
+				break;
+			}
+		}
+
+		if ((rc = bulkAdd(handle, bulk, 0, ekey, 0)) != 0) {
+			break;
+		}
+
+		memcpy(lastKey, ekey, h->ks);
+		first = boolean_false;
+		h->stats.nKeysIns++;
+	}
+
+	if (rc == bErrKeyNotFound) {
+		/* end of input, write out what remains bottom up */
+		rc = bErrOk;
+
+		for (level = 0; rc == bErrOk && level < bulk->height; level++) {
+			ion_bpp_level_t *lv = &bulk->level[level];
+
+			if (level == bulk->height - 1) {
+				rc = bulkRoot(handle, bulk, lv);
+
+				if (level > h->stats.maxHeight) {
+					h->stats.maxHeight = level;
+				}
+			}
+			else {
+				if (bulkBalance(handle, lv)) {
+					rc = bulkWrite(handle, bulk, level, 0, boolean_false);
+				}
+
+				if (rc == bErrOk) {
+					rc = bulkWrite(handle, bulk, level, 1, boolean_true);
+				}
+			}
+		}
+	}
+
+	if (rc != bErrOk) {
+		/* put the sectors written back on the free list, and leave the tree empty */
+		for (i = 0; i < bulk->adrCt; i++) {
+			if (bulk->adrs[i] && (assignBuf(handle, bulk->adrs[i], &buf) == 0)) {
+				memset(buf->p, 0, h->nodeSize);
+				freeAdr(handle, buf);
+			}
+		}
+
+		memset(root->p, 0, 3 * h->nodeSize);
+		leaf(root) = 1;
+		writeDisk(handle, root);
+
+		/* none of the keys or nodes were added */
+		h->stats.maxHeight	= stats.maxHeight;
+		h->stats.nNodesIns	= stats.nNodesIns;
+		h->stats.nNodesDel	= stats.nNodesDel;
+		h->stats.nKeysIns	= stats.nKeysIns;
+	}
+
+	for (level = 0; level < bulk->height; level++) {
+		free(bulk->level[level].malloc1);
+	}
+
+	free(bulk->adrs);
+	free(bulk);
+	return rc;
+}
+
+ion_bpp_err_t
+bFindFirstKey(
+	ion_bpp_handle_t			handle,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+) {
+	ion_bpp_err_t		rc;			/* return code */
+	ion_bpp_buffer_t	*buf;				/* buffer */
+
+	ion_bpp_h_node_t *h = handle;
+
+	buf = &h->root;
+
+	while (!leaf(buf)) {
+		if ((rc = readDisk(handle, childLT(fkey(buf)), &buf)) != 0) {
+			return rc;
+		}
+	}
+
+	if (ct(buf) == 0) {
+		return bErrKeyNotFound;
+	}
+
+	memcpy(key, key(fkey(buf)), h->keySize);
+	*rec		= rec(fkey(buf));
+	h->curBuf	= buf;
+	h->curKey	= fkey(buf);
+	return bErrOk;
+}
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * output:
+ *   key					last key in sequential set
+ *   rec					record address
+ * returns:
+ *   bErrOk				 operation successful
+ *   bErrKeyNotFound		key not found
+*/
+
+ion_bpp_err_t
+bFindLastKey(
+	ion_bpp_handle_t			handle,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+) {
+	ion_bpp_err_t		rc;			/* return code */
+	ion_bpp_buffer_t	*buf;				/* buffer */
+
+	ion_bpp_h_node_t *h = handle;
+
+	buf = &h->root;
 
 	while (!leaf(buf)) {
 		if ((rc = readDisk(handle, childGE(lkey(buf)), &buf)) != 0) {
@@ -1713,3 +2999,285 @@ bFindPrevKey(
 	h->curKey	= pkey;
 	return bErrOk;
 }
+
+/*
+ * A scan walks the leaves in order without disturbing the buffer pool.
+ * It keeps its own copy of the current leaf, so keys are returned from
+ * memory until the leaf is used up.  Leaves not in the pool are read
+ * from a run of nodes read ahead; the run doubles while the leaves
+ * follow one another on disk, as they do after a bulk load.
+*/
+
+typedef struct {
+	ion_bpp_h_node_t	*h;
+	ion_bpp_buffer_t	leaf;			/* copy of current leaf */
+	unsigned int		curKey;	/* index of next key in leaf, or one past it if descending */
+	ion_bpp_bool_t		descending;	/* true if scanning from greatest key down */
+	char				*ahead;			/* nodes read ahead */
+	ion_bpp_address_t	aheadAdr;	/* address of first node in ahead */
+	int					aheadCt;/* number of nodes in ahead */
+	int					aheadMax;	/* most nodes ahead holds */
+	unsigned long		aheadFlushCt;	/* h->flushCt when ahead was read */
+} ion_bpp_scan_node_t;
+
+static unsigned int
+lowerBound(
+	ion_bpp_handle_t	handle,
+	ion_bpp_buffer_t	*buf,
+	void				*key
+) {
+	ion_bpp_h_node_t	*h = handle;
+	unsigned int		lb;		/* lower-bound of binary search */
+	unsigned int		ub;		/* upper-bound of binary search */
+	unsigned int		m;		/* midpoint of search */
+
+	/* number of keys in buf less than key */
+	lb	= 0;
+	ub	= ct(buf);
+
+	while (lb < ub) {
+		m = (lb + ub) / 2;
+
+		if (h->comp(key(fkey(buf) + ks(m)), key, (ion_key_size_t) (h->keySize)) < 0) {
+			lb = m + 1;
+		}
+		else {
+			ub = m;
+		}
+	}
+
+	return lb;
+}
+
+static unsigned int
+upperBound(
+	ion_bpp_handle_t	handle,
+	ion_bpp_buffer_t	*buf,
+	void				*key
+) {
+	ion_bpp_h_node_t	*h = handle;
+	unsigned int		lb;		/* lower-bound of binary search */
+	unsigned int		ub;		/* upper-bound of binary search */
+	unsigned int		m;		/* midpoint of search */
+
+	/* number of keys in buf less than or equal to key */
+	lb	= 0;
+	ub	= ct(buf);
+
+	while (lb < ub) {
+		m = (lb + ub) / 2;
+
+		if (h->comp(key(fkey(buf) + ks(m)), key, (ion_key_size_t) (h->keySize)) <= 0) {
+			lb = m + 1;
+		}
+		else {
+			ub = m;
+		}
+	}
+
+	return lb;
+}
+
+static ion_bpp_err_t
+scanLeaf(
+	ion_bpp_scan_node_t *scan,
+	ion_bpp_address_t	adr
+) {
+	ion_bpp_h_node_t	*h = scan->h;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_address_t	end;	/* address of first sector past the file */
+	ion_bpp_address_t	first;	/* address of first node read */
+	int					n;		/* nodes to read ahead */
+	long				len;	/* bytes to read ahead */
+	ion_bpp_err_t		rc;			/* return code */
+
+	/* copy leaf at adr into scan */
+	if (adr == 0) {
+		memcpy(scan->leaf.p, h->root.p, 3 * h->nodeSize);
+	}
+	else if (((buf = cachedBuf(h, adr)) != NULL) && buf->valid) {
+		memcpy(scan->leaf.p, buf->p, h->nodeSize);
+	}
+	else {
+		if ((scan->aheadFlushCt != h->flushCt) || (adr < scan->aheadAdr) || (adr >= scan->aheadAdr + scan->aheadCt * h->nodeSize)) {
+			/* read ahead more if leaf follows (or precedes, */
+			/* if descending) the last run */
+			n = 1;
+
+			if ((scan->aheadCt > 0) && (scan->descending ? (adr + (scan->aheadCt + 1) * h->nodeSize >= scan->aheadAdr) : (adr <= scan->aheadAdr + (scan->aheadCt + 1) * h->nodeSize))) {
+				n = 2 * scan->aheadCt;
+
+				if (n > scan->aheadMax) {
+					n = scan->aheadMax;
+				}
+			}
+
+			/* a descending run ends at adr, and starts after the root */
+			first = adr;
+
+			if (scan->descending) {
+				if (adr - (n - 1) * h->nodeSize < 3 * h->nodeSize) {
+					n = (adr < 3 * h->nodeSize) ? 1 : (adr - 3 * h->nodeSize) / h->nodeSize + 1;
+				}
+
+				first = adr - (n - 1) * h->nodeSize;
+			}
+
+			len = n * h->nodeSize;
+
+			if ((n > 1) || h->compress) {
+				/* don't read past the end of the file, where the */
+				/* last node of a compressed index may be short */
+				end = ion_fend(h->fp) - fileAdr(0);
+
+				if (end - first < len) {
+					len = end - first;
+					n	= (len + h->nodeSize - 1) / h->nodeSize;
+				}
+			}
+
+			if (err_ok != ion_fread_at(h->fp, fileAdr(first), len, (ion_byte_t *) scan->ahead)) {
+				scan->aheadCt = 0;
+				return error(bErrIO);
+			}
+
+			scan->aheadAdr		= first;
+			scan->aheadCt		= n;
+			scan->aheadFlushCt	= h->flushCt;
+			h->stats.nDiskReads++;
+		}
+
+		if (!h->compress) {
+			memcpy(scan->leaf.p, scan->ahead + (adr - scan->aheadAdr), h->nodeSize);
+		}
+		else if ((rc = decodeNode(h, scan->ahead + (adr - scan->aheadAdr), h->maxCt, &scan->leaf)) != 0) {
+			scan->aheadCt = 0;
+			return rc;
+		}
+	}
+
+	scan->leaf.adr	= adr;
+	scan->curKey	= scan->descending ? scan->leaf.p->ct : 0;
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bScanOpen(
+	ion_bpp_handle_t	handle,
+	void				*key,
+	ion_bpp_bool_t		descending,
+	ion_bpp_scan_t		*scan
+) {
+	ion_bpp_h_node_t	*h = handle;
+	ion_bpp_scan_node_t *s;
+	ion_bpp_buffer_t	*buf;				/* buffer */
+	ion_bpp_err_t		rc;			/* return code */
+	unsigned int		i;
+	int					aheadMax;	/* most nodes read ahead */
+
+	aheadMax = ION_BPP_READ_AHEAD / h->nodeSize;
+
+	if (aheadMax < 1) {
+		aheadMax = 1;
+	}
+
+	/* scan struct, leaf with room for root, nodes read ahead */
+	if ((s = calloc(1, sizeof(ion_bpp_scan_node_t) + (3 + aheadMax) * h->nodeSize)) == NULL) {
+		return error(bErrMemory);
+	}
+
+	s->aheadMax		= aheadMax;
+	s->descending	= descending;
+
+	s->h			= h;
+	s->leaf.p	= (ion_bpp_node_t *) (s + 1);
+	s->ahead	= (char *) s->leaf.p + 3 * h->nodeSize;
+
+	/* descend to leaf holding first key >= key, */
+	/* or last key <= key if descending */
+	buf			= &h->root;
+
+	while (!leaf(buf)) {
+		if (descending) {
+			i = (NULL == key) ? ct(buf) : upperBound(handle, buf, key);
+		}
+		else {
+			i = (NULL == key) ? 0 : lowerBound(handle, buf, key);
+		}
+
+		if ((rc = readDisk(handle, i ? childGE(fkey(buf) + ks(i - 1)) : childLT(fkey(buf)), &buf)) != 0) {
+			free(s);
+			return rc;
+		}
+	}
+
+	if ((rc = scanLeaf(s, buf->adr)) != 0) {
+		free(s);
+		return rc;
+	}
+
+	if (NULL != key) {
+		s->curKey = descending ? upperBound(handle, &s->leaf, key) : lowerBound(handle, &s->leaf, key);
+	}
+
+	*scan = s;
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bScanNext(
+	ion_bpp_scan_t				scan,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+) {
+	ion_bpp_scan_node_t *s = scan;
+	ion_bpp_h_node_t	*h = s->h;
+	ion_bpp_buffer_t	*leaf;				/* current leaf */
+	ion_bpp_key_t		*k;
+	ion_bpp_err_t		rc;			/* return code */
+
+	leaf = &s->leaf;
+
+	if (s->descending) {
+		while (0 == s->curKey) {
+			/* leaf used up, go to previous */
+			if (!prev(leaf)) {
+				return bErrKeyNotFound;
+			}
+
+			if ((rc = scanLeaf(s, prev(leaf))) != 0) {
+				return rc;
+			}
+		}
+
+		s->curKey--;
+		k = fkey(leaf) + ks(s->curKey);
+	}
+	else {
+		while (s->curKey >= ct(leaf)) {
+			/* leaf used up, go to next */
+			if (!next(leaf)) {
+				return bErrKeyNotFound;
+			}
+
+			if ((rc = scanLeaf(s, next(leaf))) != 0) {
+				return rc;
+			}
+		}
+
+		k = fkey(leaf) + ks(s->curKey);
+		s->curKey++;
+	}
+
+	memcpy(key, key(k), h->keySize);
+	*rec = rec(k);
+	return bErrOk;
+}
+
+ion_bpp_err_t
+bScanClose(
+	ion_bpp_scan_t scan
+) {
+	free(scan);
+	return bErrOk;
+}
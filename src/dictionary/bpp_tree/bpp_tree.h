@@ -41,27 +41,91 @@ typedef char (*ion_bpp_comparison_t)(
  * implementation independent *
  ******************************/
 
-/* statistics */
-int maxHeight;	/* maximum height attained */
-int nNodesIns;	/* number of nodes inserted */
-int nNodesDel;	/* number of nodes deleted */
-int nKeysIns;	/* number of keys inserted */
-int nKeysDel;	/* number of keys deleted */
-int nDiskReads;	/* number of disk reads */
-int nDiskWrites;/* number of disk writes */
-
-/* line number for last IO or memory error */
-int bErrLineNo;
+/* statistics, kept for each open index */
+typedef struct {
+	int				maxHeight;	/* maximum height attained */
+	unsigned long	nNodesIns;	/* number of nodes inserted */
+	unsigned long	nNodesDel;	/* number of nodes deleted */
+	unsigned long	nKeysIns;	/* number of keys inserted */
+	unsigned long	nKeysDel;	/* number of keys deleted */
+	unsigned long	nDiskReads;	/* number of disk reads */
+	unsigned long	nDiskWrites;/* number of disk writes */
+	unsigned long	nBufHits;	/* nodes found in the buffer pool */
+	unsigned long	nBufMisses;	/* nodes not found in the buffer pool */
+	unsigned long	nEvictions;	/* buffers reused for another node */
+	unsigned long	nSplits;/* nodes split to make room for keys */
+	unsigned long	nJoins;	/* nodes joined after keys were deleted */
+	int				errLineNo;	/* line number for first IO or memory error */
+} ion_bpp_stats_t;
 
 typedef ion_boolean_e ion_bpp_bool_t;
 
 /* typedef enum {false, true} bool; */
 typedef enum ION_BPP_ERR {
-	bErrOk, bErrKeyNotFound, bErrDupKeys, bErrSectorSize, bErrFileNotOpen, bErrFileExists, bErrIO, bErrMemory
+	bErrOk, bErrKeyNotFound, bErrDupKeys, bErrSectorSize, bErrFileNotOpen, bErrFileExists, bErrIO, bErrMemory, bErrKeyOrder, bErrNotEmpty
 } ion_bpp_err_t;
 
 typedef void *ion_bpp_handle_t;
 
+typedef void *ion_bpp_scan_t;
+
+/* number of node buffers cached when bOpen() is not given a count */
+#if !defined(ION_BPP_DEFAULT_BUFFER_COUNT)
+#if defined(ARDUINO)
+#define ION_BPP_DEFAULT_BUFFER_COUNT 7
+#else
+#define ION_BPP_DEFAULT_BUFFER_COUNT 64
+#endif
+#endif
+
+/* most bytes of node buffers bOpen() allocates, whatever count it is given */
+#if !defined(ION_BPP_MAX_BUFFER_BYTES)
+#if defined(ARDUINO)
+#define ION_BPP_MAX_BUFFER_BYTES 4096
+#else
+#define ION_BPP_MAX_BUFFER_BYTES (8L * 1024 * 1024)
+#endif
+#endif
+
+/* most bytes a scan reads from disk at once, though always one node */
+#if !defined(ION_BPP_READ_AHEAD)
+#if defined(ARDUINO)
+#define ION_BPP_READ_AHEAD 0
+#else
+#define ION_BPP_READ_AHEAD 65536
+#endif
+#endif
+
+/* most bytes of adjacent modified nodes written back at once, 0 to write nodes singly */
+#if !defined(ION_BPP_WRITE_BACK)
+#if defined(ARDUINO)
+#define ION_BPP_WRITE_BACK 0
+#else
+#define ION_BPP_WRITE_BACK 65536
+#endif
+#endif
+
+/* sector size the dictionary handler creates an index with */
+#if !defined(ION_BPP_DEFAULT_SECTOR_SIZE)
+#if defined(ARDUINO)
+#define ION_BPP_DEFAULT_SECTOR_SIZE 256
+#else
+#define ION_BPP_DEFAULT_SECTOR_SIZE 4096
+#endif
+#endif
+
+/* largest sector size bOpen() accepts */
+#define ION_BPP_MAX_SECTOR_SIZE 65536
+
+/* sectors in a node of a compressed index */
+#if !defined(ION_BPP_COMPRESSED_SECTORS)
+#if defined(ARDUINO)
+#define ION_BPP_COMPRESSED_SECTORS 2
+#else
+#define ION_BPP_COMPRESSED_SECTORS 4
+#endif
+#endif
+
 typedef struct {
 	/* info for bOpen() */
 	char					*iName;	/* name of index file */
@@ -69,8 +133,22 @@ typedef struct {
 	ion_bpp_bool_t			dupKeys;		/* true if duplicate keys allowed */
 	size_t					sectorSize;	/* size of sector on disk */
 	ion_bpp_comparison_t	comp;			/* pointer to compare function */
+	int						bufCt;	/* node buffers to cache, <= 0 for default, capped by ION_BPP_MAX_BUFFER_BYTES */
+	ion_bpp_bool_t			compress;	/* true to prefix compress keys on disk */
+	int						dirtyMax;	/* modified buffers that start a write back, <= 0 for all */
 } ion_bpp_open_t;
 
+/* supplies keys to bBulkLoad() in order, returning:
+ *	bErrOk			  key and rec set
+ *	bErrKeyNotFound	  no more keys
+ *	anything else	  error, load is abandoned
+*/
+typedef ion_bpp_err_t (*ion_bpp_bulk_next_t)(
+	void						*arg,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+);
+
 /***********************
  * function prototypes *
  ***********************/
@@ -88,8 +166,22 @@ bOpen(
  * returns:
  *   bErrOk				 open was successful
  *   bErrMemory			 insufficient memory
- *   bErrSectorSize		 sector size too small or not 0 mod 4
- *   bErrFileNotOpen		unable to open index file
+ *   bErrSectorSize		 sector size too small, too large or not 0 mod 4,
+ *						  or key size differs from existing index
+ *   bErrFileNotOpen		unable to open index file, or file is not an index
+ * notes:
+ *   With info.compress, keys are stored on disk with the prefix they
+ *   share with the key before them removed, and separators are cut
+ *   to the shortest key that still divides their children.  Nodes
+ *   are then ION_BPP_COMPRESSED_SECTORS sectors long, but only the
+ *   sectors holding data are read.  Keys are compared with comp as
+ *   usual, so compression suits keys whose zero bytes sort first,
+ *   such as strings.  An existing index keeps the format and
+ *   sector size it was made with.  Nodes are aligned on disk to
+ *   their size, so a sector size of the system page size gives
+ *   page-sized, page-aligned nodes.  The buffer pool is cut to fit
+ *   in ION_BPP_MAX_BUFFER_BYTES, though never below the few buffers
+ *   an update needs.
 */
 
 ion_bpp_err_t
@@ -104,6 +196,123 @@ bClose(
  *   bErrOk				 file closed, resources deleted
 */
 
+ion_bpp_err_t
+bFlush(
+	ion_bpp_handle_t handle
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * returns:
+ *   bErrOk				 modified nodes and header written to the file
+ *   bErrIO				 write failed
+ * notes:
+ *   Modified nodes are kept in the buffer pool, and written when
+ *   info.dirtyMax of them are modified, when a modified one is
+ *   reused, and by bFlush and bClose.  All are then written at
+ *   once, in address order, with runs of adjacent nodes of up to
+ *   ION_BPP_WRITE_BACK bytes in a single write.
+*/
+
+ion_bpp_err_t
+bStats(
+	ion_bpp_handle_t	handle,
+	ion_bpp_stats_t		*stats
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * output:
+ *   stats				  statistics of the index since it was opened
+ * returns:
+ *   bErrOk				 stats copied
+*/
+
+ion_bpp_err_t
+bSetDirtyMax(
+	ion_bpp_handle_t	handle,
+	int					dirtyMax
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ *   dirtyMax			   modified buffers that start a write back,
+ *						  <= 0 for the whole pool
+ * returns:
+ *   bErrOk				 threshold changed
+*/
+
+ion_bpp_err_t
+bSetDupKeys(
+	ion_bpp_handle_t	handle,
+	ion_bpp_bool_t		dupKeys
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ *   dupKeys				true to allow duplicate keys
+ * returns:
+ *   bErrOk				 mode changed, kept in the index file
+ *   bErrNotEmpty		   index already has keys
+ * notes:
+ *   An existing index is opened in the mode it was made with,
+ *   whatever info.dupKeys says.
+*/
+
+ion_bpp_bool_t
+bDupKeys(
+	ion_bpp_handle_t handle
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * returns:
+ *   true if the index allows duplicate keys
+*/
+
+int
+bSectorSize(
+	ion_bpp_handle_t handle
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * returns:
+ *   sector size of the index, which may differ from info.sectorSize
+ *   when an existing index was opened
+*/
+
+ion_bpp_bool_t
+bCompressed(
+	ion_bpp_handle_t handle
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * returns:
+ *   true if the index prefix compresses its keys, which may differ
+ *   from info.compress when an existing index was opened
+*/
+
+int
+bBufferCount(
+	ion_bpp_handle_t handle
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ * returns:
+ *   node buffers in the pool, which may differ from info.bufCt
+*/
+
 ion_bpp_err_t
 bInsertKey(
 	ion_bpp_handle_t			handle,
@@ -173,6 +382,33 @@ bDeleteKey(
  *   rec is used to determine which key to delete.
 */
 
+ion_bpp_err_t
+bBulkLoad(
+	ion_bpp_handle_t	handle,
+	int					fillFactor,
+	ion_bpp_bulk_next_t source,
+	void				*arg
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ *   fillFactor			 percent of each node to fill, at least 50
+ *   source				 called for each key, in ascending order
+ *   arg					passed to source
+ * returns:
+ *   bErrOk				 operation successful
+ *   bErrNotEmpty		   index already has keys
+ *   bErrKeyOrder		   key less than the one before it
+ *   bErrDupKeys			key repeated (and info.dupKeys = false)
+ * notes:
+ *   Builds the tree bottom-up, writing each node once.  Values of
+ *   fillFactor out of range mean 100.  If dupKeys is true, keys
+ *   that repeat must have ascending record addresses.  On error
+ *   the index is left empty, with the nodes already written put
+ *   on the free list and the key and node counts as they were.
+*/
+
 ion_bpp_err_t
 bFindKey(
 	ion_bpp_handle_t			handle,
@@ -189,6 +425,8 @@ bFindKey(
  * returns:
  *   bErrOk				 operation successful
  *   bErrKeyNotFound		key not found
+ * notes:
+ *   If dupKeys is true, the first of the duplicates is found.
 */
 
 ion_bpp_err_t
@@ -264,6 +502,64 @@ bFindNextKey(
  *   bErrKeyNotFound		key not found
 */
 
+ion_bpp_err_t
+bScanOpen(
+	ion_bpp_handle_t	handle,
+	void				*key,
+	ion_bpp_bool_t		descending,
+	ion_bpp_scan_t		*scan
+);
+
+/*
+ * input:
+ *   handle				 handle returned by bOpen
+ *   key					first key to return is the least >= key,
+ *						  or NULL to start at the first key
+ *   descending			 true to return keys from greatest to least,
+ *						  starting at the greatest <= key, or at the
+ *						  last key if key is NULL
+ * output:
+ *   scan				   handle to scan, used in bScanNext
+ * returns:
+ *   bErrOk				 operation successful
+ *   bErrMemory			 insufficient memory
+ * notes:
+ *   A scan has its own copy of the current leaf, so scans are
+ *   independent of each other and of bFindNextKey.  The tree must
+ *   not be modified while a scan is open.
+*/
+
+ion_bpp_err_t
+bScanNext(
+	ion_bpp_scan_t				scan,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+);
+
+/*
+ * input:
+ *   scan				   handle returned by bScanOpen
+ * output:
+ *   key					next key in sequential set, or previous
+ *						  key if descending
+ *   rec					record address
+ * returns:
+ *   bErrOk				 operation successful
+ *   bErrKeyNotFound		no more keys
+*/
+
+ion_bpp_err_t
+bScanClose(
+	ion_bpp_scan_t scan
+);
+
+/*
+ * input:
+ *   scan				   handle returned by bScanOpen
+ * returns:
+ *   bErrOk				 scan resources deleted
+*/
+
 #if defined(__cplusplus)
 }
 #endif
@@ -8,12 +8,84 @@
 
 #include "bpp_tree_handler.h"
 
-void
-bpptree_get_value_filename(
-	ion_dictionary_id_t id,
-	char				*str
+/**
+@brief		Opens the index and value files of a B+ tree.
+
+@param		bpptree
+				The B+ tree to open the files for. Its @p buffer_count,
+				@p sector_size, @p write_concern and @p compress must
+				already be set; an existing index replaces the
+				@p sector_size, @p write_concern and @p compress with its
+				own.
+@param		id
+				ID of the dictionary, used to name the files.
+@param		index_ext
+				The extension of the index file.
+@param		value_ext
+				The extension of the value file.
+@param		key_size
+				The size of the key in bytes.
+@param		compare
+				Function pointer for the comparison function for the dictionary.
+@return		The status of opening the files. If they can't be opened,
+			@p tree is left @c NULL and no file is left open.
+*/
+static ion_err_t
+bpptree_open_files(
+	ion_bpptree_t				*bpptree,
+	ion_dictionary_id_t			id,
+	char						*index_ext,
+	char						*value_ext,
+	ion_key_size_t				key_size,
+	ion_dictionary_compare_t	compare
 ) {
-	sprintf(str, "%d.val", id);
+	char			index_filename[ION_MAX_FILENAME_LENGTH];
+	char			value_filename[ION_MAX_FILENAME_LENGTH];
+	ion_bpp_open_t	info;
+
+	if ((dictionary_get_filename(id, index_ext, index_filename) >= ION_MAX_FILENAME_LENGTH) || (dictionary_get_filename(id, value_ext, value_filename) >= ION_MAX_FILENAME_LENGTH)) {
+		return err_dictionary_initialization_failed;
+	}
+
+	/* Until both files are open, the tree has none. */
+	bpptree->tree				= NULL;
+	bpptree->values.file_handle = ion_fopen(value_filename);
+
+/*TODO: Cleanup **/
+#if defined(ARDUINO)
+
+	if (NULL == bpptree->values.file_handle.file) {
+#else
+
+	if (NULL == bpptree->values.file_handle) {
+#endif
+		return err_file_open_error;
+	}
+
+	if (err_ok != lfb_initialize(&(bpptree->values), bpptree->values.file_handle)) {
+		ion_fclose(bpptree->values.file_handle);
+		return err_dictionary_initialization_failed;
+	}
+
+	info.iName		= index_filename;
+	info.keySize	= key_size;
+	info.dupKeys	= wc_duplicate == bpptree->write_concern;
+	info.sectorSize = bpptree->sector_size;
+	info.comp		= compare;
+	info.bufCt		= bpptree->buffer_count;
+	info.dirtyMax	= bpptree->dirty_max;
+	info.compress	= bpptree->compress;
+
+	if (bErrOk != bOpen(info, &(bpptree->tree))) {
+		ion_fclose(bpptree->values.file_handle);
+		return err_dictionary_initialization_failed;
+	}
+
+	bpptree->sector_size	= bSectorSize(bpptree->tree);
+	bpptree->write_concern	= bDupKeys(bpptree->tree) ? wc_duplicate : wc_update;
+	bpptree->compress		= bCompressed(bpptree->tree);
+
+	return err_ok;
 }
 
 /**
@@ -21,7 +93,9 @@ bpptree_get_value_filename(
 
 @details	Creates as instance of a dictionary given a @p key_size and
 			@p value_size, in bytes. The @p dictionary_size parameter is
-			not used for this implementation, as there is no size bound.
+			the number of tree nodes to cache in memory; @c 0 or @c -1
+			selects @ref ION_BPP_DEFAULT_BUFFER_COUNT. The cache is cut to
+			fit in @ref ION_BPP_MAX_BUFFER_BYTES.
 @param		id
 				ID of a dictionary that's given to us.
 @param		key_type
@@ -31,7 +105,7 @@ bpptree_get_value_filename(
 @param		value_size
 				The size of the value in bytes.
 @param		dictionary_size
-				The size of the hashmap in discrete units
+				The number of node buffers to cache.
 @param		compare
 				Function pointer for the comparison function for the dictionary.
 @param		handler
@@ -52,15 +126,13 @@ bpptree_create_dictionary(
 	ion_dictionary_handler_t	*handler,
 	ion_dictionary_t			*dictionary
 ) {
-	UNUSED(dictionary_size);
-
 	/* TODO: Uncomment this when IINQ has been merged into development */
 /*	if (key_size != sizeof(int)) {
 		return err_invalid_initial_size;
 	}*/
 
 	ion_bpptree_t	*bpptree;
-	ion_bpp_open_t	info;
+	ion_err_t		err;
 
 	bpptree = malloc(sizeof(ion_bpptree_t));
 
@@ -68,35 +140,18 @@ bpptree_create_dictionary(
 		return err_out_of_memory;
 	}
 
-	char value_filename[20];
-
-	bpptree_get_value_filename(id, value_filename);
-	bpptree->values.file_handle = ion_fopen(value_filename);
-
-	bpptree->values.next_empty	= ION_FILE_NULL;
-
-	/* FIXME: read this from a property bag. */
-
-	/* FIXME: VARIABLE NAMES! */
-	char addr_filename[ION_MAX_FILENAME_LENGTH];
-
-	int actual_filename_length = dictionary_get_filename(id, "bpt", addr_filename);
-
-	if (actual_filename_length >= ION_MAX_FILENAME_LENGTH) {
-		return err_dictionary_initialization_failed;
-	}
-
-	info.iName		= addr_filename;
-	info.keySize	= key_size;
-	info.dupKeys	= boolean_false;
-	/* FIXME: HOW DO WE SET BLOCK SIZE? */
-	info.sectorSize = 256;
-	info.comp		= compare;
+	/* An unbounded size, cast from -1, falls back to the default pool. */
+	bpptree->buffer_count	= (int) dictionary_size;
+	bpptree->dirty_max		= 0;
+	bpptree->sector_size	= ION_BPP_DEFAULT_SECTOR_SIZE;
+	bpptree->write_concern	= wc_update;
+	bpptree->compress		= boolean_false;
 
-	ion_bpp_err_t bErr = bOpen(info, &(bpptree->tree));
+	err						= bpptree_open_files(bpptree, id, "bpt", "val", key_size, compare);
 
-	if (bErrOk != bErr) {
-		return err_dictionary_initialization_failed;
+	if (err_ok != err) {
+		free(bpptree);
+		return err;
 	}
 
 	dictionary->instance					= (ion_dictionary_parent_t *) bpptree;
@@ -135,10 +190,15 @@ bpptree_insert(
 	bpptree = (ion_bpptree_t *) dictionary->instance;
 
 	offset	= ION_FILE_NULL;
-	bErr	= bFindKey(bpptree->tree, key, &offset);
+	bErr	= bErrKeyNotFound;
+
+	/* Duplicates get a key of their own, otherwise they join the chain of the key. */
+	if (wc_duplicate != bpptree->write_concern) {
+		bErr = bFindKey(bpptree->tree, key, &offset);
 
-	if (bErrKeyNotFound == bErr) {
-		offset = ION_FILE_NULL;
+		if (bErrKeyNotFound == bErr) {
+			offset = ION_FILE_NULL;
+		}
 	}
 
 	err = lfb_put(&(bpptree->values), (ion_byte_t *) value, bpptree->super.record.value_size, offset, &offset);
@@ -152,7 +212,7 @@ bpptree_insert(
 		}
 
 		if (bErrOk != bErr) {
-			/* TODO: lfb_delete from values */
+			lfb_delete(&(bpptree->values), offset, bpptree->super.record.value_size);
 			return ION_STATUS_ERROR(err_unable_to_insert);
 		}
 
@@ -240,10 +300,40 @@ bpptree_delete(
 
 	bpptree = (ion_bpptree_t *) dictionary->instance;
 
-	bErr	= bDeleteKey(bpptree->tree, key, &offset);
+	if (wc_duplicate == bpptree->write_concern) {
+		/* Each copy of the key holds one value. */
+		status.count = 0;
+
+		while (bErrOk == (bErr = bFindKey(bpptree->tree, key, &offset))) {
+			bErr = bDeleteKey(bpptree->tree, key, &offset);
+
+			if (bErrOk != bErr) {
+				break;
+			}
+
+			status.error = lfb_delete(&(bpptree->values), offset, bpptree->super.record.value_size);
+
+			if (err_ok != status.error) {
+				return status;
+			}
+
+			status.count++;
+		}
+
+		if (bErrKeyNotFound != bErr) {
+			status.error = err_file_write_error;
+		}
+		else {
+			status.error = (0 == status.count) ? err_item_not_found : err_ok;
+		}
+
+		return status;
+	}
+
+	bErr = bDeleteKey(bpptree->tree, key, &offset);
 
 	if (bErrKeyNotFound != bErr) {
-		status.error = lfb_delete_all(&(bpptree->values), offset, &(status.count));
+		status.error = lfb_delete_all(&(bpptree->values), offset, bpptree->super.record.value_size, &(status.count));
 	}
 	else {
 		status.error = err_item_not_found;
@@ -261,8 +351,14 @@ bpptree_close_dictionary(
 	ion_bpp_err_t	bErr;
 
 	bpptree					= (ion_bpptree_t *) dictionary->instance;
-	bErr					= bClose(bpptree->tree);
-	ion_fclose(bpptree->values.file_handle);
+	bErr					= bErrOk;
+
+	/* A tree whose files could not be opened again has none to close. */
+	if (NULL != bpptree->tree) {
+		bErr = bClose(bpptree->tree);
+		ion_fclose(bpptree->values.file_handle);
+	}
+
 	free(dictionary->instance);
 	dictionary->instance	= NULL;
 
@@ -273,6 +369,28 @@ bpptree_close_dictionary(
 	return err_ok;
 }
 
+/**
+@brief		Writes the modified nodes of the tree and the value file.
+
+@param		dictionary
+				The instance of the dictionary to flush.
+@return		The status of the flush.
+*/
+ion_err_t
+bpptree_flush_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	ion_bpptree_t *bpptree;
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+
+	if ((bErrOk != bFlush(bpptree->tree)) || (err_ok != ion_fflush(bpptree->values.file_handle))) {
+		return err_file_write_error;
+	}
+
+	return err_ok;
+}
+
 /**
 @brief	  Deletes an instance of the dictionary and associated data.
 
@@ -308,6 +426,80 @@ bpptree_delete_dictionary(
 	return err_ok;
 }
 
+/**
+@brief		Updates every value of a key in a B+ tree that repeats the key
+			for each value.
+
+@param		bpptree
+				The B+ tree to update.
+@param		dictionary
+				The dictionary of @p bpptree, used to insert the key if it
+				is not found.
+@param		key
+				The key that is to be updated.
+@param		value
+				The value that is to be updated.
+@return		The status of the update.
+*/
+static ion_status_t
+bpptree_update_duplicates(
+	ion_bpptree_t		*bpptree,
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	ion_bpp_scan_t		scan;
+	ion_byte_t			*found_key;
+	ion_file_offset_t	offset;
+	ion_result_count_t	count;
+	ion_bpp_err_t		bErr;
+	ion_err_t			err;
+
+	found_key = malloc(bpptree->super.record.key_size);
+
+	if (NULL == found_key) {
+		return ION_STATUS_ERROR(err_out_of_memory);
+	}
+
+	bErr = bScanOpen(bpptree->tree, key, boolean_false, &scan);
+
+	if (bErrOk != bErr) {
+		free(found_key);
+		return ION_STATUS_ERROR((bErrMemory == bErr) ? err_out_of_memory : err_file_read_error);
+	}
+
+	/* The copies of the key are next to each other in the leaves. */
+	count	= 0;
+	err		= err_ok;
+
+	while ((bErrOk == (bErr = bScanNext(scan, found_key, &offset))) && (ION_IS_EQUAL == bpptree->super.compare(found_key, key, bpptree->super.record.key_size))) {
+		err = lfb_update(&(bpptree->values), offset, bpptree->super.record.value_size, (ion_byte_t *) value, NULL);
+
+		if (err_ok != err) {
+			break;
+		}
+
+		count++;
+	}
+
+	bScanClose(scan);
+	free(found_key);
+
+	if (err_ok != err) {
+		return ION_STATUS_CREATE(err, count);
+	}
+
+	if ((bErrOk != bErr) && (bErrKeyNotFound != bErr)) {
+		return ION_STATUS_CREATE(err_file_read_error, count);
+	}
+
+	if (0 == count) {
+		return bpptree_insert(dictionary, key, value);
+	}
+
+	return ION_STATUS_OK(count);
+}
+
 /**
 @brief		Updates the value for a given key.
 
@@ -336,6 +528,10 @@ bpptree_update(
 	count	= 0;
 	bpptree = (ion_bpptree_t *) dictionary->instance;
 
+	if (wc_duplicate == bpptree->write_concern) {
+		return bpptree_update_duplicates(bpptree, dictionary, key, value);
+	}
+
 	bErr	= bFindKey(bpptree->tree, key, &offset);
 
 	if (bErrKeyNotFound != bErr) {
@@ -348,6 +544,545 @@ bpptree_update(
 	return ION_STATUS_OK(count);
 }
 
+/**
+@brief		Makes an empty B+ tree again with another sector size or format.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to remake.
+@param		sector_size
+				The sector size of the new index.
+@param		compress
+				Whether the new index prefix compresses its keys.
+@return		The status of the change. @c err_illegal_state if the
+			dictionary is not empty, or @c err_invalid_initial_size if the
+			new index was refused and the index was made again as it was.
+			If even that fails, @c err_file_open_error is returned and the
+			dictionary can only be closed or deleted.
+*/
+static ion_err_t
+bpptree_remake_index(
+	ion_dictionary_t	*dictionary,
+	int					sector_size,
+	ion_boolean_t		compress
+) {
+	ion_bpptree_t				*bpptree;
+	ion_bpp_external_address_t	offset;
+	ion_key_t					key;
+	ion_bpp_err_t				bErr;
+	char						filename[ION_MAX_FILENAME_LENGTH];
+	int							previous_sector_size;
+	ion_boolean_t				previous_compress;
+	ion_err_t					err;
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+
+	if (NULL == bpptree->tree) {
+		return err_file_open_error;
+	}
+
+	key = malloc(dictionary->instance->record.key_size);
+
+	if (NULL == key) {
+		return err_out_of_memory;
+	}
+
+	/* Nodes are laid out by sector and format, so only an empty index can be remade. */
+	bErr = bFindFirstKey(bpptree->tree, key, &offset);
+	free(key);
+
+	if (bErrKeyNotFound != bErr) {
+		return err_illegal_state;
+	}
+
+	bClose(bpptree->tree);
+	ion_fclose(bpptree->values.file_handle);
+	dictionary_get_filename(dictionary->instance->id, "bpt", filename);
+	ion_fremove(filename);
+
+	previous_sector_size	= bpptree->sector_size;
+	previous_compress		= bpptree->compress;
+	bpptree->sector_size	= sector_size;
+	bpptree->compress		= compress;
+	err						= bpptree_open_files(bpptree, dictionary->instance->id, "bpt", "val", dictionary->instance->record.key_size, dictionary->instance->compare);
+
+	if (err_ok != err) {
+		/* The new index was refused, so make the index again as it was. */
+		bpptree->sector_size	= previous_sector_size;
+		bpptree->compress		= previous_compress;
+
+		if (err_ok != bpptree_open_files(bpptree, dictionary->instance->id, "bpt", "val", dictionary->instance->record.key_size, dictionary->instance->compare)) {
+			return err_file_open_error;
+		}
+
+		return err_invalid_initial_size;
+	}
+
+	return err_ok;
+}
+
+ion_err_t
+bpptree_set_sector_size(
+	ion_dictionary_t	*dictionary,
+	int					sector_size
+) {
+	ion_bpptree_t *bpptree;
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+
+	if (sector_size == bpptree->sector_size) {
+		return err_ok;
+	}
+
+	return bpptree_remake_index(dictionary, sector_size, bpptree->compress);
+}
+
+ion_err_t
+bpptree_set_dirty_max(
+	ion_dictionary_t	*dictionary,
+	int					dirty_max
+) {
+	ion_bpptree_t *bpptree;
+
+	bpptree				= (ion_bpptree_t *) dictionary->instance;
+	bpptree->dirty_max	= dirty_max;
+	bSetDirtyMax(bpptree->tree, dirty_max);
+
+	return err_ok;
+}
+
+ion_err_t
+bpptree_get_stats(
+	ion_dictionary_t	*dictionary,
+	ion_bpp_stats_t		*stats
+) {
+	ion_bpptree_t *bpptree;
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+
+	if (bErrOk != bStats(bpptree->tree, stats)) {
+		return err_illegal_state;
+	}
+
+	return err_ok;
+}
+
+ion_err_t
+bpptree_set_write_concern(
+	ion_dictionary_t	*dictionary,
+	ion_write_concern_t write_concern
+) {
+	ion_bpptree_t	*bpptree;
+	ion_bpp_err_t	bErr;
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+
+	if ((wc_duplicate != write_concern) && (wc_update != write_concern)) {
+		return err_write_concern;
+	}
+
+	if (write_concern == bpptree->write_concern) {
+		return err_ok;
+	}
+
+	bErr = bSetDupKeys(bpptree->tree, wc_duplicate == write_concern);
+
+	if (bErrNotEmpty == bErr) {
+		return err_illegal_state;
+	}
+
+	bpptree->write_concern = write_concern;
+
+	return err_ok;
+}
+
+ion_err_t
+bpptree_set_compress(
+	ion_dictionary_t	*dictionary,
+	ion_boolean_t		compress
+) {
+	ion_bpptree_t *bpptree;
+
+	bpptree		= (ion_bpptree_t *) dictionary->instance;
+	compress	= compress ? boolean_true : boolean_false;
+
+	if (compress == bpptree->compress) {
+		return err_ok;
+	}
+
+	return bpptree_remake_index(dictionary, bpptree->sector_size, compress);
+}
+
+/**
+@brief		Records fed to a bulk load, with one record of lookahead.
+*/
+typedef struct {
+	ion_bpptree_t		*bpptree;
+	/**< Tree being loaded */
+	ion_dict_cursor_t	*cursor;	/**< Source of records, or NULL when loading arrays */
+	ion_byte_t			*keys;		/**< Keys left to load from an array */
+	ion_byte_t			*values;	/**< Values left to load from an array */
+	int					count;		/**< Records left in the arrays */
+	ion_record_t		record;		/**< Lookahead record */
+	ion_boolean_t		pending;	/**< Whether @p record holds a record */
+	ion_result_count_t	loaded;		/**< Records loaded so far */
+	ion_err_t			error;		/**< First error hit reading or writing records */
+} ion_bpp_bulk_source_t;
+
+/**
+@brief		Reads the next record of a bulk load source into its lookahead.
+
+@param		source
+				The source to advance.
+*/
+static void
+bpptree_bulk_advance(
+	ion_bpp_bulk_source_t *source
+) {
+	ion_dictionary_parent_t *parent = &(source->bpptree->super);
+
+	if (NULL != source->cursor) {
+		source->pending = cs_cursor_active == source->cursor->next(source->cursor, &(source->record));
+	}
+	else if (source->count > 0) {
+		source->record.key		= source->keys;
+		source->record.value	= source->values;
+		source->keys			+= parent->record.key_size;
+		source->values			+= parent->record.value_size;
+		source->count--;
+		source->pending			= boolean_true;
+	}
+	else {
+		source->pending = boolean_false;
+	}
+}
+
+/**
+@brief		Supplies the next key to @ref bBulkLoad.
+
+@details	All values of the key are appended to the value file, chained
+			in the order they were given. A tree that repeats keys is given
+			the key again for each value instead.
+
+@param		arg
+				The @ref ion_bpp_bulk_source_t to read from.
+@param		key
+				Where to write the key.
+@param		rec
+				Where to write the offset of the first value of the key.
+@return		@c bErrOk when a key was read, @c bErrKeyNotFound once the
+			source is exhausted, or an error to abandon the load.
+*/
+static ion_bpp_err_t
+bpptree_bulk_next(
+	void						*arg,
+	void						*key,
+	ion_bpp_external_address_t	*rec
+) {
+	ion_bpp_bulk_source_t	*source = arg;
+	ion_dictionary_parent_t *parent = &(source->bpptree->super);
+	ion_file_offset_t		last;
+	ion_file_offset_t		wrote_at;
+	char					cc;
+
+	if (!source->pending) {
+		return bErrKeyNotFound;
+	}
+
+	memcpy(key, source->record.key, parent->record.key_size);
+	last = ION_LFB_NULL;
+
+	do {
+		/* Appended, so the values of a key ascend in the file as the tree requires. */
+		source->error = lfb_append(&(source->bpptree->values), source->record.value, parent->record.value_size, ION_LFB_NULL, &wrote_at);
+
+		if ((err_ok == source->error) && (ION_LFB_NULL != last)) {
+			source->error = lfb_update_next(&(source->bpptree->values), last, wrote_at);
+		}
+
+		if (err_ok != source->error) {
+			return bErrIO;
+		}
+
+		if (ION_LFB_NULL == last) {
+			*rec = wrote_at;
+		}
+
+		last = wrote_at;
+		source->loaded++;
+		bpptree_bulk_advance(source);
+	} while (source->pending && (ION_IS_EQUAL == (cc = parent->compare(source->record.key, key, parent->record.key_size))) && (wc_duplicate != source->bpptree->write_concern));
+
+	if (source->pending && (cc < ION_IS_EQUAL)) {
+		source->error = err_sorted_order_violation;
+		return bErrKeyOrder;
+	}
+
+	return bErrOk;
+}
+
+/**
+@brief		Loads an empty B+ tree from a bulk load source.
+
+@details	If the load fails, the values it appended are freed, as the
+			tree frees the nodes it wrote.
+
+@param		bpptree
+				The B+ tree to load.
+@param		source
+				The source, with its first record not yet read.
+@param		fill_factor
+				Percent of each node to fill.
+@return		The status of the load, counting the records loaded.
+*/
+static ion_status_t
+bpptree_bulk_load_source(
+	ion_bpptree_t			*bpptree,
+	ion_bpp_bulk_source_t	*source,
+	int						fill_factor
+) {
+	ion_bpp_err_t		bErr;
+	ion_file_offset_t	values_end;
+
+	source->bpptree = bpptree;
+	source->loaded	= 0;
+	source->error	= err_ok;
+	values_end		= ion_fend(bpptree->values.file_handle);
+	bpptree_bulk_advance(source);
+
+	bErr			= bBulkLoad(source->bpptree->tree, fill_factor, bpptree_bulk_next, source);
+
+	if ((bErrOk != bErr) && (bErrNotEmpty != bErr)) {
+		ion_err_t err = lfb_delete_appended(&(bpptree->values), values_end, bpptree->super.record.value_size);
+
+		if (err_ok == source->error) {
+			source->error = err;
+		}
+	}
+
+	if (err_ok != source->error) {
+		return ION_STATUS_ERROR(source->error);
+	}
+
+	switch (bErr) {
+		case bErrOk:
+			return ION_STATUS_OK(source->loaded);
+
+		case bErrNotEmpty:
+			return ION_STATUS_ERROR(err_illegal_state);
+
+		case bErrMemory:
+			return ION_STATUS_ERROR(err_out_of_memory);
+
+		default:
+			return ION_STATUS_ERROR(err_unable_to_insert);
+	}
+}
+
+/**
+@brief		Loads an empty B+ tree from the records of a cursor.
+
+@param		bpptree
+				The B+ tree to load.
+@param		cursor
+				The cursor to read records from.
+@param		fill_factor
+				Percent of each node to fill.
+@return		The status of the load, counting the records loaded.
+*/
+static ion_status_t
+bpptree_bulk_load_cursor(
+	ion_bpptree_t		*bpptree,
+	ion_dict_cursor_t	*cursor,
+	int					fill_factor
+) {
+	ion_bpp_bulk_source_t	source;
+	ion_status_t			status;
+
+	source.cursor		= cursor;
+	source.count		= 0;
+	source.record.key	= malloc(bpptree->super.record.key_size + bpptree->super.record.value_size);
+
+	if (NULL == source.record.key) {
+		return ION_STATUS_ERROR(err_out_of_memory);
+	}
+
+	source.record.value = (ion_byte_t *) source.record.key + bpptree->super.record.key_size;
+
+	status				= bpptree_bulk_load_source(bpptree, &source, fill_factor);
+
+	free(source.record.key);
+	return status;
+}
+
+ion_status_t
+bpptree_bulk_load(
+	ion_dictionary_t	*dictionary,
+	ion_dict_cursor_t	*cursor,
+	int					fill_factor
+) {
+	return bpptree_bulk_load_cursor((ion_bpptree_t *) dictionary->instance, cursor, fill_factor);
+}
+
+ion_status_t
+bpptree_bulk_load_array(
+	ion_dictionary_t	*dictionary,
+	ion_byte_t			*keys,
+	ion_byte_t			*values,
+	int					count,
+	int					fill_factor
+) {
+	ion_bpp_bulk_source_t	source;
+	ion_key_size_t			key_size = dictionary->instance->record.key_size;
+	int						i;
+
+	/* Checked before anything is written, so an unsorted array leaves the files as they were. */
+	for (i = 1; i < count; i++) {
+		if (dictionary->instance->compare(keys + i * key_size, keys + (i - 1) * key_size, key_size) < ION_IS_EQUAL) {
+			return ION_STATUS_ERROR(err_sorted_order_violation);
+		}
+	}
+
+	source.cursor	= NULL;
+	source.keys		= keys;
+	source.values	= values;
+	source.count	= count;
+
+	return bpptree_bulk_load_source((ion_bpptree_t *) dictionary->instance, &source, fill_factor);
+}
+
+/**
+@brief		Renames one of the files of a B+ tree.
+@param		id
+				The ID of the dictionary the file belongs to.
+@param		from
+				The extension of the file to rename.
+@param		to
+				The extension to give the file.
+@return		The status of the rename.
+*/
+static ion_err_t
+bpptree_rename_file(
+	ion_dictionary_id_t id,
+	char				*from,
+	char				*to
+) {
+	char	from_filename[ION_MAX_FILENAME_LENGTH];
+	char	to_filename[ION_MAX_FILENAME_LENGTH];
+
+	dictionary_get_filename(id, from, from_filename);
+	dictionary_get_filename(id, to, to_filename);
+
+	return ion_frename(from_filename, to_filename);
+}
+
+ion_err_t
+bpptree_compact(
+	ion_dictionary_t *dictionary
+) {
+	ion_bpptree_t		*bpptree;
+	ion_bpptree_t		compacted;
+	ion_dictionary_id_t id;
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_err_t			err;
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	char				compacted_filename[ION_MAX_FILENAME_LENGTH];
+
+	bpptree = (ion_bpptree_t *) dictionary->instance;
+	id		= dictionary->instance->id;
+
+	/* Leftovers of an earlier compaction that did not finish. */
+	dictionary_get_filename(id, "bpc", compacted_filename);
+
+	if (ion_fexists(compacted_filename)) {
+		ion_fremove(compacted_filename);
+	}
+
+	dictionary_get_filename(id, "vac", compacted_filename);
+
+	if (ion_fexists(compacted_filename)) {
+		ion_fremove(compacted_filename);
+	}
+
+	err = dictionary_build_predicate(&predicate, predicate_all_records);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	cursor	= NULL;
+	err		= dictionary_find(dictionary, &predicate, &cursor);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	compacted.super			= bpptree->super;
+	compacted.buffer_count	= bpptree->buffer_count;
+	compacted.dirty_max		= bpptree->dirty_max;
+	compacted.sector_size	= bpptree->sector_size;
+	compacted.write_concern = bpptree->write_concern;
+	compacted.compress		= bpptree->compress;
+	err						= bpptree_open_files(&compacted, id, "bpc", "vac", dictionary->instance->record.key_size, dictionary->instance->compare);
+
+	if (err_ok == err) {
+		/* Every key in order, with its values laid out one after another. */
+		err = bpptree_bulk_load_cursor(&compacted, cursor, 100).error;
+
+		if (bErrOk != bClose(compacted.tree)) {
+			err = err_file_write_error;
+		}
+
+		ion_fclose(compacted.values.file_handle);
+	}
+
+	cursor->destroy(&cursor);
+
+	if (err_ok != err) {
+		dictionary_get_filename(id, "bpc", compacted_filename);
+		ion_fremove(compacted_filename);
+		dictionary_get_filename(id, "vac", compacted_filename);
+		ion_fremove(compacted_filename);
+		return err;
+	}
+
+	/* Swap the compacted files in place of the originals. The originals are
+	   moved aside first, so that a failed rename can be undone in reverse. */
+	char	*from[]	= { "bpt", "val", "bpc", "vac" };
+	char	*to[]	= { "bpo", "vao", "bpt", "val" };
+	int		step;
+
+	bClose(bpptree->tree);
+	ion_fclose(bpptree->values.file_handle);
+
+	for (step = 0; (err_ok == err) && (step < 4); step++) {
+		err = bpptree_rename_file(id, from[step], to[step]);
+	}
+
+	if (err_ok != err) {
+		/* The step that failed did nothing, so only the ones before it are undone. */
+		for (step -= 2; step >= 0; step--) {
+			bpptree_rename_file(id, to[step], from[step]);
+		}
+
+		dictionary_get_filename(id, "bpc", compacted_filename);
+		ion_fremove(compacted_filename);
+		dictionary_get_filename(id, "vac", compacted_filename);
+		ion_fremove(compacted_filename);
+
+		/* Leave the dictionary open on its original files. */
+		bpptree_open_files(bpptree, id, "bpt", "val", dictionary->instance->record.key_size, dictionary->instance->compare);
+		return err;
+	}
+
+	dictionary_get_filename(id, "bpo", filename);
+	ion_fremove(filename);
+	dictionary_get_filename(id, "vao", filename);
+	ion_fremove(filename);
+
+	return bpptree_open_files(bpptree, id, "bpt", "val", dictionary->instance->record.key_size, dictionary->instance->compare);
+}
+
 /**
 @brief		Next function to query and retrieve the next
 			<K,V> that stratifies the predicate of the cursor.
@@ -381,17 +1116,27 @@ bpptree_next(
 			switch (cursor->predicate->type) {
 				case predicate_equality: {
 					if (-1 == bCursor->offset) {
-						/* End of results, we can quit */
-						is_valid = boolean_false;
+						if (NULL == bCursor->scan) {
+							/* End of results, we can quit */
+							is_valid = boolean_false;
+						}
+						else {
+							/* The next copy of the key holds the next value. */
+							ion_bpp_err_t bErr = bScanNext(bCursor->scan, bCursor->cur_key, &bCursor->offset);
+
+							if ((bErrOk != bErr) || (boolean_false == test_predicate(cursor, bCursor->cur_key))) {
+								is_valid = boolean_false;
+							}
+						}
 					}
 
 					break;
 				}
 
 				case predicate_range: {
-					/*do bFindNextKey then test_predicate */
+					/*do bScanNext then test_predicate */
 					if (-1 == bCursor->offset) {
-						ion_bpp_err_t bErr = bFindNextKey(bpptree->tree, bCursor->cur_key, &bCursor->offset);
+						ion_bpp_err_t bErr = bScanNext(bCursor->scan, bCursor->cur_key, &bCursor->offset);
 
 						if ((bErrOk != bErr) || (boolean_false == test_predicate(cursor, bCursor->cur_key))) {
 							is_valid = boolean_false;
@@ -403,7 +1148,7 @@ bpptree_next(
 
 				case predicate_all_records: {
 					if (-1 == bCursor->offset) {
-						ion_bpp_err_t bErr = bFindNextKey(bpptree->tree, bCursor->cur_key, &bCursor->offset);
+						ion_bpp_err_t bErr = bScanNext(bCursor->scan, bCursor->cur_key, &bCursor->offset);
 
 						if (bErrOk != bErr) {
 							is_valid = boolean_false;
@@ -434,7 +1179,13 @@ bpptree_next(
 		memcpy(record->key, bCursor->cur_key, cursor->dictionary->instance->record.key_size);
 
 		/* Get value */
-		lfb_get(&(bpptree->values), bCursor->offset, cursor->dictionary->instance->record.value_size, record->value, &bCursor->offset);
+		if (NULL != bCursor->scan) {
+			lfb_get_buffered(&(bpptree->values), &bCursor->window, bCursor->offset, cursor->dictionary->instance->record.value_size, record->value, &bCursor->offset);
+		}
+		else {
+			lfb_get(&(bpptree->values), bCursor->offset, cursor->dictionary->instance->record.value_size, record->value, &bCursor->offset);
+		}
+
 		return cursor->status;
 	}
 
@@ -457,12 +1208,84 @@ void
 bpptree_destroy_cursor(
 	ion_dict_cursor_t **cursor
 ) {
+	ion_bpp_cursor_t *bCursor = (ion_bpp_cursor_t *) (*cursor);
+
+	if (NULL != bCursor->scan) {
+		bScanClose(bCursor->scan);
+	}
+
+	free(bCursor->window.buffer);
 	(*cursor)->predicate->destroy(&(*cursor)->predicate);
-	free(((ion_bpp_cursor_t *) (*cursor))->cur_key);
+	free(bCursor->cur_key);
 	free((*cursor));
 	*cursor = NULL;
 }
 
+/**
+@brief		Starts the leaf scan of a range or all records cursor, and
+			reads the first key of the scan.
+
+@param		bpptree
+				The B+ tree to scan.
+@param		bCursor
+				The cursor to start. Its status is set to show whether a
+				key was found.
+@param		key
+				The scan starts at the least key greater than or equal to
+				this, or at the first key if @c NULL.
+@param		descending
+				If @c boolean_true, the scan instead returns keys from
+				greatest to least, starting at the greatest key less than
+				or equal to @p key, or at the last key if @p key is @c NULL.
+@return		The status of starting the scan.
+*/
+static ion_err_t
+bpptree_start_scan(
+	ion_bpptree_t		*bpptree,
+	ion_bpp_cursor_t	*bCursor,
+	ion_key_t			key,
+	ion_boolean_t		descending
+) {
+	unsigned int	size;
+	ion_bpp_err_t	bErr;
+
+	size = ION_BPP_CURSOR_READ_AHEAD;
+
+	if (size < sizeof(ion_file_offset_t) + bpptree->super.record.value_size) {
+		size = sizeof(ion_file_offset_t) + bpptree->super.record.value_size;
+	}
+
+	bCursor->window.buffer = malloc(size);
+
+	if (NULL == bCursor->window.buffer) {
+		return err_out_of_memory;
+	}
+
+	bCursor->window.size		= size;
+	bCursor->window.num_bytes	= 0;
+
+	bErr						= bScanOpen(bpptree->tree, key, descending, &bCursor->scan);
+
+	if (bErrOk != bErr) {
+		bCursor->scan = NULL;
+		return (bErrMemory == bErr) ? err_out_of_memory : err_file_read_error;
+	}
+
+	bErr = bScanNext(bCursor->scan, bCursor->cur_key, &bCursor->offset);
+
+	if (bErrOk == bErr) {
+		bCursor->super.status = cs_cursor_initialized;
+	}
+	else if (bErrKeyNotFound == bErr) {
+		bCursor->super.status = cs_end_of_results;
+	}
+	else {
+		return err_file_read_error;
+	}
+
+	return err_ok;
+}
+
 /**
 @brief	  Finds multiple instances of a keys that satisfy the provided
 			 predicate in the dictionary.
@@ -505,6 +1328,9 @@ bpptree_find(
 		return err_out_of_memory;
 	}
 
+	bCursor->scan			= NULL;
+	bCursor->window.buffer	= NULL;
+
 	(*cursor)->dictionary	= dictionary;
 	(*cursor)->status		= cs_cursor_uninitialized;
 
@@ -538,6 +1364,22 @@ bpptree_find(
 
 			memcpy((*cursor)->predicate->statement.equality.equality_value, target_key, key_size);
 
+			if (wc_duplicate == bpptree->write_concern) {
+				/* The copies of the key, one per value, are scanned in place. */
+				ion_err_t err = bpptree_start_scan(bpptree, bCursor, (*cursor)->predicate->statement.equality.equality_value, boolean_false);
+
+				if (err_ok != err) {
+					bpptree_destroy_cursor(cursor);
+					return err;
+				}
+
+				if ((cs_cursor_initialized == (*cursor)->status) && (boolean_false == test_predicate(*cursor, bCursor->cur_key))) {
+					(*cursor)->status = cs_end_of_results;
+				}
+
+				return err_ok;
+			}
+
 			memcpy(bCursor->cur_key, target_key, key_size);
 
 			ion_bpp_err_t err = bFindKey(bpptree->tree, target_key, &bCursor->offset);
@@ -578,33 +1420,41 @@ bpptree_find(
 			}
 
 			memcpy((*cursor)->predicate->statement.range.upper_bound, predicate->statement.range.upper_bound, key_size);
+			(*cursor)->predicate->statement.range.descending = predicate->statement.range.descending;
 
-			/* We search for the FGEQ of the Lower bound. */
-			bFindFirstGreaterOrEqual(bpptree->tree, (*cursor)->predicate->statement.range.lower_bound, bCursor->cur_key, &bCursor->offset);
+			/* We scan from the FGEQ of the Lower bound, or down from the LEQ of the upper bound. */
+			ion_err_t err;
 
-			/* If the key returned doesn't satisfy the predicate, we can exit */
-			if (boolean_false == test_predicate(*cursor, bCursor->cur_key)) {
-				(*cursor)->status = cs_end_of_results;
-				return err_ok;
+			if (predicate->statement.range.descending) {
+				err = bpptree_start_scan(bpptree, bCursor, (*cursor)->predicate->statement.range.upper_bound, boolean_true);
 			}
 			else {
-				(*cursor)->status = cs_cursor_initialized;
-				return err_ok;
+				err = bpptree_start_scan(bpptree, bCursor, (*cursor)->predicate->statement.range.lower_bound, boolean_false);
+			}
+
+			if (err_ok != err) {
+				bpptree_destroy_cursor(cursor);
+				return err;
+			}
+
+			/* If the key returned doesn't satisfy the predicate, we can exit */
+			if ((cs_cursor_initialized == (*cursor)->status) && (boolean_false == test_predicate(*cursor, bCursor->cur_key))) {
+				(*cursor)->status = cs_end_of_results;
 			}
 
+			return err_ok;
 			break;
 		}
 
 		case predicate_all_records: {
-			ion_bpp_err_t err;
+			(*cursor)->predicate->statement.all_records.descending = predicate->statement.all_records.descending;
 
-			/* We search for first key in B++ tree. */
-			err					= bFindFirstKey(bpptree->tree, bCursor->cur_key, &bCursor->offset);
+			/* We scan from the first key in B++ tree, or from the last if descending. */
+			ion_err_t err = bpptree_start_scan(bpptree, bCursor, NULL, predicate->statement.all_records.descending);
 
-			(*cursor)->status	= cs_cursor_initialized;
-
-			if (bErrOk != err) {
-				(*cursor)->status = cs_end_of_results;
+			if (err_ok != err) {
+				bpptree_destroy_cursor(cursor);
+				return err;
 			}
 
 			return err_ok;
@@ -649,4 +1499,5 @@ bpptree_init(
 	handler->delete_dictionary	= bpptree_delete_dictionary;
 	handler->open_dictionary	= bpptree_open_dictionary;
 	handler->close_dictionary	= bpptree_close_dictionary;
+	handler->flush_dictionary	= bpptree_flush_dictionary;
 }
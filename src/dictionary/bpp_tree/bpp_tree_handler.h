@@ -19,16 +19,38 @@ extern "C" {
 #include "../../file/linked_file_bag.h"
 #include "bpp_tree.h"
 
+/**
+@brief		The most bytes of the value file a range or all records cursor
+			reads at once.
+@details	Values stored next to each other, as after a bulk load, are
+			then read together instead of one at a time.
+*/
+#if !defined(ION_BPP_CURSOR_READ_AHEAD)
+#if defined(ARDUINO)
+#define ION_BPP_CURSOR_READ_AHEAD 64
+#else
+#define ION_BPP_CURSOR_READ_AHEAD 4096
+#endif
+#endif
+
 typedef struct bplusplustree {
 	ion_dictionary_parent_t super;
 	ion_bpp_handle_t		tree;
 	ion_lfb_t				values;
+	int						buffer_count;	/**< Node buffers cached by @p tree */
+	int						dirty_max;		/**< Modified node buffers that start a write back, 0 for all */
+	int						sector_size;	/**< Sector size of the index file */
+	ion_write_concern_t		write_concern;	/**< @c wc_duplicate if each value has its own key in @p tree,
+												 otherwise @c wc_update and the values of a key are chained in @p values */
+	ion_boolean_t			compress;		/**< @c boolean_true if the keys in @p tree are prefix compressed */
 } ion_bpptree_t;
 
 typedef struct {
 	ion_dict_cursor_t	super;		/**< Supertype of cursor		*/
 	ion_key_t			cur_key;/**< Current key we're visiting */
 	ion_file_offset_t	offset;		/**< offset in LFB; holds value */
+	ion_bpp_scan_t		scan;		/**< Leaf scan of range and all records cursors */
+	ion_lfb_window_t	window;		/**< Values read ahead by @p scan cursors */
 } ion_bpp_cursor_t;
 
 /**
@@ -46,6 +68,205 @@ bpptree_init(
 	ion_dictionary_handler_t *handler
 );
 
+/**
+@brief		Chooses the sector size of an empty B+ tree.
+
+@details	Nodes are one sector long, and are aligned to their size in the
+			index file, so a sector the size of a page (the default on PC,
+			@ref ION_BPP_DEFAULT_SECTOR_SIZE) gives one page per node. Larger
+			sectors hold more keys per node, making the tree shallower. The
+			size is kept in the index file and applies whenever the
+			dictionary is opened again.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to change.
+@param		sector_size
+				The sector size in bytes, a multiple of 4 up to
+				@ref ION_BPP_MAX_SECTOR_SIZE.
+@return		The status of the change. @c err_invalid_initial_size if the
+			size can't be used, or @c err_illegal_state if the dictionary
+			is not empty. @c err_file_open_error if the index could not be
+			made again, after which the dictionary can only be closed or
+			deleted.
+*/
+ion_err_t
+bpptree_set_sector_size(
+	ion_dictionary_t	*dictionary,
+	int					sector_size
+);
+
+/**
+@brief		Chooses when a B+ tree writes back modified nodes.
+
+@details	Modified nodes stay in the buffer pool until @p dirty_max of
+			them are modified, a modified one must make room for another
+			node, or the dictionary is flushed or closed. They are then
+			all written at once in file order, adjacent nodes in a single
+			write. A lower threshold bounds the work lost if the program
+			stops without closing the dictionary.
+
+@param		dictionary
+				The B+ tree dictionary instance to change.
+@param		dirty_max
+				The number of modified node buffers, or 0 to wait until
+				the whole pool is modified.
+@return		The status of the change.
+*/
+ion_err_t
+bpptree_set_dirty_max(
+	ion_dictionary_t	*dictionary,
+	int					dirty_max
+);
+
+/**
+@brief		Reads the statistics of a B+ tree.
+
+@details	The counts cover this dictionary's index since it was last
+			opened, so the buffer hits and misses, evictions and disk
+			reads and writes show how well the buffer pool size
+			(@p dictionary_size) and sector size suit its workload.
+
+@param		dictionary
+				The B+ tree dictionary instance to read.
+@param		stats
+				Where to copy the statistics.
+@return		The status of the read.
+*/
+ion_err_t
+bpptree_get_stats(
+	ion_dictionary_t	*dictionary,
+	ion_bpp_stats_t		*stats
+);
+
+/**
+@brief		Chooses how an empty B+ tree stores the values of a key.
+
+@details	By default (@c wc_update) a key is stored once in the tree and
+			its values are chained together in the value file. With
+			@c wc_duplicate the key is repeated in the tree for each value,
+			so the values of a key are found in adjacent leaf slots rather
+			than by following the chain. The choice is kept in the index
+			file and applies whenever the dictionary is opened again.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to change.
+@param		write_concern
+				@c wc_duplicate or @c wc_update.
+@return		The status of the change. @c err_write_concern if the write
+			concern is not supported, or @c err_illegal_state if the
+			dictionary is not empty.
+*/
+ion_err_t
+bpptree_set_write_concern(
+	ion_dictionary_t	*dictionary,
+	ion_write_concern_t write_concern
+);
+
+/**
+@brief		Chooses whether an empty B+ tree prefix compresses its keys.
+
+@details	Off by default. A compressed index stores each key on disk with
+			the prefix it shares with the key before it left out, and
+			trailing zero bytes dropped, so long text keys that share
+			prefixes (@c key_type_char_array or
+			@c key_type_null_terminated_string) take far less space. The
+			index file format differs, and the choice is kept in the index
+			file and applies whenever the dictionary is opened again.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to change.
+@param		compress
+				@c boolean_true to compress keys, @c boolean_false for the
+				uncompressed format.
+@return		The status of the change. @c err_invalid_initial_size if
+			the index can't be made in the new format, or
+			@c err_illegal_state if the dictionary is not empty.
+			@c err_file_open_error if the index could not be made again,
+			after which the dictionary can only be closed or deleted.
+*/
+ion_err_t
+bpptree_set_compress(
+	ion_dictionary_t	*dictionary,
+	ion_boolean_t		compress
+);
+
+/**
+@brief		Builds an empty B+ tree from records in ascending key order.
+
+@details	Leaves are filled left to right and the inner levels are built
+			from them bottom-up, so each node is written once. Values are
+			appended to the value file in the order given, and records
+			with equal keys must be adjacent.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to load.
+@param		cursor
+				A cursor returning records in ascending key order, such as
+				an all records cursor of another B+ tree.
+@param		fill_factor
+				Percent of each node to fill, from 50 to 100. Lower values
+				leave room for later inserts; out of range values mean 100.
+@return		The status of the load, counting the records loaded.
+			@c err_sorted_order_violation if a key was out of order, or
+			@c err_illegal_state if the dictionary was not empty. A
+			failed load leaves the dictionary empty, with the space it
+			wrote to freed for later inserts.
+*/
+ion_status_t
+bpptree_bulk_load(
+	ion_dictionary_t	*dictionary,
+	ion_dict_cursor_t	*cursor,
+	int					fill_factor
+);
+
+/**
+@brief		Builds an empty B+ tree from arrays of records in ascending
+			key order.
+
+@details	As @ref bpptree_bulk_load, reading records from arrays.
+
+@param		dictionary
+				The empty B+ tree dictionary instance to load.
+@param		keys
+				@p count keys packed one after another.
+@param		values
+				@p count values packed one after another.
+@param		count
+				The number of records to load.
+@param		fill_factor
+				Percent of each node to fill, from 50 to 100.
+@return		The status of the load, counting the records loaded.
+			@c err_sorted_order_violation if a key was out of order,
+			which is checked before anything is written.
+*/
+ion_status_t
+bpptree_bulk_load_array(
+	ion_dictionary_t	*dictionary,
+	ion_byte_t			*keys,
+	ion_byte_t			*values,
+	int					count,
+	int					fill_factor
+);
+
+/**
+@brief		Rewrites the index and value files of a B+ tree densely.
+
+@details	Every key is bulk loaded in order into a new, full index, and
+			its values are copied next to each other into a new value file. The new files
+			then replace the old ones, dropping all space left by deletes.
+			If they cannot be swapped in, the original files are put back
+			and the dictionary stays open on them.
+			Cursors on the dictionary must not be in use.
+
+@param		dictionary
+				The B+ tree dictionary instance to compact.
+@return		The status of the compaction.
+*/
+ion_err_t
+bpptree_compact(
+	ion_dictionary_t *dictionary
+);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -258,6 +258,107 @@ dictionary_compare_signed_value(
 	return return_value;
 }
 
+/**
+@brief		Rotates a 32 bit word left.
+@param		word
+				The word to rotate.
+@param		bits
+				How far to rotate, between 1 and 31.
+@return		The rotated word.
+*/
+static uint32_t
+dictionary_rotate_left(
+	uint32_t	word,
+	int			bits
+) {
+	return (word << bits) | (word >> (32 - bits));
+}
+
+/**
+@brief		Spreads every input bit of a 32 bit word across the whole word.
+@param		hash
+				The word to mix.
+@return		The mixed word.
+*/
+static uint32_t
+dictionary_mix_hash(
+	uint32_t hash
+) {
+	hash	^= hash >> 16;
+	hash	*= UINT32_C(0x85EBCA6B);
+	hash	^= hash >> 13;
+	hash	*= UINT32_C(0xC2B2AE35);
+	hash	^= hash >> 16;
+
+	return hash;
+}
+
+uint32_t
+dictionary_hash_key(
+	ion_key_t		key,
+	ion_key_type_t	key_type,
+	ion_key_size_t	key_size
+) {
+	ion_byte_t	*bytes = (ion_byte_t *) key;
+	uint32_t	hash;
+	uint32_t	word;
+	uint64_t	wide;
+	int			length;
+	int			idx;
+
+	if ((key_type_numeric_signed == key_type) || (key_type_numeric_unsigned == key_type)) {
+		if (4 == key_size) {
+			memcpy(&word, bytes, 4);
+			return dictionary_mix_hash(word);
+		}
+
+		if (8 == key_size) {
+			memcpy(&wide, bytes, 8);
+			wide	^= wide >> 33;
+			wide	*= UINT64_C(0xFF51AFD7ED558CCD);
+			wide	^= wide >> 33;
+			wide	*= UINT64_C(0xC4CEB9FE1A85EC53);
+			wide	^= wide >> 33;
+			return (uint32_t) wide;
+		}
+
+		length = key_size;
+	}
+	else {
+		/* Bytes after a null byte take no part in a strncmp comparison. */
+		length = 0;
+
+		while ((length < key_size) && ('\0' != bytes[length])) {
+			length++;
+		}
+	}
+
+	hash = (uint32_t) length;
+
+	for (idx = 0; idx + 4 <= length; idx += 4) {
+		memcpy(&word, bytes + idx, 4);
+		word	*= UINT32_C(0xCC9E2D51);
+		word	= dictionary_rotate_left(word, 15);
+		word	*= UINT32_C(0x1B873593);
+		hash	^= word;
+		hash	= dictionary_rotate_left(hash, 13);
+		hash	= hash * 5 + UINT32_C(0xE6546B64);
+	}
+
+	word = 0;
+
+	for (; idx < length; idx++) {
+		word = (word << 8) | bytes[idx];
+	}
+
+	word	*= UINT32_C(0xCC9E2D51);
+	word	= dictionary_rotate_left(word, 15);
+	word	*= UINT32_C(0x1B873593);
+	hash	^= word;
+
+	return dictionary_mix_hash(hash);
+}
+
 ion_err_t
 dictionary_open(
 	ion_dictionary_handler_t		*handler,
@@ -424,6 +525,17 @@ dictionary_close(
 	return error;
 }
 
+ion_err_t
+dictionary_flush(
+	ion_dictionary_t *dictionary
+) {
+	if ((ion_dictionary_status_closed == dictionary->status) || (NULL == dictionary->handler->flush_dictionary)) {
+		return err_ok;
+	}
+
+	return dictionary->handler->flush_dictionary(dictionary);
+}
+
 /**
 @brief		Destroys an equality predicate.
 @details	This function should not be called directly. Instead, it is set
@@ -508,12 +620,14 @@ dictionary_build_predicate(
 
 			predicate->statement.range.lower_bound	= lower_bound;
 			predicate->statement.range.upper_bound	= upper_bound;
+			predicate->statement.range.descending	= boolean_false;
 			predicate->destroy						= dictionary_destroy_predicate_range;
 			break;
 		}
 
 		case predicate_all_records: {
-			predicate->destroy = dictionary_destroy_predicate_all_records;
+			predicate->statement.all_records.descending = boolean_false;
+			predicate->destroy							= dictionary_destroy_predicate_all_records;
 			break;
 		}
 
@@ -532,6 +646,47 @@ dictionary_build_predicate(
 	return err_ok;
 }
 
+ion_err_t
+dictionary_set_predicate_descending(
+	ion_predicate_t *predicate,
+	ion_boolean_t	descending
+) {
+	switch (predicate->type) {
+		case predicate_range: {
+			predicate->statement.range.descending = descending;
+			return err_ok;
+		}
+
+		case predicate_all_records: {
+			predicate->statement.all_records.descending = descending;
+			return err_ok;
+		}
+
+		default: {
+			return err_invalid_predicate;
+		}
+	}
+}
+
+ion_boolean_t
+dictionary_predicate_is_descending(
+	ion_predicate_t *predicate
+) {
+	switch (predicate->type) {
+		case predicate_range: {
+			return predicate->statement.range.descending;
+		}
+
+		case predicate_all_records: {
+			return predicate->statement.all_records.descending;
+		}
+
+		default: {
+			return boolean_false;
+		}
+	}
+}
+
 ion_err_t
 dictionary_find(
 	ion_dictionary_t	*dictionary,
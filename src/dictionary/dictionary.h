@@ -222,6 +222,30 @@ dictionary_compare_signed_value(
 	ion_key_size_t	key_size
 );
 
+/**
+@brief		Hashes a key of the given type.
+@details	Numeric keys of 4 or 8 bytes are read as one word and mixed
+			directly. Other keys are mixed four bytes at a time over the
+			whole @p key_size, so keys that share a prefix still spread
+			out. Character array and string keys are compared with
+			@c strncmp, so hashing stops at the first null byte. Every bit
+			of the result depends on the key, which makes it safe to mask
+			the low bits for a power of two table.
+@param		key
+				The key to hash.
+@param		key_type
+				The type of the key.
+@param		key_size
+				The length of the key in bytes.
+@return		The 32 bit hash of the key.
+*/
+uint32_t
+dictionary_hash_key(
+	ion_key_t		key,
+	ion_key_type_t	key_type,
+	ion_key_size_t	key_size
+);
+
 /**
 @brief		Opens a dictionary, given the desired config.
 @param		handler
@@ -251,6 +275,19 @@ dictionary_close(
 	ion_dictionary_t *dictionary
 );
 
+/**
+@brief		Writes changes held in memory by a dictionary to its files.
+@details	Dictionaries that hold back writes, such as the B+ tree with its
+			buffer pool, write them all at once. Others have nothing to do.
+@param		dictionary
+				A pointer to the dictionary object to be flushed.
+@returns	An error describing the result of the flush operation.
+*/
+ion_err_t
+dictionary_flush(
+	ion_dictionary_t *dictionary
+);
+
 /**
 @brief		Builds a predicate based on the type given.
 @details	The caller is responsible for allocating the memory needed
@@ -276,6 +313,41 @@ dictionary_build_predicate(
 	...
 );
 
+/**
+@brief		Chooses the order in which a predicate's records are returned.
+@details	By default, range and all records cursors return records in
+			ascending key order. Descending cursors start at the greatest
+			key, so the last @c N records by key are found by reading
+			only @c N records. Dictionaries that keep no key order, and
+			the flat file unless it is in sorted mode, refuse to find
+			descending predicates with @c err_not_implemented.
+@param		predicate
+				A pointer to a range or all records predicate built by
+				@ref dictionary_build_predicate.
+@param		descending
+				@c boolean_true for descending key order.
+@returns	An error describing the result of the operation.
+			@c err_invalid_predicate for other kinds of predicate.
+*/
+ion_err_t
+dictionary_set_predicate_descending(
+	ion_predicate_t *predicate,
+	ion_boolean_t	descending
+);
+
+/**
+@brief		Tells whether a predicate asks for records in descending key
+			order.
+@param		predicate
+				A pointer to the predicate to check.
+@returns	@c boolean_true for a descending range or all records
+			predicate.
+*/
+ion_boolean_t
+dictionary_predicate_is_descending(
+	ion_predicate_t *predicate
+);
+
 /**
 @brief		Uses the given predicate and cursor to search the dictionary.
 @details	This function will allocate and initialize the cursor.
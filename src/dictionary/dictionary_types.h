@@ -219,6 +219,10 @@ struct dictionary_handler {
 		ion_dictionary_t *
 	);
 	/**< A pointer to the dictionaries close function */
+	ion_err_t (*flush_dictionary)(
+		ion_dictionary_t *
+	);
+	/**< A pointer to the dictionaries flush function, NULL if writes are not held back */
 };
 
 /**
@@ -296,10 +300,12 @@ typedef struct equality_statement {
 @details	This is to be used by the user to setup a predicate for evaluation.
 */
 typedef struct range_statement {
-	ion_key_t	lower_bound;
+	ion_key_t		lower_bound;
 	/**< The lower value in the range */
-	ion_key_t	upper_bound;
+	ion_key_t		upper_bound;
 	/**< The upper value in the range */
+	ion_boolean_t	descending;
+	/**< Whether records are returned from @p upper_bound down */
 } ion_range_statement_t;
 
 /**
@@ -307,8 +313,8 @@ typedef struct range_statement {
 @details	This is to be used by the user to setup a predicate for evaluation.
 */
 typedef struct ion_all_records_statement {
-	/**> For now, all_records has no required information. */
-	char unused;
+	/**> Whether records are returned from the greatest key down. */
+	ion_boolean_t descending;
 } ion_all_records_statement_t;
 
 /**
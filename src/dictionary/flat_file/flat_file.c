@@ -21,7 +21,98 @@
 */
 /******************************************************************************/
 
+#if defined(__linux__) && !defined(ARDUINO) && !defined(_POSIX_C_SOURCE)
+/* Mapping the data file takes the POSIX file functions. */
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "flat_file.h"
+#include "../../file/ion_file.h"
+
+#if ION_FLAT_FILE_MATCH_LANES > 1
+#include <emmintrin.h>
+#endif
+
+#include <stddef.h>
+
+#if ION_FLAT_FILE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+@brief		Gives how many bytes the versioned header takes in a file written with
+			header version @p version.
+@details	Version 1 headers end before the dead row count.
+*/
+static size_t
+flat_file_header_size(
+	int version
+) {
+	return 1 == version ? offsetof(ion_flat_file_header_t, num_dead_rows) : sizeof(ion_flat_file_header_t);
+}
+
+/**
+@brief		Writes the versioned header of @p flat_file at the start of @p file.
+@details	The row count comes from the end of the rows in @p flat_file, so any
+			rows held in memory should be written before the header is marked clean.
+			The data file keeps the header version it has, and any other file
+			takes the current one.
+@param[in]	flat_file
+				Which flat file the header describes.
+@param[in]	file
+				The data file, or a file that is about to replace it.
+@param[in]	sorted
+				Whether the rows are sorted.
+@param[in]	clean
+				Whether the file is being closed cleanly.
+@return		The resulting status of the write.
+*/
+static ion_err_t
+flat_file_write_header(
+	ion_flat_file_t *flat_file,
+	FILE			*file,
+	ion_boolean_t	sorted,
+	ion_boolean_t	clean
+) {
+	ion_flat_file_header_t header;
+
+	header.magic			= ION_FLAT_FILE_HEADER_MAGIC;
+	header.version			= file == flat_file->data_file ? flat_file->header_version : ION_FLAT_FILE_HEADER_VERSION;
+	header.row_size			= flat_file->row_size;
+	header.flags			= (sorted ? ION_FLAT_FILE_HEADER_FLAG_SORTED : 0) | (clean ? ION_FLAT_FILE_HEADER_FLAG_CLEAN : 0);
+	header.block_rows		= flat_file->block_rows;
+	header.num_rows			= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	header.num_dead_rows	= flat_file->num_dead_rows;
+
+	if (0 != fseek(file, 0, SEEK_SET)) {
+		return err_file_bad_seek;
+	}
+
+	if (1 != fwrite(&header, flat_file_header_size(header.version), 1, file)) {
+		return err_file_incomplete_write;
+	}
+
+	return err_ok;
+}
+
+/**
+@brief		Frees the buffers @ref flat_file_initialize has allocated so far and
+			closes the file, when it cannot finish opening the flat file.
+*/
+static void
+flat_file_initialize_failed(
+	ion_flat_file_t *flat_file
+) {
+	free(flat_file->buffer);
+	flat_file->buffer			= NULL;
+	free(flat_file->block_buffer);
+	flat_file->block_buffer		= NULL;
+	free(flat_file->append_buffer);
+	flat_file->append_buffer	= NULL;
+	fclose(flat_file->data_file);
+	flat_file->data_file		= NULL;
+}
 
 ion_err_t
 flat_file_initialize(
@@ -37,6 +128,7 @@ flat_file_initialize(
 		dictionary_size = 1;
 	}
 
+	flat_file->super.id					= id;
 	flat_file->super.key_type			= key_type;
 	flat_file->super.record.key_size	= key_size;
 	flat_file->super.record.value_size	= value_size;
@@ -48,9 +140,28 @@ flat_file_initialize(
 		return err_dictionary_initialization_failed;
 	}
 
-	flat_file->sorted_mode				= boolean_false;/* By default, we don't use sorted mode */
-	flat_file->num_buffered				= dictionary_size;	/* TODO: Sorted mode needs to be written out as a header? */
+	flat_file->sorted_mode				= boolean_false;/* Unless the header says so, we don't use sorted mode */
+	flat_file->num_buffered				= dictionary_size;
 	flat_file->current_loaded_region	= -1;	/* No loaded region yet */
+	flat_file->map						= NULL;	/* Mapped by flat_file_use_mmap */
+	flat_file->map_size					= 0;
+	flat_file->tombstone_deletes		= boolean_false;/* Deletes swap the last row in, unless sorted */
+	flat_file->num_dead_rows			= 0;
+	flat_file->append_buffer			= NULL;	/* Allocated once the file is opened */
+	flat_file->num_appended				= 0;
+	flat_file->max_appended				= ION_FLAT_FILE_APPEND_ROWS;
+	flat_file->fence_keys				= NULL;	/* Fences are built by the first sorted search */
+	flat_file->num_fences				= 0;
+	flat_file->max_fences				= 0;
+	flat_file->zone_rows				= ION_FLAT_FILE_ZONE_ROWS;
+	flat_file->zone_keys				= NULL;	/* Zones are built by the first range scan */
+	flat_file->num_zoned_rows			= 0;
+	flat_file->max_zones				= 0;
+	flat_file->block_rows				= 0;	/* Unless the header says so, rows are stored whole */
+	flat_file->num_blocks				= 0;
+	flat_file->block_buffer				= NULL;
+	flat_file->buffer					= NULL;	/* Allocated once the header is read */
+	flat_file->region_has_values		= boolean_true;
 
 	flat_file->data_file				= fopen(filename, "r+b");
 
@@ -64,55 +175,166 @@ flat_file_initialize(
 		}
 	}
 
-	/* For now, we don't have any header information. But we write some garbage there just so that
-	   we can verify that the code to handle the header is working.*/
-	fwrite(&(int) { 0xADDE }, sizeof(int), 1, flat_file->data_file);
-	flat_file->start_of_data = ftell(flat_file->data_file);
+	/* A record is laid out as: | STATUS |	  KEY	 |	   VALUE	  | */
+	/*				   Bytes:	(1)	 (key_size)   (value_size)	*/
+	flat_file->row_size = sizeof(ion_flat_file_row_status_t) + key_size + value_size;
+
+	/* The header records the row size, whether the rows are sorted, their layout, and how many
+	   rows there were if the file was closed cleanly. New files start out unsorted. */
+	ion_flat_file_header_t	header;
+	ion_boolean_t			clean			= boolean_false;
+	ion_boolean_t			dead_rows_known	= boolean_false;
+	size_t					header_read		= fread(&header, 1, sizeof(header), flat_file->data_file);
+
+	if ((flat_file_header_size(1) <= header_read) && ((int) ION_FLAT_FILE_HEADER_MAGIC == header.magic) && (flat_file_header_size(header.version) <= header_read)) {
+		if ((ION_FLAT_FILE_HEADER_VERSION < header.version) || ((int) flat_file->row_size != header.row_size) || (0 > header.block_rows)) {
+			fclose(flat_file->data_file);
+			return err_dictionary_initialization_failed;
+		}
 
-	if (-1 == flat_file->start_of_data) {
+		flat_file->header_version	= header.version;
+		flat_file->sorted_mode		= 0 != (header.flags & ION_FLAT_FILE_HEADER_FLAG_SORTED);
+		flat_file->block_rows		= header.block_rows;
+		flat_file->start_of_data	= flat_file_header_size(header.version);
+		clean						= 0 != (header.flags & ION_FLAT_FILE_HEADER_FLAG_CLEAN);
+	}
+	else if ((sizeof(int) <= header_read) && (((int) ION_FLAT_FILE_HEADER_SORTED == header.magic) || ((int) ION_FLAT_FILE_HEADER_UNSORTED == header.magic))) {
+		flat_file->header_version	= 0;
+		flat_file->sorted_mode		= (int) ION_FLAT_FILE_HEADER_SORTED == header.magic;
+		flat_file->start_of_data	= sizeof(int);
+	}
+	else if (0 == header_read) {
+		flat_file->header_version	= ION_FLAT_FILE_HEADER_VERSION;
+		flat_file->start_of_data	= sizeof(header);
+		flat_file->eof_position		= flat_file->start_of_data;
+
+		if (err_ok != flat_file_write_header(flat_file, flat_file->data_file, boolean_false, boolean_false)) {
+			fclose(flat_file->data_file);
+			return err_file_write_error;
+		}
+	}
+	else {
+		/* Whatever this file holds, it is not a flat file. */
 		fclose(flat_file->data_file);
-		return err_file_read_error;
+		return err_dictionary_initialization_failed;
 	}
 
-	/* A record is laid out as: | STATUS |	  KEY	 |	   VALUE	  | */
-	/*				   Bytes:	(1)	 (key_size)   (value_size)	*/
-	flat_file->row_size = sizeof(ion_flat_file_row_status_t) + key_size + value_size;
-	flat_file->buffer	= calloc(flat_file->num_buffered, flat_file->row_size);
+	flat_file->max_buffered = ION_FLAT_FILE_SCAN_BUFFER / flat_file->row_size;
+
+	if (flat_file->max_buffered < flat_file->num_buffered) {
+		flat_file->max_buffered = flat_file->num_buffered;
+	}
+
+	flat_file->fence_rows	= ION_FLAT_FILE_FENCE_ROWS;
+
+	if ((0 < flat_file->fence_rows) && ((ion_dictionary_size_t) flat_file->fence_rows < flat_file->num_buffered)) {
+		flat_file->fence_rows = flat_file->num_buffered;
+	}
+
+	if ((size_t) flat_file->fence_rows > flat_file->max_buffered) {
+		flat_file->fence_rows = flat_file->max_buffered;
+	}
+
+	flat_file->buffer		= calloc(flat_file->max_buffered, flat_file->row_size);
+	flat_file->region		= flat_file->buffer;
 
 	if (NULL == flat_file->buffer) {
 		fclose(flat_file->data_file);
 		return err_out_of_memory;
 	}
 
+	if (0 < flat_file->block_rows) {
+		flat_file->block_buffer = malloc(flat_file->block_rows * flat_file->row_size);
+
+		if (NULL == flat_file->block_buffer) {
+			flat_file_initialize_failed(flat_file);
+			return err_out_of_memory;
+		}
+	}
+
 	if (0 != fseek(flat_file->data_file, 0, SEEK_END)) {
-		fclose(flat_file->data_file);
+		flat_file_initialize_failed(flat_file);
 		return err_file_bad_seek;
 	}
 
 	flat_file->eof_position = ftell(flat_file->data_file);
 
 	if (-1 == flat_file->eof_position) {
-		fclose(flat_file->data_file);
+		flat_file_initialize_failed(flat_file);
 		return err_file_read_error;
 	}
 
-	/* Now move the eof to the last non-empty row in the file */
-	ion_fpos_t			loc = -1;
-	ion_flat_file_row_t row;
-	ion_err_t			err = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_BACKWARDS, flat_file_predicate_not_empty);
+	if (0 == flat_file->block_rows) {
+		/* A crash while rows were being appended can leave part of a row at the end of the file.
+		   That torn row is dropped, and the next append writes over it. */
+		flat_file->eof_position -= (flat_file->eof_position - flat_file->start_of_data) % flat_file->row_size;
+	}
+	else {
+		/* Blocks are made full size before any of their rows are written, so only a torn write
+		   leaves part of one. It is filled out, since rows only count once their status is written. */
+		ion_fpos_t block_size = flat_file->block_rows * flat_file->row_size;
 
-	if ((err_ok != err) && (err_file_hit_eof != err)) {
-		fclose(flat_file->data_file);
-		return err;
+		flat_file->num_blocks = (flat_file->eof_position - flat_file->start_of_data + block_size - 1) / block_size;
+
+		if (flat_file->eof_position != flat_file->start_of_data + flat_file->num_blocks * block_size) {
+			if ((0 != fseek(flat_file->data_file, flat_file->start_of_data + flat_file->num_blocks * block_size - 1, SEEK_SET)) || (1 != fwrite(&(ion_byte_t) { 0 }, 1, 1, flat_file->data_file))) {
+				flat_file_initialize_failed(flat_file);
+				return err_file_write_error;
+			}
+		}
+
+		flat_file->eof_position = flat_file->start_of_data + flat_file->num_blocks * block_size;
 	}
 
-	if (err_file_hit_eof == err) {
-		/* Then there are no occupied rows in the file. We'll set to the start of data. */
-		loc = -1;
+	if (clean && (0 <= header.num_rows) && (flat_file->start_of_data + header.num_rows * (ion_fpos_t) flat_file->row_size <= flat_file->eof_position)) {
+		/* The file was closed cleanly, so the header says where the rows end, and from version 2
+		   on, how many of them are deleted. */
+		flat_file->eof_position = flat_file->start_of_data + header.num_rows * flat_file->row_size;
+
+		if ((2 <= flat_file->header_version) && (0 <= header.num_dead_rows) && (header.num_dead_rows <= header.num_rows)) {
+			flat_file->num_dead_rows	= header.num_dead_rows;
+			dead_rows_known				= boolean_true;
+		}
+	}
+	else {
+		/* Otherwise move the eof to the last non-empty row in the file */
+		ion_fpos_t			loc = -1;
+		ion_flat_file_row_t row;
+		ion_err_t			err = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_BACKWARDS, flat_file_predicate_not_empty);
+
+		if ((err_ok != err) && (err_file_hit_eof != err)) {
+			flat_file_initialize_failed(flat_file);
+			return err;
+		}
+
+		if (err_file_hit_eof == err) {
+			/* Then there are no occupied rows in the file. We'll set to the start of data. */
+			loc = -1;
+		}
+
+		/* Move to its final position as one-past the position found. */
+		flat_file->eof_position = flat_file->start_of_data + (loc + 1) * flat_file->row_size;
+	}
+
+	if (!dead_rows_known && (flat_file->eof_position != flat_file->start_of_data)) {
+		/* The deleted rows are counted when they are first needed. */
+		flat_file->num_dead_rows = -1;
+	}
+
+	/* Until it is closed again, a crash may leave the row count in the header out of date. */
+	if (clean && (err_ok != flat_file_write_header(flat_file, flat_file->data_file, flat_file->sorted_mode, boolean_false))) {
+		flat_file_initialize_failed(flat_file);
+		return err_file_write_error;
 	}
 
-	/* Move to its final position as one-past the position found. */
-	flat_file->eof_position = flat_file->start_of_data + (loc + 1) * flat_file->row_size;
+	if (0 < flat_file->max_appended) {
+		flat_file->append_buffer = malloc(flat_file->max_appended * flat_file->row_size);
+
+		if (NULL == flat_file->append_buffer) {
+			flat_file_initialize_failed(flat_file);
+			return err_out_of_memory;
+		}
+	}
 
 	return err_ok;
 }
@@ -140,556 +362,2488 @@ flat_file_destroy(
 	return err_ok;
 }
 
-ion_err_t
-flat_file_scan(
-	ion_flat_file_t				*flat_file,
-	ion_fpos_t					start_location,
-	ion_fpos_t					*location,
-	ion_flat_file_row_t			*row,
-	ion_byte_t					scan_direction,
-	ion_flat_file_predicate_t	predicate,
-	...
+/**
+@brief		Computes the file offset of one field of the row at index @p location.
+@details	The field starts @p field_offset bytes into a row held in memory. In the
+			PAX layout, the fields of a block are in stripes that start at
+			@p field_offset times the rows in a block. The row layout works out the
+			same way with blocks of one row.
+*/
+static ion_fpos_t
+flat_file_field_offset(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		location,
+	size_t			field_offset,
+	size_t			field_size
 ) {
-	ion_fpos_t	cur_offset	= flat_file->start_of_data + start_location * flat_file->row_size;
-	ion_fpos_t	end_offset	= ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? flat_file->eof_position : flat_file->start_of_data;
-
-	if (-1 == start_location) {
-		if (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction) {
-			cur_offset = flat_file->start_of_data;
-		}
-		else {
-			cur_offset = flat_file->eof_position;
-		}
-	}
+	ion_fpos_t	block_rows	= 0 == flat_file->block_rows ? 1 : flat_file->block_rows;
+	ion_fpos_t	slot		= location % block_rows;
 
-	/* If we're scanning backwards, bump the cur_offset up one record so that we read the record we're sitting on. */
-	/* We don't do this if we're positioned at the EOF, since otherwise we would read garbage. */
-	if ((ION_FLAT_FILE_SCAN_BACKWARDS == scan_direction) && (cur_offset != flat_file->eof_position)) {
-		cur_offset += flat_file->row_size;
-	}
-
-	if ((cur_offset > flat_file->eof_position) || (cur_offset < flat_file->start_of_data)) {
-		return err_out_of_bounds;
-	}
+	return flat_file->start_of_data + (location - slot) * flat_file->row_size + block_rows * field_offset + slot * field_size;
+}
 
-	while (cur_offset != end_offset) {
-		if (0 != fseek(flat_file->data_file, cur_offset, SEEK_SET)) {
-			return err_file_bad_seek;
-		}
+#if ION_FLAT_FILE_MMAP
 
-		/* We set cur_offset to be the next block to read after this next code segment, so */
-		/* we need t save what block we're currently reading now for location calculation purposes */
-		ion_fpos_t	prev_offset				= cur_offset;
-		size_t		num_records_to_process	= flat_file->num_buffered;
+/**
+@brief		Grows the mapping of the data file to at least @p end bytes, doubling
+			its size so that appends remap rarely.
+@details	The loaded region is dropped, since its rows may be in the old mapping.
+			The old mapping is kept if the new one cannot be made.
+*/
+static ion_err_t
+flat_file_grow_map(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		end
+) {
+	ion_fpos_t	map_size	= 2 * flat_file->map_size < end ? end : 2 * flat_file->map_size;
+	ion_byte_t	*map;
 
-		if (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction) {
-			/* It's possible for this to do a partial read (if you're close to EOF), calculate how many we need to read */
-			size_t records_left = (end_offset - cur_offset) / flat_file->row_size;
+	if (0 != ftruncate(fileno(flat_file->data_file), map_size)) {
+		return err_file_write_error;
+	}
 
-			num_records_to_process = records_left > (unsigned) /* TODO HACK: remove this */ flat_file->num_buffered ? (unsigned) flat_file->num_buffered : records_left;
+	map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(flat_file->data_file), 0);
 
-			if (num_records_to_process != fread(flat_file->buffer, flat_file->row_size, num_records_to_process, flat_file->data_file)) {
-				return err_file_incomplete_read;
-			}
+	if (MAP_FAILED == map) {
+		return err_out_of_memory;
+	}
 
-			if (-1 == (cur_offset = ftell(flat_file->data_file))) {
-				return err_file_read_error;
-			}
-		}
-		else {
-			/* Move the offset pointer to the next read location, clamp it at start_of_file if we go too far. */
-			cur_offset -= flat_file->row_size * flat_file->num_buffered;
+	munmap(flat_file->map, flat_file->map_size);
+	flat_file->map						= map;
+	flat_file->map_size					= map_size;
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+	flat_file->region					= flat_file->buffer;
 
-			if (cur_offset < flat_file->start_of_data) {
-				/* We know how many rows we went past the start of file, calculate it so we don't fread too much */
-				num_records_to_process	= flat_file->num_buffered - (flat_file->start_of_data - cur_offset) / flat_file->row_size;
-				cur_offset				= flat_file->start_of_data;
-			}
+	return err_ok;
+}
 
-			if (0 != fseek(flat_file->data_file, cur_offset, SEEK_SET)) {
-				return err_file_bad_seek;
-			}
+#endif
 
-			if (num_records_to_process != fread(flat_file->buffer, flat_file->row_size, num_records_to_process, flat_file->data_file)) {
-				return err_file_incomplete_read;
-			}
+/**
+@brief		Reads @p size bytes at @p offset in the data file into @p data, copying
+			them out of the mapping if the data file is mapped.
+*/
+static ion_err_t
+flat_file_read_at(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		offset,
+	size_t			size,
+	void			*data
+) {
+	if (0 == size) {
+		return err_ok;
+	}
 
-			/* In this case, the prev_offset is actually the cur_offset. */
-			prev_offset = cur_offset;
+	if (NULL != flat_file->map) {
+		if (offset + (ion_fpos_t) size > flat_file->map_size) {
+			return err_file_incomplete_read;
 		}
 
-		flat_file->current_loaded_region	= (prev_offset - flat_file->start_of_data) / flat_file->row_size;
-		flat_file->num_in_buffer			= num_records_to_process;
-
-		int32_t i;
+		memcpy(data, flat_file->map + offset, size);
+		return err_ok;
+	}
 
-		for (i = ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? 0 : num_records_to_process - 1; ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? (size_t) i < num_records_to_process : i >= 0; ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? i++ : i--) {
-			size_t cur_rec = i * flat_file->row_size;
+	if (0 != fseek(flat_file->data_file, offset, SEEK_SET)) {
+		return err_file_bad_seek;
+	}
 
-			/* This cast is done because in the future, the status could possibly be a non-byte type */
-			row->row_status = *((ion_flat_file_row_status_t *) &flat_file->buffer[cur_rec]);
-			row->key		= &flat_file->buffer[cur_rec + sizeof(ion_flat_file_row_status_t)];
-			row->value		= &flat_file->buffer[cur_rec + sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size];
+	if (1 != fread(data, size, 1, flat_file->data_file)) {
+		return err_file_incomplete_read;
+	}
 
-			va_list predicate_arguments;
+	return err_ok;
+}
 
-			va_start(predicate_arguments, predicate);
+/**
+@brief		Writes @p size bytes from @p data at @p offset in @p file. Writes to the
+			mapped data file are copied into the mapping, which grows as needed.
+*/
+static ion_err_t
+flat_file_write_at(
+	ion_flat_file_t *flat_file,
+	FILE			*file,
+	ion_fpos_t		offset,
+	size_t			size,
+	const void		*data
+) {
+	if (0 == size) {
+		return err_ok;
+	}
 
-			ion_boolean_t predicate_test = predicate(flat_file, row, &predicate_arguments);
+#if ION_FLAT_FILE_MMAP
 
-			va_end(predicate_arguments);
+	if ((NULL != flat_file->map) && (flat_file->data_file == file)) {
+		if (offset + (ion_fpos_t) size > flat_file->map_size) {
+			ion_err_t err = flat_file_grow_map(flat_file, offset + size);
 
-			if (predicate_test) {
-				*location = (prev_offset - flat_file->start_of_data) / flat_file->row_size + i;
-				return err_ok;
+			if (err_ok != err) {
+				return err;
 			}
 		}
-	}
 
-	/* If we reach this point, then no row matched the predicate. */
-	*location = (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
-	return err_file_hit_eof;
-}
+		memcpy(flat_file->map + offset, data, size);
+		return err_ok;
+	}
 
-ion_boolean_t
-flat_file_predicate_not_empty(
-	ion_flat_file_t		*flat_file,
-	ion_flat_file_row_t *row,
-	va_list				*args
-) {
+#else
 	UNUSED(flat_file);
-	UNUSED(args);
+#endif
 
-	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status;
-}
+	if (0 != fseek(file, offset, SEEK_SET)) {
+		return err_file_bad_seek;
+	}
 
-ion_boolean_t
-flat_file_predicate_key_match(
-	ion_flat_file_t		*flat_file,
-	ion_flat_file_row_t *row,
-	va_list				*args
-) {
-	ion_key_t target_key = va_arg(*args, ion_key_t);
+	if (1 != fwrite(data, size, 1, file)) {
+		return err_file_incomplete_write;
+	}
 
-	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status && 0 == flat_file->super.compare(target_key, row->key, flat_file->super.record.key_size);
+	return err_ok;
 }
 
-ion_boolean_t
-flat_file_predicate_within_bounds(
-	ion_flat_file_t		*flat_file,
-	ion_flat_file_row_t *row,
-	va_list				*args
-) {
-	ion_key_t	lower_bound = va_arg(*args, ion_key_t);
-	ion_key_t	upper_bound = va_arg(*args, ion_key_t);
-
-	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status && flat_file->super.compare(row->key, lower_bound, flat_file->super.record.key_size) >= 0 && flat_file->super.compare(row->key, upper_bound, flat_file->super.record.key_size) <= 0;
-}
+#if ION_FLAT_FILE_MMAP
 
 /**
-@brief		Writes the given row out to the data file.
-@details	If the key or value is given as @p NULL, then no write will be performed
-			for that @p NULL key/value. This can be used to perform a status-only write
-			by passing in @p NULL for both the key and value. **NOTE:** The alignment
-			of the write is dependent on the occurence of the writes that come before
-			it. This means that the @p key cannot be @p NULL while the value is not @p NULL.
-			After any call to this function, the internal cache of the flat file is considered
-			to be invalidated.
-@param[in]	flat_file
-				Which flat file instance to write to.
-@param[in]	location
-				Which row index to write to. This function will compute
-				the file offset of the row index.
-@param[in]	row
-				Given row to write out at the destined @p location.
-@return		Resulting status of the several file operations used to commit the write.
+@brief		Writes the mapping out, unmaps the data file, and cuts the data file back
+			to the end of its rows or blocks.
 */
-ion_err_t
-flat_file_write_row(
-	ion_flat_file_t		*flat_file,
-	ion_fpos_t			location,
-	ion_flat_file_row_t *row
+static ion_err_t
+flat_file_unmap(
+	ion_flat_file_t *flat_file
 ) {
-	/* Invalidate the region cache, since data will be mutated. */
-	flat_file->current_loaded_region	= -1;
-	flat_file->num_in_buffer			= 0;
+	ion_fpos_t	end = flat_file->eof_position;
+	ion_err_t	err = err_ok;
 
-	if (0 != fseek(flat_file->data_file, flat_file->start_of_data + location * flat_file->row_size, SEEK_SET)) {
-		return err_file_bad_seek;
+	if (0 < flat_file->block_rows) {
+		end = flat_file->start_of_data + flat_file->num_blocks * flat_file->block_rows * flat_file->row_size;
 	}
 
-	if (1 != fwrite(&row->row_status, sizeof(row->row_status), 1, flat_file->data_file)) {
-		return err_file_incomplete_write;
+	if (0 != msync(flat_file->map, flat_file->map_size, MS_SYNC)) {
+		err = err_file_write_error;
 	}
 
-	if ((NULL != row->key) && (1 != fwrite(row->key, flat_file->super.record.key_size, 1, flat_file->data_file))) {
-		return err_file_incomplete_write;
-	}
+	munmap(flat_file->map, flat_file->map_size);
+	flat_file->map						= NULL;
+	flat_file->map_size					= 0;
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+	flat_file->region					= flat_file->buffer;
 
-	if ((NULL != row->value) && (1 != fwrite(row->value, flat_file->super.record.value_size, 1, flat_file->data_file))) {
-		return err_file_incomplete_write;
+	if ((0 != ftruncate(fileno(flat_file->data_file), end)) && (err_ok == err)) {
+		err = err_file_write_error;
 	}
 
-	return err_ok;
+	return err;
 }
 
-ion_err_t
-flat_file_read_row(
-	ion_flat_file_t		*flat_file,
-	ion_fpos_t			location,
-	ion_flat_file_row_t *row
-) {
-	ion_fpos_t read_index = 0;
+#endif
 
-	if ((flat_file->current_loaded_region != -1) && (location >= flat_file->current_loaded_region) && ((unsigned) location < flat_file->current_loaded_region + flat_file->num_in_buffer)) {
-		/* Cache hit, return directly from buffer */
-		read_index = location - flat_file->current_loaded_region;
+/**
+@brief		Reads @p count rows starting at row index @p first into @p rows, in the
+			row layout.
+@details	The row layout takes a single seek and read. The PAX layout takes one
+			for each block, which covers the statuses and keys of the rows, and
+			their values only if @p with_values is set.
+*/
+static ion_err_t
+flat_file_read_rows(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		first,
+	size_t			count,
+	ion_byte_t		*rows,
+	ion_boolean_t	with_values
+) {
+	size_t		row_size		= flat_file->row_size;
+	size_t		key_size		= flat_file->super.record.key_size;
+	size_t		value_size		= flat_file->super.record.value_size;
+	size_t		value_offset	= sizeof(ion_flat_file_row_status_t) + key_size;
+	ion_fpos_t	block_rows		= flat_file->block_rows;
+	ion_fpos_t	loc;
+	ion_fpos_t	slot;
+	ion_fpos_t	end_slot;
+	ion_fpos_t	low;
+	ion_fpos_t	high;
+	ion_fpos_t	i;
+
+	ion_err_t	err;
+
+	if (0 == block_rows) {
+		return flat_file_read_at(flat_file, flat_file->start_of_data + first * row_size, count * row_size, rows);
 	}
-	else {
-		/* Cache miss, have to re-read from file */
-		if (0 != fseek(flat_file->data_file, flat_file->start_of_data + location * flat_file->row_size, SEEK_SET)) {
-			return err_file_bad_seek;
-		}
 
-		if (1 != fread(flat_file->buffer, sizeof(row->row_status), 1, flat_file->data_file)) {
-			return err_file_incomplete_write;
-		}
+	for (loc = first; loc < first + (ion_fpos_t) count; loc += end_slot - slot) {
+		slot		= loc % block_rows;
+		end_slot	= first + (ion_fpos_t) count - loc + slot < block_rows ? first + (ion_fpos_t) count - loc + slot : block_rows;
+		low			= slot * sizeof(ion_flat_file_row_status_t);
+		high		= with_values ? block_rows * value_offset + end_slot * value_size : block_rows * sizeof(ion_flat_file_row_status_t) + end_slot * key_size;
 
-		if (1 != fread(flat_file->buffer + sizeof(row->row_status), flat_file->super.record.key_size, 1, flat_file->data_file)) {
-			return err_file_incomplete_write;
+		err			= flat_file_read_at(flat_file, flat_file_field_offset(flat_file, loc, 0, sizeof(ion_flat_file_row_status_t)), high - low, flat_file->block_buffer);
+
+		if (err_ok != err) {
+			return err;
 		}
 
-		if (1 != fread(flat_file->buffer + sizeof(row->row_status) + flat_file->super.record.key_size, flat_file->super.record.value_size, 1, flat_file->data_file)) {
-			return err_file_incomplete_write;
+		/* Move each field from its stripe into its row. */
+		for (i = slot; i < end_slot; i++) {
+			ion_byte_t *row = rows + (loc - first + i - slot) * row_size;
+
+			memcpy(row, flat_file->block_buffer + i * sizeof(ion_flat_file_row_status_t) - low, sizeof(ion_flat_file_row_status_t));
+			memcpy(row + sizeof(ion_flat_file_row_status_t), flat_file->block_buffer + block_rows * sizeof(ion_flat_file_row_status_t) + i * key_size - low, key_size);
+
+			if (with_values) {
+				memcpy(row + value_offset, flat_file->block_buffer + block_rows * value_offset + i * value_size - low, value_size);
+			}
 		}
 	}
 
-	row->row_status = *((ion_flat_file_row_status_t *) &flat_file->buffer[read_index * flat_file->row_size]);
-	row->key		= &flat_file->buffer[read_index * flat_file->row_size + sizeof(ion_flat_file_row_status_t)];
-	row->value		= &flat_file->buffer[read_index * flat_file->row_size + sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size];
-
 	return err_ok;
 }
 
-ion_status_t
-flat_file_insert(
+/**
+@brief		Writes @p count rows held in the row layout in @p rows to @p file,
+			starting at row index @p first of a file in the layout with
+			@p block_rows rows in each block.
+@details	In the PAX layout, the values and keys of each block are written
+			before the statuses, so a torn write leaves no row half written.
+			The blocks must already be full size.
+*/
+static ion_err_t
+flat_file_write_rows_to(
 	ion_flat_file_t *flat_file,
-	ion_key_t		key,
-	ion_value_t		value
+	FILE			*file,
+	ion_fpos_t		start_of_data,
+	ion_fpos_t		block_rows,
+	ion_fpos_t		first,
+	size_t			count,
+	ion_byte_t		*rows
 ) {
-	ion_status_t	status	= ION_STATUS_INITIALIZE;
-	ion_err_t		err;
-	/* We can assume append-only insert here because our delete operation does a swap replacement, and
-	   in sorted mode, we don't allow deletes - so there are no holes to fill. */
-	ion_fpos_t insert_loc	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	size_t		row_size		= flat_file->row_size;
+	size_t		field_offset[3] = { sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size, sizeof(ion_flat_file_row_status_t), 0 };
+	size_t		field_size[3]	= { flat_file->super.record.value_size, flat_file->super.record.key_size, sizeof(ion_flat_file_row_status_t) };
+	ion_fpos_t	loc;
+	ion_fpos_t	slot;
+	ion_fpos_t	num_slots;
+	ion_fpos_t	i;
+	int			field;
+
+	ion_err_t	err;
+
+	if (0 == block_rows) {
+		return flat_file_write_at(flat_file, file, start_of_data + first * row_size, count * row_size, rows);
+	}
 
-	if (flat_file->sorted_mode) {
-		ion_fpos_t			last_record_loc = (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size - 1;
-		ion_flat_file_row_t row;
+	for (loc = first; loc < first + (ion_fpos_t) count; loc += num_slots) {
+		slot		= loc % block_rows;
+		num_slots	= first + (ion_fpos_t) count - loc < block_rows - slot ? first + (ion_fpos_t) count - loc : block_rows - slot;
 
-		if (last_record_loc >= 0) {
-			err = flat_file_read_row(flat_file, last_record_loc, &row);
+		for (field = 0; field < 3; field++) {
+			for (i = 0; i < num_slots; i++) {
+				memcpy(flat_file->block_buffer + i * field_size[field], rows + (loc - first + i) * row_size + field_offset[field], field_size[field]);
+			}
+
+			err = flat_file_write_at(flat_file, file, start_of_data + (loc - slot) * row_size + block_rows * field_offset[field] + slot * field_size[field], num_slots * field_size[field], flat_file->block_buffer);
 
 			if (err_ok != err) {
-				status.error = err;
-				return status;
+				return err;
 			}
+		}
+	}
 
-			if (flat_file->super.compare(key, row.key, flat_file->super.record.key_size) < 0) {
-				status.error = err_sorted_order_violation;
-				return status;
+	return err_ok;
+}
+
+/**
+@brief		Makes the data file long enough for the PAX layout blocks holding
+			the rows before index @p end_row.
+@details	Writing the last byte of the last block is enough, and the rows
+			between are read back as empty.
+*/
+static ion_err_t
+flat_file_reserve_blocks(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		end_row
+) {
+	if (0 == flat_file->block_rows) {
+		return err_ok;
+	}
+
+	ion_fpos_t num_blocks = (end_row + flat_file->block_rows - 1) / flat_file->block_rows;
+
+	if (num_blocks <= flat_file->num_blocks) {
+		return err_ok;
+	}
+
+	ion_err_t err = flat_file_write_at(flat_file, flat_file->data_file, flat_file->start_of_data + num_blocks * flat_file->block_rows * flat_file->row_size - 1, 1, &(ion_byte_t) { 0 });
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->num_blocks = num_blocks;
+
+	return err_ok;
+}
+
+/**
+@brief		Writes @p count rows held in the row layout in @p rows to the data
+			file, starting at row index @p first.
+*/
+static ion_err_t
+flat_file_write_rows(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		first,
+	size_t			count,
+	ion_byte_t		*rows
+) {
+	ion_err_t err = flat_file_reserve_blocks(flat_file, first + count);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	return flat_file_write_rows_to(flat_file, flat_file->data_file, flat_file->start_of_data, flat_file->block_rows, first, count, rows);
+}
+
+/**
+@brief		Writes the rows held in the append buffer to the end of the data file.
+@details	This must be done before the data file is read or written at any
+			other place, so that the held rows are found there. In the row
+			layout, this is a single seek and write.
+*/
+static ion_err_t
+flat_file_write_appended(
+	ion_flat_file_t *flat_file
+) {
+	if (0 == flat_file->num_appended) {
+		return err_ok;
+	}
+
+	ion_err_t err = flat_file_write_rows(flat_file, (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size - flat_file->num_appended, flat_file->num_appended, flat_file->append_buffer);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->num_appended = 0;
+
+	return err_ok;
+}
+
+/**
+@brief		Reads the value of the row at index @p location, which is in a loaded
+			region that was read without values, into its place in the buffer.
+*/
+static ion_err_t
+flat_file_load_value(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		location
+) {
+	size_t value_offset = sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size;
+
+	return flat_file_read_at(flat_file, flat_file_field_offset(flat_file, location, value_offset, flat_file->super.record.value_size), flat_file->super.record.value_size, &flat_file->region[(location - flat_file->current_loaded_region) * flat_file->row_size + value_offset]);
+}
+
+/**
+@brief		Reads @p num_rows rows starting at row index @p first into the buffer,
+			and makes them the loaded region.
+@details	In the row layout this is a single seek and read. The values are left
+			out of a PAX layout region unless @p with_values is set. The loaded
+			region is left empty if the read fails.
+*/
+static ion_err_t
+flat_file_load_region(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		first,
+	size_t			num_rows,
+	ion_boolean_t	with_values
+) {
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+
+	flat_file->region					= flat_file->buffer;
+
+	ion_err_t err = flat_file_write_appended(flat_file);
+
+	if ((err_ok == err) && (NULL != flat_file->map) && (0 == flat_file->block_rows)) {
+		/* Mapped rows in the row layout are used in place. */
+		if (flat_file->start_of_data + (first + (ion_fpos_t) num_rows) * (ion_fpos_t) flat_file->row_size > flat_file->map_size) {
+			return err_file_incomplete_read;
+		}
+
+		flat_file->region = flat_file->map + flat_file->start_of_data + first * flat_file->row_size;
+	}
+	else if (err_ok == err) {
+		err = flat_file_read_rows(flat_file, first, num_rows, flat_file->buffer, with_values);
+	}
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->current_loaded_region	= first;
+	flat_file->num_in_buffer			= num_rows;
+	flat_file->region_has_values		= with_values || (0 == flat_file->block_rows);
+
+	return err_ok;
+}
+
+/**
+@brief		Takes @p key into the zone of the row at index @p location.
+@details	The row is either covered by the zones already, and only widens its
+			zone, or is the next row past them. A row that starts a new zone grows
+			the zone array as needed.
+@return		@p boolean_false if the zone array could not grow.
+*/
+static ion_boolean_t
+flat_file_add_to_zone(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		location,
+	ion_key_t		key
+) {
+	ion_key_size_t	key_size	= flat_file->super.record.key_size;
+	ion_fpos_t		zone		= location / flat_file->zone_rows;
+	ion_byte_t		*zone_keys;
+
+	if ((flat_file->num_zoned_rows == location) && (0 == location % flat_file->zone_rows)) {
+		if (zone == flat_file->max_zones) {
+			ion_fpos_t max_zones = 0 == flat_file->max_zones ? 16 : 2 * flat_file->max_zones;
+
+			zone_keys = realloc(flat_file->zone_keys, max_zones * 2 * key_size);
+
+			if (NULL == zone_keys) {
+				return boolean_false;
+			}
+
+			flat_file->zone_keys	= zone_keys;
+			flat_file->max_zones	= max_zones;
+		}
+
+		zone_keys = &flat_file->zone_keys[zone * 2 * key_size];
+		memcpy(zone_keys, key, key_size);
+		memcpy(zone_keys + key_size, key, key_size);
+	}
+	else {
+		zone_keys = &flat_file->zone_keys[zone * 2 * key_size];
+
+		if (flat_file->super.compare(key, zone_keys, key_size) < 0) {
+			memcpy(zone_keys, key, key_size);
+		}
+
+		if (flat_file->super.compare(key, zone_keys + key_size, key_size) > 0) {
+			memcpy(zone_keys + key_size, key, key_size);
+		}
+	}
+
+	if (flat_file->num_zoned_rows == location) {
+		flat_file->num_zoned_rows++;
+	}
+
+	return boolean_true;
+}
+
+/**
+@brief		Brings the zones up to date with the first @p num_rows rows in the file,
+			by reading the keys of the rows they do not cover yet.
+@details	After the flat file is opened this reads every key once. Inserts and
+			deletes keep the zones current after that. The keys of deleted rows are
+			taken in too, which only makes their zones wider.
+*/
+static ion_err_t
+flat_file_update_zones(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		num_rows
+) {
+	ion_fpos_t	count;
+	ion_fpos_t	i;
+	ion_err_t	err;
+
+	while (flat_file->num_zoned_rows < num_rows) {
+		count	= num_rows - flat_file->num_zoned_rows < (ion_fpos_t) flat_file->max_buffered ? num_rows - flat_file->num_zoned_rows : (ion_fpos_t) flat_file->max_buffered;
+		err		= flat_file_load_region(flat_file, flat_file->num_zoned_rows, count, boolean_false);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (!flat_file_add_to_zone(flat_file, flat_file->num_zoned_rows, &flat_file->region[i * flat_file->row_size + sizeof(ion_flat_file_row_status_t)])) {
+				return err_out_of_memory;
+			}
+		}
+	}
+
+	return err_ok;
+}
+
+/**
+@brief		Tests each row of the loaded region against @p target with @p type keys.
+@details	Rows are tested straight out of the buffer without going through the
+			predicate, and equal keys are found by comparing their bytes as
+			one @p type. This is only used when the key fits @p type exactly.
+*/
+#define ION_FLAT_FILE_MATCH_KEYS(type) { \
+		type target_key; \
+		type row_key; \
+		memcpy(&target_key, key, sizeof(type)); \
+		for (; i != end; i += step) { \
+			memcpy(&row_key, &flat_file->region[i * flat_file->row_size + sizeof(ion_flat_file_row_status_t)], sizeof(type)); \
+			if ((target_key == row_key) && (ION_FLAT_FILE_STATUS_OCCUPIED == flat_file->region[i * flat_file->row_size])) { \
+				break; \
+			} \
+		} \
+}
+
+ion_boolean_t
+flat_file_match_key_in_region(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		*location,
+	ion_byte_t		scan_direction,
+	ion_key_t		key
+) {
+	ion_fpos_t	i		= *location - flat_file->current_loaded_region;
+	ion_fpos_t	end		= ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? (ion_fpos_t) flat_file->num_in_buffer : -1;
+	ion_fpos_t	step	= ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? 1 : -1;
+
+	switch (flat_file->super.record.key_size) {
+		case sizeof(uint16_t):
+			ION_FLAT_FILE_MATCH_KEYS(uint16_t);
+			break;
+
+		case sizeof(uint32_t):
+			ION_FLAT_FILE_MATCH_KEYS(uint32_t);
+			break;
+
+		case sizeof(uint64_t):
+			ION_FLAT_FILE_MATCH_KEYS(uint64_t);
+			break;
+
+		default:
+
+			for (; i != end; i += step) {
+				ion_byte_t *cur_row = &flat_file->region[i * flat_file->row_size];
+
+				if ((ION_FLAT_FILE_STATUS_OCCUPIED == cur_row[0]) && (0 == memcmp(key, cur_row + sizeof(ion_flat_file_row_status_t), flat_file->super.record.key_size))) {
+					break;
+				}
+			}
+
+			break;
+	}
+
+	*location = flat_file->current_loaded_region + i;
+
+	return i != end;
+}
+
+#undef ION_FLAT_FILE_MATCH_KEYS
+
+ion_fpos_t
+flat_file_match_key_in_stripe(
+	ion_byte_t		*statuses,
+	ion_byte_t		*keys,
+	ion_key_size_t	key_size,
+	ion_fpos_t		count,
+	ion_key_t		key
+) {
+	ion_fpos_t i = 0;
+
+#if ION_FLAT_FILE_MATCH_LANES > 1
+
+	if ((sizeof(uint16_t) == key_size) || (sizeof(uint32_t) == key_size) || (sizeof(uint64_t) == key_size)) {
+		__m128i			occupied	= _mm_set1_epi8((char) ION_FLAT_FILE_STATUS_OCCUPIED);
+		__m128i			target;
+		__m128i			lanes[4];
+		unsigned int	match;
+		int				j;
+
+		if (sizeof(uint16_t) == key_size) {
+			uint16_t target_key;
+
+			memcpy(&target_key, key, sizeof(target_key));
+			target = _mm_set1_epi16((short) target_key);
+		}
+		else if (sizeof(uint32_t) == key_size) {
+			uint32_t target_key;
+
+			memcpy(&target_key, key, sizeof(target_key));
+			target = _mm_set1_epi32((int) target_key);
+		}
+		else {
+			target = _mm_loadl_epi64((const __m128i *) key);
+			target = _mm_unpacklo_epi64(target, target);
+		}
+
+		for (; i + ION_FLAT_FILE_MATCH_LANES <= count; i += ION_FLAT_FILE_MATCH_LANES) {
+			/* One bit for each of the 16 rows, set where the row is occupied and its key matches. */
+			match = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (statuses + i)), occupied));
+
+			if (0 == match) {
+				continue;
+			}
+
+			if (sizeof(uint16_t) == key_size) {
+				for (j = 0; j < 2; j++) {
+					lanes[j] = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *) (keys + (i + j * 8) * key_size)), target);
+				}
+
+				match &= (unsigned int) _mm_movemask_epi8(_mm_packs_epi16(lanes[0], lanes[1]));
+			}
+			else if (sizeof(uint32_t) == key_size) {
+				for (j = 0; j < 4; j++) {
+					lanes[j] = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (keys + (i + j * 4) * key_size)), target);
+				}
+
+				match &= (unsigned int) _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(lanes[0], lanes[1]), _mm_packs_epi32(lanes[2], lanes[3])));
+			}
+			else {
+				unsigned int	keys_match = 0;
+				__m128i			equal;
+
+				/* An 8 byte key matches when both of its 32 bit halves do. */
+				for (j = 0; j < 8; j++) {
+					equal		= _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (keys + (i + j * 2) * key_size)), target);
+					equal		= _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+					keys_match	|= (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(equal)) << (2 * j);
+				}
+
+				match &= keys_match;
+			}
+
+			if (0 != match) {
+				for (j = 0; 0 == (match & 1); j++) {
+					match >>= 1;
+				}
+
+				return i + j;
 			}
 		}
 	}
 
-	err = flat_file_write_row(flat_file, insert_loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_OCCUPIED, key, value });
+#endif
+
+	for (; i < count; i++) {
+		if ((ION_FLAT_FILE_STATUS_OCCUPIED == statuses[i]) && (0 == memcmp(key, keys + i * key_size, key_size))) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/**
+@brief		Searches the blocks of a PAX layout for the first occupied row with
+			@p key, from row index @p location on, reading only their status and
+			key stripes.
+@details	Each block is read with a single read, as @ref flat_file_read_rows
+			does, but the stripes are searched where they are rather than moved
+			into rows.
+@param[in,out]	location
+					The row index to start at. The row index of the match is
+					written back, or @p num_rows if there is none.
+*/
+static ion_err_t
+flat_file_match_key_in_blocks(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		*location,
+	ion_fpos_t		num_rows,
+	ion_key_t		key
+) {
+	ion_key_size_t	key_size	= flat_file->super.record.key_size;
+	ion_fpos_t		block_rows	= flat_file->block_rows;
+	ion_fpos_t		loc			= *location;
+	ion_fpos_t		slot;
+	ion_fpos_t		end_slot;
+	ion_fpos_t		found;
+	ion_err_t		err;
+
+	err = flat_file_write_appended(flat_file);
+
+	for (; (err_ok == err) && (loc < num_rows); loc += end_slot - slot) {
+		slot		= loc % block_rows;
+		end_slot	= num_rows - loc + slot < block_rows ? num_rows - loc + slot : block_rows;
+
+		/* The statuses from slot on, then the keys up to end_slot. */
+		err			= flat_file_read_at(flat_file, flat_file_field_offset(flat_file, loc, 0, sizeof(ion_flat_file_row_status_t)), block_rows - slot + end_slot * key_size, flat_file->block_buffer);
+
+		if (err_ok != err) {
+			break;
+		}
+
+		found = flat_file_match_key_in_stripe(flat_file->block_buffer, flat_file->block_buffer + block_rows - slot + slot * key_size, key_size, end_slot - slot, key);
+
+		if (found < end_slot - slot) {
+			*location = loc + found;
+			return err_ok;
+		}
+	}
+
+	*location = num_rows;
+
+	return err;
+}
+
+ion_err_t
+flat_file_scan(
+	ion_flat_file_t				*flat_file,
+	ion_fpos_t					start_location,
+	ion_fpos_t					*location,
+	ion_flat_file_row_t			*row,
+	ion_byte_t					scan_direction,
+	ion_flat_file_predicate_t	predicate,
+	...
+) {
+	ion_fpos_t	num_rows	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	ion_fpos_t	cur_loc		= start_location;
+	ion_fpos_t	first;
+	size_t		num_to_read;
+	ion_key_t	match_key	= NULL;
+
+	/* The predicates here only test statuses and keys, so a PAX layout scan for them leaves out the values. */
+	ion_boolean_t with_values = (flat_file_predicate_not_empty != predicate) && (flat_file_predicate_key_match != predicate) && (flat_file_predicate_within_bounds != predicate);
+
+	/* Unsorted range scans pass over the zones whose keys are all out of range. */
+	ion_key_t	lower_bound		= NULL;
+	ion_key_t	upper_bound		= NULL;
+	ion_fpos_t	checked_zone	= -1;
+
+	if ((flat_file_predicate_within_bounds == predicate) && !flat_file->sorted_mode && (0 < flat_file->zone_rows) && (err_ok == flat_file_update_zones(flat_file, num_rows))) {
+		va_list predicate_arguments;
+
+		va_start(predicate_arguments, predicate);
+		lower_bound = va_arg(predicate_arguments, ion_key_t);
+		upper_bound = va_arg(predicate_arguments, ion_key_t);
+		va_end(predicate_arguments);
+	}
+
+	/* Numeric keys are equal exactly when their bytes are, so key matches can skip the predicate. */
+	if ((flat_file_predicate_key_match == predicate) && ((dictionary_compare_signed_value == flat_file->super.compare) || (dictionary_compare_unsigned_value == flat_file->super.compare))) {
+		va_list predicate_arguments;
+
+		va_start(predicate_arguments, predicate);
+		match_key = va_arg(predicate_arguments, ion_key_t);
+		va_end(predicate_arguments);
+	}
+
+	if (-1 == start_location) {
+		cur_loc = ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? 0 : num_rows - 1;
+	}
+	else if ((ION_FLAT_FILE_SCAN_BACKWARDS == scan_direction) && (num_rows == start_location)) {
+		/* Scanning backwards from the EOF starts at the last row. */
+		cur_loc = num_rows - 1;
+	}
+
+	if ((cur_loc > num_rows) || (cur_loc < -1) || ((ION_FLAT_FILE_SCAN_FORWARDS == scan_direction) && (cur_loc < 0))) {
+		return err_out_of_bounds;
+	}
+
+	while (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? cur_loc < num_rows : cur_loc >= 0) {
+		if ((NULL != lower_bound) && (cur_loc / flat_file->zone_rows != checked_zone)) {
+			ion_key_size_t	key_size	= flat_file->super.record.key_size;
+			ion_byte_t		*zone_keys;
+
+			checked_zone	= cur_loc / flat_file->zone_rows;
+			zone_keys		= &flat_file->zone_keys[checked_zone * 2 * key_size];
+
+			if ((flat_file->super.compare(zone_keys + key_size, lower_bound, key_size) < 0) || (flat_file->super.compare(zone_keys, upper_bound, key_size) > 0)) {
+				cur_loc = ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? (checked_zone + 1) * flat_file->zone_rows : checked_zone * flat_file->zone_rows - 1;
+				continue;
+			}
+		}
+
+		if ((-1 == flat_file->current_loaded_region) || (cur_loc < flat_file->current_loaded_region) || ((size_t) cur_loc >= flat_file->current_loaded_region + flat_file->num_in_buffer) || (with_values && !flat_file->region_has_values)) {
+			if ((NULL != match_key) && (0 < flat_file->block_rows) && (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction)) {
+				/* Only the rows from the match on need loading. */
+				ion_err_t err = flat_file_match_key_in_blocks(flat_file, &cur_loc, num_rows, match_key);
+
+				if (err_ok != err) {
+					return err;
+				}
+
+				if (num_rows == cur_loc) {
+					continue;
+				}
+			}
+
+			/* Read more rows at a time while the scan runs on from the loaded region. */
+			num_to_read = flat_file->num_buffered;
+
+			if ((-1 != flat_file->current_loaded_region) && (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? (size_t) cur_loc == flat_file->current_loaded_region + flat_file->num_in_buffer : cur_loc + 1 == flat_file->current_loaded_region)) {
+				num_to_read = 2 * flat_file->num_in_buffer;
+			}
+
+			if (num_to_read > flat_file->max_buffered) {
+				num_to_read = flat_file->max_buffered;
+			}
+
+			/* A backwards read ends at the current row, and both are clamped to the rows in the file. */
+			if (ION_FLAT_FILE_SCAN_FORWARDS == scan_direction) {
+				first = cur_loc;
+
+				if ((ion_fpos_t) num_to_read > num_rows - cur_loc) {
+					num_to_read = num_rows - cur_loc;
+				}
+			}
+			else {
+				if ((ion_fpos_t) num_to_read > cur_loc + 1) {
+					num_to_read = cur_loc + 1;
+				}
+
+				first = cur_loc + 1 - num_to_read;
+			}
+
+			ion_err_t err = flat_file_load_region(flat_file, first, num_to_read, with_values);
+
+			if (err_ok != err) {
+				return err;
+			}
+		}
+
+		if ((NULL != match_key) && !flat_file_match_key_in_region(flat_file, &cur_loc, scan_direction, match_key)) {
+			continue;
+		}
+
+		size_t cur_rec = (cur_loc - flat_file->current_loaded_region) * flat_file->row_size;
+
+		/* This cast is done because in the future, the status could possibly be a non-byte type */
+		row->row_status = *((ion_flat_file_row_status_t *) &flat_file->region[cur_rec]);
+		row->key		= &flat_file->region[cur_rec + sizeof(ion_flat_file_row_status_t)];
+		row->value		= &flat_file->region[cur_rec + sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size];
+
+		va_list predicate_arguments;
+
+		va_start(predicate_arguments, predicate);
+
+		ion_boolean_t predicate_test = predicate(flat_file, row, &predicate_arguments);
+
+		va_end(predicate_arguments);
+
+		if (predicate_test) {
+			if (!flat_file->region_has_values) {
+				ion_err_t err = flat_file_load_value(flat_file, cur_loc);
+
+				if (err_ok != err) {
+					return err;
+				}
+			}
+
+			*location = cur_loc;
+			return err_ok;
+		}
+
+		cur_loc += ION_FLAT_FILE_SCAN_FORWARDS == scan_direction ? 1 : -1;
+	}
+
+	/* If we reach this point, then no row matched the predicate. */
+	*location = num_rows;
+	return err_file_hit_eof;
+}
+
+ion_boolean_t
+flat_file_predicate_not_empty(
+	ion_flat_file_t		*flat_file,
+	ion_flat_file_row_t *row,
+	va_list				*args
+) {
+	UNUSED(flat_file);
+	UNUSED(args);
+
+	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status;
+}
+
+ion_boolean_t
+flat_file_predicate_key_match(
+	ion_flat_file_t		*flat_file,
+	ion_flat_file_row_t *row,
+	va_list				*args
+) {
+	ion_key_t target_key = va_arg(*args, ion_key_t);
+
+	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status && 0 == flat_file->super.compare(target_key, row->key, flat_file->super.record.key_size);
+}
+
+ion_boolean_t
+flat_file_predicate_within_bounds(
+	ion_flat_file_t		*flat_file,
+	ion_flat_file_row_t *row,
+	va_list				*args
+) {
+	ion_key_t	lower_bound = va_arg(*args, ion_key_t);
+	ion_key_t	upper_bound = va_arg(*args, ion_key_t);
+
+	return ION_FLAT_FILE_STATUS_OCCUPIED == row->row_status && flat_file->super.compare(row->key, lower_bound, flat_file->super.record.key_size) >= 0 && flat_file->super.compare(row->key, upper_bound, flat_file->super.record.key_size) <= 0;
+}
+
+/**
+@brief		Writes the given row out to the data file.
+@details	If the key or value is given as @p NULL, then no write will be performed
+			for that @p NULL key/value. This can be used to perform a status-only write
+			by passing in @p NULL for both the key and value. **NOTE:** The alignment
+			of the write is dependent on the occurence of the writes that come before
+			it. This means that the @p key cannot be @p NULL while the value is not @p NULL.
+			After any call to this function, the internal cache of the flat file is considered
+			to be invalidated, except for status-only writes to rows in the loaded region.
+@param[in]	flat_file
+				Which flat file instance to write to.
+@param[in]	location
+				Which row index to write to. This function will compute
+				the file offset of the row index.
+@param[in]	row
+				Given row to write out at the destined @p location.
+@return		Resulting status of the several file operations used to commit the write.
+*/
+ion_err_t
+flat_file_write_row(
+	ion_flat_file_t		*flat_file,
+	ion_fpos_t			location,
+	ion_flat_file_row_t *row
+) {
+	ion_err_t err = flat_file_write_appended(flat_file);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	if ((NULL == row->key) && (NULL == row->value) && (-1 != flat_file->current_loaded_region) && (location >= flat_file->current_loaded_region) && ((size_t) location < flat_file->current_loaded_region + flat_file->num_in_buffer)) {
+		/* A status-only write to a loaded row is made to the buffer too, so the region stays loaded. */
+		flat_file->region[(location - flat_file->current_loaded_region) * flat_file->row_size] = row->row_status;
+	}
+	else {
+		/* Invalidate the region cache, since data will be mutated. */
+		flat_file->current_loaded_region	= -1;
+		flat_file->num_in_buffer			= 0;
+	}
+
+	if (0 < flat_file->block_rows) {
+		/* Each field goes to its own stripe, and the status last, so a torn write leaves no half written row. */
+		void	*field[3]			= { row->value, row->key, &row->row_status };
+		size_t	field_offset[3]		= { sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size, sizeof(ion_flat_file_row_status_t), 0 };
+		size_t	field_size[3]		= { flat_file->super.record.value_size, flat_file->super.record.key_size, sizeof(ion_flat_file_row_status_t) };
+		int		i;
+
+		err = flat_file_reserve_blocks(flat_file, location + 1);
+
+		for (i = 0; (err_ok == err) && (i < 3); i++) {
+			if (NULL == field[i]) {
+				continue;
+			}
+
+			err = flat_file_write_at(flat_file, flat_file->data_file, flat_file_field_offset(flat_file, location, field_offset[i], field_size[i]), field_size[i], field[i]);
+		}
+
+		return err;
+	}
+
+	ion_fpos_t offset = flat_file->start_of_data + location * flat_file->row_size;
+
+	err = flat_file_write_at(flat_file, flat_file->data_file, offset, sizeof(row->row_status), &row->row_status);
+
+	if ((err_ok == err) && (NULL != row->key)) {
+		err = flat_file_write_at(flat_file, flat_file->data_file, offset + sizeof(row->row_status), flat_file->super.record.key_size, row->key);
+	}
+
+	if ((err_ok == err) && (NULL != row->value)) {
+		err = flat_file_write_at(flat_file, flat_file->data_file, offset + sizeof(row->row_status) + flat_file->super.record.key_size, flat_file->super.record.value_size, row->value);
+	}
+
+	return err;
+}
+
+ion_err_t
+flat_file_read_row(
+	ion_flat_file_t		*flat_file,
+	ion_fpos_t			location,
+	ion_flat_file_row_t *row
+) {
+	ion_fpos_t read_index = 0;
+
+	if ((flat_file->current_loaded_region != -1) && (location >= flat_file->current_loaded_region) && ((unsigned) location < flat_file->current_loaded_region + flat_file->num_in_buffer)) {
+		/* Cache hit, return directly from buffer */
+		read_index = location - flat_file->current_loaded_region;
+
+		if (!flat_file->region_has_values) {
+			ion_err_t err = flat_file_load_value(flat_file, location);
+
+			if (err_ok != err) {
+				return err;
+			}
+		}
+	}
+	else {
+		/* Cache miss, have to re-read from file. This overwrites the start of the loaded region. */
+		ion_err_t err = flat_file_load_region(flat_file, location, 1, boolean_true);
+
+		if (err_ok != err) {
+			return err;
+		}
+	}
+
+	row->row_status = *((ion_flat_file_row_status_t *) &flat_file->region[read_index * flat_file->row_size]);
+	row->key		= &flat_file->region[read_index * flat_file->row_size + sizeof(ion_flat_file_row_status_t)];
+	row->value		= &flat_file->region[read_index * flat_file->row_size + sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size];
+
+	return err_ok;
+}
+
+/**
+@brief		Appends @p key as the fence of the next block, growing the fence array as needed.
+@return		@p boolean_false if the fence array could not grow.
+*/
+static ion_boolean_t
+flat_file_add_fence(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key
+) {
+	if (flat_file->num_fences == flat_file->max_fences) {
+		ion_fpos_t	max_fences	= 0 == flat_file->max_fences ? 16 : 2 * flat_file->max_fences;
+		ion_byte_t	*fence_keys = realloc(flat_file->fence_keys, max_fences * flat_file->super.record.key_size);
+
+		if (NULL == fence_keys) {
+			return boolean_false;
+		}
+
+		flat_file->fence_keys	= fence_keys;
+		flat_file->max_fences	= max_fences;
+	}
+
+	memcpy(&flat_file->fence_keys[flat_file->num_fences * flat_file->super.record.key_size], key, flat_file->super.record.key_size);
+	flat_file->num_fences++;
+
+	return boolean_true;
+}
+
+/**
+@brief		Brings the fences up to date with the rows in the file, by reading
+			the first row of each block that does not have a fence yet.
+@details	After the flat file is opened this builds the whole fence array.
+			Appends keep it current after that.
+*/
+static ion_err_t
+flat_file_update_fences(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		num_rows
+) {
+	ion_err_t			err;
+	ion_flat_file_row_t row;
+
+	while (flat_file->num_fences * flat_file->fence_rows < num_rows) {
+		err = flat_file_read_row(flat_file, flat_file->num_fences * flat_file->fence_rows, &row);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		if (!flat_file_add_fence(flat_file, row.key)) {
+			return err_out_of_memory;
+		}
+	}
+
+	return err_ok;
+}
+
+ion_status_t
+flat_file_insert(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key,
+	ion_value_t		value
+) {
+	ion_status_t	status	= ION_STATUS_INITIALIZE;
+	ion_err_t		err;
+	/* We can assume append-only insert here because our delete operation either does a swap replacement,
+	   or leaves holes that are only reclaimed by compaction. A deleted last row still bounds sorted order. */
+	ion_fpos_t insert_loc	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+
+	if (flat_file->sorted_mode && (insert_loc > 0)) {
+		ion_flat_file_row_t row;
+
+		if (0 < flat_file->num_appended) {
+			/* The last row is still held in memory. */
+			row.key = &flat_file->append_buffer[(flat_file->num_appended - 1) * flat_file->row_size + sizeof(ion_flat_file_row_status_t)];
+		}
+		else {
+			err = flat_file_read_row(flat_file, insert_loc - 1, &row);
+
+			if (err_ok != err) {
+				status.error = err;
+				return status;
+			}
+		}
+
+		if (flat_file->super.compare(key, row.key, flat_file->super.record.key_size) < 0) {
+			status.error = err_sorted_order_violation;
+			return status;
+		}
+	}
+
+	if (0 == flat_file->max_appended) {
+		err = flat_file_write_row(flat_file, insert_loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_OCCUPIED, key, value });
+	}
+	else {
+		/* Hold the row until the append buffer fills, then write all of them at once. */
+		err = flat_file->num_appended == flat_file->max_appended ? flat_file_write_appended(flat_file) : err_ok;
+
+		/* A delete can leave the loaded region holding the emptied row this one takes the place of. */
+		if ((-1 != flat_file->current_loaded_region) && (flat_file->current_loaded_region + (ion_fpos_t) flat_file->num_in_buffer > insert_loc)) {
+			flat_file->current_loaded_region	= -1;
+			flat_file->num_in_buffer			= 0;
+		}
+
+		if (err_ok == err) {
+			ion_byte_t *appended = &flat_file->append_buffer[flat_file->num_appended * flat_file->row_size];
+
+			appended[0] = ION_FLAT_FILE_STATUS_OCCUPIED;
+			memcpy(appended + sizeof(ion_flat_file_row_status_t), key, flat_file->super.record.key_size);
+			memcpy(appended + sizeof(ion_flat_file_row_status_t) + flat_file->super.record.key_size, value, flat_file->super.record.value_size);
+			flat_file->num_appended++;
+		}
+	}
+
+	if (err_ok != err) {
+		status.error = err;
+		return status;
+	}
+
+	flat_file->eof_position += flat_file->row_size;
+
+	/* Keep the fences current if this row starts a new block. Otherwise the next search catches them up. */
+	if (flat_file->sorted_mode && (flat_file->num_fences * flat_file->fence_rows == insert_loc)) {
+		flat_file_add_fence(flat_file, key);
+	}
+
+	/* Likewise the zones, if they cover every row before this one. */
+	if (!flat_file->sorted_mode && (0 < flat_file->zone_rows) && (flat_file->num_zoned_rows == insert_loc)) {
+		flat_file_add_to_zone(flat_file, insert_loc, key);
+	}
+
+	status.error	= err_ok;
+	status.count	= 1;
+	return status;
+}
+
+ion_status_t
+flat_file_get(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key,
+	ion_value_t		value
+) {
+	ion_status_t		status		= ION_STATUS_INITIALIZE;
+	ion_err_t			err;
+	ion_fpos_t			found_loc	= -1;
+	ion_flat_file_row_t row;
+
+	if (!flat_file->sorted_mode) {
+		err = flat_file_scan(flat_file, -1, &found_loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key);
+
+		if (err_ok != err) {
+			if (err_file_hit_eof == err) {
+				/* Alias the error since in this case, since hitting the EOF signifies */
+				/* that we didn't find what we were looking for */
+				status.error = err_item_not_found;
+			}
+			else {
+				/* This error takes priority since it is likely a file I/O issue */
+				status.error = err;
+			}
+
+			return status;
+		}
+	}
+	else {
+		err = flat_file_binary_search(flat_file, key, &found_loc);
+
+		if (err_ok != err) {
+			status.error = err;
+			return status;
+		}
+
+		err = flat_file_read_row(flat_file, found_loc, &row);
+
+		if (err_ok != err) {
+			status.error = err;
+			return status;
+		}
+
+		if (0 != flat_file->super.compare(row.key, key, flat_file->super.record.key_size)) {
+			status.error = err_item_not_found;
+			return status;
+		}
+	}
+
+	memcpy(value, row.value, flat_file->super.record.value_size);
+	status.error	= err_ok;
+	status.count	= 1;
+
+	return status;
+}
+
+/**
+@brief		Cuts the data file after the first @p end_row rows, once compaction has
+			moved the live rows ahead of the rest.
+@details	The PAX layout keeps the whole block holding the last row, so the
+			rows after it in that block are marked empty. A mapped file is cut
+			and then made its mapped size again, which reads back as empty rows.
+			SD files cannot be made shorter, so on Arduino every row past the
+			cut is marked empty instead.
+@param[in]	flat_file
+				Which flat file to cut.
+@param[in]	end_row
+				How many rows to keep.
+@param[in]	num_rows
+				How many rows there were before compaction.
+@return		The resulting status of the writes.
+*/
+static ion_err_t
+flat_file_truncate(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		end_row,
+	ion_fpos_t		num_rows
+) {
+	ion_fpos_t	block_rows	= flat_file->block_rows;
+	ion_fpos_t	keep_rows	= end_row;
+	ion_fpos_t	clear_to	= num_rows;
+	ion_fpos_t	first;
+	size_t		count;
+	ion_err_t	err;
+
+	if (0 < block_rows) {
+		keep_rows = (end_row + block_rows - 1) / block_rows * block_rows;
+	}
+
+#if !defined(ARDUINO)
+
+	if (keep_rows < clear_to) {
+		clear_to = keep_rows;
+	}
+
+#endif
+
+	memset(flat_file->buffer, ION_FLAT_FILE_STATUS_EMPTY, flat_file->max_buffered * flat_file->row_size);
+
+	for (first = end_row; first < clear_to; first += count) {
+		count	= clear_to - first < (ion_fpos_t) flat_file->max_buffered ? (size_t) (clear_to - first) : flat_file->max_buffered;
+		err		= flat_file_write_rows(flat_file, first, count, flat_file->buffer);
+
+		if (err_ok != err) {
+			return err;
+		}
+	}
+
+#if !defined(ARDUINO)
+
+	ion_fpos_t		end = flat_file->start_of_data + keep_rows * flat_file->row_size;
+	ion_boolean_t	cut = (0 == fflush(flat_file->data_file)) && (0 == ftruncate(fileno(flat_file->data_file), end));
+
+#if ION_FLAT_FILE_MMAP
+
+	if (cut && (NULL != flat_file->map)) {
+		/* The mapping still covers the rows past the cut, so the file has to reach that far again. */
+		cut = 0 == ftruncate(fileno(flat_file->data_file), flat_file->map_size);
+	}
+
+#endif
+
+	if (!cut) {
+		return err_file_write_error;
+	}
+
+	if (0 < block_rows) {
+		flat_file->num_blocks = keep_rows / block_rows;
+	}
+
+#endif
+
+	return err_ok;
+}
+
+ion_err_t
+flat_file_compact(
+	ion_flat_file_t *flat_file
+) {
+	ion_fpos_t	num_rows	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	ion_fpos_t	read_loc;
+	ion_fpos_t	write_loc	= 0;
+	size_t		count;
+	size_t		num_live;
+	size_t		i;
+	ion_err_t	err;
+
+	err = flat_file_write_appended(flat_file);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+	flat_file->region					= flat_file->buffer;
+
+	/* Read the file a buffer at a time and write its live rows back over the start of the file. */
+	for (read_loc = 0; read_loc < num_rows; read_loc += count) {
+		count	= num_rows - read_loc < (ion_fpos_t) flat_file->max_buffered ? (size_t) (num_rows - read_loc) : flat_file->max_buffered;
+		err		= flat_file_read_rows(flat_file, read_loc, count, flat_file->buffer, boolean_true);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		num_live = 0;
+
+		for (i = 0; i < count; i++) {
+			if (ION_FLAT_FILE_STATUS_EMPTY != flat_file->buffer[i * flat_file->row_size]) {
+				if (num_live != i) {
+					memcpy(&flat_file->buffer[num_live * flat_file->row_size], &flat_file->buffer[i * flat_file->row_size], flat_file->row_size);
+				}
+
+				num_live++;
+			}
+		}
+
+		if ((write_loc != read_loc) || (num_live != count)) {
+			err = flat_file_write_rows(flat_file, write_loc, num_live, flat_file->buffer);
+
+			if (err_ok != err) {
+				return err;
+			}
+		}
+
+		write_loc += num_live;
+	}
+
+	/* Drop the rows past the new end, so that they are not found again when the file is reopened. */
+	err = flat_file_truncate(flat_file, write_loc, num_rows);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->eof_position		= flat_file->start_of_data + write_loc * flat_file->row_size;
+	flat_file->num_dead_rows	= 0;
+	flat_file->num_fences		= 0;
+	flat_file->num_zoned_rows	= 0;
+
+	return err_ok;
+}
+
+/**
+@brief		Counts the rows before the end of the rows that are marked empty, when
+			the file was not closed cleanly and so its header does not say.
+*/
+static ion_err_t
+flat_file_count_dead_rows(
+	ion_flat_file_t *flat_file
+) {
+	ion_fpos_t	num_rows	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	ion_fpos_t	num_dead	= 0;
+	ion_fpos_t	first;
+	size_t		count;
+	size_t		i;
+	ion_err_t	err;
+
+	err = flat_file_write_appended(flat_file);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+	flat_file->region					= flat_file->buffer;
+
+	for (first = 0; first < num_rows; first += count) {
+		count	= num_rows - first < (ion_fpos_t) flat_file->max_buffered ? (size_t) (num_rows - first) : flat_file->max_buffered;
+		err		= flat_file_read_rows(flat_file, first, count, flat_file->buffer, boolean_false);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (ION_FLAT_FILE_STATUS_EMPTY == flat_file->buffer[i * flat_file->row_size]) {
+				num_dead++;
+			}
+		}
+	}
+
+	flat_file->num_dead_rows = num_dead;
+
+	return err_ok;
+}
+
+/**
+@brief		Deletes all records stored with the given @p key by marking their rows empty.
+@details	Rows are not moved, so sorted mode stays sorted and the other rows keep
+			their order. Once @ref ION_FLAT_FILE_COMPACT_PERCENT of the rows are
+			dead, the file is compacted.
+*/
+static ion_status_t
+flat_file_delete_tombstone(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key
+) {
+	ion_status_t		status	= ION_STATUS_INITIALIZE;
+	ion_flat_file_row_t row;
+	ion_err_t			err;
+	ion_fpos_t			loc		= -1;
+
+	status.count = 0;
+
+	if (flat_file->sorted_mode) {
+		/* The matches are the live rows from the first match until a greater key. */
+		err = flat_file_binary_search(flat_file, key, &loc);
+
+		while ((err_ok == err) && (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty))) && (0 == flat_file->super.compare(row.key, key, flat_file->super.record.key_size))) {
+			err = flat_file_write_row(flat_file, loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_EMPTY, NULL, NULL });
+			status.count++;
+			loc++;
+		}
+	}
+	else {
+		while (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key))) {
+			err = flat_file_write_row(flat_file, loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_EMPTY, NULL, NULL });
+
+			if (err_ok != err) {
+				break;
+			}
+
+			status.count++;
+			loc++;
+		}
+	}
+
+	if ((err_ok != err) && (err_file_hit_eof != err) && (err_item_not_found != err)) {
+		status.error = err;
+		return status;
+	}
+
+	if (0 == status.count) {
+		status.error = err_item_not_found;
+		return status;
+	}
+
+	if (-1 == flat_file->num_dead_rows) {
+		/* The rows just deleted are counted along with the rest. */
+		status.error = flat_file_count_dead_rows(flat_file);
+
+		if (err_ok != status.error) {
+			return status;
+		}
+	}
+	else {
+		flat_file->num_dead_rows += status.count;
+	}
+
+	ion_fpos_t num_rows = (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+
+	status.error = err_ok;
+
+	if (flat_file->num_dead_rows * 100 >= num_rows * ION_FLAT_FILE_COMPACT_PERCENT) {
+		status.error = flat_file_compact(flat_file);
+	}
+
+	return status;
+}
+
+ion_status_t
+flat_file_delete(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key
+) {
+	if (flat_file->sorted_mode || flat_file->tombstone_deletes) {
+		return flat_file_delete_tombstone(flat_file, key);
+	}
+
+	ion_status_t		status	= ION_STATUS_INITIALIZE;
+	ion_flat_file_row_t row;
+	ion_err_t			err;
+	ion_fpos_t			loc		= -1;
+
+	while (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key))) {
+		ion_fpos_t			last_record_offset	= flat_file->eof_position - flat_file->row_size;
+		ion_flat_file_row_t last_row;
+		ion_fpos_t			last_record_index	= (last_record_offset - flat_file->start_of_data) / flat_file->row_size;
+		ion_err_t			row_err;
+
+		/* If the last index and the loc are the same, then we can just move the eof position. Saves a read/write. */
+		if (last_record_index != loc) {
+			row_err = flat_file_read_row(flat_file, last_record_index, &last_row);
+
+			if (err_ok != row_err) {
+				status.error = row_err;
+				return status;
+			}
+
+			/* The last row's key moves into the zone of the row it replaces. */
+			if (loc < flat_file->num_zoned_rows) {
+				flat_file_add_to_zone(flat_file, loc, last_row.key);
+			}
+
+			row_err = flat_file_write_row(flat_file, loc, &last_row);
+
+			if (err_ok != row_err) {
+				status.error = row_err;
+				return status;
+			}
+		}
+
+		/* Set last row to be empty just for sanity reasons. */
+		row_err = flat_file_write_row(flat_file, last_record_index, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_EMPTY, NULL, NULL });
+
+		if (err_ok != row_err) {
+			status.error = row_err;
+			return status;
+		}
+
+		/* Soft truncate the file by bumping the eof position back to cut off the last record. */
+		flat_file->eof_position = last_record_offset;
+		flat_file->num_fences	= 0;
+
+		if (flat_file->num_zoned_rows > last_record_index) {
+			flat_file->num_zoned_rows = last_record_index;
+		}
+		status.count++;
+
+		/* No location movement is done here, since we need to check the row we just swapped in to see if it is
+		   also a match. */
+	}
+
+	status.error = err_ok;
+
+	if (((err == err_file_hit_eof) || (-1 == loc)) && (status.count == 0)) {
+		status.error = err_item_not_found;
+	}
+	else if (err != err_file_hit_eof) {
+		status.error = err;
+	}
+
+	return status;
+}
+
+ion_status_t
+flat_file_update(
+	ion_flat_file_t *flat_file,
+	ion_key_t		key,
+	ion_value_t		value
+) {
+	ion_status_t status		= ION_STATUS_INITIALIZE;
+
+	ion_fpos_t			loc = -1;
+	ion_flat_file_row_t row;
+	ion_err_t			err;
+
+	if (flat_file->sorted_mode) {
+		err = flat_file_binary_search(flat_file, key, &loc);
+
+		if (err_ok != err) {
+			if (err_item_not_found == err) {
+				/* Key didn't exist, do upsert. This may fail because it violates the sorted order. */
+				return flat_file_insert(flat_file, key, value);
+			}
+
+			status.error = err;
+			return status;
+		}
+
+		err = flat_file_read_row(flat_file, loc, &row);
+
+		if (err_ok != err) {
+			status.error = err;
+			return status;
+		}
+
+		if (0 != flat_file->super.compare(row.key, key, flat_file->super.record.key_size)) {
+			/* Key didn't exist, do upsert. */
+			return flat_file_insert(flat_file, key, value);
+		}
+	}
+
+	while (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key))) {
+		ion_err_t row_err = flat_file_write_row(flat_file, loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_OCCUPIED, key, value });
+
+		if (err_ok != row_err) {
+			status.error = row_err;
+			return status;
+		}
+
+		status.count++;
+		/* Move one-forwards to skip the one we just updated */
+		loc++;
+	}
+
+	status.error = err_ok;
+
+	if ((err == err_file_hit_eof) && (status.count == 0)) {
+		/* If this is the case, then we had nothing to update. Do an upsert instead */
+		return flat_file_insert(flat_file, key, value);
+	}
+	else if (err != err_file_hit_eof) {
+		status.error = err;
+	}
+
+	return status;
+}
+
+ion_err_t
+flat_file_flush(
+	ion_flat_file_t *flat_file
+) {
+	ion_err_t err = flat_file_write_appended(flat_file);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+#if ION_FLAT_FILE_MMAP
+
+	if ((NULL != flat_file->map) && (0 != msync(flat_file->map, flat_file->map_size, MS_SYNC))) {
+		return err_file_write_error;
+	}
+
+#endif
+
+	if (0 != fflush(flat_file->data_file)) {
+		return err_file_write_error;
+	}
+
+	return err_ok;
+}
+
+ion_err_t
+flat_file_use_pax_layout(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		block_rows
+) {
+	if (0 >= block_rows) {
+		return err_invalid_initial_size;
+	}
+
+	/* The layout of the rows can only change while the data file holds none, and is not mapped. */
+	if ((NULL != flat_file->map) || (0 != flat_file->block_rows) || (flat_file->start_of_data != flat_file->eof_position) || (0 != fseek(flat_file->data_file, 0, SEEK_END)) || (flat_file->start_of_data != ftell(flat_file->data_file))) {
+		return err_illegal_state;
+	}
+
+	ion_byte_t *block_buffer = malloc(block_rows * flat_file->row_size);
+
+	if (NULL == block_buffer) {
+		return err_out_of_memory;
+	}
+
+	/* Files with the older single word header take the versioned one, which has room for the layout. */
+	flat_file->header_version	= ION_FLAT_FILE_HEADER_VERSION;
+	flat_file->start_of_data	= sizeof(ion_flat_file_header_t);
+	flat_file->eof_position		= flat_file->start_of_data;
+	flat_file->block_rows		= block_rows;
+
+	ion_err_t err = flat_file_write_header(flat_file, flat_file->data_file, flat_file->sorted_mode, boolean_false);
+
+	if (err_ok != err) {
+		free(block_buffer);
+		flat_file->block_rows = 0;
+		return err;
+	}
+
+	flat_file->num_blocks				= 0;
+	flat_file->block_buffer				= block_buffer;
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+
+	return err_ok;
+}
+
+ion_err_t
+flat_file_use_mmap(
+	ion_flat_file_t *flat_file
+) {
+#if ION_FLAT_FILE_MMAP
+
+	if (NULL != flat_file->map) {
+		return err_illegal_state;
+	}
+
+	/* Anything written through the stream goes to the file before it is mapped. */
+	ion_err_t err = flat_file_flush(flat_file);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	if (0 != fseek(flat_file->data_file, 0, SEEK_END)) {
+		return err_file_bad_seek;
+	}
+
+	ion_fpos_t	map_size	= ftell(flat_file->data_file);
+	ion_byte_t	*map;
+
+	if (map_size < flat_file->eof_position) {
+		map_size = flat_file->eof_position;
+	}
+
+	if (0 != ftruncate(fileno(flat_file->data_file), map_size)) {
+		return err_file_write_error;
+	}
+
+	map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(flat_file->data_file), 0);
+
+	if (MAP_FAILED == map) {
+		return err_out_of_memory;
+	}
+
+	flat_file->map						= map;
+	flat_file->map_size					= map_size;
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+
+	return err_ok;
+#else
+	UNUSED(flat_file);
+	return err_not_implemented;
+#endif
+}
+
+ion_err_t
+flat_file_close(
+	ion_flat_file_t *flat_file
+) {
+	/* A failed seal can leave the flat file without a data file. Then only the buffers are freed. */
+	ion_err_t err = NULL == flat_file->data_file ? err_file_open_error : err_ok;
+
+	/* The file is closed even if the held rows could not be written. */
+	if (err_ok == err) {
+		err = flat_file_write_appended(flat_file);
+	}
+
+#if ION_FLAT_FILE_MMAP
+
+	if (NULL != flat_file->map) {
+		ion_err_t unmap_err = flat_file_unmap(flat_file);
+
+		if (err_ok == err) {
+			err = unmap_err;
+		}
+	}
+
+#endif
+
+	/* Once every row is written, the header can say where they end, so the next open need not look. */
+	if ((err_ok == err) && (0 < flat_file->header_version)) {
+		err = flat_file_write_header(flat_file, flat_file->data_file, flat_file->sorted_mode, boolean_true);
+	}
+
+	free(flat_file->buffer);
+	flat_file->buffer			= NULL;
+	free(flat_file->append_buffer);
+	flat_file->append_buffer	= NULL;
+	flat_file->num_appended		= 0;
+	free(flat_file->block_buffer);
+	flat_file->block_buffer		= NULL;
+	free(flat_file->fence_keys);
+	flat_file->fence_keys		= NULL;
+	flat_file->num_fences		= 0;
+	flat_file->max_fences		= 0;
+	free(flat_file->zone_keys);
+	flat_file->zone_keys		= NULL;
+	flat_file->num_zoned_rows	= 0;
+	flat_file->max_zones		= 0;
+
+	if ((NULL != flat_file->data_file) && (0 != fclose(flat_file->data_file))) {
+		return err_file_close_error;
+	}
+
+	return err;
+}
+
+/**
+@brief		Binary search through the fences in memory, then within one block
+			read in full, with the same results as the plain binary search.
+*/
+static ion_err_t
+flat_file_fence_search(
+	ion_flat_file_t *flat_file,
+	ion_key_t		target_key,
+	ion_fpos_t		num_rows,
+	ion_fpos_t		*location
+) {
+	ion_key_size_t	key_size	= flat_file->super.record.key_size;
+	ion_fpos_t		low_idx		= 0;
+	ion_fpos_t		high_idx	= flat_file->num_fences;
+	ion_fpos_t		mid_idx;
+
+	/* Find the first fence that is not less than the target. */
+	while (low_idx < high_idx) {
+		mid_idx = low_idx + (high_idx - low_idx) / 2;
+
+		if (flat_file->super.compare(&flat_file->fence_keys[mid_idx * key_size], target_key, key_size) < 0) {
+			low_idx = mid_idx + 1;
+		}
+		else {
+			high_idx = mid_idx;
+		}
+	}
+
+	ion_fpos_t		fence		= low_idx;
+	ion_boolean_t	fence_equal = fence < flat_file->num_fences && 0 == flat_file->super.compare(&flat_file->fence_keys[fence * key_size], target_key, key_size);
+
+	if (0 == fence) {
+		/* Every key is at least the target, so only the first row can be a match. */
+		*location = fence_equal ? 0 : -1;
+		return fence_equal ? err_ok : err_item_not_found;
+	}
+
+	/* The rows not greater than the target, and the start of any duplicates, end in the block before. */
+	ion_fpos_t	first	= (fence - 1) * flat_file->fence_rows;
+	ion_fpos_t	count	= num_rows - first < flat_file->fence_rows ? num_rows - first : flat_file->fence_rows;
+
+	if ((-1 == flat_file->current_loaded_region) || (flat_file->current_loaded_region > first) || ((size_t) (first - flat_file->current_loaded_region + count) > flat_file->num_in_buffer)) {
+		ion_err_t err = flat_file_load_region(flat_file, first, count, boolean_false);
+
+		if (err_ok != err) {
+			return err;
+		}
+	}
+
+	ion_byte_t *block = &flat_file->region[(first - flat_file->current_loaded_region) * flat_file->row_size + sizeof(ion_flat_file_row_status_t)];
+
+	/* Then find the first row in the block that is not less than the target. The first row is less. */
+	low_idx		= 1;
+	high_idx	= count;
+
+	while (low_idx < high_idx) {
+		mid_idx = low_idx + (high_idx - low_idx) / 2;
+
+		if (flat_file->super.compare(&block[mid_idx * flat_file->row_size], target_key, key_size) < 0) {
+			low_idx = mid_idx + 1;
+		}
+		else {
+			high_idx = mid_idx;
+		}
+	}
+
+	if ((low_idx < count) && (0 == flat_file->super.compare(&block[low_idx * flat_file->row_size], target_key, key_size))) {
+		*location = first + low_idx;
+	}
+	else if ((low_idx == count) && fence_equal) {
+		/* The duplicates start with the next block. */
+		*location = first + count;
+	}
+	else {
+		*location = first + low_idx - 1;
+	}
+
+	return err_ok;
+}
+
+/**
+@brief		Binary search by key alone, which can land on a deleted row.
+*/
+static ion_err_t
+flat_file_binary_search_rows(
+	ion_flat_file_t *flat_file,
+	ion_key_t		target_key,
+	ion_fpos_t		*location
+) {
+	ion_err_t			err;
+	ion_flat_file_row_t row;
+	ion_fpos_t			low_idx		= 0;
+	ion_fpos_t			high_idx	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size - 1;
+	ion_fpos_t			mid_idx;
+
+	if (high_idx < 0) {
+		/* We're empty, short circuit */
+		*location = -1;
+		return err_item_not_found;
+	}
+
+	/* With fences in memory, a search costs one block read instead of a read per probe. */
+	if ((0 < flat_file->fence_rows) && (err_ok == flat_file_update_fences(flat_file, high_idx + 1))) {
+		return flat_file_fence_search(flat_file, target_key, high_idx + 1, location);
+	}
+
+	while (low_idx < high_idx) {
+		mid_idx = low_idx + (high_idx - low_idx) / 2;
+		err		= flat_file_read_row(flat_file, mid_idx, &row);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		char comp_result = flat_file->super.compare(target_key, row.key, flat_file->super.record.key_size);
+
+		if (comp_result > 0) {
+			low_idx = mid_idx + 1;
+		}
+		else if (comp_result < 0) {
+			high_idx = mid_idx - 1;
+		}
+		else {
+			/* Match found, scroll to beginning of (potential) duplicate block and return */
+			ion_fpos_t dup_idx = mid_idx;
+
+			while (dup_idx > 0) {
+				err = flat_file_read_row(flat_file, dup_idx - 1, &row);
+
+				if (err_ok != err) {
+					return err;
+				}
+
+				if (0 != flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size)) {
+					break;
+				}
+
+				dup_idx--;
+			}
+
+			*location = dup_idx;
+			return err_ok;
+		}
+	}
+
+	/* If we reach here, then we fell through the loop - do check and adjust for LEQ as necessary */
+	err = flat_file_read_row(flat_file, low_idx, &row);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	if (flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size) > 0) {
+		low_idx--;
+	}
+
+	*location = low_idx;
+	return low_idx >= 0 ? err_ok : err_item_not_found;
+}
+
+ion_err_t
+flat_file_binary_search(
+	ion_flat_file_t *flat_file,
+	ion_key_t		target_key,
+	ion_fpos_t		*location
+) {
+	if (!flat_file->sorted_mode) {
+		return err_sorted_order_violation;
+	}
+
+	ion_flat_file_row_t row;
+	ion_err_t			err = flat_file_binary_search_rows(flat_file, target_key, location);
+
+	if (err_ok == err) {
+		err = flat_file_read_row(flat_file, *location, &row);
+	}
+
+	if ((err_ok != err) || (ION_FLAT_FILE_STATUS_EMPTY != row.row_status)) {
+		return err;
+	}
+
+	/* Deleted rows keep their keys, so the first live duplicate is the next live row if its key matches. */
+	if (0 == flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size)) {
+		ion_fpos_t next_loc;
+
+		err = flat_file_scan(flat_file, *location, &next_loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
+
+		if ((err_ok == err) && (0 == flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size))) {
+			*location = next_loc;
+			return err_ok;
+		}
+		else if ((err_ok != err) && (err_file_hit_eof != err)) {
+			return err;
+		}
+	}
+
+	/* Otherwise it is the last live row before, whose key is less. */
+	err = flat_file_scan(flat_file, *location, location, &row, ION_FLAT_FILE_SCAN_BACKWARDS, flat_file_predicate_not_empty);
+
+	if (err_file_hit_eof == err) {
+		*location = -1;
+		return err_item_not_found;
+	}
+
+	return err;
+}
+
+/**
+@brief		Compares the keys of two rows held in memory.
+@details	Empty rows sort after every row that holds a record, so sealing
+			gathers them at the end of each run.
+*/
+static char
+flat_file_compare_rows(
+	ion_flat_file_t *flat_file,
+	ion_byte_t		*first_row,
+	ion_byte_t		*second_row
+) {
+	ion_boolean_t	first_empty		= ION_FLAT_FILE_STATUS_EMPTY == *first_row;
+	ion_boolean_t	second_empty	= ION_FLAT_FILE_STATUS_EMPTY == *second_row;
+
+	if (first_empty || second_empty) {
+		return (char) (first_empty - second_empty);
+	}
+
+	return flat_file->super.compare(first_row + sizeof(ion_flat_file_row_status_t), second_row + sizeof(ion_flat_file_row_status_t), flat_file->super.record.key_size);
+}
+
+/**
+@brief		Moves the row at @p root down the heap of the first @p count @p rows
+			until it is not less than the rows below it.
+*/
+static void
+flat_file_sift_row(
+	ion_flat_file_t *flat_file,
+	ion_byte_t		*rows,
+	size_t			root,
+	size_t			count,
+	ion_byte_t		*temp_row
+) {
+	size_t row_size = flat_file->row_size;
+	size_t child;
+
+	while ((child = 2 * root + 1) < count) {
+		if ((child + 1 < count) && (flat_file_compare_rows(flat_file, rows + child * row_size, rows + (child + 1) * row_size) < 0)) {
+			child++;
+		}
+
+		if (flat_file_compare_rows(flat_file, rows + root * row_size, rows + child * row_size) >= 0) {
+			return;
+		}
+
+		memcpy(temp_row, rows + root * row_size, row_size);
+		memcpy(rows + root * row_size, rows + child * row_size, row_size);
+		memcpy(rows + child * row_size, temp_row, row_size);
+		root = child;
+	}
+}
+
+/**
+@brief		Heap sorts @p count @p rows held in memory by key.
+@details	@p temp_row must have room for one row.
+*/
+static void
+flat_file_sort_rows(
+	ion_flat_file_t *flat_file,
+	ion_byte_t		*rows,
+	size_t			count,
+	ion_byte_t		*temp_row
+) {
+	size_t	row_size = flat_file->row_size;
+	size_t	i;
+
+	for (i = count / 2; i > 0; i--) {
+		flat_file_sift_row(flat_file, rows, i - 1, count, temp_row);
+	}
+
+	for (i = count; i > 1; i--) {
+		memcpy(temp_row, rows, row_size);
+		memcpy(rows, rows + (i - 1) * row_size, row_size);
+		memcpy(rows + (i - 1) * row_size, temp_row, row_size);
+		flat_file_sift_row(flat_file, rows, 0, i - 1, temp_row);
+	}
+}
+
+/**
+@brief		Merges each group of @p fan_in sorted runs of @p run_rows rows in @p in
+			into one sorted run, written to @p out starting at @p out_start in the
+			layout with @p out_block_rows rows in each block.
+@details	@p work is split into @p fan_in slices of @p slice_rows rows for the
+			runs being merged, followed by one slice for the merged output.
+			With @p drop_empty, the empty rows that sort last are not written.
+*/
+static ion_err_t
+flat_file_merge_runs(
+	ion_flat_file_t *flat_file,
+	FILE			*in,
+	FILE			*out,
+	ion_fpos_t		out_start,
+	ion_fpos_t		out_block_rows,
+	ion_fpos_t		num_rows,
+	ion_fpos_t		run_rows,
+	int				fan_in,
+	ion_byte_t		*work,
+	size_t			slice_rows,
+	ion_boolean_t	drop_empty
+) {
+	size_t		row_size	= flat_file->row_size;
+	ion_byte_t	*out_slice	= work + fan_in * slice_rows * row_size;
+	ion_fpos_t	next_row[ION_FLAT_FILE_SEAL_FAN_IN];
+	ion_fpos_t	end_row[ION_FLAT_FILE_SEAL_FAN_IN];
+	size_t		slice_pos[ION_FLAT_FILE_SEAL_FAN_IN];
+	size_t		slice_count[ION_FLAT_FILE_SEAL_FAN_IN];
+	size_t		out_count;
+	ion_fpos_t	out_row		= 0;
+	ion_fpos_t	group;
+	int			i;
+	int			smallest;
+	ion_err_t	err;
+
+	for (group = 0; group < num_rows; group += run_rows * fan_in) {
+		for (i = 0; i < fan_in; i++) {
+			next_row[i]		= group + i * run_rows < num_rows ? group + i * run_rows : num_rows;
+			end_row[i]		= next_row[i] + run_rows < num_rows ? next_row[i] + run_rows : num_rows;
+			slice_pos[i]	= 0;
+			slice_count[i]	= 0;
+		}
+
+		out_count = 0;
+
+		while (1) {
+			smallest = -1;
+
+			for (i = 0; i < fan_in; i++) {
+				ion_byte_t *slice = work + i * slice_rows * row_size;
+
+				if ((slice_pos[i] == slice_count[i]) && (next_row[i] < end_row[i])) {
+					slice_count[i]	= end_row[i] - next_row[i] < (ion_fpos_t) slice_rows ? (size_t) (end_row[i] - next_row[i]) : slice_rows;
+					slice_pos[i]	= 0;
+
+					if (0 != fseek(in, next_row[i] * row_size, SEEK_SET)) {
+						return err_file_bad_seek;
+					}
+
+					if (slice_count[i] != fread(slice, row_size, slice_count[i], in)) {
+						return err_file_incomplete_read;
+					}
+
+					next_row[i] += slice_count[i];
+				}
+
+				if ((slice_pos[i] < slice_count[i]) && ((-1 == smallest) || (flat_file_compare_rows(flat_file, slice + slice_pos[i] * row_size, work + (smallest * slice_rows + slice_pos[smallest]) * row_size) < 0))) {
+					smallest = i;
+				}
+			}
+
+			/* Only empty rows are left in the group once the smallest is empty. */
+			if ((-1 != smallest) && drop_empty && (ION_FLAT_FILE_STATUS_EMPTY == work[(smallest * slice_rows + slice_pos[smallest]) * row_size])) {
+				smallest = -1;
+			}
+
+			if ((-1 == smallest) || (out_count == slice_rows)) {
+				err = flat_file_write_rows_to(flat_file, out, out_start, out_block_rows, out_row, out_count, out_slice);
+
+				if (err_ok != err) {
+					return err;
+				}
+
+				out_row		+= out_count;
+				out_count	= 0;
+			}
+
+			if (-1 == smallest) {
+				break;
+			}
+
+			memcpy(out_slice + out_count * row_size, work + (smallest * slice_rows + slice_pos[smallest]) * row_size, row_size);
+			out_count++;
+			slice_pos[smallest]++;
+		}
+	}
+
+	return err_ok;
+}
+
+/**
+@brief		Makes @p sealed long enough for the PAX layout blocks holding
+			@p num_rows rows, before any of them are written.
+*/
+static ion_err_t
+flat_file_reserve_sealed(
+	ion_flat_file_t *flat_file,
+	FILE			*sealed,
+	ion_fpos_t		num_rows
+) {
+	ion_fpos_t block_rows = flat_file->block_rows;
 
-	if (err_ok != err) {
-		status.error = err;
-		return status;
+	if ((0 == block_rows) || (0 == num_rows)) {
+		return err_ok;
 	}
 
-	/* Record new eof position */
-	flat_file->eof_position = ftell(flat_file->data_file);
+	if (0 != fseek(sealed, sizeof(ion_flat_file_header_t) + (num_rows + block_rows - 1) / block_rows * block_rows * flat_file->row_size - 1, SEEK_SET)) {
+		return err_file_bad_seek;
+	}
 
-	if (-1 == flat_file->eof_position) {
-		status.error = err_file_read_error;
-		return status;
+	if (1 != fwrite(&(ion_byte_t) { 0 }, 1, 1, sealed)) {
+		return err_file_incomplete_write;
 	}
 
-	status.error	= err_ok;
-	status.count	= 1;
-	return status;
+	return err_ok;
 }
 
-ion_status_t
-flat_file_get(
+/**
+@brief		Sorts the rows of @p flat_file into @p sealed after its header, using
+			@p run_files for the runs of the external sort.
+@details	Empty rows are left out, so every row of @p sealed holds a record.
+			How many there are is written back to @p sealed_rows.
+*/
+static ion_err_t
+flat_file_seal_into(
 	ion_flat_file_t *flat_file,
-	ion_key_t		key,
-	ion_value_t		value
+	FILE			*sealed,
+	FILE			**run_files,
+	char			run_filenames[2][ION_MAX_FILENAME_LENGTH],
+	ion_byte_t		*work,
+	size_t			work_rows,
+	ion_fpos_t		*sealed_rows
 ) {
-	ion_status_t		status		= ION_STATUS_INITIALIZE;
-	ion_err_t			err;
-	ion_fpos_t			found_loc	= -1;
-	ion_flat_file_row_t row;
+	size_t		row_size	= flat_file->row_size;
+	ion_fpos_t	num_rows	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+	ion_fpos_t	block_rows	= flat_file->block_rows;
+	ion_fpos_t	start_of_data;
+	ion_fpos_t	run_rows	= work_rows;
+	ion_fpos_t	live_rows	= 0;
+	ion_fpos_t	first;
+	FILE		*out;
+	int			fan_in		= ION_FLAT_FILE_SEAL_FAN_IN;
+	int			cur_run		= 0;
+	ion_err_t	err;
+
+	err = flat_file_write_header(flat_file, sealed, boolean_true, boolean_false);
 
-	if (!flat_file->sorted_mode) {
-		err = flat_file_scan(flat_file, -1, &found_loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key);
+	if (err_ok != err) {
+		return err;
+	}
 
-		if (err_ok != err) {
-			if (err_file_hit_eof == err) {
-				/* Alias the error since in this case, since hitting the EOF signifies */
-				/* that we didn't find what we were looking for */
-				status.error = err_item_not_found;
-			}
-			else {
-				/* This error takes priority since it is likely a file I/O issue */
-				status.error = err;
-			}
+	start_of_data = sizeof(ion_flat_file_header_t);
 
-			return status;
+	/* Sort the rows a memory load at a time. If they all fit, they are sealed already. */
+	out = sealed;
+
+	if (num_rows > run_rows) {
+		out = run_files[0] = fopen(run_filenames[0], "w+b");
+
+		if (NULL == out) {
+			return err_file_open_error;
 		}
 	}
-	else {
-		err = flat_file_binary_search(flat_file, key, &found_loc);
 
-		if (err_ok != err) {
-			status.error = err;
-			return status;
-		}
+	for (first = 0; first < num_rows; first += run_rows) {
+		size_t	count	= num_rows - first < run_rows ? (size_t) (num_rows - first) : (size_t) run_rows;
+		size_t	live	= 0;
+		size_t	i;
 
-		err = flat_file_read_row(flat_file, found_loc, &row);
+		err = flat_file_read_rows(flat_file, first, count, work, boolean_true);
 
 		if (err_ok != err) {
-			status.error = err;
-			return status;
+			return err;
 		}
 
-		if (0 != flat_file->super.compare(row.key, key, flat_file->super.record.key_size)) {
-			status.error = err_item_not_found;
-			return status;
+		for (i = 0; i < count; i++) {
+			if (ION_FLAT_FILE_STATUS_EMPTY != work[i * row_size]) {
+				live++;
+			}
 		}
-	}
 
-	memcpy(value, row.value, flat_file->super.record.value_size);
-	status.error	= err_ok;
-	status.count	= 1;
+		live_rows += live;
+		flat_file_sort_rows(flat_file, work, count, work + work_rows * row_size);
 
-	return status;
-}
+		/* The runs keep their empty rows at the end, so that each is the same length. The
+		   sealed file only gets the live rows, in the PAX layout if the data file uses it. */
+		if (sealed == out) {
+			err = flat_file_reserve_sealed(flat_file, sealed, live);
 
-ion_status_t
-flat_file_delete(
-	ion_flat_file_t *flat_file,
-	ion_key_t		key
-) {
-	if (flat_file->sorted_mode) {
-		return ION_STATUS_ERROR(err_sorted_order_violation);
-	}
+			if (err_ok == err) {
+				err = flat_file_write_rows_to(flat_file, sealed, start_of_data, block_rows, first, live, work);
+			}
+		}
+		else {
+			err = flat_file_write_rows_to(flat_file, out, 0, 0, first, count, work);
+		}
 
-	ion_status_t		status	= ION_STATUS_INITIALIZE;
-	ion_flat_file_row_t row;
-	ion_err_t			err;
-	ion_fpos_t			loc		= -1;
+		if (err_ok != err) {
+			return err;
+		}
+	}
 
-	while (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key))) {
-		ion_fpos_t			last_record_offset	= flat_file->eof_position - flat_file->row_size;
-		ion_flat_file_row_t last_row;
-		ion_fpos_t			last_record_index	= (last_record_offset - flat_file->start_of_data) / flat_file->row_size;
-		ion_err_t			row_err;
+	/* Then merge the runs, a few at a time, until one is left. Each slice needs at least a row. */
+	if ((size_t) fan_in + 1 > work_rows) {
+		fan_in = work_rows - 1;
+	}
 
-		/* If the last index and the loc are the same, then we can just move the eof position. Saves a read/write. */
-		if (last_record_index != loc) {
-			row_err = flat_file_read_row(flat_file, last_record_index, &last_row);
+	while (run_rows < num_rows) {
+		if (run_rows * fan_in >= num_rows) {
+			out = sealed;
+			err = flat_file_reserve_sealed(flat_file, sealed, live_rows);
 
-			if (err_ok != row_err) {
-				status.error = row_err;
-				return status;
+			if (err_ok != err) {
+				return err;
 			}
+		}
+		else {
+			if (NULL == run_files[1 - cur_run]) {
+				run_files[1 - cur_run] = fopen(run_filenames[1 - cur_run], "w+b");
 
-			row_err = flat_file_write_row(flat_file, loc, &last_row);
-
-			if (err_ok != row_err) {
-				status.error = row_err;
-				return status;
+				if (NULL == run_files[1 - cur_run]) {
+					return err_file_open_error;
+				}
 			}
+
+			out = run_files[1 - cur_run];
 		}
 
-		/* Set last row to be empty just for sanity reasons. */
-		row_err = flat_file_write_row(flat_file, last_record_index, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_EMPTY, NULL, NULL });
+		err = flat_file_merge_runs(flat_file, run_files[cur_run], out, sealed == out ? start_of_data : 0, sealed == out ? block_rows : 0, num_rows, run_rows, fan_in, work, work_rows / (fan_in + 1), sealed == out);
 
-		if (err_ok != row_err) {
-			status.error = row_err;
-			return status;
+		if (err_ok != err) {
+			return err;
 		}
 
-		/* Soft truncate the file by bumping the eof position back to cut off the last record. */
-		flat_file->eof_position = last_record_offset;
-		status.count++;
-
-		/* No location movement is done here, since we need to check the row we just swapped in to see if it is
-		   also a match. */
+		run_rows	*= fan_in;
+		cur_run		= 1 - cur_run;
 	}
 
-	status.error = err_ok;
-
-	if (((err == err_file_hit_eof) || (-1 == loc)) && (status.count == 0)) {
-		status.error = err_item_not_found;
-	}
-	else if (err != err_file_hit_eof) {
-		status.error = err;
+	if (0 != fflush(sealed)) {
+		return err_file_write_error;
 	}
 
-	return status;
+	*sealed_rows = live_rows;
+
+	return err_ok;
 }
 
-ion_status_t
-flat_file_update(
+ion_err_t
+flat_file_seal(
 	ion_flat_file_t *flat_file,
-	ion_key_t		key,
-	ion_value_t		value
+	size_t			memory_budget
 ) {
-	ion_status_t status		= ION_STATUS_INITIALIZE;
+	if (flat_file->sorted_mode) {
+		return err_ok;
+	}
 
-	ion_fpos_t			loc = -1;
-	ion_flat_file_row_t row;
-	ion_err_t			err;
+	/* The runs are read straight from the data file. */
+	ion_err_t err = flat_file_write_appended(flat_file);
 
-	if (flat_file->sorted_mode) {
-		err = flat_file_binary_search(flat_file, key, &loc);
+	if (err_ok != err) {
+		return err;
+	}
 
-		if (err_ok != err) {
-			if (err_item_not_found == err) {
-				/* Key didn't exist, do upsert. This may fail because it violates the sorted order. */
-				return flat_file_insert(flat_file, key, value);
-			}
+	char	filename[ION_MAX_FILENAME_LENGTH];
+	char	sealed_filename[ION_MAX_FILENAME_LENGTH];
+	char	run_filenames[2][ION_MAX_FILENAME_LENGTH];
+	FILE	*run_files[2]	= { NULL, NULL };
+	size_t	work_rows		= memory_budget / flat_file->row_size;
+	int		i;
+
+	/* Merging needs at least a row for each of two runs and one for the output. */
+	if (work_rows < 3) {
+		work_rows = 3;
+	}
 
-			status.error = err;
-			return status;
-		}
+	/* One more row is used to swap rows while sorting. */
+	ion_byte_t *work = malloc((work_rows + 1) * flat_file->row_size);
 
-		err = flat_file_read_row(flat_file, loc, &row);
+	if (NULL == work) {
+		return err_out_of_memory;
+	}
 
-		if (err_ok != err) {
-			status.error = err;
-			return status;
-		}
+	dictionary_get_filename(flat_file->super.id, "ffs", filename);
+	dictionary_get_filename(flat_file->super.id, "ffn", sealed_filename);
+	dictionary_get_filename(flat_file->super.id, "ffa", run_filenames[0]);
+	dictionary_get_filename(flat_file->super.id, "ffb", run_filenames[1]);
 
-		if (0 != flat_file->super.compare(row.key, key, flat_file->super.record.key_size)) {
-			/* Key didn't exist, do upsert. */
-			return flat_file_insert(flat_file, key, value);
+	FILE		*sealed = fopen(sealed_filename, "w+b");
+	ion_fpos_t	num_rows;
+
+	err = err_file_open_error;
+
+	if (NULL != sealed) {
+		err = flat_file_seal_into(flat_file, sealed, run_files, run_filenames, work, work_rows, &num_rows);
+
+		if ((0 != fclose(sealed)) && (err_ok == err)) {
+			err = err_file_close_error;
 		}
 	}
 
-	while (err_ok == (err = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, key))) {
-		ion_err_t row_err = flat_file_write_row(flat_file, loc, &(ion_flat_file_row_t) { ION_FLAT_FILE_STATUS_OCCUPIED, key, value });
+	free(work);
 
-		if (err_ok != row_err) {
-			status.error = row_err;
-			return status;
+	for (i = 0; i < 2; i++) {
+		if (NULL != run_files[i]) {
+			fclose(run_files[i]);
+			fremove(run_filenames[i]);
 		}
+	}
 
-		status.count++;
-		/* Move one-forwards to skip the one we just updated */
-		loc++;
+	if (err_ok != err) {
+		fremove(sealed_filename);
+		return err;
 	}
 
-	status.error = err_ok;
+	/* Swap the sealed file in for the data file, which is kept if the swap fails. */
+	ion_boolean_t mapped = NULL != flat_file->map;
 
-	if ((err == err_file_hit_eof) && (status.count == 0)) {
-		/* If this is the case, then we had nothing to update. Do an upsert instead */
-		return flat_file_insert(flat_file, key, value);
-	}
-	else if (err != err_file_hit_eof) {
-		status.error = err;
-	}
+#if defined(ARDUINO)
 
-	return status;
-}
+	/* SD renames by copying, so the data file is closed first and opened again by name. If that
+	   fails, the flat file is left without a data file, and can only be closed. */
+	err = 0 != fclose(flat_file->data_file) ? err_file_close_error : err_ok;
 
-ion_err_t
-flat_file_close(
-	ion_flat_file_t *flat_file
-) {
-	free(flat_file->buffer);
-	flat_file->buffer = NULL;
+	if (err_ok == err) {
+		err = ion_frename(sealed_filename, filename);
+	}
 
-	if (0 != fclose(flat_file->data_file)) {
-		return err_file_close_error;
+	if (err_ok != err) {
+		fremove(sealed_filename);
 	}
 
-	return err_ok;
-}
+	flat_file->data_file = fopen(filename, "r+b");
 
-ion_err_t
-flat_file_binary_search(
-	ion_flat_file_t *flat_file,
-	ion_key_t		target_key,
-	ion_fpos_t		*location
-) {
-	if (!flat_file->sorted_mode) {
-		return err_sorted_order_violation;
+	if (NULL == flat_file->data_file) {
+		return err_file_open_error;
 	}
 
-	ion_err_t			err;
-	ion_flat_file_row_t row;
-	ion_fpos_t			low_idx		= 0;
-	ion_fpos_t			high_idx	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size - 1;
-	ion_fpos_t			mid_idx;
+	if (err_ok != err) {
+		return err;
+	}
 
-	if (high_idx < 0) {
-		/* We're empty, short circuit */
-		*location = -1;
-		return err_item_not_found;
+#else
+
+	/* The sealed file is opened before the data file is let go, so the flat file always has one. */
+	FILE *sealed_file = fopen(sealed_filename, "r+b");
+
+	if (NULL == sealed_file) {
+		fremove(sealed_filename);
+		return err_file_open_error;
 	}
 
-	while (low_idx < high_idx) {
-		mid_idx = low_idx + (high_idx - low_idx) / 2;
-		err		= flat_file_read_row(flat_file, mid_idx, &row);
+#if ION_FLAT_FILE_MMAP
+
+	if (mapped) {
+		err = flat_file_unmap(flat_file);
 
 		if (err_ok != err) {
+			fclose(sealed_file);
+			fremove(sealed_filename);
 			return err;
 		}
+	}
 
-		char comp_result = flat_file->super.compare(target_key, row.key, flat_file->super.record.key_size);
-
-		if (comp_result > 0) {
-			low_idx = mid_idx + 1;
-		}
-		else if (comp_result < 0) {
-			high_idx = mid_idx - 1;
-		}
-		else {
-			/* Match found, scroll to beginning of (potential) duplicate block and return */
-			ion_fpos_t	last_dup_idx;
-			ion_fpos_t	dup_idx = mid_idx;
+#endif
 
-			do {
-				last_dup_idx	= dup_idx;
-				dup_idx--;
-				err				= flat_file_read_row(flat_file, dup_idx, &row);
+	/* The open handle follows the sealed file to its new name. */
+	err = ion_frename(sealed_filename, filename);
 
-				if (err_ok != err) {
-					return err;
-				}
-			} while (dup_idx >= 0 && 0 == flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size));
+	if (err_ok != err) {
+		fclose(sealed_file);
+		fremove(sealed_filename);
 
-			*location = last_dup_idx;
-			return err_ok;
+		if (mapped) {
+			flat_file_use_mmap(flat_file);
 		}
-	}
-
-	/* If we reach here, then we fell through the loop - do check and adjust for LEQ as necessary */
-	err = flat_file_read_row(flat_file, low_idx, &row);
 
-	if (err_ok != err) {
 		return err;
 	}
 
-	if (flat_file->super.compare(row.key, target_key, flat_file->super.record.key_size) > 0) {
-		low_idx--;
+	fclose(flat_file->data_file);
+	flat_file->data_file = sealed_file;
+#endif
+
+	/* The file ends at the last live row now, and has the versioned header even if the data
+	   file had the older one. */
+	flat_file->header_version			= ION_FLAT_FILE_HEADER_VERSION;
+	flat_file->start_of_data			= sizeof(ion_flat_file_header_t);
+	flat_file->eof_position				= flat_file->start_of_data + num_rows * flat_file->row_size;
+	flat_file->sorted_mode				= boolean_true;
+	flat_file->num_dead_rows			= 0;
+	flat_file->current_loaded_region	= -1;
+	flat_file->num_in_buffer			= 0;
+	flat_file->num_fences				= 0;
+	flat_file->num_zoned_rows			= 0;
+
+	if (0 < flat_file->block_rows) {
+		flat_file->num_blocks = (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+		flat_file->num_blocks = (flat_file->num_blocks + flat_file->block_rows - 1) / flat_file->block_rows;
 	}
 
-	*location = low_idx;
-	return low_idx >= 0 ? err_ok : err_item_not_found;
+	return mapped ? flat_file_use_mmap(flat_file) : err_ok;
 }
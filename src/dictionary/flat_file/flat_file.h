@@ -36,8 +36,9 @@ extern "C" {
 			flat file instance. This (should) only happen when this is called from an open context
 			instead of an initialize. The flat file supports a special mode called "sorted mode". This
 			is an append only mode that assumes all keys come in monotonic non-decreasing order. In this
-			mode, search operations are significantly faster, but the store does not support deletions while
-			in sorted mode.
+			mode, search operations are significantly faster, and deletions only mark rows as empty.
+			If the file was closed cleanly, the row count in its header gives the end of the rows.
+			Otherwise, as after a crash, the end is found by scanning back for the last occupied row.
 @param[in]	flat_file
 				Given instance of a flat file struct to initialize. This must be allocated **heap** memory,
 				as destruction will assume that it needs to be freed.
@@ -50,8 +51,10 @@ extern "C" {
 @param[in]	value_size
 				Value size, in bytes used for this instance.
 @param[in]	dictionary_size
-				Dictionary size is interpreted as how many records (key value pairs) are buffered. This should be given
-				as somewhere between 1 (minimum) and the page size of the device you are working on.
+				Dictionary size is interpreted as how many records (key value pairs) are read at a time before a scan
+				starts to read larger blocks. This should be given as somewhere between 1 (minimum) and the page size
+				of the device you are working on. The buffer itself holds the larger of this many records and
+				@ref ION_FLAT_FILE_SCAN_BUFFER bytes of records.
 @return		The status of initialization.
 @see		ffdict_create_dictionary
 */
@@ -79,6 +82,8 @@ flat_file_destroy(
 
 /**
 @brief		Inserts the given record into the flat file store.
+@details	The row is held in the append buffer until it fills, so it is only
+			in the data file after the next flush, close, or other operation.
 @param[in]	flat_file
 				Which flat file to insert into.
 @param[in]	key
@@ -116,6 +121,11 @@ flat_file_get(
 
 /**
 @brief		Deletes all records stored with the given @p key.
+@details	By default, each deleted row is filled by moving the last row of the file
+			into it. In sorted mode, or when @p tombstone_deletes is set, the rows are
+			instead marked empty in place, which keeps the order of the other rows, and
+			the file is compacted with @ref flat_file_compact once
+			@ref ION_FLAT_FILE_COMPACT_PERCENT of its rows are empty.
 @param[in]	flat_file
 				Which flat file to delete in.
 @param[in]	key
@@ -129,6 +139,20 @@ flat_file_delete(
 	ion_key_t		key
 );
 
+/**
+@brief		Removes the empty rows from a flat file in one sequential pass.
+@details	Live rows are moved up over the empty ones in order, so sorted mode
+			stays sorted. This is done on its own by tombstone deletes, but can
+			also be called to reclaim rows deleted before the file was reopened.
+@param[in]	flat_file
+				Which flat file to compact.
+@return		Resulting status of the compaction.
+*/
+ion_err_t
+flat_file_compact(
+	ion_flat_file_t *flat_file
+);
+
 /**
 @brief		Updates all records stored with the given @p key to have @p value.
 @param[in]	flat_file
@@ -148,8 +172,65 @@ flat_file_update(
 	ion_value_t		value
 );
 
+/**
+@brief		Writes the inserted rows held in memory to the data file, and
+			flushes the data file.
+@param		flat_file
+				Which flat file to flush.
+@return		Status of the flush.
+@see		ffdict_flush_dictionary
+*/
+ion_err_t
+flat_file_flush(
+	ion_flat_file_t *flat_file
+);
+
+/**
+@brief		Switches a flat file with no rows to the PAX layout.
+@details	Rows are normally stored whole, one after another. In the PAX layout,
+			each block of @p block_rows rows keeps the statuses, keys and values
+			of its rows in three separate stripes instead. Scans that only test
+			keys then read the status and key stripes alone, and read the value
+			of a row once it is found. This saves most of the reads of key scans
+			when values are much larger than keys, at the cost of a seek for each
+			block. The layout is recorded in the header of the data file.
+@param		flat_file
+				Which flat file to switch to the PAX layout. Its data file must
+				be empty, as it is when newly created.
+@param		block_rows
+				How many rows each block holds.
+@return		Status of the switch. @c err_illegal_state if the flat file
+			already has rows, or is already in the PAX layout.
+*/
+ion_err_t
+flat_file_use_pax_layout(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		block_rows
+);
+
+/**
+@brief		Maps the data file of a flat file into memory.
+@details	Reads and writes then copy straight to and from the mapping, and
+			scans of the row layout test rows in place without copying them.
+			The mapping doubles in size as rows are appended, and the data
+			file is cut back to its rows when the flat file is closed.
+			@ref flat_file_flush and @ref flat_file_close write the mapping
+			out with @c msync. Mapping is only done on Linux.
+@param		flat_file
+				Which flat file to map, normally just after it is opened.
+@return		Status of the mapping. @c err_not_implemented where the data
+			file cannot be mapped, and @c err_illegal_state if it is
+			mapped already.
+*/
+ion_err_t
+flat_file_use_mmap(
+	ion_flat_file_t *flat_file
+);
+
 /**
 @brief		Closes and frees any memory associated with the flat file.
+@details	The header of the data file is marked clean, with the row count, so
+			it opens without a scan.
 @param		flat_file
 				Which flat file to close.
 @return		Status of closure.
@@ -163,8 +244,11 @@ flat_file_close(
 @brief			Performs a linear scan of the flat file writing the first location
 				seen that satisfies the given @p predicate to @p location.
 @details		If the scan falls through, then the location is written as
-				the EOF position of the file. The variadic arguments accepted
-				by this function are passed into the predicate's additional parameters.
+				the EOF position of the file. Rows are read through the loaded
+				region of the buffer, which doubles in size each time the scan
+				runs past it, so long scans make few large reads. The variadic
+				arguments accepted by this function are passed into the
+				predicate's additional parameters.
 				This can be used to provide additional context to the predicate for use
 				in determining whether or not the row is a match.
 @param[in]		flat_file
@@ -189,8 +273,6 @@ flat_file_close(
 @return			Resulting status of scan.
 @todo			Try changing the predicate to be an enum-and-switch to eliminate the function
 				call. Benchmark the performance gain and decide which strategy to use.
-@todo			Consider changing to @p SEEK_CUR whenever possible. Benchmark this and see
-				if the performance gain (if any) is worth it.
 */
 ion_err_t
 flat_file_scan(
@@ -241,6 +323,62 @@ flat_file_predicate_not_empty(
 	va_list				*args
 );
 
+/**
+@brief		Searches the region loaded into the buffer for the first occupied row
+			with the given @p key, starting from @p location.
+@details	This is how @ref flat_file_scan matches keys for
+			@ref flat_file_predicate_key_match. It compares the key bytes of
+			each row directly, without a predicate call per row, so it is only
+			correct for keys that are equal exactly when their bytes are equal,
+			such as numeric keys.
+@param[in]		flat_file
+					Which flat file instance to search within.
+@param[in,out]	location
+					The row index to start at, which must be within the loaded region.
+					The row index of the match is written back, or if there is none,
+					the first row index past the region in the direction of the search.
+@param[in]		scan_direction
+					Searches in the direction provided.
+@param[in]		key
+					Desired key to search for.
+@return		@p boolean_true if a row matched.
+*/
+ion_boolean_t
+flat_file_match_key_in_region(
+	ion_flat_file_t *flat_file,
+	ion_fpos_t		*location,
+	ion_byte_t		scan_direction,
+	ion_key_t		key
+);
+
+/**
+@brief		Searches the status and key stripes of a PAX block for the first
+			occupied row with the given @p key.
+@details	This is how @ref flat_file_scan matches numeric keys in a PAX
+			layout, a block at a time, before it loads any rows. With
+			@ref ION_FLAT_FILE_MATCH_LANES above 1, 2, 4 and 8 byte keys are
+			tested that many rows at a time, and the rest one at a time.
+@param[in]	statuses
+				The statuses of @p count rows, one after another.
+@param[in]	keys
+				The keys of the same rows, one after another.
+@param[in]	key_size
+				The size of each key, in bytes.
+@param[in]	count
+				How many rows to search.
+@param[in]	key
+				Desired key to search for.
+@return		The index of the first matching row, or @p count if none match.
+*/
+ion_fpos_t
+flat_file_match_key_in_stripe(
+	ion_byte_t		*statuses,
+	ion_byte_t		*keys,
+	ion_key_size_t	key_size,
+	ion_fpos_t		count,
+	ion_key_t		key
+);
+
 /**
 @brief		Reads the row specified by the given location into the buffer.
 @details	The returned row is given by attaching pointers correctly from
@@ -293,6 +431,28 @@ flat_file_binary_search(
 	ion_fpos_t		*location
 );
 
+/**
+@brief		Sorts the rows of an unsorted flat file and switches it into sorted mode.
+@details	The rows are sorted a memory load at a time into runs, and the runs
+			are merged @ref ION_FLAT_FILE_SEAL_FAN_IN at a time, so sealing
+			a file of any size takes about @p memory_budget bytes. The sorted
+			rows are written to a new file, which then replaces the data file,
+			so the flat file is left as it was if sealing fails. The header of
+			the new file records sorted mode, so the flat file is opened in
+			sorted mode from then on. Sealing a flat file that is already in
+			sorted mode does nothing.
+@param[in]	flat_file
+				Which flat file instance to seal.
+@param[in]	memory_budget
+				How many bytes to sort with. At least three rows are used.
+@return		Resulting status of the seal.
+*/
+ion_err_t
+flat_file_seal(
+	ion_flat_file_t *flat_file,
+	size_t			memory_budget
+);
+
 #if defined(__cplusplus)
 }
 #endif
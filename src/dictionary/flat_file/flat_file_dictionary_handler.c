@@ -55,29 +55,58 @@ ffdict_next(
 			ion_flat_file_row_t throwaway_row;
 			ion_err_t			err = err_uninitialized;
 
-			/* TODO: Implement sorted mode search */
-			switch (cursor->predicate->type) {
-				case predicate_equality: {
-					err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, cursor->predicate->statement.equality.equality_value);
+			if (dictionary_predicate_is_descending(cursor->predicate)) {
+				/* Step back to the previous live row. On a miss, this loads the block of rows ending there. */
+				ion_fpos_t prev_location = flat_file_cursor->current_location - 1;
 
-					break;
+				if (prev_location < 0) {
+					err = err_file_hit_eof;
+				}
+				else {
+					err = flat_file_scan(flat_file, prev_location, &prev_location, &throwaway_row, ION_FLAT_FILE_SCAN_BACKWARDS, flat_file_predicate_not_empty);
 				}
 
-				case predicate_range: {
-					err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, cursor->predicate->statement.range.lower_bound, cursor->predicate->statement.range.upper_bound);
+				if (err_ok == err) {
+					flat_file_cursor->current_location = prev_location;
 
-					break;
+					/* Keys only get smaller from here, so the first one out of range ends the cursor. */
+					if (boolean_false == test_predicate(cursor, throwaway_row.key)) {
+						err = err_file_hit_eof;
+					}
 				}
+			}
+			else if (flat_file->sorted_mode && ((predicate_equality == cursor->predicate->type) || (predicate_range == cursor->predicate->type))) {
+				err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
 
-				case predicate_all_records: {
-					err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
-
-					break;
+				/* Keys only get larger from here, so the first one that does not match ends the cursor. */
+				if ((err_ok == err) && (boolean_false == test_predicate(cursor, throwaway_row.key))) {
+					err = err_file_hit_eof;
 				}
+			}
+			else {
+				switch (cursor->predicate->type) {
+					case predicate_equality: {
+						err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, cursor->predicate->statement.equality.equality_value);
+
+						break;
+					}
+
+					case predicate_range: {
+						err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, cursor->predicate->statement.range.lower_bound, cursor->predicate->statement.range.upper_bound);
+
+						break;
+					}
+
+					case predicate_all_records: {
+						err = flat_file_scan(flat_file, flat_file_cursor->current_location + 1, &flat_file_cursor->current_location, &throwaway_row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
+
+						break;
+					}
 
-				case predicate_predicate: {
-					/* TODO not implemented */
-					break;
+					case predicate_predicate: {
+						/* TODO not implemented */
+						break;
+					}
 				}
 			}
 
@@ -179,6 +208,19 @@ ffdict_close_dictionary(
 	return err_ok;
 }
 
+/**
+@brief		Writes the inserted records this flat file store holds in memory to disk.
+@param[in]	dictionary
+				Which instance of a flat file store to flush.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+ffdict_flush_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	return flat_file_flush((ion_flat_file_t *) dictionary->instance);
+}
+
 /**
 @brief			Initializes a cursor query and returns an allocated cursor object.
 @details		Given a @p predicate that was previously initialized by @ref dictionary_build_predicate,
@@ -200,10 +242,15 @@ ffdict_find(
 	ion_predicate_t		*predicate,
 	ion_dict_cursor_t	**cursor
 ) {
-	*cursor = malloc(sizeof(ion_flat_file_cursor_t));
-
 	ion_flat_file_t *flat_file = (ion_flat_file_t *) dictionary->instance;
 
+	/* Rows are only in key order in sorted mode. */
+	if (dictionary_predicate_is_descending(predicate) && !flat_file->sorted_mode) {
+		return err_not_implemented;
+	}
+
+	*cursor = malloc(sizeof(ion_flat_file_cursor_t));
+
 	if (NULL == *cursor) {
 		return err_out_of_memory;
 	}
@@ -226,7 +273,6 @@ ffdict_find(
 
 	ion_key_size_t key_size = dictionary->instance->record.key_size;
 
-	/* TODO: Implement sorted mode search here */
 	switch (predicate->type) {
 		case predicate_equality: {
 			ion_key_t target_key = predicate->statement.equality.equality_value;
@@ -243,7 +289,23 @@ ffdict_find(
 
 			ion_fpos_t			loc			= -1;
 			ion_flat_file_row_t row;
-			ion_err_t			scan_result = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, target_key);
+			ion_err_t			scan_result;
+
+			if (flat_file->sorted_mode) {
+				/* The binary search finds the first of the key's duplicates, if there are any. */
+				scan_result = flat_file_binary_search(flat_file, target_key, &loc);
+
+				if (err_ok == scan_result) {
+					scan_result = flat_file_read_row(flat_file, loc, &row);
+				}
+
+				if ((err_item_not_found == scan_result) || ((err_ok == scan_result) && (0 != flat_file->super.compare(row.key, target_key, key_size)))) {
+					scan_result = err_file_hit_eof;
+				}
+			}
+			else {
+				scan_result = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, target_key);
+			}
 
 			if (err_file_hit_eof == scan_result) {
 				/* If this happens, that means the target key doesn't exist */
@@ -287,11 +349,84 @@ ffdict_find(
 			}
 
 			memcpy((*cursor)->predicate->statement.range.upper_bound, predicate->statement.range.upper_bound, key_size);
+			(*cursor)->predicate->statement.range.descending = predicate->statement.range.descending;
+
+			if (predicate->statement.range.descending) {
+				/* Binary search for the upper bound, then move past any duplicates of it. */
+				ion_fpos_t			loc;
+				ion_fpos_t			num_rows	= (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+				ion_flat_file_row_t row;
+				ion_err_t			err			= flat_file_binary_search(flat_file, (*cursor)->predicate->statement.range.upper_bound, &loc);
+
+				while ((err_ok == err) && (loc + 1 < num_rows)) {
+					ion_fpos_t next_loc;
+
+					err = flat_file_scan(flat_file, loc + 1, &next_loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
+
+					if ((err_ok != err) || (flat_file->super.compare(row.key, (*cursor)->predicate->statement.range.upper_bound, key_size) > 0)) {
+						err = err_file_hit_eof == err ? err_ok : err;
+						break;
+					}
+
+					loc = next_loc;
+				}
+
+				if (err_ok == err) {
+					err = flat_file_read_row(flat_file, loc, &row);
+				}
+
+				if ((err_item_not_found == err) || ((err_ok == err) && (flat_file->super.compare(row.key, (*cursor)->predicate->statement.range.lower_bound, key_size) < 0))) {
+					/* Every key is above the upper bound, or the greatest key within it is below the lower bound */
+					(*cursor)->status = cs_end_of_results;
+					return err_ok;
+				}
+				else if (err_ok != err) {
+					return err;
+				}
+
+				((ion_flat_file_cursor_t *) (*cursor))->current_location	= loc;
+				(*cursor)->status											= cs_cursor_initialized;
+				return err_ok;
+			}
 
 			/* Find the first satisfactory key. */
 			ion_fpos_t			loc			= -1;
 			ion_flat_file_row_t row;
-			ion_err_t			scan_result = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, (*cursor)->predicate->statement.range.lower_bound, (*cursor)->predicate->statement.range.upper_bound);
+			ion_err_t			scan_result;
+
+			if (flat_file->sorted_mode) {
+				/* Binary search for the lower bound. The first key in range is just past any keys below it. */
+				ion_fpos_t num_rows = (flat_file->eof_position - flat_file->start_of_data) / flat_file->row_size;
+
+				scan_result = flat_file_binary_search(flat_file, (*cursor)->predicate->statement.range.lower_bound, &loc);
+
+				if (err_item_not_found == scan_result) {
+					loc			= 0;
+					scan_result = err_ok;
+				}
+				else if (err_ok == scan_result) {
+					scan_result = flat_file_read_row(flat_file, loc, &row);
+
+					if ((err_ok == scan_result) && (flat_file->super.compare(row.key, (*cursor)->predicate->statement.range.lower_bound, key_size) < 0)) {
+						loc++;
+					}
+				}
+
+				if ((err_ok == scan_result) && (loc >= num_rows)) {
+					scan_result = err_file_hit_eof;
+				}
+				else if (err_ok == scan_result) {
+					/* Deleted rows are skipped over. */
+					scan_result = flat_file_scan(flat_file, loc, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
+
+					if ((err_ok == scan_result) && (flat_file->super.compare(row.key, (*cursor)->predicate->statement.range.upper_bound, key_size) > 0)) {
+						scan_result = err_file_hit_eof;
+					}
+				}
+			}
+			else {
+				scan_result = flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, (*cursor)->predicate->statement.range.lower_bound, (*cursor)->predicate->statement.range.upper_bound);
+			}
 
 			if (err_file_hit_eof == scan_result) {
 				/* This means the returned node is smaller than the lower bound, which means that there are no valid records to return */
@@ -317,9 +452,12 @@ ffdict_find(
 		case predicate_all_records: {
 			ion_flat_file_cursor_t *flat_file_cursor	= (ion_flat_file_cursor_t *) (*cursor);
 
+			(*cursor)->predicate->statement.all_records.descending = predicate->statement.all_records.descending;
+
+			/* Descending cursors scan in from the end of the file. */
 			ion_fpos_t			loc						= -1;
 			ion_flat_file_row_t row;
-			ion_err_t			scan_result				= flat_file_scan(flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
+			ion_err_t			scan_result				= flat_file_scan(flat_file, -1, &loc, &row, predicate->statement.all_records.descending ? ION_FLAT_FILE_SCAN_BACKWARDS : ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_not_empty);
 
 			if (err_file_hit_eof == scan_result) {
 				(*cursor)->status = cs_end_of_results;
@@ -364,6 +502,7 @@ ffdict_init(
 	handler->delete_dictionary	= ffdict_delete_dictionary;
 	handler->open_dictionary	= ffdict_open_dictionary;
 	handler->close_dictionary	= ffdict_close_dictionary;
+	handler->flush_dictionary	= ffdict_flush_dictionary;
 }
 
 ion_status_t
@@ -439,3 +578,26 @@ ffdict_update(
 ) {
 	return flat_file_update((ion_flat_file_t *) dictionary->instance, key, value);
 }
+
+ion_err_t
+ffdict_seal(
+	ion_dictionary_t	*dictionary,
+	size_t				memory_budget
+) {
+	return flat_file_seal((ion_flat_file_t *) dictionary->instance, memory_budget);
+}
+
+ion_err_t
+ffdict_use_pax_layout(
+	ion_dictionary_t	*dictionary,
+	ion_fpos_t			block_rows
+) {
+	return flat_file_use_pax_layout((ion_flat_file_t *) dictionary->instance, block_rows);
+}
+
+ion_err_t
+ffdict_use_mmap(
+	ion_dictionary_t *dictionary
+) {
+	return flat_file_use_mmap((ion_flat_file_t *) dictionary->instance);
+}
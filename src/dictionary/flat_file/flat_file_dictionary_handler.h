@@ -99,8 +99,8 @@ ffdict_get(
 @param[in]	value_size
 				Same as above, for values.
 @param[in]	dictionary_size
-				Designates how many records we buffer in memory. Higher means better overall performance at
-				the cost of increased memory usage.
+				Designates how many records we read into memory at a time before scans move to larger blocks.
+				Higher means better overall performance at the cost of increased memory usage.
 @param[in]	compare
 				The function pointer that designates how to compare two keys. This is given by the upper
 				dictionary layers.
@@ -166,6 +166,54 @@ ffdict_update(
 	ion_value_t			value
 );
 
+/**
+@brief		Sorts the records of a flat file dictionary and switches it into sorted mode.
+@details	Afterwards gets use a binary search, and range cursors stop at the end
+			of the range. Inserts must then come in key order, and deletes mark
+			rows empty in place. Cursors on the dictionary must not be in use.
+@param[in]	dictionary
+				Which dictionary to seal.
+@param[in]	memory_budget
+				How many bytes of memory to sort with.
+@return		The resulting status of the operation.
+@see		flat_file_seal
+*/
+ion_err_t
+ffdict_seal(
+	ion_dictionary_t	*dictionary,
+	size_t				memory_budget
+);
+
+/**
+@brief		Switches a flat file dictionary with no records to the PAX layout,
+			which stores the statuses, keys and values of each block of
+			@p block_rows records apart, so key scans read less.
+@param[in]	dictionary
+				Which dictionary to switch. It must hold no records.
+@param[in]	block_rows
+				How many records each block holds.
+@return		The resulting status of the operation.
+@see		flat_file_use_pax_layout
+*/
+ion_err_t
+ffdict_use_pax_layout(
+	ion_dictionary_t	*dictionary,
+	ion_fpos_t			block_rows
+);
+
+/**
+@brief		Maps the data file of a flat file dictionary into memory, so
+			records are read and written without going through stdio.
+@param[in]	dictionary
+				Which dictionary to map.
+@return		The resulting status of the operation.
+@see		flat_file_use_mmap
+*/
+ion_err_t
+ffdict_use_mmap(
+	ion_dictionary_t *dictionary
+);
+
 #if defined(__cplusplus)
 }
 #endif
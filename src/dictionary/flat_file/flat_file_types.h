@@ -54,6 +54,165 @@ typedef ion_byte_t ion_flat_file_row_status_t;
 */
 #define ION_FLAT_FILE_SCAN_BACKWARDS	0
 
+/**
+@brief		The single word header of a flat file written before the versioned header,
+			whose rows are in no particular order.
+@details	These files are still opened, but always have their end found by a scan.
+*/
+#define ION_FLAT_FILE_HEADER_UNSORTED	0xADDE
+/**
+@brief		The single word header of a flat file in sorted mode written before the
+			versioned header.
+*/
+#define ION_FLAT_FILE_HEADER_SORTED		0x50DE
+/**
+@brief		The first word of the versioned header, @ref ion_flat_file_header_t.
+*/
+#define ION_FLAT_FILE_HEADER_MAGIC		0x46464844
+/**
+@brief		The version of @ref ion_flat_file_header_t that is written. Files with a
+			later version are refused.
+*/
+#define ION_FLAT_FILE_HEADER_VERSION	2
+/**
+@brief		Header flag set when the rows are sorted, such as after @ref flat_file_seal.
+*/
+#define ION_FLAT_FILE_HEADER_FLAG_SORTED	0x1
+/**
+@brief		Header flag set by @ref flat_file_close, and cleared when the file is opened.
+			The row count in the header is only trusted while it is set.
+*/
+#define ION_FLAT_FILE_HEADER_FLAG_CLEAN		0x2
+
+/**
+@brief		How many sorted runs @ref flat_file_seal merges at once.
+@details	The memory given to the seal is split evenly between this many
+			runs and the merged output.
+*/
+#if !defined(ION_FLAT_FILE_SEAL_FAN_IN)
+#define ION_FLAT_FILE_SEAL_FAN_IN 8
+#endif
+
+/**
+@brief		The most bytes of rows a scan reads from the data file at once.
+@details	Scans start by reading the number of rows given as the
+			dictionary size, and double the rows read each time they run on
+			through the file, up to this many bytes. Whole-file scans then
+			cost a few large reads rather than one read per buffered region.
+			A buffer of this size is allocated by each flat file, so it
+			falls back to the dictionary size on small devices.
+*/
+#if !defined(ION_FLAT_FILE_SCAN_BUFFER)
+#if defined(ARDUINO)
+#define ION_FLAT_FILE_SCAN_BUFFER 0
+#else
+#define ION_FLAT_FILE_SCAN_BUFFER (1024L * 1024L)
+#endif
+#endif
+
+/**
+@brief		How many rows each fence covers in sorted mode.
+@details	Sorted flat files keep the first key of every block of this many
+			rows in memory, so a binary search reads a single block from the
+			data file. Blocks are never smaller than the dictionary size. The
+			fences take the key size for every block of rows, so they are off
+			(0) on small devices, where each probe of the search reads a row.
+*/
+#if !defined(ION_FLAT_FILE_FENCE_ROWS)
+#if defined(ARDUINO)
+#define ION_FLAT_FILE_FENCE_ROWS 0
+#else
+#define ION_FLAT_FILE_FENCE_ROWS 64
+#endif
+#endif
+
+/**
+@brief		How many rows each zone covers in an unsorted flat file.
+@details	Unsorted flat files keep the smallest and largest key of every
+			zone of this many rows in memory, so range scans pass over the
+			zones that cannot hold a key in range without reading them. The
+			zones take twice the key size for every zone of rows, so they are
+			off (0) on small devices.
+*/
+#if !defined(ION_FLAT_FILE_ZONE_ROWS)
+#if defined(ARDUINO)
+#define ION_FLAT_FILE_ZONE_ROWS 0
+#else
+#define ION_FLAT_FILE_ZONE_ROWS 256
+#endif
+#endif
+
+/**
+@brief		How many rows a key match scan of a PAX layout tests at once.
+@details	The statuses and keys of a PAX block each lie in one stripe, so
+			with SSE2 a scan loads 16 statuses and the keys beside them into
+			vector registers and tests them together. Other targets test a
+			row at a time, as SSE2 builds do when this is set to 1.
+*/
+#if !defined(ION_FLAT_FILE_MATCH_LANES)
+#if defined(__SSE2__)
+#define ION_FLAT_FILE_MATCH_LANES 16
+#else
+#define ION_FLAT_FILE_MATCH_LANES 1
+#endif
+#endif
+
+/**
+@brief		How many inserted rows a flat file holds in memory before writing
+			them to the end of the data file together.
+@details	Held rows are written out before any other operation reads or
+			writes the data file, and by @ref flat_file_flush. Small devices
+			write each row as it is inserted (0).
+*/
+#if !defined(ION_FLAT_FILE_APPEND_ROWS)
+#if defined(ARDUINO)
+#define ION_FLAT_FILE_APPEND_ROWS 0
+#else
+#define ION_FLAT_FILE_APPEND_ROWS 256
+#endif
+#endif
+
+/**
+@brief		The share of rows, in percent, that may be deleted rows before a flat
+			file using tombstone deletes compacts itself.
+*/
+#if !defined(ION_FLAT_FILE_COMPACT_PERCENT)
+#define ION_FLAT_FILE_COMPACT_PERCENT 25
+#endif
+
+/**
+@brief		The header at the start of a flat file's data file.
+*/
+typedef struct {
+	/**> Always @ref ION_FLAT_FILE_HEADER_MAGIC. */
+	int			magic;
+	/**> The @ref ION_FLAT_FILE_HEADER_VERSION the file was written with. */
+	int			version;
+	/**> The size of each row, which must match the key and value sizes the file is opened with. */
+	int			row_size;
+	/**> Any of @ref ION_FLAT_FILE_HEADER_FLAG_SORTED and @ref ION_FLAT_FILE_HEADER_FLAG_CLEAN. */
+	int			flags;
+	/**> How many rows each block holds in the PAX layout, or zero for the row layout. */
+	ion_fpos_t	block_rows;
+	/**> How many rows the file held when it was closed. Only valid in a clean header. */
+	ion_fpos_t	num_rows;
+	/**> How many of those rows were marked empty. Only valid in a clean header, and
+		 missing from version 1 headers. */
+	ion_fpos_t	num_dead_rows;
+} ion_flat_file_header_t;
+
+/**
+@brief		Whether @ref flat_file_use_mmap can map the data file into memory,
+			which it only does on Linux.
+*/
+#if !defined(ION_FLAT_FILE_MMAP)
+#if defined(__linux__) && !defined(ARDUINO)
+#define ION_FLAT_FILE_MMAP 1
+#else
+#define ION_FLAT_FILE_MMAP 0
+#endif
+#endif
+
 /**
 @brief		Metadata container that holds flat file specific information.
 */
@@ -62,6 +221,16 @@ typedef struct {
 	ion_dictionary_parent_t super;
 	/**> Flag to toggle whether or not to activate "sorted mode" for storage. */
 	ion_boolean_t			sorted_mode;
+	/**> Flag to make deletes mark rows empty instead of moving the last row into their place.
+		 Deletes always do this in sorted mode. */
+	ion_boolean_t			tombstone_deletes;
+	/**> How many rows before @p eof_position are marked empty, or -1 until they are
+		 counted. It is kept in the header across a clean close, and counted at the
+		 first tombstone delete after any other open. */
+	ion_fpos_t				num_dead_rows;
+	/**> The @ref ION_FLAT_FILE_HEADER_VERSION of the data file's header, or zero for
+		 the single word header of older files, which is left as it is. */
+	int						header_version;
 	/**> This signifies where the actual record data starts, in case we want to
 		 write some metadata at the beginning of the flat file's file. */
 	ion_fpos_t				start_of_data;
@@ -71,11 +240,27 @@ typedef struct {
 		 records we want to buffer at a time. This is a trade-off between
 		 better performance and increased memory usage. */
 	ion_dictionary_size_t	num_buffered;
-	/**> Memory buffer capable of holding @p row_size number of rows. This is used
+	/**> How many rows fit in @p buffer. This is at least @p num_buffered, and larger
+		 when @ref ION_FLAT_FILE_SCAN_BUFFER holds more rows. */
+	size_t					max_buffered;
+	/**> Memory buffer capable of holding @p max_buffered number of rows. This is used
 		 for many purposes throughout the flat file. */
 	ion_byte_t				*buffer;
+	/**> Inserted rows that have not been written to @p data_file yet. They are the last
+		 @p num_appended rows before @p eof_position, which counts them already. */
+	ion_byte_t				*append_buffer;
+	/**> How many rows are waiting in @p append_buffer. */
+	size_t					num_appended;
+	/**> How many rows fit in @p append_buffer. Zero when inserts are written as they come. */
+	size_t					max_appended;
 	/**> The file descriptor of the file this flat file instance operates on. */
 	FILE					*data_file;
+	/**> The data file mapped into memory by @ref flat_file_use_mmap, or @p NULL while it
+		 is read and written through @p data_file. */
+	ion_byte_t				*map;
+	/**> How many bytes of the data file are mapped. The data file is grown to this size,
+		 and cut back to its rows once it is unmapped. */
+	ion_fpos_t				map_size;
 	/**> This value expresses the size of one row inside the @p data_file. A row is defined
 		 as a record + metadata. Change this if @ref ion_flat_file_row_t changes!*/
 	size_t					row_size;
@@ -84,8 +269,41 @@ typedef struct {
 		 This is expressed as an index that points to the first record in the region. @p num_in_buffer-1 would
 		 be the last index in the region. */
 	ion_fpos_t	current_loaded_region;
+	/**> The rows of the loaded region. This is @p buffer, or the rows in place in @p map for
+		 the row layout. */
+	ion_byte_t	*region;
 	/**> Expresses how many valid records are currently in the buffer. */
 	size_t		num_in_buffer;
+	/**> How many rows each fence covers. Zero when sorted mode does not use fences. */
+	ion_fpos_t	fence_rows;
+	/**> The first key of each block of @p fence_rows rows, for sorted mode searches. These are
+		 built by the first search after the file is opened, and kept up to date by inserts. */
+	ion_byte_t	*fence_keys;
+	/**> How many fences are in @p fence_keys. */
+	ion_fpos_t	num_fences;
+	/**> How many fences @p fence_keys has room for. */
+	ion_fpos_t	max_fences;
+	/**> How many rows each zone covers. Zero when range scans do not use zones. */
+	ion_fpos_t	zone_rows;
+	/**> The smallest and then the largest key of each zone of @p zone_rows rows, for unsorted
+		 range scans. These are built by the first range scan after the file is opened, and kept
+		 up to date by inserts and deletes. Deleted rows may leave a zone wider than it needs to be. */
+	ion_byte_t	*zone_keys;
+	/**> How many rows, from the start of the file, the zones cover. */
+	ion_fpos_t	num_zoned_rows;
+	/**> How many zones @p zone_keys has room for. */
+	ion_fpos_t	max_zones;
+	/**> How many rows each block holds in the PAX layout, where a block keeps the statuses,
+		 keys and values of its rows in three separate stripes. Zero for the row layout. */
+	ion_fpos_t	block_rows;
+	/**> How many blocks the data file has room for in the PAX layout. */
+	ion_fpos_t	num_blocks;
+	/**> Room for one block, used to move rows between the row layout in memory and the
+		 PAX layout in the data file. */
+	ion_byte_t	*block_buffer;
+	/**> Whether the loaded region holds the values of its rows. Scans of a PAX layout
+		 file that only test keys leave them out, and fetch the value of the row they find. */
+	ion_boolean_t	region_has_values;
 } ion_flat_file_t;
 
 /**
@@ -0,0 +1,1034 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Implementation of the linear hash.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#include <limits.h>
+#include "linear_hash.h"
+
+/**
+@brief		Finds the bucket that holds @p key.
+@details	Buckets below the split point of this round have already been
+			split, so they are addressed with one more bit of the hash.
+*/
+static int
+linear_hash_bucket(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key
+) {
+	uint32_t	hash	= dictionary_hash_key(key, linear_hash->super.key_type, linear_hash->super.record.key_size);
+	uint32_t	round	= (uint32_t) linear_hash->header.initial_buckets << linear_hash->header.level;
+	uint32_t	bucket	= hash & (round - 1);
+
+	if (bucket < (uint32_t) linear_hash->header.split) {
+		bucket = hash & (2 * round - 1);
+	}
+
+	return (int) bucket;
+}
+
+/**
+@brief		Gives the slot at index @p slot of a page held in memory.
+*/
+static ion_byte_t *
+linear_hash_slot(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page,
+	int						slot
+) {
+	return page->data + sizeof(int) + slot * linear_hash->slot_size;
+}
+
+/**
+@brief		Gives the overflow page that follows a page held in memory.
+*/
+static int
+linear_hash_page_next(
+	ion_linear_hash_page_t *page
+) {
+	int next;
+
+	memcpy(&next, page->data, sizeof(int));
+	return next;
+}
+
+/**
+@brief		Sets the overflow page that follows a page held in memory.
+*/
+static void
+linear_hash_set_page_next(
+	ion_linear_hash_page_t	*page,
+	int						next
+) {
+	memcpy(page->data, &next, sizeof(int));
+}
+
+/**
+@brief		Empties a page held in memory and names it as the given page.
+*/
+static void
+linear_hash_clear_page(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page,
+	int						bucket,
+	int						overflow
+) {
+	memset(page->data, 0, linear_hash->page_size);
+	linear_hash_set_page_next(page, ION_LINEAR_HASH_NO_PAGE);
+	page->bucket	= ION_LINEAR_HASH_NO_PAGE == overflow ? bucket : ION_LINEAR_HASH_NO_PAGE;
+	page->overflow	= overflow;
+}
+
+/**
+@brief		Gives the file a page is in.
+*/
+static ion_file_handle_t
+linear_hash_page_file(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page
+) {
+	return ION_LINEAR_HASH_NO_PAGE == page->overflow ? linear_hash->bucket_file : linear_hash->overflow_file;
+}
+
+/**
+@brief		Gives where a page starts in its file.
+*/
+static ion_file_offset_t
+linear_hash_page_offset(
+	ion_linear_hash_t	*linear_hash,
+	int					bucket,
+	int					overflow
+) {
+	if (ION_LINEAR_HASH_NO_PAGE == overflow) {
+		return (ion_file_offset_t) sizeof(ion_linear_hash_header_t) + (ion_file_offset_t) bucket * linear_hash->page_size;
+	}
+
+	return (ion_file_offset_t) overflow * linear_hash->page_size;
+}
+
+/**
+@brief		Reads a page into @p page, unless it is the page already held.
+@param[in]	linear_hash
+				Which linear hash to read from.
+@param[out]	page
+				Where to hold the page.
+@param[in]	bucket
+				The bucket whose first page to read. Ignored for overflow pages.
+@param[in]	overflow
+				The overflow page to read, or @ref ION_LINEAR_HASH_NO_PAGE for the
+				first page of @p bucket.
+@return		The status of the read.
+*/
+static ion_err_t
+linear_hash_read_page(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page,
+	int						bucket,
+	int						overflow
+) {
+	if (ION_LINEAR_HASH_NO_PAGE != overflow) {
+		bucket = ION_LINEAR_HASH_NO_PAGE;
+	}
+
+	if ((page->bucket == bucket) && (page->overflow == overflow)) {
+		return err_ok;
+	}
+
+	/* Until the read succeeds, the buffer holds no page. */
+	page->bucket	= ION_LINEAR_HASH_NO_PAGE;
+	page->overflow	= ION_LINEAR_HASH_NO_PAGE;
+
+	ion_file_handle_t	file	= ION_LINEAR_HASH_NO_PAGE == overflow ? linear_hash->bucket_file : linear_hash->overflow_file;
+	ion_err_t			err		= ion_fread_at(file, linear_hash_page_offset(linear_hash, bucket, overflow), linear_hash->page_size, page->data);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	page->bucket	= bucket;
+	page->overflow	= overflow;
+
+	return err_ok;
+}
+
+/**
+@brief		Writes the whole of a page held in memory to its file.
+@details	If the page was written from another buffer than the one lookups
+			read into, that buffer no longer holds it.
+*/
+static ion_err_t
+linear_hash_write_page(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page
+) {
+	if ((page != &linear_hash->page) && (linear_hash->page.bucket == page->bucket) && (linear_hash->page.overflow == page->overflow)) {
+		linear_hash->page.bucket	= ION_LINEAR_HASH_NO_PAGE;
+		linear_hash->page.overflow	= ION_LINEAR_HASH_NO_PAGE;
+	}
+
+	return ion_fwrite_at(linear_hash_page_file(linear_hash, page), linear_hash_page_offset(linear_hash, page->bucket, page->overflow), linear_hash->page_size, page->data);
+}
+
+/**
+@brief		Writes one slot of a page held in memory to its file.
+*/
+static ion_err_t
+linear_hash_write_slot(
+	ion_linear_hash_t		*linear_hash,
+	ion_linear_hash_page_t	*page,
+	int						slot
+) {
+	ion_file_offset_t offset = linear_hash_page_offset(linear_hash, page->bucket, page->overflow) + sizeof(int) + (ion_file_offset_t) slot * linear_hash->slot_size;
+
+	return ion_fwrite_at(linear_hash_page_file(linear_hash, page), offset, linear_hash->slot_size, linear_hash_slot(linear_hash, page, slot));
+}
+
+/**
+@brief		Takes an overflow page off the free list, or adds one to the end of
+			the overflow file.
+@details	Only the link of a free page is read, so neither page buffer changes.
+*/
+static ion_err_t
+linear_hash_allocate_overflow(
+	ion_linear_hash_t	*linear_hash,
+	int					*overflow
+) {
+	if (ION_LINEAR_HASH_NO_PAGE == linear_hash->header.free_page) {
+		*overflow = linear_hash->header.overflow_pages++;
+		return err_ok;
+	}
+
+	int			next;
+	ion_err_t	err = ion_fread_at(linear_hash->overflow_file, linear_hash_page_offset(linear_hash, ION_LINEAR_HASH_NO_PAGE, linear_hash->header.free_page), sizeof(int), (ion_byte_t *) &next);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	*overflow						= linear_hash->header.free_page;
+	linear_hash->header.free_page	= next;
+
+	return err_ok;
+}
+
+/**
+@brief		Puts an overflow page on the free list by pointing its link at the
+			previous head of the list.
+*/
+static ion_err_t
+linear_hash_free_overflow(
+	ion_linear_hash_t	*linear_hash,
+	int					overflow
+) {
+	if (linear_hash->page.overflow == overflow) {
+		linear_hash->page.overflow = ION_LINEAR_HASH_NO_PAGE;
+	}
+
+	ion_err_t err = ion_fwrite_at(linear_hash->overflow_file, linear_hash_page_offset(linear_hash, ION_LINEAR_HASH_NO_PAGE, overflow), sizeof(int), (ion_byte_t *) &linear_hash->header.free_page);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	linear_hash->header.free_page = overflow;
+
+	return err_ok;
+}
+
+/**
+@brief		Writes the header held in memory to the start of the bucket file.
+*/
+static ion_err_t
+linear_hash_write_header(
+	ion_linear_hash_t *linear_hash
+) {
+	return ion_fwrite_at(linear_hash->bucket_file, 0, sizeof(ion_linear_hash_header_t), (ion_byte_t *) &linear_hash->header);
+}
+
+/**
+@brief		Fills in the key and value of @p location from the page held.
+*/
+static void
+linear_hash_set_location(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_location_t	*location,
+	int							bucket,
+	int							overflow,
+	int							slot
+) {
+	ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, slot);
+
+	location->bucket	= bucket;
+	location->overflow	= overflow;
+	location->slot		= slot;
+	location->key		= data + sizeof(ion_linear_hash_slot_status_t);
+	location->value		= data + sizeof(ion_linear_hash_slot_status_t) + linear_hash->super.record.key_size;
+}
+
+/**
+@brief		Walks the chain of the bucket of @p key looking for it.
+@param[in]	linear_hash
+				Which linear hash to look in.
+@param[in]	key
+				Key to search for.
+@param[out]	location
+				Set to the slot holding @p key, if it is found.
+@param[out]	free_slot
+				Set to the first free slot of the chain. If there is none, its
+				slot is -1 and it names the last page of the chain, which is
+				then the page held. May be NULL.
+@return		@c err_item_not_found if the key is not stored.
+*/
+static ion_err_t
+linear_hash_find_slot(
+	ion_linear_hash_t			*linear_hash,
+	ion_key_t					key,
+	ion_linear_hash_location_t	*location,
+	ion_linear_hash_location_t	*free_slot
+) {
+	int bucket		= linear_hash_bucket(linear_hash, key);
+	int overflow	= ION_LINEAR_HASH_NO_PAGE;
+	int slot;
+
+	if (NULL != free_slot) {
+		free_slot->slot = -1;
+	}
+
+	while (1) {
+		ion_err_t err = linear_hash_read_page(linear_hash, &linear_hash->page, bucket, overflow);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		for (slot = 0; slot < linear_hash->header.page_slots; slot++) {
+			ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, slot);
+
+			if (ION_LINEAR_HASH_STATUS_OCCUPIED == *data) {
+				if (ION_IS_EQUAL == linear_hash->super.compare(data + sizeof(ion_linear_hash_slot_status_t), key, linear_hash->super.record.key_size)) {
+					linear_hash_set_location(linear_hash, location, bucket, overflow, slot);
+					return err_ok;
+				}
+			}
+			else if ((NULL != free_slot) && (-1 == free_slot->slot)) {
+				free_slot->bucket	= bucket;
+				free_slot->overflow = overflow;
+				free_slot->slot		= slot;
+			}
+		}
+
+		int next = linear_hash_page_next(&linear_hash->page);
+
+		if (ION_LINEAR_HASH_NO_PAGE == next) {
+			break;
+		}
+
+		overflow = next;
+	}
+
+	if ((NULL != free_slot) && (-1 == free_slot->slot)) {
+		free_slot->bucket	= bucket;
+		free_slot->overflow = overflow;
+	}
+
+	return err_item_not_found;
+}
+
+/**
+@brief		Frees a chain of overflow pages.
+@param[in]	linear_hash
+				Which linear hash the pages belong to.
+@param[in]	overflow
+				The first page of the chain, or @ref ION_LINEAR_HASH_NO_PAGE.
+@param[in]	last
+				The last page of the chain, whose link is not read because it
+				may never have been written. @ref ION_LINEAR_HASH_NO_PAGE to
+				follow the links to the end.
+@return		The status of the reads and writes.
+*/
+static ion_err_t
+linear_hash_free_chain(
+	ion_linear_hash_t	*linear_hash,
+	int					overflow,
+	int					last
+) {
+	ion_err_t err = err_ok;
+
+	while ((err_ok == err) && (ION_LINEAR_HASH_NO_PAGE != overflow)) {
+		int next = ION_LINEAR_HASH_NO_PAGE;
+
+		if (overflow != last) {
+			err = ion_fread_at(linear_hash->overflow_file, linear_hash_page_offset(linear_hash, ION_LINEAR_HASH_NO_PAGE, overflow), sizeof(int), (ion_byte_t *) &next);
+		}
+
+		if (err_ok == err) {
+			err			= linear_hash_free_overflow(linear_hash, overflow);
+			overflow	= next;
+		}
+	}
+
+	return err;
+}
+
+/**
+@brief		Clears the copies left behind in the bucket that was split last.
+@details	Records of the bucket whose key is now addressed to another bucket
+			are cleared, and overflow pages left empty at the end of the chain
+			are freed. Until then, scans skip those copies. This is safe to
+			run again if it was cut short.
+*/
+static ion_err_t
+linear_hash_clean_bucket(
+	ion_linear_hash_t *linear_hash
+) {
+	int			bucket		= linear_hash->header.stale_bucket;
+	int			overflow	= ION_LINEAR_HASH_NO_PAGE;
+	int			last_kept	= ION_LINEAR_HASH_NO_PAGE;
+	ion_err_t	err;
+	int			slot;
+
+	while (1) {
+		ion_boolean_t	cleared = boolean_false;
+		ion_boolean_t	kept	= boolean_false;
+
+		err = linear_hash_read_page(linear_hash, &linear_hash->page, bucket, overflow);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		for (slot = 0; slot < linear_hash->header.page_slots; slot++) {
+			ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, slot);
+
+			if (ION_LINEAR_HASH_STATUS_OCCUPIED != *data) {
+				continue;
+			}
+
+			if (linear_hash_bucket(linear_hash, data + sizeof(ion_linear_hash_slot_status_t)) == bucket) {
+				kept = boolean_true;
+			}
+			else {
+				*data	= ION_LINEAR_HASH_STATUS_EMPTY;
+				cleared = boolean_true;
+			}
+		}
+
+		if (cleared) {
+			err = linear_hash_write_page(linear_hash, &linear_hash->page);
+
+			if (err_ok != err) {
+				return err;
+			}
+		}
+
+		if (kept) {
+			last_kept = overflow;
+		}
+
+		overflow = linear_hash_page_next(&linear_hash->page);
+
+		if (ION_LINEAR_HASH_NO_PAGE == overflow) {
+			break;
+		}
+	}
+
+	/* Cut the chain after the last page that still holds a record, and free the rest. */
+	err = linear_hash_read_page(linear_hash, &linear_hash->page, bucket, last_kept);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	overflow = linear_hash_page_next(&linear_hash->page);
+
+	if (ION_LINEAR_HASH_NO_PAGE != overflow) {
+		linear_hash_set_page_next(&linear_hash->page, ION_LINEAR_HASH_NO_PAGE);
+		err = ion_fwrite_at(linear_hash_page_file(linear_hash, &linear_hash->page), linear_hash_page_offset(linear_hash, linear_hash->page.bucket, linear_hash->page.overflow), sizeof(int), linear_hash->page.data);
+
+		if (err_ok == err) {
+			err = linear_hash_free_chain(linear_hash, overflow, ION_LINEAR_HASH_NO_PAGE);
+		}
+	}
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	linear_hash->header.stale_bucket = ION_LINEAR_HASH_NO_PAGE;
+
+	return err_ok;
+}
+
+/**
+@brief		Splits the next bucket of this round.
+@details	The records of the bucket whose hash has the new bit set are
+			copied to a new bucket at the end of the bucket file, while the old
+			chain is left as it is. Only once the new chain is written does the
+			header say the new bucket exists. Then the copies are cleared from
+			the old chain. If the split fails before the header is written,
+			every record is still in the old bucket. If it fails after, the
+			old bucket is cleaned up before the next split.
+*/
+static ion_err_t
+linear_hash_split(
+	ion_linear_hash_t *linear_hash
+) {
+	int						round		= linear_hash->header.initial_buckets << linear_hash->header.level;
+	int						old_bucket	= linear_hash->header.split;
+	int						new_bucket	= old_bucket + round;
+	uint32_t				mask		= 2 * (uint32_t) round - 1;
+	ion_linear_hash_page_t	*to			= &linear_hash->split_page;
+	int						to_slot		= 0;
+	int						first		= ION_LINEAR_HASH_NO_PAGE;
+	int						overflow	= ION_LINEAR_HASH_NO_PAGE;
+	ion_err_t				err			= err_ok;
+	int						slot;
+
+	if (ION_LINEAR_HASH_NO_PAGE != linear_hash->header.stale_bucket) {
+		err = linear_hash_clean_bucket(linear_hash);
+
+		if (err_ok != err) {
+			return err;
+		}
+	}
+
+	linear_hash_clear_page(linear_hash, to, new_bucket, ION_LINEAR_HASH_NO_PAGE);
+
+	while (err_ok == err) {
+		err = linear_hash_read_page(linear_hash, &linear_hash->page, old_bucket, overflow);
+
+		for (slot = 0; (err_ok == err) && (slot < linear_hash->header.page_slots); slot++) {
+			ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, slot);
+
+			if ((ION_LINEAR_HASH_STATUS_OCCUPIED != *data) || ((dictionary_hash_key(data + sizeof(ion_linear_hash_slot_status_t), linear_hash->super.key_type, linear_hash->super.record.key_size) & mask) != (uint32_t) new_bucket)) {
+				continue;
+			}
+
+			if (to_slot == linear_hash->header.page_slots) {
+				int next;
+
+				err = linear_hash_allocate_overflow(linear_hash, &next);
+
+				if (err_ok != err) {
+					break;
+				}
+
+				linear_hash_set_page_next(to, next);
+				err = linear_hash_write_page(linear_hash, to);
+
+				if (err_ok != err) {
+					linear_hash_free_overflow(linear_hash, next);
+					break;
+				}
+
+				if (ION_LINEAR_HASH_NO_PAGE == first) {
+					first = next;
+				}
+
+				linear_hash_clear_page(linear_hash, to, ION_LINEAR_HASH_NO_PAGE, next);
+				to_slot = 0;
+			}
+
+			memcpy(linear_hash_slot(linear_hash, to, to_slot++), data, linear_hash->slot_size);
+		}
+
+		if (err_ok == err) {
+			overflow = linear_hash_page_next(&linear_hash->page);
+
+			if (ION_LINEAR_HASH_NO_PAGE == overflow) {
+				break;
+			}
+		}
+	}
+
+	if (err_ok == err) {
+		err = linear_hash_write_page(linear_hash, to);
+	}
+
+	if (err_ok == err) {
+		err = ion_fflush(linear_hash->bucket_file);
+	}
+
+	if (err_ok == err) {
+		err = ion_fflush(linear_hash->overflow_file);
+	}
+
+	if (err_ok != err) {
+		/* The old chain still holds every record, so only the pages taken for the new chain are given back. */
+		linear_hash_free_chain(linear_hash, first, to->overflow);
+		return err;
+	}
+
+	int level = linear_hash->header.level;
+
+	linear_hash->header.split++;
+
+	if (linear_hash->header.split == round) {
+		linear_hash->header.level++;
+		linear_hash->header.split = 0;
+	}
+
+	/* The new bucket is only found once the header says it exists. */
+	linear_hash->header.stale_bucket	= old_bucket;
+	err									= linear_hash_write_header(linear_hash);
+
+	if (err_ok == err) {
+		err = ion_fflush(linear_hash->bucket_file);
+	}
+
+	if (err_ok != err) {
+		linear_hash->header.level			= level;
+		linear_hash->header.split			= old_bucket;
+		linear_hash->header.stale_bucket	= ION_LINEAR_HASH_NO_PAGE;
+		linear_hash_free_chain(linear_hash, first, ION_LINEAR_HASH_NO_PAGE);
+		return err;
+	}
+
+	return linear_hash_clean_bucket(linear_hash);
+}
+
+ion_err_t
+linear_hash_initialize(
+	ion_linear_hash_t		*linear_hash,
+	ion_dictionary_id_t		id,
+	ion_key_type_t			key_type,
+	ion_key_size_t			key_size,
+	ion_value_size_t		value_size,
+	ion_dictionary_size_t	dictionary_size
+) {
+	linear_hash->super.id					= id;
+	linear_hash->super.key_type				= key_type;
+	linear_hash->super.record.key_size		= key_size;
+	linear_hash->super.record.value_size	= value_size;
+
+	char	bucket_filename[ION_MAX_FILENAME_LENGTH];
+	char	overflow_filename[ION_MAX_FILENAME_LENGTH];
+
+	if ((dictionary_get_filename(id, "lhb", bucket_filename) >= ION_MAX_FILENAME_LENGTH) || (dictionary_get_filename(id, "lho", overflow_filename) >= ION_MAX_FILENAME_LENGTH)) {
+		return err_dictionary_initialization_failed;
+	}
+
+	/* A slot is laid out as: | STATUS |	  KEY	 |	   VALUE	  | */
+	/*				 Bytes:	(1)	 (key_size)   (value_size)	*/
+	linear_hash->slot_size = sizeof(ion_linear_hash_slot_status_t) + key_size + value_size;
+
+	ion_boolean_t exists = ion_fexists(bucket_filename);
+
+	linear_hash->bucket_file = ion_fopen(bucket_filename);
+#if defined(ARDUINO)
+
+	if (NULL == linear_hash->bucket_file.file) {
+#else
+
+	if (NULL == linear_hash->bucket_file) {
+#endif
+		return err_file_open_error;
+	}
+
+	linear_hash->overflow_file = ion_fopen(overflow_filename);
+#if defined(ARDUINO)
+
+	if (NULL == linear_hash->overflow_file.file) {
+#else
+
+	if (NULL == linear_hash->overflow_file) {
+#endif
+		ion_fclose(linear_hash->bucket_file);
+		return err_file_open_error;
+	}
+
+	ion_err_t err = err_ok;
+
+	if (exists) {
+		err = ion_fread_at(linear_hash->bucket_file, 0, sizeof(ion_linear_hash_header_t), (ion_byte_t *) &linear_hash->header);
+
+		if ((err_ok == err) && (((int) ION_LINEAR_HASH_HEADER_MAGIC != linear_hash->header.magic) || (ION_LINEAR_HASH_HEADER_VERSION < linear_hash->header.version) || (linear_hash->slot_size != linear_hash->header.slot_size) || (0 >= linear_hash->header.page_slots))) {
+			/* Whatever this file holds, it is not a linear hash of these records. */
+			err = err_dictionary_initialization_failed;
+		}
+	}
+	else {
+		/* The page size only matters when the hash is created. Later on, the header says how many slots a page has. */
+		linear_hash->header.magic			= ION_LINEAR_HASH_HEADER_MAGIC;
+		linear_hash->header.version			= ION_LINEAR_HASH_HEADER_VERSION;
+		linear_hash->header.slot_size		= linear_hash->slot_size;
+		linear_hash->header.page_slots		= (ION_LINEAR_HASH_PAGE_SIZE - (int) sizeof(int)) / linear_hash->slot_size;
+		linear_hash->header.initial_buckets = 1;
+		linear_hash->header.level			= 0;
+		linear_hash->header.split			= 0;
+		linear_hash->header.num_records		= 0;
+		linear_hash->header.overflow_pages	= 0;
+		linear_hash->header.free_page		= ION_LINEAR_HASH_NO_PAGE;
+		linear_hash->header.stale_bucket	= ION_LINEAR_HASH_NO_PAGE;
+
+		if (linear_hash->header.page_slots < 1) {
+			linear_hash->header.page_slots = 1;
+		}
+
+		/* Start with enough buckets for the dictionary size, rounded up to a power of two. */
+		ion_dictionary_size_t buckets_needed = dictionary_size / linear_hash->header.page_slots + (0 != dictionary_size % linear_hash->header.page_slots);
+
+		while (((ion_dictionary_size_t) linear_hash->header.initial_buckets < buckets_needed) && (linear_hash->header.initial_buckets <= INT_MAX / 4)) {
+			linear_hash->header.initial_buckets *= 2;
+		}
+	}
+
+	linear_hash->page_size			= sizeof(int) + linear_hash->header.page_slots * linear_hash->slot_size;
+	linear_hash->page.data			= NULL;
+	linear_hash->split_page.data	= NULL;
+
+	if (err_ok == err) {
+		linear_hash->page.data			= malloc(linear_hash->page_size);
+		linear_hash->split_page.data	= malloc(linear_hash->page_size);
+
+		if ((NULL == linear_hash->page.data) || (NULL == linear_hash->split_page.data)) {
+			err = err_out_of_memory;
+		}
+	}
+
+	if ((err_ok == err) && !exists) {
+		int bucket;
+
+		err = linear_hash_write_header(linear_hash);
+
+		for (bucket = 0; (err_ok == err) && (bucket < linear_hash->header.initial_buckets); bucket++) {
+			linear_hash_clear_page(linear_hash, &linear_hash->page, bucket, ION_LINEAR_HASH_NO_PAGE);
+			err = linear_hash_write_page(linear_hash, &linear_hash->page);
+		}
+	}
+
+	if (err_ok != err) {
+		free(linear_hash->page.data);
+		free(linear_hash->split_page.data);
+		ion_fclose(linear_hash->bucket_file);
+		ion_fclose(linear_hash->overflow_file);
+
+		if (!exists) {
+			ion_fremove(bucket_filename);
+			ion_fremove(overflow_filename);
+		}
+
+		return err;
+	}
+
+	linear_hash->page.bucket			= ION_LINEAR_HASH_NO_PAGE;
+	linear_hash->page.overflow			= ION_LINEAR_HASH_NO_PAGE;
+	linear_hash->split_page.bucket		= ION_LINEAR_HASH_NO_PAGE;
+	linear_hash->split_page.overflow	= ION_LINEAR_HASH_NO_PAGE;
+
+	return err_ok;
+}
+
+ion_err_t
+linear_hash_destroy(
+	ion_linear_hash_t *linear_hash
+) {
+	ion_err_t err = linear_hash_close(linear_hash);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	char	bucket_filename[ION_MAX_FILENAME_LENGTH];
+	char	overflow_filename[ION_MAX_FILENAME_LENGTH];
+
+	dictionary_get_filename(linear_hash->super.id, "lhb", bucket_filename);
+	dictionary_get_filename(linear_hash->super.id, "lho", overflow_filename);
+
+	if ((err_ok != ion_fremove(bucket_filename)) || (err_ok != ion_fremove(overflow_filename))) {
+		return err_file_delete_error;
+	}
+
+	return err_ok;
+}
+
+ion_err_t
+linear_hash_close(
+	ion_linear_hash_t *linear_hash
+) {
+	/* The files are closed even if the header could not be written. */
+	ion_err_t err = linear_hash_write_header(linear_hash);
+
+	free(linear_hash->page.data);
+	linear_hash->page.data			= NULL;
+	free(linear_hash->split_page.data);
+	linear_hash->split_page.data	= NULL;
+
+	ion_fclose(linear_hash->bucket_file);
+	ion_fclose(linear_hash->overflow_file);
+
+	return err;
+}
+
+ion_err_t
+linear_hash_flush(
+	ion_linear_hash_t *linear_hash
+) {
+	ion_err_t err = linear_hash_write_header(linear_hash);
+
+	if (err_ok == err) {
+		err = ion_fflush(linear_hash->bucket_file);
+	}
+
+	if (err_ok == err) {
+		err = ion_fflush(linear_hash->overflow_file);
+	}
+
+	return err;
+}
+
+ion_status_t
+linear_hash_insert(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	ion_linear_hash_location_t	location;
+	ion_linear_hash_location_t	free_slot;
+	ion_err_t					err = linear_hash_find_slot(linear_hash, key, &location, &free_slot);
+
+	if (err_ok == err) {
+		return ION_STATUS_ERROR(err_duplicate_key);
+	}
+	else if (err_item_not_found != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	ion_file_handle_t	last_file	= linear_hash->bucket_file;
+	ion_file_offset_t	last_offset = 0;
+	int					overflow	= ION_LINEAR_HASH_NO_PAGE;
+
+	if (-1 == free_slot.slot) {
+		/* The chain is full, so a new overflow page goes on its end. The last page of the chain is still held. Only
+		   where its link is kept is noted here, as the link is written after the new page. */
+		last_file	= linear_hash_page_file(linear_hash, &linear_hash->page);
+		last_offset = linear_hash_page_offset(linear_hash, linear_hash->page.bucket, linear_hash->page.overflow);
+		err			= linear_hash_allocate_overflow(linear_hash, &overflow);
+
+		if (err_ok != err) {
+			return ION_STATUS_ERROR(err);
+		}
+
+		linear_hash_clear_page(linear_hash, &linear_hash->page, ION_LINEAR_HASH_NO_PAGE, overflow);
+		free_slot.overflow	= overflow;
+		free_slot.slot		= 0;
+	}
+	else {
+		err = linear_hash_read_page(linear_hash, &linear_hash->page, free_slot.bucket, free_slot.overflow);
+
+		if (err_ok != err) {
+			return ION_STATUS_ERROR(err);
+		}
+	}
+
+	ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, free_slot.slot);
+
+	*data = ION_LINEAR_HASH_STATUS_OCCUPIED;
+	memcpy(data + sizeof(ion_linear_hash_slot_status_t), key, linear_hash->super.record.key_size);
+	memcpy(data + sizeof(ion_linear_hash_slot_status_t) + linear_hash->super.record.key_size, value, linear_hash->super.record.value_size);
+
+	if (ION_LINEAR_HASH_NO_PAGE != overflow) {
+		/* A reused overflow page still holds the records it had when it was freed. It is written whole, with the
+		   rest of its slots empty, before the chain links to it, so a crash between the two writes cannot bring
+		   those records back. */
+		err = linear_hash_write_page(linear_hash, &linear_hash->page);
+
+		if (err_ok == err) {
+			err = ion_fwrite_at(last_file, last_offset, sizeof(int), (ion_byte_t *) &overflow);
+		}
+
+		if (err_ok != err) {
+			linear_hash_free_overflow(linear_hash, overflow);
+			return ION_STATUS_ERROR(err);
+		}
+	}
+	else {
+		err = linear_hash_write_slot(linear_hash, &linear_hash->page, free_slot.slot);
+
+		if (err_ok != err) {
+			return ION_STATUS_ERROR(err);
+		}
+	}
+
+	linear_hash->header.num_records++;
+
+	if ((long) linear_hash->header.num_records * 100 > (long) ION_LINEAR_HASH_SPLIT_LOAD * linear_hash_num_buckets(linear_hash) * linear_hash->header.page_slots) {
+		err = linear_hash_split(linear_hash);
+
+		if (err_ok != err) {
+			return ION_STATUS_ERROR(err);
+		}
+	}
+
+	return ION_STATUS_OK(1);
+}
+
+ion_status_t
+linear_hash_get(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	ion_linear_hash_location_t	location;
+	ion_err_t					err = linear_hash_find_slot(linear_hash, key, &location, NULL);
+
+	if (err_ok != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	memcpy(value, location.value, linear_hash->super.record.value_size);
+
+	return ION_STATUS_OK(1);
+}
+
+ion_status_t
+linear_hash_delete(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key
+) {
+	ion_linear_hash_location_t	location;
+	ion_err_t					err = linear_hash_find_slot(linear_hash, key, &location, NULL);
+
+	if (err_ok != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	/* The slot is on the page still held from the search. */
+	*linear_hash_slot(linear_hash, &linear_hash->page, location.slot) = ION_LINEAR_HASH_STATUS_EMPTY;
+
+	err = linear_hash_write_slot(linear_hash, &linear_hash->page, location.slot);
+
+	if (err_ok != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	linear_hash->header.num_records--;
+
+	return ION_STATUS_OK(1);
+}
+
+ion_status_t
+linear_hash_update(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	ion_linear_hash_location_t	location;
+	ion_err_t					err = linear_hash_find_slot(linear_hash, key, &location, NULL);
+
+	if (err_item_not_found == err) {
+		return linear_hash_insert(linear_hash, key, value);
+	}
+	else if (err_ok != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	memcpy(location.value, value, linear_hash->super.record.value_size);
+
+	err = linear_hash_write_slot(linear_hash, &linear_hash->page, location.slot);
+
+	if (err_ok != err) {
+		return ION_STATUS_ERROR(err);
+	}
+
+	return ION_STATUS_OK(1);
+}
+
+ion_err_t
+linear_hash_find(
+	ion_linear_hash_t			*linear_hash,
+	ion_key_t					key,
+	ion_linear_hash_location_t	*location
+) {
+	return linear_hash_find_slot(linear_hash, key, location, NULL);
+}
+
+ion_err_t
+linear_hash_next(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_location_t	*location
+) {
+	int slot;
+
+	if (ION_LINEAR_HASH_NO_PAGE == location->bucket) {
+		location->bucket	= 0;
+		location->overflow	= ION_LINEAR_HASH_NO_PAGE;
+		location->slot		= -1;
+	}
+
+	while (location->bucket < linear_hash_num_buckets(linear_hash)) {
+		ion_err_t err = linear_hash_read_page(linear_hash, &linear_hash->page, location->bucket, location->overflow);
+
+		if (err_ok != err) {
+			return err;
+		}
+
+		for (slot = location->slot + 1; slot < linear_hash->header.page_slots; slot++) {
+			ion_byte_t *data = linear_hash_slot(linear_hash, &linear_hash->page, slot);
+
+			if (ION_LINEAR_HASH_STATUS_OCCUPIED != *data) {
+				continue;
+			}
+
+			/* A split that was cut short leaves copies of the records it moved behind. */
+			if ((location->bucket != linear_hash->header.stale_bucket) || (linear_hash_bucket(linear_hash, data + sizeof(ion_linear_hash_slot_status_t)) == location->bucket)) {
+				linear_hash_set_location(linear_hash, location, location->bucket, location->overflow, slot);
+				return err_ok;
+			}
+		}
+
+		location->overflow	= linear_hash_page_next(&linear_hash->page);
+		location->slot		= -1;
+
+		if (ION_LINEAR_HASH_NO_PAGE == location->overflow) {
+			location->bucket++;
+		}
+	}
+
+	return err_file_hit_eof;
+}
+
+ion_err_t
+linear_hash_read_location(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_location_t	*location
+) {
+	ion_err_t err = linear_hash_read_page(linear_hash, &linear_hash->page, location->bucket, location->overflow);
+
+	if (err_ok != err) {
+		return err;
+	}
+
+	if (ION_LINEAR_HASH_STATUS_OCCUPIED != *linear_hash_slot(linear_hash, &linear_hash->page, location->slot)) {
+		return err_item_not_found;
+	}
+
+	linear_hash_set_location(linear_hash, location, location->bucket, location->overflow, location->slot);
+
+	return err_ok;
+}
+
+int
+linear_hash_num_buckets(
+	ion_linear_hash_t *linear_hash
+) {
+	return (linear_hash->header.initial_buckets << linear_hash->header.level) + linear_hash->header.split;
+}
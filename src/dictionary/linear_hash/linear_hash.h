@@ -0,0 +1,243 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		A linear hash, an on-disk hash table that grows one bucket at a time.
+@details	The hash starts with a few buckets and splits the next bucket in
+			turn whenever it gets too full, moving about half the records of
+			that bucket into a new bucket at the end of the file. A lookup
+			reads a bucket's page and any overflow pages chained after it, so
+			it costs about one read however many records are stored.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#if !defined(LINEAR_HASH_H)
+#define LINEAR_HASH_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "linear_hash_types.h"
+
+/**
+@brief		Initializes the linear hash and creates its files, or opens them if
+			they already exist.
+@details	The hash keeps its buckets in one file, which starts with
+			a header, and its overflow pages in another.
+@param[in]	linear_hash
+				Given instance of a linear hash struct to initialize.
+@param[in]	id
+				The assigned ID of this dictionary instance.
+@param[in]	key_type
+				Key category to use for this instance.
+@param[in]	key_size
+				Key size, in bytes used for this instance.
+@param[in]	value_size
+				Value size, in bytes used for this instance.
+@param[in]	dictionary_size
+				How many records a new hash is sized for. The hash starts with
+				enough buckets for this many records, rounded up to a power of
+				two, and grows past it as needed. Ignored when the files exist.
+@return		The status of initialization.
+@see		lhdict_create_dictionary
+*/
+ion_err_t
+linear_hash_initialize(
+	ion_linear_hash_t		*linear_hash,
+	ion_dictionary_id_t		id,
+	ion_key_type_t			key_type,
+	ion_key_size_t			key_size,
+	ion_value_size_t		value_size,
+	ion_dictionary_size_t	dictionary_size
+);
+
+/**
+@brief		Closes and removes the files of the linear hash.
+@param[in]	linear_hash
+				Given linear hash instance to destroy.
+@return		The resulting status of destruction.
+@see		lhdict_delete_dictionary
+*/
+ion_err_t
+linear_hash_destroy(
+	ion_linear_hash_t *linear_hash
+);
+
+/**
+@brief		Writes the header and closes the files of the linear hash.
+@param[in]	linear_hash
+				Which linear hash to close.
+@return		The resulting status of the operation.
+@see		lhdict_close_dictionary
+*/
+ion_err_t
+linear_hash_close(
+	ion_linear_hash_t *linear_hash
+);
+
+/**
+@brief		Writes the header and flushes the files of the linear hash.
+@details	Records are written as they change, so only the header is
+			behind.
+@param[in]	linear_hash
+				Which linear hash to flush.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+linear_hash_flush(
+	ion_linear_hash_t *linear_hash
+);
+
+/**
+@brief		Inserts the given record into the linear hash.
+@details	Keys are unique. If the insert takes the hash over
+			@ref ION_LINEAR_HASH_SPLIT_LOAD, the next bucket is split.
+@param[in]	linear_hash
+				Which linear hash to insert into.
+@param[in]	key
+				Key portion of the record to insert.
+@param[in]	value
+				Value portion of the record to insert.
+@return		Resulting status of insertion. The error is @c err_duplicate_key
+			if the key is already stored. If the split fails, its error is
+			returned, though the record was written and can be found.
+@see		lhdict_insert
+*/
+ion_status_t
+linear_hash_insert(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+/**
+@brief		Fetches the record stored with the given @p key.
+@param[in]	linear_hash
+				Which linear hash to look in.
+@param[in]	key
+				Specified key to look for.
+@param[out]	value
+				Space for the value of the record, of at least the value size.
+@return		Resulting status of the operation.
+@see		lhdict_get
+*/
+ion_status_t
+linear_hash_get(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+/**
+@brief		Deletes the record stored with the given @p key.
+@param[in]	linear_hash
+				Which linear hash to delete in.
+@param[in]	key
+				Key to search for and delete.
+@return		Resulting status of the operation.
+@see		lhdict_delete
+*/
+ion_status_t
+linear_hash_delete(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key
+);
+
+/**
+@brief		Updates the value stored with the given @p key, or inserts the
+			record if the key is not stored.
+@param[in]	linear_hash
+				Which linear hash to update.
+@param[in]	key
+				Key to search for.
+@param[in]	value
+				Value to store with the key.
+@return		Resulting status of the operation.
+@see		lhdict_update
+*/
+ion_status_t
+linear_hash_update(
+	ion_linear_hash_t	*linear_hash,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+/**
+@brief		Finds the slot holding the given @p key.
+@param[in]	linear_hash
+				Which linear hash to look in.
+@param[in]	key
+				Key to search for.
+@param[out]	location
+				Set to the slot holding @p key, with its key and value.
+@return		@c err_item_not_found if the key is not stored.
+*/
+ion_err_t
+linear_hash_find(
+	ion_linear_hash_t			*linear_hash,
+	ion_key_t					key,
+	ion_linear_hash_location_t	*location
+);
+
+/**
+@brief		Moves @p location on to the next slot that holds a record, going
+			through the buckets in order.
+@param[in]	linear_hash
+				Which linear hash to scan.
+@param[in,out]	location
+				The slot to start after. A bucket of @ref ION_LINEAR_HASH_NO_PAGE
+				starts at the first slot of the hash.
+@return		@c err_file_hit_eof when no record is left.
+*/
+ion_err_t
+linear_hash_next(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_location_t	*location
+);
+
+/**
+@brief		Reads the slot at @p location, setting its key and value.
+@param[in]	linear_hash
+				Which linear hash to read.
+@param[in,out]	location
+				The slot to read.
+@return		@c err_item_not_found if the slot no longer holds a record.
+*/
+ion_err_t
+linear_hash_read_location(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_location_t	*location
+);
+
+/**
+@brief		Gives the number of buckets the linear hash has.
+@param[in]	linear_hash
+				Which linear hash to count.
+@return		The number of buckets.
+*/
+int
+linear_hash_num_buckets(
+	ion_linear_hash_t *linear_hash
+);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,407 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Function definitions at the dictionary interface level for the
+			linear hash.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#include "linear_hash_dictionary_handler.h"
+
+/**
+@brief			Moves a range or all records cursor on to the next record that
+				satisfies its predicate.
+@param[in]		linear_hash
+					Which linear hash the cursor is over.
+@param[in,out]	cursor
+					The cursor to move. Its location is the slot to start after.
+@return			@c err_file_hit_eof when no such record is left.
+*/
+static ion_err_t
+lhdict_scan(
+	ion_linear_hash_t			*linear_hash,
+	ion_linear_hash_cursor_t	*cursor
+) {
+	ion_err_t err;
+
+	while (err_ok == (err = linear_hash_next(linear_hash, &cursor->location))) {
+		if (test_predicate(&cursor->super, cursor->location.key)) {
+			break;
+		}
+	}
+
+	return err;
+}
+
+/**
+@brief			Fetches the next record to be returned from a cursor that has already been initialized.
+@details		The returned record is written back to @p record, and then the cursor is advanced to the next
+				record. Records come in bucket order, which has nothing to do with key order.
+@param[in]		cursor
+					Which cursor to fetch results from.
+@param[out]		record
+					An initialized record struct with the @p key and @p value appropriately allocated to fit
+					the returned key and value. This function will write back data to the struct.
+@return			The resulting status of the operation.
+*/
+ion_cursor_status_t
+lhdict_next(
+	ion_dict_cursor_t	*cursor,
+	ion_record_t		*record
+) {
+	ion_linear_hash_t			*linear_hash		= (ion_linear_hash_t *) cursor->dictionary->instance;
+	ion_linear_hash_cursor_t	*linear_hash_cursor = (ion_linear_hash_cursor_t *) cursor;
+	ion_err_t					err;
+
+	if ((cursor->status == cs_cursor_uninitialized) || (cursor->status == cs_end_of_results)) {
+		return cursor->status;
+	}
+	else if ((cursor->status == cs_cursor_initialized) || (cursor->status == cs_cursor_active)) {
+		if (cursor->status == cs_cursor_active) {
+			/* Keys are unique, so an equality cursor has a single record. */
+			if (predicate_equality == cursor->predicate->type) {
+				err = err_file_hit_eof;
+			}
+			else {
+				err = lhdict_scan(linear_hash, linear_hash_cursor);
+			}
+
+			if (err_file_hit_eof == err) {
+				cursor->status = cs_end_of_results;
+				return cursor->status;
+			}
+			else if (err_ok != err) {
+				cursor->status = cs_possible_data_inconsistency;
+				return cursor->status;
+			}
+		}
+		else {
+			/* The status is cs_cursor_initialized */
+			cursor->status = cs_cursor_active;
+
+			if (err_ok != linear_hash_read_location(linear_hash, &linear_hash_cursor->location)) {
+				cursor->status = cs_possible_data_inconsistency;
+				return cursor->status;
+			}
+		}
+
+		/*Copy both key and value into user provided struct */
+		memcpy(record->key, linear_hash_cursor->location.key, linear_hash->super.record.key_size);
+		memcpy(record->value, linear_hash_cursor->location.value, linear_hash->super.record.value_size);
+
+		return cursor->status;
+	}
+
+	return cs_invalid_cursor;
+}
+
+/**
+@brief		Destroys and frees the given cursor.
+@details	This function should not be called directly, but instead accessed through the interface
+			the cursor object.
+@param[in]	cursor
+				Which cursor to destroy.
+*/
+void
+lhdict_destroy_cursor(
+	ion_dict_cursor_t **cursor
+) {
+	(*cursor)->predicate->destroy(&(*cursor)->predicate);
+	free(*cursor);
+	*cursor = NULL;
+}
+
+/**
+@brief		Re-instances a previously created linear hash and prepares it to be used again.
+@param[in]	handler
+				A handler that must be bound with the linear hash's functions.
+@param[in]	dictionary
+				A dictionary that is allocated but not initialized.
+@param[in]	config
+				The configuration parameters previously used by the linear hash.
+@param[in]	compare
+				The comparison function that will be given by higher layers, based on the
+				destined key type.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+lhdict_open_dictionary(
+	ion_dictionary_handler_t		*handler,
+	ion_dictionary_t				*dictionary,
+	ion_dictionary_config_info_t	*config,
+	ion_dictionary_compare_t		compare
+) {
+	return lhdict_create_dictionary(config->id, config->type, config->key_size, config->value_size, config->dictionary_size, compare, handler, dictionary);
+}
+
+/**
+@brief		Closes this linear hash and persists everything to disk
+			to be brought back later using @ref dictionary_open.
+@param[in]	dictionary
+				Which instance of a linear hash to close.
+@return		The resuling status of the operation.
+*/
+ion_err_t
+lhdict_close_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	ion_err_t err = linear_hash_close((ion_linear_hash_t *) dictionary->instance);
+
+	free(dictionary->instance);
+	dictionary->instance = NULL;
+
+	return err;
+}
+
+/**
+@brief		Writes the header of this linear hash and flushes its files.
+@param[in]	dictionary
+				Which instance of a linear hash to flush.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+lhdict_flush_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	return linear_hash_flush((ion_linear_hash_t *) dictionary->instance);
+}
+
+/**
+@brief			Initializes a cursor query and returns an allocated cursor object.
+@details		Equality cursors read the one bucket the key hashes to. Range and all
+				records cursors read every bucket, and return records in no particular
+				key order, so descending predicates are refused.
+@param[in]		dictionary
+					Which dictionary to query on.
+@param[in]		predicate
+					An allocated, initialized predicate object that defines the parameters of the query.
+@param[out]		cursor
+					A cursor pointer should be initialized to @p NULL, and then given to this function.
+					This function shall allocate appropriate memory and redirect @p cursor to point to
+					the allocated memory.
+@return			The resulting status of the operation.
+*/
+ion_err_t
+lhdict_find(
+	ion_dictionary_t	*dictionary,
+	ion_predicate_t		*predicate,
+	ion_dict_cursor_t	**cursor
+) {
+	ion_linear_hash_t *linear_hash = (ion_linear_hash_t *) dictionary->instance;
+
+	/* hashing keeps no key order to scan in reverse */
+	if (dictionary_predicate_is_descending(predicate)) {
+		return err_not_implemented;
+	}
+
+	*cursor = malloc(sizeof(ion_linear_hash_cursor_t));
+
+	if (NULL == *cursor) {
+		return err_out_of_memory;
+	}
+
+	(*cursor)->dictionary	= dictionary;
+	(*cursor)->status		= cs_cursor_uninitialized;
+
+	(*cursor)->destroy		= lhdict_destroy_cursor;
+	(*cursor)->next			= lhdict_next;
+
+	(*cursor)->predicate	= malloc(sizeof(ion_predicate_t));
+
+	if (NULL == (*cursor)->predicate) {
+		free(*cursor);
+		return err_out_of_memory;
+	}
+
+	(*cursor)->predicate->type		= predicate->type;
+	(*cursor)->predicate->destroy	= predicate->destroy;
+
+	ion_linear_hash_cursor_t	*linear_hash_cursor = (ion_linear_hash_cursor_t *) (*cursor);
+	ion_key_size_t				key_size			= dictionary->instance->record.key_size;
+	ion_err_t					err;
+
+	switch (predicate->type) {
+		case predicate_equality: {
+			(*cursor)->predicate->statement.equality.equality_value = malloc(key_size);
+
+			if (NULL == (*cursor)->predicate->statement.equality.equality_value) {
+				free((*cursor)->predicate);
+				free(*cursor);
+				return err_out_of_memory;
+			}
+
+			memcpy((*cursor)->predicate->statement.equality.equality_value, predicate->statement.equality.equality_value, key_size);
+
+			err = linear_hash_find(linear_hash, (*cursor)->predicate->statement.equality.equality_value, &linear_hash_cursor->location);
+			break;
+		}
+
+		case predicate_range: {
+			(*cursor)->predicate->statement.range.lower_bound = malloc(key_size);
+
+			if (NULL == (*cursor)->predicate->statement.range.lower_bound) {
+				free((*cursor)->predicate);
+				free(*cursor);
+				return err_out_of_memory;
+			}
+
+			memcpy((*cursor)->predicate->statement.range.lower_bound, predicate->statement.range.lower_bound, key_size);
+
+			(*cursor)->predicate->statement.range.upper_bound = malloc(key_size);
+
+			if (NULL == (*cursor)->predicate->statement.range.upper_bound) {
+				free((*cursor)->predicate->statement.range.lower_bound);
+				free((*cursor)->predicate);
+				free(*cursor);
+				return err_out_of_memory;
+			}
+
+			memcpy((*cursor)->predicate->statement.range.upper_bound, predicate->statement.range.upper_bound, key_size);
+			(*cursor)->predicate->statement.range.descending = boolean_false;
+
+			linear_hash_cursor->location.bucket = ION_LINEAR_HASH_NO_PAGE;
+			err									= lhdict_scan(linear_hash, linear_hash_cursor);
+			break;
+		}
+
+		case predicate_all_records: {
+			(*cursor)->predicate->statement.all_records.descending = boolean_false;
+
+			linear_hash_cursor->location.bucket = ION_LINEAR_HASH_NO_PAGE;
+			err									= lhdict_scan(linear_hash, linear_hash_cursor);
+			break;
+		}
+
+		default: {
+			free((*cursor)->predicate);
+			free(*cursor);
+			*cursor = NULL;
+			return err_invalid_predicate;
+		}
+	}
+
+	if ((err_item_not_found == err) || (err_file_hit_eof == err)) {
+		/* Nothing matches the predicate */
+		(*cursor)->status = cs_end_of_results;
+	}
+	else if (err_ok == err) {
+		(*cursor)->status = cs_cursor_initialized;
+	}
+	else {
+		/* The scan failed on an external error */
+		(*cursor)->destroy(cursor);
+		return err;
+	}
+
+	return err_ok;
+}
+
+void
+lhdict_init(
+	ion_dictionary_handler_t *handler
+) {
+	handler->insert				= lhdict_insert;
+	handler->create_dictionary	= lhdict_create_dictionary;
+	handler->get				= lhdict_get;
+	handler->update				= lhdict_update;
+	handler->find				= lhdict_find;
+	handler->remove				= lhdict_delete;
+	handler->delete_dictionary	= lhdict_delete_dictionary;
+	handler->open_dictionary	= lhdict_open_dictionary;
+	handler->close_dictionary	= lhdict_close_dictionary;
+	handler->flush_dictionary	= lhdict_flush_dictionary;
+}
+
+ion_status_t
+lhdict_insert(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	return linear_hash_insert((ion_linear_hash_t *) dictionary->instance, key, value);
+}
+
+ion_status_t
+lhdict_get(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	return linear_hash_get((ion_linear_hash_t *) dictionary->instance, key, value);
+}
+
+ion_err_t
+lhdict_create_dictionary(
+	ion_dictionary_id_t			id,
+	ion_key_type_t				key_type,
+	ion_key_size_t				key_size,
+	ion_value_size_t			value_size,
+	ion_dictionary_size_t		dictionary_size,
+	ion_dictionary_compare_t	compare,
+	ion_dictionary_handler_t	*handler,
+	ion_dictionary_t			*dictionary
+) {
+	dictionary->instance = malloc(sizeof(ion_linear_hash_t));
+
+	if (NULL == dictionary->instance) {
+		return err_out_of_memory;
+	}
+
+	dictionary->instance->compare = compare;
+
+	ion_err_t result = linear_hash_initialize((ion_linear_hash_t *) dictionary->instance, id, key_type, key_size, value_size, dictionary_size);
+
+	if (err_ok == result) {
+		dictionary->handler = handler;
+	}
+	else {
+		free(dictionary->instance);
+		dictionary->instance = NULL;
+	}
+
+	return result;
+}
+
+ion_status_t
+lhdict_delete(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key
+) {
+	return linear_hash_delete((ion_linear_hash_t *) dictionary->instance, key);
+}
+
+ion_err_t
+lhdict_delete_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	ion_err_t result = linear_hash_destroy((ion_linear_hash_t *) dictionary->instance);
+
+	free(dictionary->instance);
+	dictionary->instance = NULL;
+	return result;
+}
+
+ion_status_t
+lhdict_update(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+) {
+	return linear_hash_update((ion_linear_hash_t *) dictionary->instance, key, value);
+}
@@ -0,0 +1,164 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Function declarations at the dictionary interface level for the
+			linear hash.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#if !defined(LINEAR_HASH_DICTIONARY_HANDLER_H_)
+#define LINEAR_HASH_DICTIONARY_HANDLER_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "linear_hash_types.h"
+#include "linear_hash.h"
+
+/**
+@brief		Given the @p handler instance, bind the appropriate linear hash functions.
+@param[in]	handler
+				The handler is assumed to be memory that is allocated and initialized
+				by the user.
+*/
+void
+lhdict_init(
+	ion_dictionary_handler_t *handler
+);
+
+/**
+@brief		Given a record ( @p key, @p value ), insert it into the dictionary.
+@param[in]	dictionary
+				The initialized dictionary instance we want to insert into.
+@param[in]	key
+				The key portion of the record to be inserted.
+@param[in]	value
+				The value portion of the record to be inserted.
+@return		The resulting status of the operation.
+*/
+ion_status_t
+lhdict_insert(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+/**
+@brief		Performs a "get" operation on the dictionary to retrieve a single record.
+@param[in]	dictionary
+				Which dictionary to perform the operation on.
+@param[in]	key
+				The desired search key.
+@param[out]	value
+				The output location in which to write the returned value. This space
+				must be allocated by the user to at least @p value_size bytes, as
+				originally defined on dictionary creation.
+@return		The resulting status of the operation.
+*/
+ion_status_t
+lhdict_get(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+/**
+@brief		Creates an instance of a dictionary using a linear hash.
+@details	The @p dictionary_size is the number of records the hash starts out
+			sized for. The hash grows one bucket at a time past it.
+@param[in]	id
+				The identifier of the dictionary, used to name its files.
+@param[in]	key_type
+				The category of key used by the dictionary.
+@param[in]	key_size
+				The size of the keys used for this dictionary, specified in bytes.
+@param[in]	value_size
+				The size of the values used for this dictionary, specified in bytes.
+@param[in]	dictionary_size
+				How many records the hash is first sized for.
+@param[in]	compare
+				Function pointer for the comparison function for the dictionary.
+@param[in]	handler
+				The handler for the specific dictionary being created.
+@param[out]	dictionary
+				The pointer declared by the caller that will reference
+				the instance of the dictionary created.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+lhdict_create_dictionary(
+	ion_dictionary_id_t			id,
+	ion_key_type_t				key_type,
+	ion_key_size_t				key_size,
+	ion_value_size_t			value_size,
+	ion_dictionary_size_t		dictionary_size,
+	ion_dictionary_compare_t	compare,
+	ion_dictionary_handler_t	*handler,
+	ion_dictionary_t			*dictionary
+);
+
+/**
+@brief		Deletes the record stored with the given @p key.
+@param[in]	dictionary
+				Which dictionary to delete from.
+@param[in]	key
+				The key of the record to delete.
+@return		The resulting status of the operation.
+*/
+ion_status_t
+lhdict_delete(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key
+);
+
+/**
+@brief		Cleans up all files created by the dictionary, and frees any allocated memory.
+@param[in]	dictionary
+				Which dictionary to delete.
+@return		The resulting status of the operation.
+*/
+ion_err_t
+lhdict_delete_dictionary(
+	ion_dictionary_t *dictionary
+);
+
+/**
+@brief		Updates the value stored with the given @p key, inserting the record
+			if the key is not stored.
+@param[in]	dictionary
+				Which dictionary to update.
+@param[in]	key
+				The key of the record to update.
+@param[in]	value
+				The value to store with the key.
+@return		The resulting status of the operation.
+*/
+ion_status_t
+lhdict_update(
+	ion_dictionary_t	*dictionary,
+	ion_key_t			key,
+	ion_value_t			value
+);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
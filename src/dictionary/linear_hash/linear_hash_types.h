@@ -0,0 +1,187 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Implementation specific type definitions for the linear hash.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#if !defined(LINEAR_HASH_TYPES_H)
+#define LINEAR_HASH_TYPES_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "../dictionary.h"
+#include "../../file/ion_file.h"
+
+/**
+@brief		This type describes the status flag of a slot within a linear hash page.
+*/
+typedef ion_byte_t ion_linear_hash_slot_status_t;
+
+/**
+@brief		Signifies that this slot holds a record.
+*/
+#define ION_LINEAR_HASH_STATUS_OCCUPIED 1
+/**
+@brief		Signifies that this slot is free. New pages are zeroed, so all their slots are free.
+*/
+#define ION_LINEAR_HASH_STATUS_EMPTY	0
+
+/**
+@brief		Marks the end of a chain of overflow pages, or a page that is not held.
+*/
+#define ION_LINEAR_HASH_NO_PAGE			-1
+
+/**
+@brief		The first word of @ref ion_linear_hash_header_t.
+*/
+#define ION_LINEAR_HASH_HEADER_MAGIC	0x4C484448
+/**
+@brief		The version of @ref ion_linear_hash_header_t that is written. Files with a
+			later version are refused.
+*/
+#define ION_LINEAR_HASH_HEADER_VERSION	1
+
+/**
+@brief		The size in bytes of a bucket page.
+@details	Each bucket is one page of the bucket file, followed by a chain of
+			overflow pages when it holds more records than fit. A page holds
+			as many whole records as fit after its link to the next page, and
+			never less than one.
+*/
+#if !defined(ION_LINEAR_HASH_PAGE_SIZE)
+#if defined(ARDUINO)
+#define ION_LINEAR_HASH_PAGE_SIZE 64
+#else
+#define ION_LINEAR_HASH_PAGE_SIZE 512
+#endif
+#endif
+
+/**
+@brief		How full, in percent of the slots of the bucket pages, a linear hash
+			may get before it splits a bucket.
+@details	Each insert that takes the hash over this load splits the next
+			bucket in turn, so the table grows by one page at a time and the
+			overflow chains stay short.
+*/
+#if !defined(ION_LINEAR_HASH_SPLIT_LOAD)
+#define ION_LINEAR_HASH_SPLIT_LOAD 80
+#endif
+
+/**
+@brief		The header at the start of a linear hash's bucket file.
+@details	It is written when the file is created, after every split, and when
+			the hash is flushed or closed.
+*/
+typedef struct {
+	/**> Always @ref ION_LINEAR_HASH_HEADER_MAGIC. */
+	int magic;
+	/**> The @ref ION_LINEAR_HASH_HEADER_VERSION the file was written with. */
+	int version;
+	/**> The size of each slot, which must match the key and value sizes the file is opened with. */
+	int slot_size;
+	/**> How many slots each page holds. */
+	int page_slots;
+	/**> How many buckets the hash started with, always a power of two. */
+	int initial_buckets;
+	/**> How many times the number of buckets has doubled. */
+	int level;
+	/**> The next bucket to split in this round. */
+	int split;
+	/**> How many records the hash holds. */
+	int num_records;
+	/**> How many pages the overflow file holds, both in use and free. */
+	int overflow_pages;
+	/**> The first overflow page that is free for reuse, or @ref ION_LINEAR_HASH_NO_PAGE. */
+	int free_page;
+	/**> The bucket last split while it still holds copies of the records that moved out, or @ref ION_LINEAR_HASH_NO_PAGE. */
+	int stale_bucket;
+} ion_linear_hash_header_t;
+
+/**
+@brief		A page of a linear hash held in memory.
+@details	A page is either the first page of a bucket, in the bucket file, or
+			an overflow page. Its data starts with the overflow page that follows
+			it in the chain, then holds its slots. Each slot is a status byte
+			followed by the key and value.
+*/
+typedef struct {
+	/**> The bucket whose first page this is, or @ref ION_LINEAR_HASH_NO_PAGE. */
+	int			bucket;
+	/**> The overflow page this is, or @ref ION_LINEAR_HASH_NO_PAGE. */
+	int			overflow;
+	/**> The bytes of the page. */
+	ion_byte_t	*data;
+} ion_linear_hash_page_t;
+
+/**
+@brief		Metadata container that holds linear hash specific information.
+*/
+typedef struct {
+	/**> Parent structure that holds dictionary level information. */
+	ion_dictionary_parent_t		super;
+	/**> The file holding the header and the first page of each bucket. */
+	ion_file_handle_t			bucket_file;
+	/**> The file holding the overflow pages. */
+	ion_file_handle_t			overflow_file;
+	/**> The header, kept up to date in memory. */
+	ion_linear_hash_header_t	header;
+	/**> The size of each slot, in bytes. */
+	int							slot_size;
+	/**> The size of each page, in bytes. */
+	int							page_size;
+	/**> The page most recently read or written. Writes go through to the file. */
+	ion_linear_hash_page_t		page;
+	/**> The page being filled while a bucket is split. */
+	ion_linear_hash_page_t		split_page;
+} ion_linear_hash_t;
+
+/**
+@brief		Where a slot of a linear hash is, and what the record in it is.
+*/
+typedef struct {
+	/**> The bucket the slot belongs to. */
+	int			bucket;
+	/**> The overflow page of the slot, or @ref ION_LINEAR_HASH_NO_PAGE when it is on the bucket's first page. */
+	int			overflow;
+	/**> The index of the slot within its page. */
+	int			slot;
+	/**> The key in the slot. Only valid until the next operation on the hash. */
+	ion_key_t	key;
+	/**> The value in the slot. Only valid until the next operation on the hash. */
+	ion_value_t value;
+} ion_linear_hash_location_t;
+
+/**
+@brief		Linear hash specific implementation of a cursor.
+*/
+typedef struct {
+	/**> Supertype of the dictionary cursor. */
+	ion_dict_cursor_t			super;
+	/**> The slot of the record the cursor is on. */
+	ion_linear_hash_location_t	location;
+} ion_linear_hash_cursor_t;
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -13,25 +13,332 @@
 */
 /******************************************************************************/
 
+#include <limits.h>
 #include "open_address_file_hash.h"
+#include "../../file/ion_file.h"
 
 #define ION_TEST_FILE "file.bin"
 
+/**
+@brief		Finds how many bytes of the file a page covers.
+@details	The last page of the file may hold fewer buckets than the rest.
+@param		hash_map
+				The map that owns the page.
+@param		page
+				The page number.
+@return		The size of the page in bytes.
+*/
+static int
+oafh_page_bytes(
+	ion_file_hashmap_t	*hash_map,
+	int					page
+) {
+	int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+	int num_buckets = hash_map->map_size - page * hash_map->page_buckets;
+
+	if (num_buckets > hash_map->page_buckets) {
+		num_buckets = hash_map->page_buckets;
+	}
+
+	return num_buckets * record_size;
+}
+
+/**
+@brief		Finds where a page starts in the file, past the header.
+@param		hash_map
+				The map that owns the page.
+@param		page
+				The page number.
+@return		The offset of the page in bytes.
+*/
+static long
+oafh_page_offset(
+	ion_file_hashmap_t	*hash_map,
+	int					page
+) {
+	int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+
+	return (long) sizeof(ion_oafh_header_t) + (long) page * hash_map->page_buckets * record_size;
+}
+
+/**
+@brief		Writes every changed page of the cache back to the file.
+@details	Pages are written in file order, so the writes move forward
+			through the file.
+@param		hash_map
+				The map to write back.
+@return		The status of the writes.
+*/
+static ion_err_t
+oafh_write_pages(
+	ion_file_hashmap_t *hash_map
+) {
+	int last_page = -1;
+	int next;
+	int i;
+
+	while (1) {
+		next = -1;
+
+		for (i = 0; i < hash_map->num_pages; i++) {
+			if (hash_map->pages[i].dirty && (hash_map->pages[i].page > last_page) && ((-1 == next) || (hash_map->pages[i].page < hash_map->pages[next].page))) {
+				next = i;
+			}
+		}
+
+		if (-1 == next) {
+			return err_ok;
+		}
+
+		last_page = hash_map->pages[next].page;
+
+		if ((0 != fseek(hash_map->file, oafh_page_offset(hash_map, last_page), SEEK_SET)) || (1 != fwrite(hash_map->pages[next].data, oafh_page_bytes(hash_map, last_page), 1, hash_map->file))) {
+			return err_file_write_error;
+		}
+
+		hash_map->pages[next].dirty = boolean_false;
+	}
+}
+
+/**
+@brief		Finds a bucket through the page cache, reading its page if it is
+			not held.
+@details	When a page has to be evicted and it has changed, all changed
+			pages are written back together first.
+@param		hash_map
+				The map that holds the bucket.
+@param		loc
+				The index of the bucket.
+@param		will_change
+				@c boolean_true if the caller changes the bucket, so its page
+				must be written back.
+@return		The bucket, or NULL if its page could not be read or room could
+			not be made for it.
+*/
+static ion_hash_bucket_t *
+oafh_bucket(
+	ion_file_hashmap_t	*hash_map,
+	int					loc,
+	ion_boolean_t		will_change
+) {
+	int				record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+	int				page		= loc / hash_map->page_buckets;
+	ion_oafh_page_t *held		= NULL;
+	int				i;
+
+	for (i = 0; i < hash_map->num_pages; i++) {
+		if (hash_map->pages[i].page == page) {
+			held = &hash_map->pages[i];
+			break;
+		}
+
+		/* Otherwise keep the least recently used page, preferring an unused one */
+		if ((NULL == held) || ((-1 != held->page) && ((-1 == hash_map->pages[i].page) || (hash_map->pages[i].last_used < held->last_used)))) {
+			held = &hash_map->pages[i];
+		}
+	}
+
+	if (held->page != page) {
+		if (held->dirty && (err_ok != oafh_write_pages(hash_map))) {
+			return NULL;
+		}
+
+		held->page = -1;
+
+		if ((0 != fseek(hash_map->file, oafh_page_offset(hash_map, page), SEEK_SET)) || (1 != fread(held->data, oafh_page_bytes(hash_map, page), 1, hash_map->file))) {
+			return NULL;
+		}
+
+		held->page	= page;
+		held->dirty = boolean_false;
+	}
+
+	held->last_used = ++hash_map->clock;
+
+	if (will_change) {
+		held->dirty = boolean_true;
+	}
+
+	return (ion_hash_bucket_t *) (held->data + (loc - page * hash_map->page_buckets) * record_size);
+}
+
+/**
+@brief		Frees the page cache of a map.
+@param		hash_map
+				The map whose cache is freed.
+*/
+static void
+oafh_free_pages(
+	ion_file_hashmap_t *hash_map
+) {
+	int i;
+
+	if (NULL == hash_map->pages) {
+		return;
+	}
+
+	for (i = 0; i < hash_map->num_pages; i++) {
+		free(hash_map->pages[i].data);
+	}
+
+	free(hash_map->pages);
+	hash_map->pages		= NULL;
+	hash_map->num_pages = 0;
+}
+
 ion_err_t
 oafh_close(
 	ion_file_hashmap_t *hash_map
 ) {
 	if (NULL != hash_map->file) {
 		/* check to ensure that you are not freeing something already free */
+		ion_err_t error = oafh_write_pages(hash_map);
+
+		oafh_free_pages(hash_map);
 		fclose(hash_map->file);
 		free(hash_map);
-		return err_ok;
+		return error;
 	}
 	else {
 		return err_file_close_error;
 	}
 }
 
+/**
+@brief		Creates the file of a map, holding the header and every bucket
+			empty.
+@param		hashmap
+				The map whose file is created. Its page cache must be set up.
+@param		filename
+				The name of the file.
+@return		The status of the creation. The file is left open in
+			@p hashmap on success, and closed otherwise.
+*/
+static ion_err_t
+oafh_create_file(
+	ion_file_hashmap_t	*hashmap,
+	char				*filename
+) {
+	int					record_size = SIZEOF(STATUS) + hashmap->super.record.key_size + hashmap->super.record.value_size;
+	ion_oafh_header_t	header		= { ION_OAFH_MAGIC, ION_OAFH_FILE_VERSION };
+	int					i;
+
+	/* open the file */
+	hashmap->file = fopen(filename, "w+b");
+
+	if (NULL == hashmap->file) {
+		return err_file_open_error;
+	}
+
+	/* write out the records to disk to prep, a page at a time */
+#if ION_DEBUG
+	printf("Initializing hash table\n");
+#endif
+
+	ion_byte_t *empty_page = hashmap->pages[0].data;
+
+	memset(empty_page, 0, (size_t) hashmap->page_buckets * record_size);
+
+	for (i = 0; i < hashmap->page_buckets; i++) {
+		((ion_hash_bucket_t *) (empty_page + i * record_size))->status = ION_EMPTY;
+	}
+
+	if (1 != fwrite(&header, sizeof(header), 1, hashmap->file)) {
+		fclose(hashmap->file);
+		hashmap->file = NULL;
+		return err_file_write_error;
+	}
+
+	for (i = 0; i * hashmap->page_buckets < hashmap->map_size; i++) {
+		if (1 != fwrite(empty_page, oafh_page_bytes(hashmap, i), 1, hashmap->file)) {
+			fclose(hashmap->file);
+			hashmap->file = NULL;
+			return err_file_write_error;
+		}
+	}
+
+	fflush(hashmap->file);
+
+	return err_ok;
+}
+
+/**
+@brief		Rebuilds a map file written before the file header, whose records
+			were placed by an older hash.
+@details	The old file is moved aside, a new one is created, and every
+			record in use is inserted into it again. If that fails, the new
+			file is dropped and the old one put back.
+@param		hashmap
+				The map to rebuild. Its page cache must be set up, and it
+				is freed if the rebuild fails.
+@param		id
+				The id of the map, which names its files.
+@param		filename
+				The name of the map file.
+@return		The status of the rebuild.
+*/
+static ion_err_t
+oafh_rebuild(
+	ion_file_hashmap_t	*hashmap,
+	ion_dictionary_id_t id,
+	char				*filename
+) {
+	int					record_size = SIZEOF(STATUS) + hashmap->super.record.key_size + hashmap->super.record.value_size;
+	char				old_filename[ION_MAX_FILENAME_LENGTH];
+	FILE				*old_file;
+	ion_hash_bucket_t	*bucket;
+	ion_err_t			error;
+	int					i;
+
+	dictionary_get_filename(id, "oao", old_filename);
+
+	if (err_ok != ion_frename(filename, old_filename)) {
+		oafh_free_pages(hashmap);
+		return err_file_rename_error;
+	}
+
+	error		= oafh_create_file(hashmap, filename);
+	old_file	= fopen(old_filename, "rb");
+	bucket		= malloc(record_size);
+
+	if ((err_ok == error) && ((NULL == old_file) || (NULL == bucket))) {
+		error = NULL == bucket ? err_out_of_memory : err_file_open_error;
+	}
+
+	/* A short old file holds no records past its end. */
+	for (i = 0; (err_ok == error) && (i < hashmap->map_size) && (1 == fread(bucket, record_size, 1, old_file)); i++) {
+		if (ION_IN_USE == bucket->status) {
+			error = oafh_insert(hashmap, bucket->data, bucket->data + hashmap->super.record.key_size).error;
+		}
+	}
+
+	if (err_ok == error) {
+		error = oafh_flush(hashmap);
+	}
+
+	free(bucket);
+
+	if (NULL != old_file) {
+		fclose(old_file);
+	}
+
+	if (err_ok != error) {
+		if (NULL != hashmap->file) {
+			fclose(hashmap->file);
+			hashmap->file = NULL;
+		}
+
+		oafh_free_pages(hashmap);
+		fremove(filename);
+		ion_frename(old_filename, filename);
+		return error;
+	}
+
+	fremove(old_filename);
+
+	return err_ok;
+}
+
 ion_err_t
 oafh_initialize(
 	ion_file_hashmap_t *hashmap,
@@ -53,53 +360,77 @@ oafh_initialize(
 	hashmap->compute_hash				= (*hashing_function);	/* Allows for binding of different hash functions
 																depending on requirements */
 
+	int record_size = SIZEOF(STATUS) + hashmap->super.record.key_size + hashmap->super.record.value_size;
+	int i;
+
+	/* A page holds as many whole buckets as fit, but no more than the map */
+	hashmap->page_buckets = ION_OAFH_PAGE_SIZE / record_size;
+
+	if (hashmap->page_buckets < 1) {
+		hashmap->page_buckets = 1;
+	}
+
+	if (hashmap->page_buckets > hashmap->map_size) {
+		hashmap->page_buckets = hashmap->map_size;
+	}
+
+	hashmap->clock		= 0;
+	hashmap->num_pages	= ION_OAFH_CACHE_PAGES;
+	hashmap->pages		= calloc(hashmap->num_pages, sizeof(ion_oafh_page_t));
+
+	if (NULL == hashmap->pages) {
+		return err_out_of_memory;
+	}
+
+	for (i = 0; i < hashmap->num_pages; i++) {
+		hashmap->pages[i].page	= -1;
+		hashmap->pages[i].data	= malloc((size_t) hashmap->page_buckets * record_size);
+
+		if (NULL == hashmap->pages[i].data) {
+			oafh_free_pages(hashmap);
+			return err_out_of_memory;
+		}
+	}
+
 	char addr_filename[ION_MAX_FILENAME_LENGTH];
 
 	/* open the file */
 	int actual_filename_length = dictionary_get_filename(id, "oaf", addr_filename);
 
 	if (actual_filename_length >= ION_MAX_FILENAME_LENGTH) {
+		oafh_free_pages(hashmap);
 		return err_dictionary_initialization_failed;
 	}
 
 	hashmap->file = fopen(addr_filename, "r+b");
 
 	if (NULL != hashmap->file) {
-		return err_ok;
-	}
-
-	/* open the file */
-	hashmap->file = fopen(addr_filename, "w+b");
-
-	ion_hash_bucket_t *file_record;
+		ion_oafh_header_t	header;
+		ion_boolean_t		has_header = (1 == fread(&header, sizeof(header), 1, hashmap->file)) && (ION_OAFH_MAGIC == header.magic);
 
-	int record_size = SIZEOF(STATUS) + hashmap->super.record.key_size + hashmap->super.record.value_size;
-
-	file_record			= calloc(record_size, 1);
-	file_record->status = ION_EMPTY;
+		if (has_header && (ION_OAFH_FILE_VERSION == header.version)) {
+			return err_ok;
+		}
 
-	/* write out the records to disk to prep */
-#if ION_DEBUG
-	printf("Initializing hash table\n");
-#endif
+		fclose(hashmap->file);
+		hashmap->file = NULL;
 
-	int i, writes = 0;
+		if (has_header) {
+			/* Another version, whose buckets this one can not read. */
+			oafh_free_pages(hashmap);
+			return err_file_open_error;
+		}
 
-	for (i = 0; i < hashmap->map_size; i++) {
-		writes	+= fwrite(&file_record->status, SIZEOF(STATUS), 1, hashmap->file);
-		writes	+= fwrite(file_record->data, record_size - SIZEOF(STATUS), 1, hashmap->file);
+		return oafh_rebuild(hashmap, id, addr_filename);
 	}
 
-	fflush(hashmap->file);
+	ion_err_t error = oafh_create_file(hashmap, addr_filename);
 
-	if (writes / 2 != hashmap->map_size) {
-		fclose(hashmap->file);
-		return err_file_write_error;
+	if (err_ok != error) {
+		oafh_free_pages(hashmap);
 	}
 
-	free(file_record);
-
-	return err_ok;
+	return error;
 }
 
 int
@@ -107,6 +438,10 @@ oafh_get_location(
 	ion_hash_t	num,
 	int			size
 ) {
+	if (0 == (size & (size - 1))) {
+		return num & (size - 1);
+	}
+
 	return num % size;
 }
 
@@ -119,6 +454,9 @@ oafh_destroy(
 	hash_map->super.record.key_size		= 0;
 	hash_map->super.record.value_size	= 0;
 
+	/* The file is removed, so changed pages are dropped rather than written */
+	oafh_free_pages(hash_map);
+
 	char addr_filename[ION_MAX_FILENAME_LENGTH];
 
 	int actual_filename_length = dictionary_get_filename(hash_map->super.id, "oaf", addr_filename);
@@ -139,6 +477,44 @@ oafh_destroy(
 	}
 }
 
+ion_err_t
+oafh_flush(
+	ion_file_hashmap_t *hash_map
+) {
+	ion_err_t error = oafh_write_pages(hash_map);
+
+	if (0 != fflush(hash_map->file)) {
+		error = err_file_write_error;
+	}
+
+	return error;
+}
+
+ion_err_t
+oafh_drop_pages(
+	ion_file_hashmap_t *hash_map
+) {
+	ion_err_t	error = oafh_flush(hash_map);
+	int			i;
+
+	/* A page that could not be written keeps its changes */
+	for (i = 0; i < hash_map->num_pages; i++) {
+		if (!hash_map->pages[i].dirty) {
+			hash_map->pages[i].page = -1;
+		}
+	}
+
+	return error;
+}
+
+ion_hash_bucket_t *
+oafh_get_bucket(
+	ion_file_hashmap_t	*hash_map,
+	int					loc
+) {
+	return oafh_bucket(hash_map, loc, boolean_false);
+}
+
 ion_status_t
 oafh_update(
 	ion_file_hashmap_t	*hash_map,
@@ -156,75 +532,59 @@ oafh_update(
 	return result;
 }
 
-ion_status_t
-oafh_insert(
+/**
+@brief		Probes the map for a key.
+@details	Probing stops at the first empty bucket. Along the way,
+			@p free_loc is set to the first empty or deleted bucket, which is
+			where the key would be inserted.
+@param		hash_map
+				The map to probe.
+@param		key
+				The key to look for.
+@param		free_loc
+				Set to the first free bucket seen, or -1 if there is none.
+				May be NULL when the caller does not need it.
+@param		error
+				Set to the status of the page reads.
+@return		The bucket holding @p key, or -1 if it is not in the map.
+*/
+static int
+oafh_probe(
 	ion_file_hashmap_t	*hash_map,
 	ion_key_t			key,
-	ion_value_t			value
+	int					*free_loc,
+	ion_err_t			*error
 ) {
-	ion_hash_t hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);	/* compute hash value for given key */
-
-	int loc			= oafh_get_location(hash, hash_map->map_size);
-
-	/* Scan until find an empty location - oah_insert if found */
-	int count		= 0;
+	ion_hash_t			hash	= hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);	/* compute hash value for given key */
+	int					loc		= oafh_get_location(hash, hash_map->map_size);
+	int					count;
+	ion_hash_bucket_t	*item;
 
-	ion_hash_bucket_t *item;
+	*error = err_ok;
 
-	int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+	if (NULL != free_loc) {
+		*free_loc = -1;
+	}
 
-	item = malloc(record_size);
+	for (count = 0; count < hash_map->map_size; count++) {
+		item = oafh_bucket(hash_map, loc, boolean_false);
 
-	/* set file position */
-	fseek(hash_map->file, loc * record_size, SEEK_SET);
+		if (NULL == item) {
+			*error = err_file_read_error;
+			return -1;
+		}
 
-	while (count != hash_map->map_size) {
-		fread(item, record_size, 1, hash_map->file);
-#if ION_DEBUG
-		DUMP((int) ftell(hash_map->file), "%i");
-#endif
+		if ((item->status == ION_EMPTY) || (item->status == ION_DELETED)) {
+			if ((NULL != free_loc) && (-1 == *free_loc)) {
+				*free_loc = loc;
+			}
 
-		if (item->status == ION_IN_USE) {
-			/* if a cell is in use, need to key to */
-
-			if (hash_map->super.compare(item->data, key, hash_map->super.record.key_size) == ION_IS_EQUAL) {
-				if (hash_map->write_concern == wc_insert_unique) {
-					/* allow unique entries only */
-					free(item);
-					return ION_STATUS_ERROR(err_duplicate_key);
-				}
-				else if (hash_map->write_concern == wc_update) {
-					/* allows for values to be updated											// */
-					/* backup and write */
-					fseek(hash_map->file, SIZEOF(STATUS) + hash_map->super.record.key_size - record_size, SEEK_CUR);
-#if ION_DEBUG
-					DUMP((int) ftell(hash_map->file), "%i");
-					DUMP(value, "%s");
-#endif
-					fwrite(value, hash_map->super.record.value_size, 1, hash_map->file);
-					free(item);
-					return ION_STATUS_OK(1);
-				}
-				else {
-					free(item);
-					return ION_STATUS_ERROR(err_write_concern);	/* there is a configuration issue with write concern */
-				}
+			if (item->status == ION_EMPTY) {
+				return -1;
 			}
 		}
-		else if ((item->status == ION_EMPTY) || (item->status == ION_DELETED)) {
-			/* problem is here with base types as it is just an array of data.  Need better way */
-			/* printf("empty\n"); */
-			fseek(hash_map->file, -record_size, SEEK_CUR);
-#if ION_DEBUG
-			DUMP((int) ftell(hash_map->file), "%i");
-#endif
-			item->status = ION_IN_USE;
-			memcpy(item->data, key, (hash_map->super.record.key_size));
-			memcpy(item->data + hash_map->super.record.key_size, value, (hash_map->super.record.value_size));
-			fwrite(item, record_size, 1, hash_map->file);
-			free(item);
-
-			return ION_STATUS_OK(1);
+		else if (ION_IS_EQUAL == hash_map->super.compare(item->data, key, hash_map->super.record.key_size)) {
+			return loc;
 		}
 
 		loc++;
@@ -232,82 +592,87 @@ oafh_insert(
 		if (loc >= hash_map->map_size) {
 			/* Perform wrapping */
 			loc = 0;
-			/* rewind the file */
-			frewind(hash_map->file);
 		}
-
-#if ION_DEBUG
-		printf("checking location %i\n", loc);
-#endif
-		count++;
 	}
 
-#if ION_DEBUG
-	printf("Hash table full.  Insert not done");
-#endif
-	free(item);
-	return ION_STATUS_ERROR(err_max_capacity);
+	return -1;
 }
 
-ion_err_t
-oafh_find_item_loc(
+ion_status_t
+oafh_insert(
 	ion_file_hashmap_t	*hash_map,
 	ion_key_t			key,
-	int					*location
+	ion_value_t			value
 ) {
-	ion_hash_t hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);
-	/* compute hash value for given key */
+	ion_hash_bucket_t	*item;
+	ion_err_t			error;
+	int					free_loc;
+	int					loc = oafh_probe(hash_map, key, &free_loc, &error);
 
-	int loc			= oafh_get_location(hash, hash_map->map_size);
-	/* determine bucket based on hash */
+	if (err_ok != error) {
+		return ION_STATUS_ERROR(error);
+	}
 
-	int count		= 0;
+	if (-1 != loc) {
+		if (hash_map->write_concern == wc_insert_unique) {
+			/* allow unique entries only */
+			return ION_STATUS_ERROR(err_duplicate_key);
+		}
+		else if (hash_map->write_concern == wc_update) {
+			/* allows for values to be updated */
+			item = oafh_bucket(hash_map, loc, boolean_true);
 
-	ion_hash_bucket_t *item;
+			if (NULL == item) {
+				return ION_STATUS_ERROR(err_file_read_error);
+			}
 
-	int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+			memcpy(item->data + hash_map->super.record.key_size, value, hash_map->super.record.value_size);
+			return ION_STATUS_OK(1);
+		}
+		else {
+			return ION_STATUS_ERROR(err_write_concern);	/* there is a configuration issue with write concern */
+		}
+	}
 
-	item = malloc(record_size);
+	if (-1 == free_loc) {
+#if ION_DEBUG
+		printf("Hash table full.  Insert not done");
+#endif
+		return ION_STATUS_ERROR(err_max_capacity);
+	}
 
-	/* set file position */
-	fseek(hash_map->file, loc * record_size, SEEK_SET);
+	item = oafh_bucket(hash_map, free_loc, boolean_true);
 
-	/* needs to traverse file again */
-	while (count != hash_map->map_size) {
-		fread(&item->status, SIZEOF(STATUS), 1, hash_map->file);
-		fread(item->data, record_size - SIZEOF(STATUS), 1, hash_map->file);
+	if (NULL == item) {
+		return ION_STATUS_ERROR(err_file_read_error);
+	}
 
-		if (item->status == ION_EMPTY) {
-			free(item);
-			return err_item_not_found;	/* if you hit an empty cell, exit */
-		}
-		else {
-			/* calculate if there is a match */
+	item->status = ION_IN_USE;
+	memcpy(item->data, key, (hash_map->super.record.key_size));
+	memcpy(item->data + hash_map->super.record.key_size, value, (hash_map->super.record.value_size));
 
-			if (item->status != ION_DELETED) {
-				/*@todo correct compare to use proper return type*/
-				int key_is_equal = hash_map->super.compare(item->data, key, hash_map->super.record.key_size);
+	return ION_STATUS_OK(1);
+}
 
-				if (ION_IS_EQUAL == key_is_equal) {
-					(*location) = loc;
-					free(item);
-					return err_ok;
-				}
-			}
+ion_err_t
+oafh_find_item_loc(
+	ion_file_hashmap_t	*hash_map,
+	ion_key_t			key,
+	int					*location
+) {
+	ion_err_t	error;
+	int			loc = oafh_probe(hash_map, key, NULL, &error);
 
-			loc++;
-			count++;
+	if (err_ok != error) {
+		return error;
+	}
 
-			if (loc >= hash_map->map_size) {
-				/* Perform wrapping */
-				loc = 0;
-				frewind(hash_map->file);
-			}
-		}
+	if (-1 == loc) {
+		return err_item_not_found;	/* key have not been found */
 	}
 
-	free(item);
-	return err_item_not_found;	/* key have not been found */
+	(*location) = loc;
+	return err_ok;
 }
 
 ion_status_t
@@ -315,36 +680,25 @@ oafh_delete(
 	ion_file_hashmap_t	*hash_map,
 	ion_key_t			key
 ) {
-	int loc;
+	int			loc;
+	ion_err_t	error = oafh_find_item_loc(hash_map, key, &loc);
 
-	if (oafh_find_item_loc(hash_map, key, &loc) == err_item_not_found) {
+	if (err_ok != error) {
 #if ION_DEBUG
 		printf("Item not found when trying to oah_delete.\n");
 #endif
-		return ION_STATUS_ERROR(err_item_not_found);
+		return ION_STATUS_ERROR(error);
 	}
 	else {
 		/* locate item */
-		ion_hash_bucket_t *item;
-
-		int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+		ion_hash_bucket_t *item = oafh_bucket(hash_map, loc, boolean_true);
 
-		item = malloc(record_size);
-
-		/* set file position */
-		fseek(hash_map->file, loc * record_size, SEEK_SET);
-
-		fread(&item->status, SIZEOF(STATUS), 1, hash_map->file);
-		fread(item->data, record_size - SIZEOF(STATUS), 1, hash_map->file);
+		if (NULL == item) {
+			return ION_STATUS_ERROR(err_file_read_error);
+		}
 
 		item->status = ION_DELETED;	/* delete item */
 
-		/* backup */
-		fseek(hash_map->file, -record_size, SEEK_CUR);
-		fwrite(&item->status, SIZEOF(STATUS), 1, hash_map->file);
-		fwrite(item->data, record_size - SIZEOF(STATUS), 1, hash_map->file);
-
-		free(item);
 #if ION_DEBUG
 		printf("Item deleted at location %d\n", loc);
 #endif
@@ -358,21 +712,22 @@ oafh_query(
 	ion_key_t			key,
 	ion_value_t			value
 ) {
-	int loc;
+	int			loc;
+	ion_err_t	error = oafh_find_item_loc(hash_map, key, &loc);
 
-	if (oafh_find_item_loc(hash_map, key, &loc) == err_ok) {
+	if (error == err_ok) {
 #if ION_DEBUG
 		printf("Item found at location %d\n", loc);
 #endif
 
-		int record_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+		/* the page is still held from the probe */
+		ion_hash_bucket_t *item = oafh_bucket(hash_map, loc, boolean_false);
 
-		/* set file position */
-		fseek(hash_map->file, (loc * record_size) + SIZEOF(STATUS) + hash_map->super.record.key_size, SEEK_SET);
-#if ION_DEBUG
-		printf("seeking %i\n", (loc * record_size) + SIZEOF(STATUS) + hash_map->super.record.key_size);
-#endif
-		fread(value, hash_map->super.record.value_size, 1, hash_map->file);
+		if (NULL == item) {
+			return ION_STATUS_ERROR(err_file_read_error);
+		}
+
+		memcpy(value, item->data + hash_map->super.record.key_size, hash_map->super.record.value_size);
 
 		return ION_STATUS_OK(1);
 	}
@@ -381,7 +736,7 @@ oafh_query(
 		printf("Item not found in hash table.\n");
 #endif
 		value = NULL;	/*et the number of bytes to 0 */
-		return ION_STATUS_ERROR(err_item_not_found);
+		return ION_STATUS_ERROR(error);
 	}
 }
 
@@ -398,3 +753,13 @@ oafh_compute_simple_hash(
 
 	return hash;
 }
+
+ion_hash_t
+oafh_compute_hash(
+	ion_file_hashmap_t	*hashmap,
+	ion_key_t			key,
+	int					size_of_key
+) {
+	/* Drop the top bit so the hash stays a valid, non-negative ion_hash_t. */
+	return (ion_hash_t) (dictionary_hash_key(key, hashmap->super.key_type, size_of_key) & INT_MAX);
+}
@@ -30,6 +30,68 @@ extern "C" {
 #define ION_IN_USE	-3
 #define SIZEOF(STATUS) 1
 
+/**
+@brief		The size in bytes of a page of buckets.
+@details	The buckets of the file are read and written a page at a time,
+			so a probe sequence usually needs a single read. A page holds
+			as many whole buckets as fit, and never less than one.
+*/
+#if !defined(ION_OAFH_PAGE_SIZE)
+#if defined(ARDUINO)
+#define ION_OAFH_PAGE_SIZE 64
+#else
+#define ION_OAFH_PAGE_SIZE 4096
+#endif
+#endif
+
+/**
+@brief		How many pages of buckets each file hash keeps in memory.
+@details	Changed pages stay in memory until one of them has to make room
+			for another page. All changed pages are then written back
+			together, in file order.
+*/
+#if !defined(ION_OAFH_CACHE_PAGES)
+#if defined(ARDUINO)
+#define ION_OAFH_CACHE_PAGES 1
+#else
+#define ION_OAFH_CACHE_PAGES 8
+#endif
+#endif
+
+/**
+@brief		Marks a file written by this version of the file hash.
+@details	The file starts with a @ref ion_oafh_header_t. Files from before
+			key type aware hashing start with a bucket instead, so their
+			records would be looked for in the wrong buckets. They are
+			rebuilt when opened.
+*/
+#define ION_OAFH_MAGIC			0x4846414FUL
+
+/**
+@brief		The version of the bucket layout and hash of a file hash file.
+*/
+#define ION_OAFH_FILE_VERSION	1
+
+/**
+@brief		The header at the start of a file hash file, ahead of the buckets.
+*/
+typedef struct {
+	uint32_t	magic;		/**< @ref ION_OAFH_MAGIC */
+	uint32_t	version;	/**< @ref ION_OAFH_FILE_VERSION */
+} ion_oafh_header_t;
+
+/**
+@brief		A page of buckets held in memory by a file hash.
+*/
+typedef struct {
+	int				page;		/**< The page held, or -1 if none */
+	ion_boolean_t	dirty;		/**< Whether the page changed since it was
+								 read */
+	unsigned long	last_used;	/**< When the page was last used, to choose
+								 which page to evict */
+	ion_byte_t		*data;		/**< The buckets of the page */
+} ion_oafh_page_t;
+
 /**
 @brief		Prototype declaration for hashmap
 */
@@ -53,6 +115,13 @@ struct file_hashmap {
 	/**< The hashing function to be used for
 		 the instance*/
 	FILE *file;	/**< file pointer */
+	ion_oafh_page_t			*pages;			/**< The page cache */
+	int						num_pages;		/**< The number of pages in
+											 the cache */
+	int						page_buckets;	/**< The number of buckets in a
+											 page */
+	unsigned long			clock;			/**< Counts page uses, for
+											 eviction */
 };
 
 /**
@@ -101,6 +170,10 @@ oafh_close(
 @param		id
 				The id of hashmap.
 @return		The status describing the result of the initialization.
+			A file without the current header is rebuilt, with its
+			records put back through @p hashing_function, which takes
+			@p hashmap's @p compare. A file of another version is refused
+			with @c err_file_open_error.
 */
 ion_err_t
 oafh_initialize(
@@ -127,6 +200,49 @@ oafh_destroy(
 	ion_file_hashmap_t *hash_map
 );
 
+/**
+@brief		Writes changed pages back to the file.
+@details	Afterwards the file holds every record and may be read directly.
+			The pages stay cached, clean, and a page that could not be
+			written keeps its changes for the next flush.
+@param		hash_map
+				The map to flush.
+@return		The status of the flush.
+*/
+ion_err_t
+oafh_flush(
+	ion_file_hashmap_t *hash_map
+);
+
+/**
+@brief		Flushes the map and empties the page cache.
+@details	Changes made to the file directly are read by the next
+			operation on the map. Pages that could not be written are
+			kept, so their changes are not lost.
+@param		hash_map
+				The map whose cache is emptied.
+@return		The status of the flush.
+*/
+ion_err_t
+oafh_drop_pages(
+	ion_file_hashmap_t *hash_map
+);
+
+/**
+@brief		Gives read access to a bucket through the page cache.
+@param		hash_map
+				The map that holds the bucket.
+@param		loc
+				The index of the bucket.
+@return		The bucket, which stays valid until the next operation on the
+			map, or NULL if its page could not be read.
+*/
+ion_hash_bucket_t *
+oafh_get_bucket(
+	ion_file_hashmap_t	*hash_map,
+	int					loc
+);
+
 /**
 @brief		Insert record into hashmap
 
@@ -183,7 +299,8 @@ oafh_update(
 @param		num
 				The key.
 @param		size
-				The possible number of buckets in the map.
+				The possible number of buckets in the map. A power of two
+				size masks the low bits of @p num instead of dividing.
 @return		The index position to start probing at.
 */
 int
@@ -269,6 +386,26 @@ oafh_compute_simple_hash(
 	int					size_of_key
 );
 
+/**
+@brief		Hashes the whole key according to the key type of the map.
+@details	Uses @ref dictionary_hash_key, so sequential integers and keys
+			that share a prefix do not pile up in one run of buckets. This
+			is the hash the dictionary handler binds.
+@param		hashmap
+				The hash function is associated with.
+@param		key
+				The original key value to find hash value for.
+@param		size_of_key
+				The size of the key in bytes.
+@return		The non-negative hashed value for the key.
+*/
+ion_hash_t
+oafh_compute_hash(
+	ion_file_hashmap_t	*hashmap,
+	ion_key_t			key,
+	int					size_of_key
+);
+
 /*void
 static_hash_init(ion_dictonary_handler_t * client);*/
 
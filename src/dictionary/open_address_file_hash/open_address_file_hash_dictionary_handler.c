@@ -63,22 +63,31 @@ oafdict_scan(
 	/* need to scan hashmap fully looking for values that satisfy - need to think about */
 	ion_file_hashmap_t *hash_map	= (ion_file_hashmap_t *) (cursor->super.dictionary->instance);
 
-	int loc							= (cursor->current + 1) % hash_map->map_size;
+	int loc							= cursor->current + 1;
 	/* this is the current position of the cursor */
 	/* and start scanning 1 ahead */
 
-	int record_size = SIZEOF(STATUS) + hash_map->super.record.key_size + hash_map->super.record.value_size;
-
-	/* move to the correct position in the fie */
-	fseek(hash_map->file, loc * record_size, SEEK_SET);
-
 	ion_hash_bucket_t *item;
 
-	item = malloc(record_size);
-
 	/* start at the current position, scan forward */
 	while (loc != cursor->first) {
-		fread(item, record_size, 1, hash_map->file);
+		if (loc >= hash_map->map_size) {
+			/* Range and all records cursors start at the first bucket, so they end here instead of wrapping. */
+			if (cursor->first < 0) {
+				break;
+			}
+
+			/* Perform wrapping */
+			loc = 0;
+			continue;
+		}
+
+		/* buckets are read through the page cache, so a scan reads each page once */
+		item = oafh_get_bucket(hash_map, loc);
+
+		if (NULL == item) {
+			break;
+		}
 
 		if ((item->status == ION_EMPTY) || (item->status == ION_DELETED)) {
 			/* if empty, just skip to next cell */
@@ -93,22 +102,15 @@ oafdict_scan(
 
 			if (key_satisfies_predicate == boolean_true) {
 				cursor->current = loc;	/* this is the next index for value */
-				free(item);
 				return cs_valid_data;
 			}
 
 			/* If valid bucket is not found, advance current position. */
 			loc++;
 		}
-
-		if (loc >= hash_map->map_size) {
-			/* Perform wrapping */
-			loc = 0;
-		}
 	}
 
 	/* if you end up here, you've wrapped the entire data structure and not found a value */
-	free(item);
 	return cs_end_of_results;
 }
 
@@ -142,9 +144,6 @@ oafdict_next(
 		ion_file_hashmap_t *hash_map = ((ion_file_hashmap_t *) cursor->dictionary->instance);
 
 		/* assume that the value has been pre-allocated */
-		/* compute length of data record stored in map */
-		int data_length = hash_map->super.record.key_size + hash_map->super.record.value_size;
-
 		if (cursor->status == cs_cursor_active) {
 			/* find the next valid entry */
 
@@ -164,14 +163,16 @@ oafdict_next(
 
 		/* the results are now ready //reference item at given position */
 
-		/* set position in file to read value */
-		fseek(hash_map->file, (SIZEOF(STATUS) + data_length) * oafdict_cursor->current	/* position is based on indexes (not abs file pos) */
-			+ SIZEOF(STATUS), SEEK_SET);
+		/* read the record from its bucket */
+		ion_hash_bucket_t *item = oafh_get_bucket(hash_map, oafdict_cursor->current);
 
-/*@todo this needs to be addressed in terms of return type
-*/
-		fread(record->key, hash_map->super.record.key_size, 1, hash_map->file);
-		fread(record->value, hash_map->super.record.value_size, 1, hash_map->file);
+		if (NULL == item) {
+			cursor->status = cs_end_of_results;
+			return cursor->status;
+		}
+
+		memcpy(record->key, item->data, hash_map->super.record.key_size);
+		memcpy(record->value, item->data + hash_map->super.record.key_size, hash_map->super.record.value_size);
 
 		/* and update current cursor position */
 		return cursor->status;
@@ -205,6 +206,11 @@ oafdict_find(
 	ion_predicate_t		*predicate,
 	ion_dict_cursor_t	**cursor
 ) {
+	/* hashing keeps no key order to scan in reverse */
+	if (dictionary_predicate_is_descending(predicate)) {
+		return err_not_implemented;
+	}
+
 	/* allocate memory for cursor */
 	if ((*cursor = malloc(sizeof(ion_oafdict_cursor_t))) == NULL) {
 		return err_out_of_memory;
@@ -238,12 +244,19 @@ oafdict_find(
 			memcpy((*cursor)->predicate->statement.equality.equality_value, predicate->statement.equality.equality_value, ((((ion_file_hashmap_t *) dictionary->instance)->super.record.key_size)));
 
 			/* find the location of the first element as this is a straight equality */
-			int location = cs_invalid_index;
+			int			location	= cs_invalid_index;
+			ion_err_t	error		= oafh_find_item_loc((ion_file_hashmap_t *) dictionary->instance, (*cursor)->predicate->statement.equality.equality_value, &location);
 
-			if (oafh_find_item_loc((ion_file_hashmap_t *) dictionary->instance, (*cursor)->predicate->statement.equality.equality_value, &location) == err_item_not_found) {
+			if (error == err_item_not_found) {
 				(*cursor)->status = cs_end_of_results;
 				return err_ok;
 			}
+			else if (error != err_ok) {
+				free((*cursor)->predicate->statement.equality.equality_value);
+				free((*cursor)->predicate);
+				free(*cursor);	/* cleanup */
+				return error;
+			}
 			else {
 				(*cursor)->status = cs_cursor_initialized;
 
@@ -285,11 +298,10 @@ oafdict_find(
 
 		/* Range query will intentionally continue to all record code to get rid of duplicate statements. */
 		case predicate_all_records: {
-			ion_oafdict_cursor_t	*oafdict_cursor = (ion_oafdict_cursor_t *) (*cursor);
-			ion_file_hashmap_t		*hash_map		= ((ion_file_hashmap_t *) dictionary->instance);
+			ion_oafdict_cursor_t *oafdict_cursor = (ion_oafdict_cursor_t *) (*cursor);
 
 			(*cursor)->status		= cs_cursor_initialized;
-			oafdict_cursor->first	= (hash_map->map_size) - 1;
+			oafdict_cursor->first	= -1;
 			oafdict_cursor->current = -1;
 
 			ion_err_t err = oafdict_scan(oafdict_cursor);
@@ -370,6 +382,22 @@ oafdict_close_dictionary(
 	return err_ok;
 }
 
+/**
+@brief			Writes the changed pages an open address file hash holds in
+				memory to its file.
+
+@param			dictionary
+					A pointer to the specific dictionary instance to be flushed.
+
+@return			The status of the flush.
+ */
+ion_err_t
+oafdict_flush_dictionary(
+	ion_dictionary_t *dictionary
+) {
+	return oafh_flush((ion_file_hashmap_t *) dictionary->instance);
+}
+
 void
 oafdict_init(
 	ion_dictionary_handler_t *handler
@@ -383,6 +411,7 @@ oafdict_init(
 	handler->delete_dictionary	= oafdict_delete_dictionary;
 	handler->open_dictionary	= oafdict_open_dictionary;
 	handler->close_dictionary	= oafdict_close_dictionary;
+	handler->flush_dictionary	= oafdict_flush_dictionary;
 }
 
 ion_status_t
@@ -407,12 +436,22 @@ oafdict_create_dictionary(
 ) {
 	UNUSED(id);
 	/* this is the instance of the hashmap */
-	dictionary->instance			= malloc(sizeof(ion_file_hashmap_t));
+	dictionary->instance = malloc(sizeof(ion_file_hashmap_t));
+
+	if (NULL == dictionary->instance) {
+		return err_out_of_memory;
+	}
 
-	dictionary->instance->compare	= compare;
+	dictionary->instance->compare = compare;
 
 	/* this registers the dictionary the dictionary */
-	oafh_initialize((ion_file_hashmap_t *) dictionary->instance, oafh_compute_simple_hash, key_type, key_size, value_size, dictionary_size, id);/* just pick an arbitary size for testing atm */
+	ion_err_t err = oafh_initialize((ion_file_hashmap_t *) dictionary->instance, oafh_compute_hash, key_type, key_size, value_size, dictionary_size, id);/* just pick an arbitary size for testing atm */
+
+	if (err_ok != err) {
+		free(dictionary->instance);
+		dictionary->instance = NULL;
+		return err;
+	}
 
 	/*TODO The correct comparison operator needs to be bound at run time
 	 * based on the type of key defined
@@ -13,8 +13,13 @@
 */
 /******************************************************************************/
 
+#include <limits.h>
 #include "open_address_hash.h"
 
+#if ION_OAH_GROUP_SIZE > 1
+#include <emmintrin.h>
+#endif
+
 ion_err_t
 oah_initialize(
 	ion_hashmap_t *hashmap,
@@ -36,10 +41,23 @@ oah_initialize(
 	/* The hash map is allocated as a single contiguous array*/
 	hashmap->map_size		= size;
 	hashmap->entry			= malloc((hashmap->super.record.key_size + hashmap->super.record.value_size + 1) * hashmap->map_size);
+	hashmap->control		= malloc(hashmap->map_size);
 	/* Allows for binding of different hash function depending on requirements. */
 	hashmap->compute_hash	= (*hashing_function);
-
-	if (NULL == hashmap->entry) {
+	hashmap->old_entry		= NULL;
+	hashmap->old_control	= NULL;
+	hashmap->old_map_size	= 0;
+	hashmap->rehash_index	= 0;
+	hashmap->rehash_step	= ION_OAH_REHASH_STEP;
+	hashmap->num_items		= 0;
+	hashmap->num_deleted	= 0;
+	hashmap->load_factor	= 0;
+
+	if ((NULL == hashmap->entry) || (NULL == hashmap->control)) {
+		free(hashmap->entry);
+		free(hashmap->control);
+		hashmap->entry		= NULL;
+		hashmap->control	= NULL;
 		return 1;
 	}
 
@@ -52,6 +70,8 @@ oah_initialize(
 		((ion_hash_bucket_t *) (hashmap->entry + ((hashmap->super.record.key_size + hashmap->super.record.value_size + SIZEOF(STATUS)) * i)))->status = ION_EMPTY;
 	}
 
+	memset(hashmap->control, ION_OAH_CONTROL_EMPTY, hashmap->map_size);
+
 	return 0;
 }
 
@@ -60,9 +80,308 @@ oah_get_location(
 	ion_hash_t	num,
 	int			size
 ) {
+	if (0 == (size & (size - 1))) {
+		return num & (size - 1);
+	}
+
 	return num % size;
 }
 
+/**
+@brief		Finds a bucket of one table of the map.
+@param		hash_map
+				The map that owns the table.
+@param		entry
+				The table.
+@param		loc
+				The index of the bucket.
+@return		The bucket.
+*/
+static ion_hash_bucket_t *
+oah_bucket(
+	ion_hashmap_t	*hash_map,
+	char			*entry,
+	int				loc
+) {
+	return (ion_hash_bucket_t *) (entry + (hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS)) * loc);
+}
+
+/**
+@brief		Probes one table of the map for a key.
+@details	Probing reads the control bytes, a group at a time where the
+			platform allows, and only compares keys in slots whose control
+			byte matches the hash. Probing stops at the first empty slot.
+			Along the way, @p free_loc is set to the first empty or deleted
+			slot, which is where the key would be inserted.
+@param		hash_map
+				The map that owns the table.
+@param		entry
+				The table to probe.
+@param		control
+				The control bytes of @p entry.
+@param		size
+				The size of @p entry in item capacity.
+@param		hash
+				The hash of @p key.
+@param		key
+				The key to look for.
+@param		free_loc
+				Set to the first free slot seen, or -1 if there is none.
+				May be NULL when the caller does not need it.
+@return		The slot holding @p key, or -1 if it is not in the table.
+*/
+static int
+oah_probe(
+	ion_hashmap_t	*hash_map,
+	char			*entry,
+	ion_byte_t		*control,
+	int				size,
+	ion_hash_t		hash,
+	ion_key_t		key,
+	int				*free_loc
+) {
+	ion_byte_t		tag		= ION_OAH_CONTROL_HASH(hash);
+	int				loc		= oah_get_location(hash, size);
+	int				count	= 0;
+	int				width;
+	int				bit;
+	unsigned int	match;
+	unsigned int	empty;
+	unsigned int	free_slots;
+
+	if (NULL != free_loc) {
+		*free_loc = -1;
+	}
+
+	while (count < size) {
+#if ION_OAH_GROUP_SIZE > 1
+
+		if ((loc + ION_OAH_GROUP_SIZE <= size) && (count + ION_OAH_GROUP_SIZE <= size)) {
+			__m128i group = _mm_loadu_si128((const __m128i *) (control + loc));
+
+			match		= (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) tag)));
+			empty		= (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) (signed char) -128)));
+			free_slots	= (unsigned int) _mm_movemask_epi8(group);
+			width		= ION_OAH_GROUP_SIZE;
+		}
+		else
+#endif
+		{
+			match		= control[loc] == tag;
+			empty		= control[loc] == ION_OAH_CONTROL_EMPTY;
+			free_slots	= 0 != (control[loc] & 0x80);
+			width		= 1;
+		}
+
+		if (0 != empty) {
+			/* Slots after the first empty one are not part of this probe. */
+			empty		&= 0u - empty;
+			match		&= empty - 1;
+			free_slots	&= empty | (empty - 1);
+		}
+
+		for (bit = 0; 0 != match; bit++, match >>= 1) {
+			if ((match & 1) && (ION_IS_EQUAL == hash_map->super.compare(oah_bucket(hash_map, entry, loc + bit)->data, key, hash_map->super.record.key_size))) {
+				return loc + bit;
+			}
+		}
+
+		if ((NULL != free_loc) && (-1 == *free_loc) && (0 != free_slots)) {
+			for (bit = 0; 0 == (free_slots & 1); bit++) {
+				free_slots >>= 1;
+			}
+
+			*free_loc = loc + bit;
+		}
+
+		if (0 != empty) {
+			return -1;
+		}
+
+		count	+= width;
+		loc		+= width;
+
+		if (loc >= size) {
+			/* Perform wrapping */
+			loc = 0;
+		}
+	}
+
+	return -1;
+}
+
+/**
+@brief		Moves a record from the old table into the current one.
+@details	The old bucket is marked deleted rather than empty, so that
+			probes for records not yet moved still get past it.
+@param		hash_map
+				The map being rehashed.
+@param		old_loc
+				The bucket of the old table holding the record.
+@return		The bucket of the current table the record moved to.
+*/
+static int
+oah_move_bucket(
+	ion_hashmap_t	*hash_map,
+	int				old_loc
+) {
+	int					bucket_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+	ion_hash_bucket_t	*item		= oah_bucket(hash_map, hash_map->old_entry, old_loc);
+	ion_hash_t			hash		= hash_map->compute_hash(hash_map, item->data, hash_map->super.record.key_size);
+	int					free_loc;
+
+	oah_probe(hash_map, hash_map->entry, hash_map->control, hash_map->map_size, hash, item->data, &free_loc);
+
+	if (hash_map->control[free_loc] == ION_OAH_CONTROL_DELETED) {
+		hash_map->num_deleted--;
+	}
+
+	memcpy(oah_bucket(hash_map, hash_map->entry, free_loc), item, bucket_size);
+	hash_map->control[free_loc]		= ION_OAH_CONTROL_HASH(hash);
+	item->status					= ION_DELETED;
+	hash_map->old_control[old_loc]	= ION_OAH_CONTROL_DELETED;
+
+	return free_loc;
+}
+
+/**
+@brief		Moves buckets from the old table into the current one.
+@details	Deleted buckets are not copied, which clears them from the map.
+@param		hash_map
+				The map being rehashed.
+@param		num_buckets
+				The most buckets of the old table to move.
+*/
+static void
+oah_rehash_step(
+	ion_hashmap_t	*hash_map,
+	int				num_buckets
+) {
+	while ((NULL != hash_map->old_entry) && (num_buckets > 0)) {
+		if (oah_bucket(hash_map, hash_map->old_entry, hash_map->rehash_index)->status == ION_IN_USE) {
+			oah_move_bucket(hash_map, hash_map->rehash_index);
+		}
+
+		hash_map->rehash_index++;
+		num_buckets--;
+
+		if (hash_map->rehash_index >= hash_map->old_map_size) {
+			free(hash_map->old_entry);
+			free(hash_map->old_control);
+			hash_map->old_entry		= NULL;
+			hash_map->old_control	= NULL;
+			hash_map->old_map_size	= 0;
+			hash_map->rehash_index	= 0;
+		}
+	}
+}
+
+/**
+@brief		Starts an incremental rehash if one more record would take the
+			map past its load factor.
+@details	If the allocation fails the map keeps its current table, and
+			inserts go on until it is full.
+@param		hash_map
+				The map to check.
+*/
+static void
+oah_check_load(
+	ion_hashmap_t *hash_map
+) {
+	int			bucket_size = hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS);
+	long		threshold	= (long) hash_map->load_factor * hash_map->map_size;
+	int			new_size	= hash_map->map_size;
+	char		*new_entry;
+	ion_byte_t	*new_control;
+	long		headroom;
+	int			i;
+
+	if ((0 == hash_map->load_factor) || ((long) (hash_map->num_items + hash_map->num_deleted + 1) * 100 <= threshold)) {
+		return;
+	}
+
+	/* Only one old table is kept. Its rehash was sized to be done by now, so this has nothing left to move. */
+	oah_rehash_step(hash_map, hash_map->old_map_size);
+
+	/* When deletions make up most of the load, rehashing at the same size is enough. */
+	if (((long) hash_map->num_items * 200 > threshold) && (hash_map->map_size <= INT_MAX / 2)) {
+		new_size = hash_map->map_size * 2;
+	}
+
+	new_entry	= malloc((size_t) bucket_size * new_size);
+	new_control = malloc(new_size);
+
+	if ((NULL == new_entry) || (NULL == new_control)) {
+		free(new_entry);
+		free(new_control);
+		return;
+	}
+
+	for (i = 0; i < new_size; i++) {
+		oah_bucket(hash_map, new_entry, i)->status = ION_EMPTY;
+	}
+
+	memset(new_control, ION_OAH_CONTROL_EMPTY, new_size);
+
+	hash_map->old_entry		= hash_map->entry;
+	hash_map->old_control	= hash_map->control;
+	hash_map->old_map_size	= hash_map->map_size;
+	hash_map->rehash_index	= 0;
+	hash_map->entry			= new_entry;
+	hash_map->control		= new_control;
+	hash_map->map_size		= new_size;
+	hash_map->num_deleted	= 0;
+
+	/* Every insert or delete moves buckets, and at least headroom of them come before the map is this full again. */
+	headroom				= (long) hash_map->load_factor * new_size / 100 - hash_map->num_items;
+	hash_map->rehash_step	= ION_OAH_REHASH_STEP;
+
+	if (headroom < 1) {
+		hash_map->rehash_step = hash_map->old_map_size;
+	}
+	else if ((hash_map->old_map_size + headroom - 1) / headroom > ION_OAH_REHASH_STEP) {
+		hash_map->rehash_step = (int) ((hash_map->old_map_size + headroom - 1) / headroom);
+	}
+}
+
+ion_err_t
+oah_set_load_factor(
+	ion_hashmap_t	*hash_map,
+	int				load_factor
+) {
+	if ((load_factor < 0) || (load_factor > 100)) {
+		return err_out_of_bounds;
+	}
+
+	/* The simple hash is taken modulo the map size, so it would change as the map grows. */
+	if ((0 != load_factor) && (hash_map->compute_hash == oah_compute_simple_hash)) {
+		return err_illegal_state;
+	}
+
+	hash_map->load_factor = load_factor;
+
+	return err_ok;
+}
+
+void
+oah_finish_rehash(
+	ion_hashmap_t *hash_map
+) {
+	oah_rehash_step(hash_map, hash_map->old_map_size);
+}
+
+ion_hash_bucket_t *
+oah_bucket_at(
+	ion_hashmap_t	*hash_map,
+	int				index
+) {
+	if (index >= hash_map->map_size) {
+		return oah_bucket(hash_map, hash_map->old_entry, index - hash_map->map_size);
+	}
+
+	return oah_bucket(hash_map, hash_map->entry, index);
+}
+
 ion_err_t
 oah_destroy(
 	ion_hashmap_t *hash_map
@@ -72,10 +391,19 @@ oah_destroy(
 	hash_map->super.record.key_size		= 0;
 	hash_map->super.record.value_size	= 0;
 
+	if (hash_map->old_entry != NULL) {
+		free(hash_map->old_entry);
+		free(hash_map->old_control);
+		hash_map->old_entry		= NULL;
+		hash_map->old_control	= NULL;
+	}
+
 	if (hash_map->entry != NULL) {
 		/* check to ensure that you are not freeing something already free */
 		free(hash_map->entry);
-		hash_map->entry = NULL;	/*  */
+		free(hash_map->control);
+		hash_map->entry		= NULL;	/*  */
+		hash_map->control	= NULL;
 		return err_ok;
 	}
 	else {
@@ -106,62 +434,63 @@ oah_insert(
 	ion_key_t		key,
 	ion_value_t		value
 ) {
-	ion_hash_t hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);	/* compute hash value for given key */
-
-	int loc			= oah_get_location(hash, hash_map->map_size);
+	ion_hash_bucket_t	*item;
+	ion_hash_t			hash;
+	int					loc			= -1;
+	int					free_loc	= -1;
 
-	/* Scan until find an empty location - oah_insert if found */
-	int count		= 0;
+	oah_rehash_step(hash_map, hash_map->rehash_step);
+	oah_check_load(hash_map);
 
-	ion_hash_bucket_t *item;
+	hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);	/* compute hash value for given key */
 
-	while (count != hash_map->map_size) {
-		item = ((ion_hash_bucket_t *) ((hash_map->entry + (hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS)) * loc)));
+	/* A record that has not been moved yet is updated where it is. */
+	if (NULL != hash_map->old_entry) {
+		loc = oah_probe(hash_map, hash_map->old_entry, hash_map->old_control, hash_map->old_map_size, hash, key, NULL);
+	}
 
-		if (item->status == ION_IN_USE) {
-			/* if a cell is in use, need to key to */
+	if (-1 != loc) {
+		item = oah_bucket(hash_map, hash_map->old_entry, loc);
+	}
+	else {
+		loc		= oah_probe(hash_map, hash_map->entry, hash_map->control, hash_map->map_size, hash, key, &free_loc);
+		item	= (-1 == loc) ? NULL : oah_bucket(hash_map, hash_map->entry, loc);
+	}
 
-			if (hash_map->super.compare(item->data, key, hash_map->super.record.key_size) == ION_IS_EQUAL) {
-				if (hash_map->write_concern == wc_insert_unique) {
-					/* allow unique entries only */
-					return ION_STATUS_ERROR(err_duplicate_key);
-				}
-				else if (hash_map->write_concern == wc_update) {
-					/* allows for values to be updated */
-					memcpy(item->data + hash_map->super.record.key_size, value, (hash_map->super.record.value_size));
-					return ION_STATUS_OK(1);
-				}
-				else {
-					return ION_STATUS_ERROR(err_write_concern);	/* there is a configuration issue with write concern */
-				}
-			}
+	if (NULL != item) {
+		if (hash_map->write_concern == wc_insert_unique) {
+			/* allow unique entries only */
+			return ION_STATUS_ERROR(err_duplicate_key);
 		}
-		else if ((item->status == ION_EMPTY) || (item->status == ION_DELETED)) {
-			/* problem is here with base types as it is just an array of data.  Need better way */
-			item->status = ION_IN_USE;
-			memcpy(item->data, key, (hash_map->super.record.key_size));
+		else if (hash_map->write_concern == wc_update) {
+			/* allows for values to be updated */
 			memcpy(item->data + hash_map->super.record.key_size, value, (hash_map->super.record.value_size));
 			return ION_STATUS_OK(1);
 		}
-
-		loc++;
-
-		if (loc >= hash_map->map_size) {
-			/* Perform wrapping */
-			loc = 0;
+		else {
+			return ION_STATUS_ERROR(err_write_concern);	/* there is a configuration issue with write concern */
 		}
+	}
 
+	if (-1 == free_loc) {
 #if ION_DEBUG
-		printf("checking location %i\n", loc);
+		printf("Hash table full.  Insert not done");
 #endif
-		count++;
+		return ION_STATUS_ERROR(err_max_capacity);
 	}
 
-#if ION_DEBUG
-	printf("Hash table full.  Insert not done");
-#endif
+	if (hash_map->control[free_loc] == ION_OAH_CONTROL_DELETED) {
+		hash_map->num_deleted--;
+	}
 
-	return ION_STATUS_ERROR(err_max_capacity);
+	item							= oah_bucket(hash_map, hash_map->entry, free_loc);
+	item->status					= ION_IN_USE;
+	hash_map->control[free_loc]		= ION_OAH_CONTROL_HASH(hash);
+	memcpy(item->data, key, (hash_map->super.record.key_size));
+	memcpy(item->data + hash_map->super.record.key_size, value, (hash_map->super.record.value_size));
+	hash_map->num_items++;
+
+	return ION_STATUS_OK(1);
 }
 
 ion_err_t
@@ -170,49 +499,28 @@ oah_find_item_loc(
 	ion_key_t		key,
 	int				*location
 ) {
-	/* compute hash value for given key */
-	ion_hash_t hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);
-
-	int loc			= oah_get_location(hash, hash_map->map_size);
-	/* determine bucket based on hash */
-
-	int count		= 0;
+	ion_hash_t	hash	= hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);
+	int			loc		= -1;
 
-	while (count != hash_map->map_size) {
-		/* check to see if current item is a match based on key */
-		/* locate first item */
-		ion_hash_bucket_t *item = (((ion_hash_bucket_t *) ((hash_map->entry + (hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS)) * loc))));
+	/* A record not moved yet is moved now, so that its location is in entry. */
+	if (NULL != hash_map->old_entry) {
+		loc = oah_probe(hash_map, hash_map->old_entry, hash_map->old_control, hash_map->old_map_size, hash, key, NULL);
 
-		if (item->status == ION_EMPTY) {
-			return err_item_not_found;	/* if you hit an empty cell, exit */
+		if (-1 != loc) {
+			loc = oah_move_bucket(hash_map, loc);
 		}
-		else {
-			/* calculate if there is a match */
-
-			if (item->status != ION_DELETED) {
-				/*@todo correct compare to use proper returen type*/
-				/*@todo An error exisits with the comparitor from the dictionary and will need to be
-				 * revisitied onced fixed */
-
-				int key_is_equal = hash_map->super.compare(item->data, key, hash_map->super.record.key_size);
-
-				if (ION_IS_EQUAL == key_is_equal) {
-					(*location) = loc;
-					return err_ok;
-				}
-			}
+	}
 
-			count++;
-			loc++;
+	if (-1 == loc) {
+		loc = oah_probe(hash_map, hash_map->entry, hash_map->control, hash_map->map_size, hash, key, NULL);
+	}
 
-			if (loc >= hash_map->map_size) {
-				/* Perform wrapping */
-				loc = 0;
-			}
-		}
+	if (-1 == loc) {
+		return err_item_not_found;	/* key have not been found */
 	}
 
-	return err_item_not_found;	/* key have not been found */
+	(*location) = loc;
+	return err_ok;
 }
 
 ion_status_t
@@ -220,25 +528,40 @@ oah_delete(
 	ion_hashmap_t	*hash_map,
 	ion_key_t		key
 ) {
-	int loc = -1;
+	ion_hash_t	hash;
+	int			loc = -1;
 
-	if (oah_find_item_loc(hash_map, key, &loc) == err_item_not_found) {
-#if ION_DEBUG
-		printf("Item not found when trying to oah_delete.\n");
-#endif
-		return ION_STATUS_ERROR(err_item_not_found);
+	oah_rehash_step(hash_map, hash_map->rehash_step);
+
+	hash = hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);
+
+	if (NULL != hash_map->old_entry) {
+		loc = oah_probe(hash_map, hash_map->old_entry, hash_map->old_control, hash_map->old_map_size, hash, key, NULL);
 	}
-	else {
-		/* locate item */
-		ion_hash_bucket_t *item = (((ion_hash_bucket_t *) ((hash_map->entry + (hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS)) * loc))));
 
-		item->status = ION_DELETED;	/* delete item */
+	if (-1 != loc) {
+		/* Deleted buckets in the old table go away when it is freed. */
+		oah_bucket(hash_map, hash_map->old_entry, loc)->status	= ION_DELETED;
+		hash_map->old_control[loc]								= ION_OAH_CONTROL_DELETED;
+	}
+	else {
+		loc = oah_probe(hash_map, hash_map->entry, hash_map->control, hash_map->map_size, hash, key, NULL);
 
+		if (-1 == loc) {
 #if ION_DEBUG
-		printf("Item deleted at location %d\n", loc);
+			printf("Item not found when trying to oah_delete.\n");
 #endif
-		return ION_STATUS_OK(1);
+			return ION_STATUS_ERROR(err_item_not_found);
+		}
+
+		oah_bucket(hash_map, hash_map->entry, loc)->status	= ION_DELETED;	/* delete item */
+		hash_map->control[loc]								= ION_OAH_CONTROL_DELETED;
+		hash_map->num_deleted++;
 	}
+
+	hash_map->num_items--;
+
+	return ION_STATUS_OK(1);
 }
 
 ion_status_t
@@ -247,16 +570,27 @@ oah_query(
 	ion_key_t		key,
 	ion_value_t		value
 ) {
-	int loc;
+	ion_hash_bucket_t	*item	= NULL;
+	ion_hash_t			hash	= hash_map->compute_hash(hash_map, key, hash_map->super.record.key_size);
+	int					loc		= -1;
 
-	if (oah_find_item_loc(hash_map, key, &loc) == err_ok) {
-#if ION_DEBUG
-		printf("Item found at location %d\n", loc);
-#endif
+	if (NULL != hash_map->old_entry) {
+		loc = oah_probe(hash_map, hash_map->old_entry, hash_map->old_control, hash_map->old_map_size, hash, key, NULL);
 
-		int					data_length = hash_map->super.record.key_size + hash_map->super.record.value_size;
-		ion_hash_bucket_t	*item		= (((ion_hash_bucket_t *) ((hash_map->entry + (data_length + SIZEOF(STATUS)) * loc))));
+		if (-1 != loc) {
+			item = oah_bucket(hash_map, hash_map->old_entry, loc);
+		}
+	}
 
+	if (NULL == item) {
+		loc = oah_probe(hash_map, hash_map->entry, hash_map->control, hash_map->map_size, hash, key, NULL);
+
+		if (-1 != loc) {
+			item = oah_bucket(hash_map, hash_map->entry, loc);
+		}
+	}
+
+	if (NULL != item) {
 		/* *value				   = malloc(sizeof(char) * (hash_map->super.record.value_size)); */
 		memcpy(value, (item->data + hash_map->super.record.key_size), hash_map->super.record.value_size);
 		return ION_STATUS_OK(1);
@@ -325,3 +659,13 @@ oah_compute_simple_hash(
 
 	return hash;
 }
+
+ion_hash_t
+oah_compute_hash(
+	ion_hashmap_t		*hashmap,
+	ion_key_t		key,
+	int				size_of_key
+) {
+	/* Drop the top bit so the hash stays a valid, non-negative ion_hash_t. */
+	return (ion_hash_t) (dictionary_hash_key(key, hashmap->super.key_type, size_of_key) & INT_MAX);
+}
@@ -31,6 +31,49 @@ extern "C" {
 #define ION_IN_USE	-3
 #define SIZEOF(STATUS) 1
 
+/**
+@brief		The load factor, as a percentage, at which dictionaries created
+			through the handler start to grow.
+*/
+#define ION_OAH_DEFAULT_LOAD_FACTOR 75
+
+/**
+@brief		The fewest buckets of the old table each insert or delete moves
+			while an incremental rehash is running.
+@details	A rehash that would not finish at this rate before the map
+			next passes its load factor moves more buckets at a time.
+*/
+#define ION_OAH_REHASH_STEP 4
+
+/**
+@brief		The control byte of a slot that has never been used.
+@details	Each slot has a control byte, kept apart from the buckets so that
+			a probe reads a run of them before it compares any key. A used
+			slot holds seven bits of the hash of its key, as given by
+			@ref ION_OAH_CONTROL_HASH. Free slots have the top bit set.
+*/
+#define ION_OAH_CONTROL_EMPTY	0x80
+
+/**
+@brief		The control byte of a slot whose record was deleted.
+*/
+#define ION_OAH_CONTROL_DELETED 0xFE
+
+/**
+@brief		The control byte of a used slot, taken from the top bits of the
+			hash, which the location does not use.
+*/
+#define ION_OAH_CONTROL_HASH(hash) ((ion_byte_t) (((unsigned int) (hash) >> (sizeof(ion_hash_t) * 8 - 8)) & 0x7F))
+
+/**
+@brief		How many control bytes a probe checks at once.
+*/
+#if defined(__SSE2__)
+#define ION_OAH_GROUP_SIZE 16
+#else
+#define ION_OAH_GROUP_SIZE 1
+#endif
+
 /**
 @brief		Prototype declaration for hashmap
 */
@@ -54,6 +97,26 @@ struct hashmap {
 	/**< The hashing function to be used for
 		 the instance*/
 	char *entry;/**< Pointer to the entries in the hashmap*/
+	ion_byte_t				*control;		/**< One control byte for each
+											 bucket in @p entry */
+	char					*old_entry;		/**< The table being rehashed into
+											 @p entry, or NULL */
+	ion_byte_t				*old_control;	/**< The control bytes of
+											 @p old_entry */
+	int						old_map_size;	/**< The size of @p old_entry in
+											 item capacity */
+	int						rehash_index;	/**< The next bucket of
+											 @p old_entry to move */
+	int						rehash_step;	/**< The buckets of
+											 @p old_entry each insert or
+											 delete moves */
+	int						num_items;		/**< The number of records held
+											 across both tables */
+	int						num_deleted;	/**< The number of deleted
+											 buckets in @p entry */
+	int						load_factor;	/**< The percentage of used
+											 buckets at which the map grows,
+											 or 0 for a fixed size */
 };
 
 /**
@@ -73,6 +136,8 @@ struct hashmap {
 				The size of the hashmap in item
 				(@p key_size + @p value_size + @c 1)
 @return		The status describing the result of the initialization.
+			The map keeps this size until @ref oah_set_load_factor turns on
+			growth.
 */
 ion_err_t
 oah_initialize(
@@ -84,6 +149,63 @@ oah_initialize(
 	int size
 );
 
+/**
+@brief		Sets the load factor at which the map grows.
+@details	Once the used and deleted buckets pass @p load_factor percent of
+			the map, the next insert allocates a new table and starts an
+			incremental rehash. The new table doubles the size, unless most
+			of the used buckets are deletions, in which case it keeps the
+			size and only clears them. Each insert and delete then moves
+			at least @ref ION_OAH_REHASH_STEP buckets across, leaving
+			deleted buckets behind, and enough that the rehash is done
+			before the map can pass its load factor again. Growing needs a hash that does not depend on the map
+			size, such as @ref oah_compute_hash.
+@param		hash_map
+				The map to configure.
+@param		load_factor
+				The percentage from @c 1 to @c 100, or @c 0 to keep the map
+				at a fixed size.
+@return		The status of the operation. @c err_out_of_bounds for a bad
+			percentage, and @c err_illegal_state if the map hashes with
+			@ref oah_compute_simple_hash.
+*/
+ion_err_t
+oah_set_load_factor(
+	ion_hashmap_t	*hash_map,
+	int				load_factor
+);
+
+/**
+@brief		Finishes any incremental rehash that is running.
+@details	This moves every bucket left in the old table at once, so it
+			pauses for as long as the old table is big. The map itself never
+			calls it: lookups search both tables, cursors walk both, and a
+			rehash is always done before the next one starts.
+@param		hash_map
+				The map to rehash.
+*/
+void
+oah_finish_rehash(
+	ion_hashmap_t *hash_map
+);
+
+/**
+@brief		Finds a bucket by its index across both tables, for cursors.
+@details	Indexes below @c map_size are buckets of @c entry. While a
+			rehash is running, the @c old_map_size indexes after them are
+			the buckets of @c old_entry.
+@param		hash_map
+				The map that holds the bucket.
+@param		index
+				The index of the bucket.
+@return		The bucket.
+*/
+ion_hash_bucket_t *
+oah_bucket_at(
+	ion_hashmap_t	*hash_map,
+	int				index
+);
+
 /**
 @brief		Destroys the map in memory
 
@@ -107,7 +229,8 @@ oah_destroy(
 @param		num
 				The key.
 @param		size
-				The possible number of buckets in the map.
+				The possible number of buckets in the map. A power of two
+				size masks the low bits of @p num instead of dividing.
 @return		The index position to start probing at.
 */
 int
@@ -166,7 +289,9 @@ oah_update(
 /**
 @brief	  Locates item in map.
 
-@details	Based on a key, function locates the record in the map.
+@details	Based on a key, function locates the record in the map. While
+			a rehash is running a record still in the old table is moved
+			into @c entry first, so the location is always in @c entry.
 
 @param		hash_map
 				The map into which the data is going to be inserted.
@@ -240,6 +365,26 @@ oah_compute_simple_hash(
 	int				size_of_key
 );
 
+/**
+@brief		Hashes the whole key according to the key type of the map.
+@details	Uses @ref dictionary_hash_key, so sequential integers and keys
+			that share a prefix do not pile up in one run of buckets. This
+			is the hash the dictionary handler binds.
+@param		hashmap
+				The hash function is associated with.
+@param		key
+				The original key value to find hash value for.
+@param		size_of_key
+				The size of the key in bytes.
+@return		The non-negative hashed value for the key.
+*/
+ion_hash_t
+oah_compute_hash(
+	ion_hashmap_t	*hashmap,
+	ion_key_t		key,
+	int				size_of_key
+);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -61,16 +61,30 @@ oadict_scan(
 	/* need to scan hashmap fully looking for values that satisfy - need to think about */
 	ion_hashmap_t *hash_map = (ion_hashmap_t *) (cursor->super.dictionary->instance);
 
-	int loc					= (cursor->current + 1) % hash_map->map_size;
+	int loc					= cursor->current + 1;
+
+	/* Range and all records cursors walk the old table too, after the current one, while a rehash runs. */
+	int end					= cursor->first < 0 ? hash_map->map_size + hash_map->old_map_size : hash_map->map_size;
 
 	/* this is the current position of the cursor */
 	/* and start scanning 1 ahead */
 
 	/* start at the current position, scan forward */
 	while (loc != cursor->first) {
+		if (loc >= end) {
+			/* Range and all records cursors start at the first bucket, so they end here instead of wrapping. */
+			if (cursor->first < 0) {
+				break;
+			}
+
+			/* Perform wrapping */
+			loc = 0;
+			continue;
+		}
+
 		/* check to see if current item is a match based on key */
 		/* locate first item */
-		ion_hash_bucket_t *item = (((ion_hash_bucket_t *) ((hash_map->entry + (hash_map->super.record.key_size + hash_map->super.record.value_size + SIZEOF(STATUS)) * loc))));
+		ion_hash_bucket_t *item = oah_bucket_at(hash_map, loc);
 
 		if ((item->status == ION_EMPTY) || (item->status == ION_DELETED)) {
 			/* if empty, just skip to next cell */
@@ -91,11 +105,6 @@ oadict_scan(
 			/* If valid bucket is not found, advance current position. */
 			loc++;
 		}
-
-		if (loc >= hash_map->map_size) {
-			/* Perform wrapping */
-			loc = 0;
-		}
 	}
 
 	/* if you end up here, you've wrapped the entire data structure and not found a value */
@@ -126,6 +135,11 @@ oadict_find(
 	ion_predicate_t		*predicate,
 	ion_dict_cursor_t	**cursor
 ) {
+	/* hashing keeps no key order to scan in reverse */
+	if (dictionary_predicate_is_descending(predicate)) {
+		return err_not_implemented;
+	}
+
 	/* allocate memory for cursor */
 	if ((*cursor = malloc(sizeof(ion_oadict_cursor_t))) == NULL) {
 		return err_out_of_memory;
@@ -202,11 +216,10 @@ oadict_find(
 			/* copy across the key value as the predicate may be destroyed */
 			memcpy((*cursor)->predicate->statement.range.upper_bound, predicate->statement.range.upper_bound, (((ion_hashmap_t *) dictionary->instance)->super.record.key_size));
 
-			ion_oadict_cursor_t *oadict_cursor	= (ion_oadict_cursor_t *) (*cursor);
-			ion_hashmap_t		*hash_map		= ((ion_hashmap_t *) dictionary->instance);
+			ion_oadict_cursor_t *oadict_cursor = (ion_oadict_cursor_t *) (*cursor);
 
 			(*cursor)->status		= cs_cursor_initialized;
-			oadict_cursor->first	= (hash_map->map_size) - 1;
+			oadict_cursor->first	= -1;
 			oadict_cursor->current	= -1;
 
 			ion_err_t err = oadict_scan(oadict_cursor);
@@ -220,11 +233,10 @@ oadict_find(
 		}
 
 		case predicate_all_records: {
-			ion_oadict_cursor_t *oadict_cursor	= (ion_oadict_cursor_t *) (*cursor);
-			ion_hashmap_t		*hash_map		= ((ion_hashmap_t *) dictionary->instance);
+			ion_oadict_cursor_t *oadict_cursor = (ion_oadict_cursor_t *) (*cursor);
 
 			(*cursor)->status		= cs_cursor_initialized;
-			oadict_cursor->first	= (hash_map->map_size) - 1;
+			oadict_cursor->first	= -1;
 			oadict_cursor->current	= -1;
 
 			ion_err_t err = oadict_scan(oadict_cursor);
@@ -307,6 +319,7 @@ oadict_init(
 	handler->remove				= oadict_delete;
 	handler->delete_dictionary	= oadict_delete_dictionary;
 	handler->close_dictionary	= oadict_close_dictionary;
+	handler->flush_dictionary	= NULL;
 	handler->open_dictionary	= oadict_open_dictionary;
 }
 
@@ -337,7 +350,8 @@ oadict_create_dictionary(
 	dictionary->instance->compare	= compare;
 
 	/* this registers the dictionary the dictionary */
-	oah_initialize((ion_hashmap_t *) dictionary->instance, oah_compute_simple_hash, key_type, key_size, value_size, dictionary_size);	/* just pick an arbitary size for testing atm */
+	oah_initialize((ion_hashmap_t *) dictionary->instance, oah_compute_hash, key_type, key_size, value_size, dictionary_size);	/* just pick an arbitary size for testing atm */
+	oah_set_load_factor((ion_hashmap_t *) dictionary->instance, ION_OAH_DEFAULT_LOAD_FACTOR);
 
 	/*TODO The correct comparison operator needs to be bound at run time
 	 * based on the type of key defined
@@ -398,8 +412,6 @@ oadict_next(
 		ion_hashmap_t *hash_map = ((ion_hashmap_t *) cursor->dictionary->instance);
 
 		/* assume that the value has been pre-allocated */
-		/* compute length of data record stored in map */
-		int data_length = hash_map->super.record.key_size + hash_map->super.record.value_size;
 
 		if (cursor->status == cs_cursor_active) {
 			/* find the next valid entry */
@@ -418,7 +430,7 @@ oadict_next(
 		}
 
 		/* the results are now ready //reference item at given position */
-		ion_hash_bucket_t *item = (((ion_hash_bucket_t *) ((hash_map->entry + (data_length + SIZEOF(STATUS)) * oadict_cursor->current /*idx*/))));
+		ion_hash_bucket_t *item = oah_bucket_at(hash_map, oadict_cursor->current);
 
 		/*@todo A discussion needs to be had regarding ion_record_t and its format in memory etc */
 		/* and copy key and value in */
@@ -317,6 +317,56 @@ sl_find_node(
 	return cursor;
 }
 
+ion_sl_node_t *
+sl_find_last_node(
+	ion_skiplist_t	*skiplist,
+	ion_key_t		key
+) {
+	int				key_size	= skiplist->super.record.key_size;
+	ion_sl_node_t	*cursor		= skiplist->head;
+	ion_sl_level_t	h;
+
+	for (h = skiplist->head->height; h >= 0; h--) {
+		while (NULL != cursor->next[h] && (NULL == key || skiplist->super.compare(cursor->next[h]->key, key, key_size) <= 0)) {
+			cursor = cursor->next[h];
+		}
+	}
+
+	/* The head holds no data, so nothing was found */
+	if (skiplist->head == cursor) {
+		return NULL;
+	}
+
+	return cursor;
+}
+
+ion_sl_node_t *
+sl_find_prev_node(
+	ion_skiplist_t	*skiplist,
+	ion_sl_node_t	*node
+) {
+	int				key_size	= skiplist->super.record.key_size;
+	ion_sl_node_t	*cursor		= skiplist->head;
+	ion_sl_level_t	h;
+
+	for (h = skiplist->head->height; h >= 0; h--) {
+		while (NULL != cursor->next[h] && skiplist->super.compare(cursor->next[h]->key, node->key, key_size) < 0) {
+			cursor = cursor->next[h];
+		}
+	}
+
+	/* Step through any duplicates of the key before node */
+	while (NULL != cursor->next[0] && cursor->next[0] != node) {
+		cursor = cursor->next[0];
+	}
+
+	if (skiplist->head == cursor) {
+		return NULL;
+	}
+
+	return cursor;
+}
+
 ion_sl_level_t
 sl_gen_level(
 	ion_skiplist_t *skiplist
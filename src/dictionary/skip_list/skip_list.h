@@ -160,6 +160,46 @@ sl_find_node(
 	ion_key_t		key
 );
 
+/**
+@brief	  Searches for the last node with a key less than or equal to the
+			given @p key.
+
+@details	Unlike sl_find_node, this does not stop at the first node
+			containing @p key, so it returns the last of a block of
+			duplicates. Used to start descending cursors.
+
+@param	  skiplist
+				The skiplist to search
+@param	  key
+				The key to search for, or @c NULL to find the last node
+@return	 The node found, or @c NULL if every key is greater than @p key.
+*/
+ion_sl_node_t *
+sl_find_last_node(
+	ion_skiplist_t	*skiplist,
+	ion_key_t		key
+);
+
+/**
+@brief	  Finds the node before the given @p node on the bottom level.
+
+@details	Nodes only link forward, so this searches down from the top
+			for the last node with a smaller key, then walks the bottom
+			level through any duplicates to @p node. This costs a search
+			per step, but needs no back links in the nodes.
+
+@param	  skiplist
+				The skiplist holding @p node
+@param	  node
+				The node to find the predecessor of
+@return	 The previous node, or @c NULL if @p node is the first.
+*/
+ion_sl_node_t *
+sl_find_prev_node(
+	ion_skiplist_t	*skiplist,
+	ion_sl_node_t	*node
+);
+
 /**
 @brief	  Iterates through each level of a skiplist and prints out the content
 			of each node in a meaningful way. Intended for debug use only.
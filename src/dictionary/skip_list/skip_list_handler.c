@@ -78,7 +78,13 @@ sldict_next(
 		memcpy(record->key, sl_cursor->current->key, cursor->dictionary->instance->record.key_size);
 		memcpy(record->value, sl_cursor->current->value, cursor->dictionary->instance->record.value_size);
 
-		sl_cursor->current = sl_cursor->current->next[0];
+		if (dictionary_predicate_is_descending(cursor->predicate)) {
+			sl_cursor->current = sl_find_prev_node((ion_skiplist_t *) cursor->dictionary->instance, sl_cursor->current);
+		}
+		else {
+			sl_cursor->current = sl_cursor->current->next[0];
+		}
+
 		return cursor->status;
 	}
 
@@ -223,6 +229,22 @@ sldict_find(
 			}
 
 			memcpy((*cursor)->predicate->statement.range.upper_bound, predicate->statement.range.upper_bound, key_size);
+			(*cursor)->predicate->statement.range.descending = predicate->statement.range.descending;
+
+			if (predicate->statement.range.descending) {
+				/* Start at the last node within the upper bound, and walk back to the lower bound. */
+				ion_sl_node_t *last = sl_find_last_node(skip_list, (*cursor)->predicate->statement.range.upper_bound);
+
+				if ((NULL == last) || (dictionary->instance->compare(last->key, (*cursor)->predicate->statement.range.lower_bound, key_size) < 0)) {
+					(*cursor)->status = cs_end_of_results;
+				}
+				else {
+					((ion_sldict_cursor_t *) (*cursor))->current	= last;
+					(*cursor)->status								= cs_cursor_initialized;
+				}
+
+				return err_ok;
+			}
 
 			/* Try to find the node containing the upper bound. */
 			ion_sl_node_t *loc = sl_find_node((ion_skiplist_t *) dictionary->instance, (*cursor)->predicate->statement.range.upper_bound);
@@ -266,11 +288,13 @@ sldict_find(
 		case predicate_all_records: {
 			ion_sldict_cursor_t *sl_cursor = (ion_sldict_cursor_t *) (*cursor);
 
+			(*cursor)->predicate->statement.all_records.descending = predicate->statement.all_records.descending;
+
 			if (NULL == skip_list->head->next[0]) {
 				(*cursor)->status = cs_end_of_results;
 			}
 			else {
-				sl_cursor->current	= skip_list->head->next[0];
+				sl_cursor->current	= predicate->statement.all_records.descending ? sl_find_last_node(skip_list, NULL) : skip_list->head->next[0];
 				(*cursor)->status	= cs_cursor_initialized;
 			}
 
@@ -333,6 +357,7 @@ sldict_init(
 	handler->update				= sldict_update;
 	handler->find				= sldict_find;
 	handler->close_dictionary	= sldict_close_dictionary;
+	handler->flush_dictionary	= NULL;
 	handler->open_dictionary	= sldict_open_dictionary;
 }
 
@@ -53,6 +53,27 @@ ion_fclose(
 #endif
 }
 
+ion_err_t
+ion_fflush(
+	ion_file_handle_t file
+) {
+#if defined(ARDUINO)
+
+	if (0 != fflush(file.file)) {
+		return err_file_write_error;
+	}
+
+	return err_ok;
+#else
+
+	if (0 != fflush(file)) {
+		return err_file_write_error;
+	}
+
+	return err_ok;
+#endif
+}
+
 ion_err_t
 ion_fremove(
 	char *name
@@ -69,6 +90,68 @@ ion_fremove(
 	}
 }
 
+ion_err_t
+ion_frename(
+	char	*old_name,
+	char	*new_name
+) {
+#if defined(ARDUINO)
+
+	/* SD has no rename, so copy the contents across and drop the original. */
+	ion_file_handle_t	from;
+	ion_file_handle_t	to;
+	ion_file_offset_t	offset;
+	ion_file_offset_t	end;
+	ion_byte_t			buffer[32];
+	unsigned int		num_bytes;
+	ion_err_t			error;
+
+	if (ion_fexists(new_name) && (err_ok != ion_fremove(new_name))) {
+		return err_file_rename_error;
+	}
+
+	from	= ion_fopen(old_name);
+	to		= ion_fopen(new_name);
+
+	if ((NULL == from.file) || (NULL == to.file)) {
+		return err_file_rename_error;
+	}
+
+	end		= ion_fend(from);
+	error	= err_ok;
+
+	for (offset = 0; (err_ok == error) && (offset < end); offset += num_bytes) {
+		num_bytes = sizeof(buffer);
+
+		if (end - offset < (ion_file_offset_t) num_bytes) {
+			num_bytes = end - offset;
+		}
+
+		error = ion_fread_at(from, offset, num_bytes, buffer);
+
+		if (err_ok == error) {
+			error = ion_fwrite_at(to, offset, num_bytes, buffer);
+		}
+	}
+
+	ion_fclose(from);
+	ion_fclose(to);
+
+	if ((err_ok != error) || (err_ok != ion_fremove(old_name))) {
+		return err_file_rename_error;
+	}
+
+	return err_ok;
+#else
+
+	if (0 != rename(old_name, new_name)) {
+		return err_file_rename_error;
+	}
+
+	return err_ok;
+#endif
+}
+
 ion_err_t
 ion_fseek(
 	ion_file_handle_t	file,
@@ -132,7 +215,11 @@ ion_fwrite(
 
 	return err_ok;
 #else
-	fwrite(to_write, num_bytes, 1, file);
+
+	if (num_bytes != (fwrite(to_write, num_bytes, 1, file) * num_bytes)) {
+		return err_file_incomplete_write;
+	}
+
 	return err_ok;
 #endif
 }
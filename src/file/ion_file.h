@@ -61,11 +61,22 @@ ion_fclose(
 	ion_file_handle_t file
 );
 
+ion_err_t
+ion_fflush(
+	ion_file_handle_t file
+);
+
 ion_err_t
 ion_fremove(
 	char *name
 );
 
+ion_err_t
+ion_frename(
+	char	*old_name,
+	char	*new_name
+);
+
 ion_err_t
 ion_fseek(
 	ion_file_handle_t	file,
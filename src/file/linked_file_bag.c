@@ -28,47 +28,275 @@
 #define ION_NULL ((void *) 0)
 #endif
 
-ion_err_t
-lfb_put(
+/**
+@brief		The number of bytes used by the header at the start of a bag file.
+*/
+#define ION_LFB_HEADER_SIZE (sizeof(long) + ION_LFB_SIZE_CLASSES * sizeof(ion_lfb_free_list_t))
+
+/**
+@brief		Write the free lists of a bag back to the header of its file.
+@param		bag
+				A pointer to the linked file bag handler whose free lists
+				are to be written.
+@returns	An error code describing the result of the call.
+*/
+static ion_err_t
+lfb_write_free_lists(
+	ion_lfb_t *bag
+) {
+	return ion_fwrite_at(bag->file_handle, sizeof(long), sizeof(bag->free_lists), (ion_byte_t *) bag->free_lists);
+}
+
+/**
+@brief		Find a free list with a record that can hold @p num_bytes.
+@details	A list of records of exactly @p num_bytes is preferred, then the
+			list of the smallest records large enough.
+@param		bag
+				A pointer to the linked file bag handler to search.
+@param		num_bytes
+				The number of bytes that need to be stored.
+@returns	The free list to take a record from, or @c NULL if there is none.
+*/
+static ion_lfb_free_list_t *
+lfb_find_reusable(
+	ion_lfb_t		*bag,
+	unsigned int	num_bytes
+) {
+	ion_lfb_free_list_t *best;
+	int					i;
+
+	best = ION_NULL;
+
+	for (i = 0; i < ION_LFB_SIZE_CLASSES; i++) {
+		ion_lfb_free_list_t *list = &bag->free_lists[i];
+
+		if ((ION_LFB_NULL == list->head) || (list->num_bytes < num_bytes)) {
+			continue;
+		}
+
+		if (list->num_bytes == num_bytes) {
+			return list;
+		}
+
+		if ((ION_NULL == best) || (list->num_bytes < best->num_bytes)) {
+			best = list;
+		}
+	}
+
+	return best;
+}
+
+/**
+@brief		Find the free list that a deleted record of @p num_bytes joins.
+@details	Records are kept with others of the same size. If no list has
+			that size, an empty list is given to it, otherwise the record
+			joins the list of the largest records smaller than itself, as
+			it can always hold those.
+@param		bag
+				A pointer to the linked file bag handler to search.
+@param		num_bytes
+				The number of bytes the deleted record holds.
+@returns	The free list to add the record to, or @c NULL if there is none.
+*/
+static ion_lfb_free_list_t *
+lfb_find_free_list(
+	ion_lfb_t		*bag,
+	unsigned int	num_bytes
+) {
+	ion_lfb_free_list_t *empty;
+	ion_lfb_free_list_t *smaller;
+	int					i;
+
+	empty	= ION_NULL;
+	smaller = ION_NULL;
+
+	for (i = 0; i < ION_LFB_SIZE_CLASSES; i++) {
+		ion_lfb_free_list_t *list = &bag->free_lists[i];
+
+		if (list->num_bytes == num_bytes) {
+			return list;
+		}
+
+		if (ION_LFB_NULL == list->head) {
+			if (ION_NULL == empty) {
+				empty = list;
+			}
+		}
+		else if ((list->num_bytes < num_bytes) && ((ION_NULL == smaller) || (list->num_bytes > smaller->num_bytes))) {
+			smaller = list;
+		}
+	}
+
+	if (ION_NULL != empty) {
+		empty->num_bytes = num_bytes;
+		return empty;
+	}
+
+	return smaller;
+}
+
+/**
+@brief		Add a record to the free list for its size, without writing the
+			free lists back to the file.
+@param		bag
+				A pointer to the linked file bag handler to free the record in.
+@param		offset
+				The offset of the record being freed.
+@param		num_bytes
+				The number of bytes the record holds.
+@returns	An error code describing the result of the call.
+*/
+static ion_err_t
+lfb_free(
+	ion_lfb_t			*bag,
+	ion_file_offset_t	offset,
+	unsigned int		num_bytes
+) {
+	ion_lfb_free_list_t *list;
+	ion_err_t			error;
+
+	list = lfb_find_free_list(bag, num_bytes);
+
+	if (ION_NULL == list) {
+		/* Every list holds larger records, so this one is left unused. */
+		return err_ok;
+	}
+
+	error = lfb_update_next(bag, offset, list->head);
+
+	if (err_ok == error) {
+		list->head = offset;
+	}
+
+	return error;
+}
+
+/**
+@brief		Write a record, its next offset followed by its data, at
+			@p offset.
+@param		bag
+				A pointer to the linked file bag handler to write to.
+@param		offset
+				The offset to write the record at.
+@param		to_write
+				A pointer to the buffer of data to write.
+@param		num_bytes
+				The number of bytes to write from the start of @p to_write.
+@param		next
+				The offset of the next item in the bag.
+@returns	An error code describing the result of the call.
+*/
+static ion_err_t
+lfb_write_record(
 	ion_lfb_t			*bag,
+	ion_file_offset_t	offset,
 	ion_byte_t			*to_write,
 	unsigned int		num_bytes,
-	ion_file_offset_t	next,
-	ion_file_offset_t	*wrote_at
+	ion_file_offset_t	next
 ) {
-	ion_file_offset_t	next_empty;
-	ion_err_t			error;
+	ion_err_t error;
 
-	next_empty = ION_LFB_NULL;
+	error = ion_fwrite_at(bag->file_handle, offset, sizeof(ion_file_offset_t), (ion_byte_t *) &next);
 
-	if (ION_LFB_NULL != bag->next_empty) {
-		error = ion_fread_at(bag->file_handle, bag->next_empty, sizeof(ion_file_offset_t), (ion_byte_t *) &next_empty);
+	if (err_ok != error) {
+		return error;
+	}
+
+	return ion_fwrite_at(bag->file_handle, offset + sizeof(ion_file_offset_t), num_bytes, to_write);
+}
+
+ion_err_t
+lfb_initialize(
+	ion_lfb_t			*bag,
+	ion_file_handle_t	file_handle
+) {
+	long		magic;
+	ion_err_t	error;
+	int			i;
+
+	bag->file_handle = file_handle;
+
+	if (0 == ion_fend(file_handle)) {
+		for (i = 0; i < ION_LFB_SIZE_CLASSES; i++) {
+			bag->free_lists[i].num_bytes	= 0;
+			bag->free_lists[i].head			= ION_LFB_NULL;
+		}
+
+		magic	= ION_LFB_MAGIC;
+		error	= ion_fwrite_at(file_handle, 0, sizeof(magic), (ion_byte_t *) &magic);
 
 		if (err_ok != error) {
 			return error;
 		}
 
-		*wrote_at = bag->next_empty;
+		return lfb_write_free_lists(bag);
 	}
-	else {
-		*wrote_at = ion_fend(bag->file_handle);
+
+	error = ion_fread_at(file_handle, 0, sizeof(magic), (ion_byte_t *) &magic);
+
+	if (err_ok != error) {
+		return error;
 	}
 
-	error = ion_fwrite_at(bag->file_handle, *wrote_at, sizeof(ion_file_offset_t), (ion_byte_t *) &next);
+	if (ION_LFB_MAGIC != magic) {
+		return err_illegal_state;
+	}
+
+	return ion_fread_at(file_handle, sizeof(magic), sizeof(bag->free_lists), (ion_byte_t *) bag->free_lists);
+}
+
+ion_err_t
+lfb_put(
+	ion_lfb_t			*bag,
+	ion_byte_t			*to_write,
+	unsigned int		num_bytes,
+	ion_file_offset_t	next,
+	ion_file_offset_t	*wrote_at
+) {
+	ion_lfb_free_list_t *list;
+	ion_file_offset_t	next_empty;
+	ion_err_t			error;
+
+	list = lfb_find_reusable(bag, num_bytes);
+
+	if (ION_NULL == list) {
+		return lfb_append(bag, to_write, num_bytes, next, wrote_at);
+	}
+
+	error = ion_fread_at(bag->file_handle, list->head, sizeof(ion_file_offset_t), (ion_byte_t *) &next_empty);
 
 	if (err_ok != error) {
 		return error;
 	}
 
-	error = ion_fwrite_at(bag->file_handle, *wrote_at + sizeof(ion_file_offset_t), num_bytes, to_write);
+	*wrote_at	= list->head;
+	list->head	= next_empty;
+
+	/* Unlink the record on disk before it is written over. */
+	error		= lfb_write_free_lists(bag);
 
 	if (err_ok != error) {
 		return error;
 	}
 
-	bag->next_empty = next_empty;
+	return lfb_write_record(bag, *wrote_at, to_write, num_bytes, next);
+}
 
-	return err_ok;
+ion_err_t
+lfb_append(
+	ion_lfb_t			*bag,
+	ion_byte_t			*to_write,
+	unsigned int		num_bytes,
+	ion_file_offset_t	next,
+	ion_file_offset_t	*wrote_at
+) {
+	*wrote_at = ion_fend(bag->file_handle);
+
+	if (*wrote_at < (ion_file_offset_t) ION_LFB_HEADER_SIZE) {
+		*wrote_at = ION_LFB_HEADER_SIZE;
+	}
+
+	return lfb_write_record(bag, *wrote_at, to_write, num_bytes, next);
 }
 
 ion_err_t
@@ -92,47 +320,134 @@ lfb_get(
 	return error;
 }
 
-/**
-@brief		Update the next offset for the record stored at @p offset.
-@param		bag
-				A pointer to the initialized handler for the linked file
-				bag we wish to update.
-@param		offset
-				The offset of the record to set the next offset of.
-@param		next
-				The offset of the record to be referenced in the record
-				stored starting at @p offset.
-@returns	An error code describing the result of the call.
-*/
+ion_err_t
+lfb_get_buffered(
+	ion_lfb_t			*bag,
+	ion_lfb_window_t	*window,
+	ion_file_offset_t	offset,
+	unsigned int		num_bytes,
+	ion_byte_t			*write_to,
+	ion_file_offset_t	*next
+) {
+	unsigned int		record_size;
+	unsigned int		length;
+	ion_file_offset_t	start;
+	ion_file_offset_t	end;
+	ion_err_t			error;
+
+	record_size = sizeof(ion_file_offset_t) + num_bytes;
+
+	if ((0 == window->num_bytes) || (offset < window->offset) || (offset + record_size > window->offset + window->num_bytes)) {
+		length = record_size;
+
+		if ((window->num_bytes > 0) && (offset == window->offset + window->num_bytes)) {
+			/* Reading on in order, so read ahead further this time. */
+			length = 2 * window->num_bytes;
+
+			if (length > window->size) {
+				length = window->size;
+			}
+
+			end = ion_fend(bag->file_handle);
+
+			if (end - offset < (ion_file_offset_t) length) {
+				length = end - offset;
+			}
+
+			if (length < record_size) {
+				length = record_size;
+			}
+		}
+
+		start = offset;
+
+		if ((window->num_bytes > 0) && (offset + record_size == window->offset)) {
+			/* Reading back in order, so read further back this time. */
+			length = 2 * window->num_bytes;
+
+			if (length > window->size) {
+				length = window->size;
+			}
+
+			if (offset + record_size < (ion_file_offset_t) length) {
+				length = offset + record_size;
+			}
+
+			start = offset + record_size - length;
+		}
+
+		window->num_bytes	= 0;
+		error				= ion_fread_at(bag->file_handle, start, length, window->buffer);
+
+		if (err_ok != error) {
+			return error;
+		}
+
+		window->offset		= start;
+		window->num_bytes	= length;
+	}
+
+	memcpy(next, window->buffer + (offset - window->offset), sizeof(ion_file_offset_t));
+	memcpy(write_to, window->buffer + (offset - window->offset) + sizeof(ion_file_offset_t), num_bytes);
+
+	return err_ok;
+}
+
 ion_err_t
 lfb_update_next(
 	ion_lfb_t			*bag,
 	ion_file_offset_t	offset,
 	ion_file_offset_t	next
+) {
+	return ion_fwrite_at(bag->file_handle, offset, sizeof(ion_file_offset_t), (ion_byte_t *) &(next));
+}
+
+ion_err_t
+lfb_delete(
+	ion_lfb_t			*bag,
+	ion_file_offset_t	offset,
+	unsigned int		num_bytes
 ) {
 	ion_err_t error;
 
-	error = ion_fwrite_at(bag->file_handle, offset, sizeof(ion_file_offset_t), (ion_byte_t *) &(next));
+	error = lfb_free(bag, offset, num_bytes);
 
-	if (err_ok == error) {
-		bag->next_empty = offset;
+	if (err_ok != error) {
+		return error;
 	}
 
-	return error;
+	return lfb_write_free_lists(bag);
 }
 
 ion_err_t
-lfb_delete(
+lfb_delete_appended(
 	ion_lfb_t			*bag,
-	ion_file_offset_t	offset
+	ion_file_offset_t	end,
+	unsigned int		num_bytes
 ) {
-	return lfb_update_next(bag, offset, bag->next_empty);
+	ion_file_offset_t	offset;
+	ion_file_offset_t	file_end;
+	ion_err_t			error;
+
+	offset		= end < (ion_file_offset_t) ION_LFB_HEADER_SIZE ? (ion_file_offset_t) ION_LFB_HEADER_SIZE : end;
+	file_end	= ion_fend(bag->file_handle);
+
+	for (; offset + (ion_file_offset_t) (sizeof(ion_file_offset_t) + num_bytes) <= file_end; offset += sizeof(ion_file_offset_t) + num_bytes) {
+		error = lfb_free(bag, offset, num_bytes);
+
+		if (err_ok != error) {
+			return error;
+		}
+	}
+
+	return lfb_write_free_lists(bag);
 }
 
 ion_err_t
 lfb_delete_all(
 	ion_lfb_t			*bag,
 	ion_file_offset_t	offset,
+	unsigned int		num_bytes,
 	ion_result_count_t	*count
 ) {
 	ion_err_t			error;
@@ -145,7 +460,7 @@ lfb_delete_all(
 			return error;
 		}
 
-		error = lfb_delete(bag, offset);
+		error = lfb_free(bag, offset, num_bytes);
 
 		if (err_ok != error) {
 			return error;
@@ -158,7 +473,7 @@ lfb_delete_all(
 		offset = next;
 	}
 
-	return err_ok;
+	return lfb_write_free_lists(bag);
 }
 
 ion_err_t
@@ -36,16 +36,75 @@ extern "C" {
 
 #define ION_LFB_NULL ION_FILE_NULL
 
+/**
+@brief		Identifies a file holding a linked file bag.
+*/
+#define ION_LFB_MAGIC 0x4C464201L
+
+/**
+@brief		The number of free lists kept by a bag, each for one record size.
+*/
+#if !defined(ION_LFB_SIZE_CLASSES)
+#define ION_LFB_SIZE_CLASSES 4
+#endif
+
+/**
+@brief		A list of deleted records that can be written over.
+*/
+typedef struct lfb_free_list {
+	/**> The number of bytes every record in this list can hold, or @c 0
+		 if the list is not assigned to a size yet. */
+	unsigned int		num_bytes;
+	/**> The offset of the first record in this list, or @ref ION_LFB_NULL. */
+	ion_file_offset_t	head;
+} ion_lfb_free_list_t;
+
 /**
 @brief		A handler struct for a linked file bag instance.
+@details	The free lists are stored at the start of the file, after
+			@ref ION_LFB_MAGIC, so that deleted records are reused after the
+			bag is reopened.
 */
 typedef struct linkedfilebag {
 	/**> The file handle for the file where the data is stored. */
 	ion_file_handle_t	file_handle;
-	/**> The offset for the next empty slot to write to. */
-	ion_file_offset_t	next_empty;
+	/**> Deleted records, grouped by the number of bytes they can hold. */
+	ion_lfb_free_list_t free_lists[ION_LFB_SIZE_CLASSES];
 } ion_lfb_t;
 
+/**
+@brief		Bytes of a bag held in memory for @ref lfb_get_buffered.
+@details	The caller provides @p buffer and @p size, and sets @p num_bytes
+			to @c 0 before first use.
+*/
+typedef struct lfb_window {
+	/**> Memory holding bytes read from the bag. */
+	ion_byte_t			*buffer;
+	/**> The number of bytes @p buffer can hold. */
+	unsigned int		size;
+	/**> The offset in the file of the first byte of @p buffer. */
+	ion_file_offset_t	offset;
+	/**> The number of bytes of @p buffer holding data. */
+	unsigned int		num_bytes;
+} ion_lfb_window_t;
+
+/**
+@brief		Prepare a linked file bag for use on an opened file.
+@details	An empty file is given a new header. Otherwise, the free lists
+			are read back from the header written by a previous instance.
+@param		bag
+				A pointer to the linked file bag handler object to
+				initialize.
+@param		file_handle
+				The opened file that backs the bag.
+@returns	An error code describing the result of the call.
+*/
+ion_err_t
+lfb_initialize(
+	ion_lfb_t			*bag,
+	ion_file_handle_t	file_handle
+);
+
 /**
 @brief		Add an item to the linked file bag.
 @param		bag
@@ -74,13 +133,38 @@ lfb_put(
 );
 
 /**
-@brief
+@brief		Add an item to the end of the linked file bag.
+@details	Unlike @ref lfb_put, space freed by deletes is not reused, so
+			items added one after another are stored in that order.
+@param		bag
+				A pointer to the linked file bag handler object which
+				we wish to add this item to.
+@param		to_write
+				A pointer to the buffer of data to write.
+@param		num_bytes
+				The number of bytes to write from the start of @p to_write.
+@param		next
+				The offset of next item in this bag, if one exists (otherwise,
+				pass in @c -1).
+@param		wrote_at
+				A pointer to an already allocated file offset used to
+				write where the linked file bag actually wrote.
+@returns	An error code describing the result of the call.
 */
+ion_err_t
+lfb_append(
+	ion_lfb_t			*bag,
+	ion_byte_t			*to_write,
+	unsigned int		num_bytes,
+	ion_file_offset_t	next,
+	ion_file_offset_t	*wrote_at
+);
+
 /**
-@brief		Add an item to the linked file bag.
+@brief		Read an item from the linked file bag.
 @param		bag
 				A pointer to the linked file bag handler object which
-				we wish to add this item to.
+				we wish to read this item from.
 @param		offset
 				Where to read the information from within the file bag.
 @param		num_bytes
@@ -104,6 +188,45 @@ lfb_get(
 	ion_file_offset_t	*next
 );
 
+/**
+@brief		Read an item from the linked file bag through a window of
+			bytes held in memory.
+@details	When the item is outside of @p window, the window is refilled
+			starting at the item. Each refill that continues on from the
+			end of the previous one reads twice as many bytes, up to the
+			size of the window, so items stored one after another are read
+			in large batches while scattered items are read one at a time.
+			A refill for the item just before the window instead reads the
+			bytes ending at the item, so items read in reverse order are
+			batched too. The window is not updated by writes to the bag.
+@param		bag
+				A pointer to the linked file bag handler object which
+				we wish to read this item from.
+@param		window
+				The window to read through. It must be able to hold at
+				least @p num_bytes plus the size of a file offset.
+@param		offset
+				Where to read the information from within the file bag.
+@param		num_bytes
+				The number of bytes to read into @p write_to.
+@param		write_to
+				A pointer for a memory buffer to write the retrieved data
+				into.
+@param		next
+				A pointer to a file offset which is written with where the
+				next item in this bag is located.
+@returns	An error code describing the result of the call.
+*/
+ion_err_t
+lfb_get_buffered(
+	ion_lfb_t			*bag,
+	ion_lfb_window_t	*window,
+	ion_file_offset_t	offset,
+	unsigned int		num_bytes,
+	ion_byte_t			*write_to,
+	ion_file_offset_t	*next
+);
+
 /**
 @brief		Attempt to delete a record stored at a given offset.
 @param		bag
@@ -111,12 +234,38 @@ lfb_get(
 				for which we wish to delete the record from.
 @param		offset
 				The offset of the record to remove from its bag.
+@param		num_bytes
+				The number of bytes the record holds, used to reuse it
+				for later records of the same size.
 @returns	An error code describing the result of the call.
 */
 ion_err_t
 lfb_delete(
 	ion_lfb_t			*bag,
-	ion_file_offset_t	offset
+	ion_file_offset_t	offset,
+	unsigned int		num_bytes
+);
+
+/**
+@brief		Delete every record appended to the bag since its file ended
+			at @p end.
+@details	Appended records follow one another to the end of the file,
+			so this undoes a run of @ref lfb_append calls, such as those
+			of a bulk load that failed part way.
+@param		bag
+				A pointer to the initialized linked file bag handler for which
+				we wish to delete from.
+@param		end
+				The end of the bag's file before the records were appended.
+@param		num_bytes
+				The number of bytes each appended record holds.
+@returns	An error code describing the result of the call.
+*/
+ion_err_t
+lfb_delete_appended(
+	ion_lfb_t			*bag,
+	ion_file_offset_t	end,
+	unsigned int		num_bytes
 );
 
 /**
@@ -130,6 +279,8 @@ lfb_delete(
 				we wish to delete from.
 @param		offset
 				The offset of the first linked record to delete from.
+@param		num_bytes
+				The number of bytes each linked record holds.
 @param		count
 				A pointer to write count data to. If it is @c NULL,
 				then no data will be written.
@@ -139,9 +290,29 @@ ion_err_t
 lfb_delete_all(
 	ion_lfb_t			*bag,
 	ion_file_offset_t	offset,
+	unsigned int		num_bytes,
 	ion_result_count_t	*count
 );
 
+/**
+@brief		Update the next offset for the record stored at @p offset.
+@param		bag
+				A pointer to the initialized handler for the linked file
+				bag we wish to update.
+@param		offset
+				The offset of the record to set the next offset of.
+@param		next
+				The offset of the record to be referenced in the record
+				stored starting at @p offset.
+@returns	An error code describing the result of the call.
+*/
+ion_err_t
+lfb_update_next(
+	ion_lfb_t			*bag,
+	ion_file_offset_t	offset,
+	ion_file_offset_t	next
+);
+
 /**
 @brief		Attempt to update a record within a linked file bag
 			at a given offset.
@@ -198,7 +198,10 @@ enum ION_ERROR {
 	err_out_of_bounds,
 	/**> An error code describing the situation where an operation would
 		 violate the sorted precondition. */
-	err_sorted_order_violation
+	err_sorted_order_violation,
+	/**> An error code describing the situation where a rename operation
+		 has failed. */
+	err_file_rename_error
 };
 
 /**
@@ -0,0 +1,32 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Main file for Linear Hash behaviour tests.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#include "test_behaviour_linear_hash.h"
+
+int
+main(
+	void
+) {
+	runalltests_behaviour_linear_hash();
+	return 0;
+}
@@ -11,6 +11,7 @@
 #include "../../../cpp_wrapper/Dictionary.h"
 #include "../../../cpp_wrapper/BppTree.h"
 #include "../../../cpp_wrapper/FlatFile.h"
+#include "../../../cpp_wrapper/LinearHash.h"
 #include "../../../cpp_wrapper/OpenAddressFileHash.h"
 #include "../../../cpp_wrapper/OpenAddressHash.h"
 #include "../../../cpp_wrapper/SkipList.h"
@@ -117,6 +118,11 @@ test_cpp_wrapper_insert_on_all_implementations(
 	test_cpp_wrapper_insert_get(tc, dict);
 	test_cpp_wrapper_insert_get_edge_cases(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_insert_get(tc, dict);
+	test_cpp_wrapper_insert_get_edge_cases(tc, dict);
+	delete dict;
 }
 
 /**
@@ -208,6 +214,11 @@ test_cpp_wrapper_delete_on_all_implementations(
 	test_cpp_wrapper_insert_delete(tc, dict);
 	test_cpp_wrapper_insert_delete_edge_cases(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_insert_delete(tc, dict);
+	test_cpp_wrapper_insert_delete_edge_cases(tc, dict);
+	delete dict;
 }
 
 /**
@@ -297,6 +308,11 @@ test_cpp_wrapper_update_on_all_implementations(
 	test_cpp_wrapper_insert_update(tc, dict);
 	test_cpp_wrapper_insert_update_edge_cases(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_insert_update(tc, dict);
+	test_cpp_wrapper_insert_update_edge_cases(tc, dict);
+	delete dict;
 }
 
 /**
@@ -445,6 +461,10 @@ test_cpp_wrapper_equality_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 20);
 	test_cpp_wrapper_equality_no_duplicates(tc, dict, 6);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 20);
+	test_cpp_wrapper_equality_no_duplicates(tc, dict, 6);
+	delete dict;
 }
 
 /**
@@ -475,6 +495,10 @@ test_cpp_wrapper_equality_edge_case1_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 20);
 	test_cpp_wrapper_equality_edge_case1(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 20);
+	test_cpp_wrapper_equality_edge_case1(tc, dict);
+	delete dict;
 }
 
 /**
@@ -725,6 +749,10 @@ test_cpp_wrapper_range_simple_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
 	test_cpp_wrapper_range_simple(tc, dict, 5, 7);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
+	test_cpp_wrapper_range_simple(tc, dict, 5, 7);
+	delete dict;
 }
 
 /**
@@ -755,6 +783,10 @@ test_cpp_wrapper_range_edge_case1_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
 	test_cpp_wrapper_range_edge_case1(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
+	test_cpp_wrapper_range_edge_case1(tc, dict);
+	delete dict;
 }
 
 /**
@@ -785,6 +817,10 @@ test_cpp_wrapper_range_edge_case2_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
 	test_cpp_wrapper_range_edge_case2(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
+	test_cpp_wrapper_range_edge_case2(tc, dict);
+	delete dict;
 }
 
 /**
@@ -815,6 +851,10 @@ test_cpp_wrapper_range_edge_case3_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
 	test_cpp_wrapper_range_edge_case3(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 15);
+	test_cpp_wrapper_range_edge_case3(tc, dict);
+	delete dict;
 }
 
 /**
@@ -1002,6 +1042,10 @@ test_cpp_wrapper_all_records_simple_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
 	test_cpp_wrapper_all_records_simple(tc, dict, 8);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_all_records_simple(tc, dict, 8);
+	delete dict;
 }
 
 /**
@@ -1032,6 +1076,10 @@ test_cpp_wrapper_all_records_edge_cases1_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
 	test_cpp_wrapper_all_records_edge_cases1(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_all_records_edge_cases1(tc, dict);
+	delete dict;
 }
 
 /**
@@ -1062,6 +1110,10 @@ test_cpp_wrapper_all_records_edge_cases2_on_all_implementations(
 	dict = new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
 	test_cpp_wrapper_all_records_edge_cases2(tc, dict);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_all_records_edge_cases2(tc, dict);
+	delete dict;
 }
 
 /**
@@ -1135,6 +1187,10 @@ test_cpp_wrapper_open_close_on_all_implementations(
 	dict	= new OpenAddressFileHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
 	test_cpp_wrapper_open_close(tc, dict, 5, 12);
 	delete dict;
+
+	dict = new LinearHash<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 50);
+	test_cpp_wrapper_open_close(tc, dict, 5, 12);
+	delete dict;
 	dict	= new SkipList<int, int>(key_type_numeric_signed, sizeof(int), sizeof(int), 7);
 	test_cpp_wrapper_open_close(tc, dict, 1, 13);
 	delete dict;
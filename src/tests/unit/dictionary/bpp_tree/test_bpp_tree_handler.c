@@ -1,5 +1,11 @@
 #include "test_bpp_tree_handler.h"
 
+#if !defined(ARDUINO)
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 void
 run_bpptreehandler_generic_test_set_1(
 	planck_unit_test_t *tc
@@ -117,12 +123,1262 @@ run_bpptreehandler_generic_test_set_1(
 	cleanup_generic_dictionary_test(&test);
 }
 
+/**
+@brief		Gives the test dictionary small nodes, so that a few hundred
+			keys fill many leaves and several levels.
+*/
+void
+bpptree_test_small_nodes(
+	ion_generic_test_t	*test,
+	planck_unit_test_t	*tc
+) {
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_set_sector_size(&test->dictionary, 256));
+}
+
+void
+run_bpptreehandler_small_buffer_pool(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	int					key;
+	int					value;
+	int					i;
+
+	/* The smallest pool forces node buffers to be reused on most accesses. */
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (i = 0; i < 500; i++) {
+		key		= (i * 37) % 500;
+		status	= dictionary_insert(&test.dictionary, &key, IONIZE(key * 2, int));
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	for (key = 0; key < 500; key += 2) {
+		status = dictionary_delete(&test.dictionary, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	for (key = 0; key < 500; key++) {
+		status = dictionary_get(&test.dictionary, &key, &value);
+
+		if (0 == key % 2) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key * 2, value);
+		}
+	}
+
+	dictionary_test_all_records(&test, 250, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_large_buffer_pool(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_bpptree_t		*bpptree;
+	ion_status_t		status;
+	int					key;
+
+	/* A dictionary size far past what memory allows only gets the largest pool. */
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 100000);
+
+	dictionary_test_init(&test, tc);
+
+	bpptree = (ion_bpptree_t *) test.dictionary.instance;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 100000, bpptree->buffer_count);
+	PLANCK_UNIT_ASSERT_TRUE(tc, (long) bBufferCount(bpptree->tree) * bpptree->sector_size <= ION_BPP_MAX_BUFFER_BYTES);
+
+	/* Smaller nodes fit more of them in the same memory. */
+	bpptree_test_small_nodes(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_BPP_MAX_BUFFER_BYTES / 256, bBufferCount(bpptree->tree));
+
+	for (key = 0; key < 100; key++) {
+		status = dictionary_insert(&test.dictionary, &key, IONIZE(key * 2, int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	dictionary_test_all_records(&test, 100, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Returns the size of one of the files of the test dictionary.
+*/
+long
+bpptree_test_file_size(
+	ion_dictionary_t	*dictionary,
+	char				*ext
+) {
+	char	filename[ION_MAX_FILENAME_LENGTH];
+	FILE	*file;
+	long	size;
+
+	dictionary_get_filename(dictionary->instance->id, ext, filename);
+	file = fopen(filename, "rb");
+
+	if (NULL == file) {
+		return -1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fclose(file);
+
+	return size;
+}
+
+/**
+@brief		Closes and reopens the test dictionary, so that all of its
+			files are written out.
+*/
+void
+bpptree_test_reopen(
+	ion_generic_test_t	*test,
+	planck_unit_test_t	*tc
+) {
+	ion_dictionary_config_info_t config = {
+		test->dictionary.instance->id, 0, test->key_type, test->key_size, test->value_size, test->dictionary_size
+	};
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_close(&test->dictionary));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_open(&test->handler, &test->dictionary, &config));
+}
+
+void
+run_bpptreehandler_reuse_space(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	long				index_size;
+	long				value_size;
+	int					key;
+	int					round;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (key = 0; key < 400; key++) {
+		status = dictionary_insert(&test.dictionary, &key, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	bpptree_test_reopen(&test, tc);
+
+	index_size	= bpptree_test_file_size(&test.dictionary, "bpt");
+	value_size	= bpptree_test_file_size(&test.dictionary, "val");
+
+	/* Space freed by deletes is reused, even after the files are reopened. */
+	for (round = 0; round < 3; round++) {
+		for (key = 0; key < 400; key++) {
+			status = dictionary_delete(&test.dictionary, &key);
+
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		}
+
+		bpptree_test_reopen(&test, tc);
+
+		for (key = 0; key < 400; key++) {
+			status = dictionary_insert(&test.dictionary, &key, &key);
+
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		}
+
+		bpptree_test_reopen(&test, tc);
+
+		PLANCK_UNIT_ASSERT_TRUE(tc, bpptree_test_file_size(&test.dictionary, "bpt") <= index_size);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, value_size, bpptree_test_file_size(&test.dictionary, "val"));
+	}
+
+	dictionary_test_all_records(&test, 400, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_compact(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	long				index_size;
+	long				value_size;
+	int					key;
+	int					value;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (key = 0; key < 600; key++) {
+		dictionary_insert(&test.dictionary, &key, IONIZE(key + 1, int));
+
+		/* Duplicates must keep their order through compaction. */
+		if (0 == key % 50) {
+			dictionary_insert(&test.dictionary, &key, IONIZE(-key, int));
+		}
+	}
+
+	for (key = 0; key < 600; key++) {
+		if (0 != key % 5) {
+			dictionary_delete(&test.dictionary, &key);
+		}
+	}
+
+	bpptree_test_reopen(&test, tc);
+
+	index_size	= bpptree_test_file_size(&test.dictionary, "bpt");
+	value_size	= bpptree_test_file_size(&test.dictionary, "val");
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_compact(&test.dictionary));
+
+	bpptree_test_reopen(&test, tc);
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, bpptree_test_file_size(&test.dictionary, "bpt") < index_size);
+	PLANCK_UNIT_ASSERT_TRUE(tc, bpptree_test_file_size(&test.dictionary, "val") < value_size);
+
+	for (key = 0; key < 600; key++) {
+		status = dictionary_get(&test.dictionary, &key, &value);
+
+		if (0 != key % 5) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+		}
+		else if (0 == key % 50) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, -key, value);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key + 1, value);
+		}
+	}
+
+	dictionary_test_all_records(&test, 132, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+#if !defined(ARDUINO)
+
+/**
+@brief		Tests that a compaction whose files cannot be swapped in leaves the
+			dictionary open on its original files.
+*/
+void
+run_bpptreehandler_compact_swap_failure(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	long				index_size;
+	long				value_size;
+	int					key;
+	int					value;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (key = 0; key < 300; key++) {
+		dictionary_insert(&test.dictionary, &key, IONIZE(key + 1, int));
+	}
+
+	for (key = 0; key < 300; key += 2) {
+		dictionary_delete(&test.dictionary, &key);
+	}
+
+	bpptree_test_reopen(&test, tc);
+
+	index_size	= bpptree_test_file_size(&test.dictionary, "bpt");
+	value_size	= bpptree_test_file_size(&test.dictionary, "val");
+
+	/* A directory in the way stops the value file from being moved aside. */
+	dictionary_get_filename(test.dictionary.instance->id, "vao", filename);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, mkdir(filename, 0700));
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != bpptree_compact(&test.dictionary));
+	rmdir(filename);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, index_size, bpptree_test_file_size(&test.dictionary, "bpt"));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, value_size, bpptree_test_file_size(&test.dictionary, "val"));
+	dictionary_get_filename(test.dictionary.instance->id, "bpc", filename);
+	PLANCK_UNIT_ASSERT_TRUE(tc, !ion_fexists(filename));
+
+	/* The dictionary is still usable, and compacts once nothing is in the way. */
+	for (key = 0; key < 300; key++) {
+		status = dictionary_get(&test.dictionary, &key, &value);
+
+		if (0 == key % 2) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key + 1, value);
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_compact(&test.dictionary));
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_TRUE(tc, bpptree_test_file_size(&test.dictionary, "val") < value_size);
+	dictionary_test_all_records(&test, 150, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Tests that an index cut short after its header cannot be opened,
+			and that the failed open gives back what it took.
+*/
+void
+run_bpptreehandler_open_short_index(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	char				header[ION_BPP_DEFAULT_SECTOR_SIZE];
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	FILE				*file;
+	int					key;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+
+	for (key = 0; key < 10; key++) {
+		dictionary_insert(&test.dictionary, &key, IONIZE(key + 1, int));
+	}
+
+	ion_dictionary_config_info_t config = {
+		test.dictionary.instance->id, 0, test.key_type, test.key_size, test.value_size, test.dictionary_size
+	};
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_close(&test.dictionary));
+
+	/* Keep the header, which takes the first sector, but none of the nodes. */
+	dictionary_get_filename(config.id, "bpt", filename);
+	file = fopen(filename, "rb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, sizeof(header), fread(header, 1, sizeof(header), file));
+	fclose(file);
+
+	file = fopen(filename, "wb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, sizeof(header), fwrite(header, 1, sizeof(header), file));
+	fclose(file);
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != dictionary_open(&test.handler, &test.dictionary, &config));
+
+	ion_fremove(filename);
+	dictionary_get_filename(config.id, "val", filename);
+	ion_fremove(filename);
+}
+
+/**
+@brief		Tests that a B+ tree whose index can't be made again, in either
+			format, is left closed rather than holding a freed index.
+*/
+void
+run_bpptreehandler_remake_failure(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_bpptree_t		*bpptree;
+	struct rlimit		limit;
+	struct rlimit		no_files;
+	ion_err_t			err;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+
+	bpptree = (ion_bpptree_t *) test.dictionary.instance;
+
+	/* No more files can be opened, so neither the new index nor the old one can be. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, getrlimit(RLIMIT_NOFILE, &limit));
+	no_files			= limit;
+	no_files.rlim_cur	= 0;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, setrlimit(RLIMIT_NOFILE, &no_files));
+
+	err					= bpptree_set_compress(&test.dictionary, boolean_true);
+
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_file_open_error, err);
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL == bpptree->tree);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_file_open_error, bpptree_set_sector_size(&test.dictionary, 256));
+
+	/* It can still be deleted, which removes whatever files are left. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_delete_dictionary(&test.dictionary));
+}
+
+#endif
+
+void
+run_bpptreehandler_bulk_load_array(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	int					sizes[]		= { 1, 23, 1000 };
+	int					unsorted[]	= { 1, 3, 2 };
+	int					keys[1000];
+	int					values[1000];
+	long				index_size;
+	long				value_size;
+	int					value;
+	int					size;
+	int					i;
+	int					j;
+
+	for (i = 0; i < 1000; i++) {
+		keys[i]		= 3 * i;
+		values[i]	= 3 * i + 1;
+	}
+
+	for (i = 0; i < (int) (sizeof(sizes) / sizeof(int)); i++) {
+		size = sizes[i];
+		init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+		dictionary_test_init(&test, tc);
+		bpptree_test_small_nodes(&test, tc);
+
+		status = bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) keys, (ion_byte_t *) values, size, 70);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, size, status.count);
+
+		/* Only an empty tree can be bulk loaded. */
+		status = bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) keys, (ion_byte_t *) values, size, 70);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, status.error);
+
+		bpptree_test_reopen(&test, tc);
+
+		for (j = 0; j < 3 * size; j++) {
+			status = dictionary_get(&test.dictionary, &j, &value);
+
+			if (0 == j % 3) {
+				PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+				PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, j + 1, value);
+			}
+			else {
+				PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+			}
+		}
+
+		dictionary_test_all_records(&test, size, tc);
+
+		/* The loaded tree takes ordinary inserts and deletes. */
+		for (j = 1; j < 3 * size; j += 3) {
+			dictionary_insert(&test.dictionary, &j, &j);
+		}
+
+		for (j = 0; j < 3 * size; j += 6) {
+			dictionary_delete(&test.dictionary, &j);
+		}
+
+		dictionary_test_all_records(&test, 2 * size - (size + 1) / 2, tc);
+
+		cleanup_generic_dictionary_test(&test);
+	}
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	status = bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) unsorted, (ion_byte_t *) unsorted, 3, 100);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_sorted_order_violation, status.error);
+
+	/* A failed load leaves the tree empty. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&test.dictionary, unsorted, &value).error);
+
+	/* An array is checked before anything is written, so the files do not grow. */
+	bpptree_test_reopen(&test, tc);
+	index_size	= bpptree_test_file_size(&test.dictionary, "bpt");
+	value_size	= bpptree_test_file_size(&test.dictionary, "val");
+	keys[900]	= keys[10];
+
+	status		= bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) keys, (ion_byte_t *) values, 1000, 100);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_sorted_order_violation, status.error);
+
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, index_size, bpptree_test_file_size(&test.dictionary, "bpt"));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, value_size, bpptree_test_file_size(&test.dictionary, "val"));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&test.dictionary, keys, &value).error);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		A cursor over an array of keys, each given as its own value.
+*/
+typedef struct {
+	ion_dict_cursor_t	super;
+	int					*keys;
+	int					count;
+} bpptree_test_array_cursor_t;
+
+/**
+@brief		Gives the next key of a @ref bpptree_test_array_cursor_t.
+*/
+ion_cursor_status_t
+bpptree_test_array_next(
+	ion_dict_cursor_t	*cursor,
+	ion_record_t		*record
+) {
+	bpptree_test_array_cursor_t *array = (bpptree_test_array_cursor_t *) cursor;
+
+	if (0 == array->count) {
+		return cursor->status = cs_end_of_results;
+	}
+
+	memcpy(record->key, array->keys, sizeof(int));
+	memcpy(record->value, array->keys, sizeof(int));
+	array->keys++;
+	array->count--;
+
+	return cursor->status = cs_cursor_active;
+}
+
+void
+run_bpptreehandler_bulk_load_unsorted_cursor(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t			test;
+	bpptree_test_array_cursor_t cursor;
+	ion_status_t				status;
+	long						index_size;
+	long						value_size;
+	int							keys[600];
+	int							value;
+	int							i;
+
+	for (i = 0; i < 600; i++) {
+		keys[i] = i;
+	}
+
+	/* A cursor can not be checked first, so its records are loaded until the key out of order. */
+	keys[599]				= 5;
+	cursor.super.status		= cs_cursor_initialized;
+	cursor.super.next		= bpptree_test_array_next;
+	cursor.super.destroy	= NULL;
+	cursor.keys				= keys;
+	cursor.count			= 600;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	status = bpptree_bulk_load(&test.dictionary, &cursor.super, 100);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_sorted_order_violation, status.error);
+
+	bpptree_test_reopen(&test, tc);
+	index_size	= bpptree_test_file_size(&test.dictionary, "bpt");
+	value_size	= bpptree_test_file_size(&test.dictionary, "val");
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&test.dictionary, IONIZE(5, int), &value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&test.dictionary, IONIZE(500, int), &value).error);
+
+	/* The nodes and values written before the failure were freed, so inserts reuse their space. */
+	for (i = 0; i < 150; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_insert(&test.dictionary, &i, IONIZE(i * 2, int)).error);
+	}
+
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, index_size, bpptree_test_file_size(&test.dictionary, "bpt"));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, value_size, bpptree_test_file_size(&test.dictionary, "val"));
+	dictionary_test_all_records(&test, 150, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_bulk_load_cursor(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_dictionary_t	copy;
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_status_t		status;
+	int					key;
+	int					value;
+	int					copied_value;
+	int					i;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (i = 0; i < 300; i++) {
+		key = (i * 37) % 300;
+		dictionary_insert(&test.dictionary, &key, IONIZE(key * 2, int));
+
+		if (0 == key % 30) {
+			dictionary_insert(&test.dictionary, &key, IONIZE(-key, int));
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_create(&test.handler, &copy, 2, key_type_numeric_signed, sizeof(int), sizeof(int), -1));
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test.dictionary, &predicate, &cursor));
+
+	status = bpptree_bulk_load(&copy, cursor, 100);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 310, status.count);
+
+	cursor->destroy(&cursor);
+
+	for (key = 0; key < 300; key++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_get(&test.dictionary, &key, &value).error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_get(&copy, &key, &copied_value).error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, value, copied_value);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_delete_dictionary(&copy));
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Checks that a range cursor returns the @p count keys from
+			@p lower to @p upper that are multiples of @p step, in order
+			(from @p upper down if @p descending) and with their values.
+*/
+void
+bpptree_test_range(
+	ion_generic_test_t	*test,
+	planck_unit_test_t	*tc,
+	int					lower,
+	int					upper,
+	int					step,
+	int					count,
+	ion_boolean_t		descending
+) {
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_record_t		record;
+	int					key;
+	int					value;
+	int					expected;
+	int					found;
+
+	record.key		= &key;
+	record.value	= &value;
+
+	dictionary_build_predicate(&predicate, predicate_range, &lower, &upper);
+	dictionary_set_predicate_descending(&predicate, descending);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test->dictionary, &predicate, &cursor));
+
+	expected	= descending ? (upper / step) * step : ((lower + step - 1) / step) * step;
+	found		= 0;
+
+	while (cs_cursor_active == cursor->next(cursor, &record)) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected, key);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key + 1, value);
+		expected += descending ? -step : step;
+		found++;
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, count, found);
+
+	cursor->destroy(&cursor);
+}
+
+void
+run_bpptreehandler_range_cursor(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*first;
+	ion_dict_cursor_t	*second;
+	ion_record_t		first_record;
+	ion_record_t		second_record;
+	int					keys[2000];
+	int					values[2000];
+	int					first_key;
+	int					second_key;
+	int					value;
+	int					i;
+
+	for (i = 0; i < 2000; i++) {
+		keys[i]		= 2 * i;
+		values[i]	= 2 * i + 1;
+	}
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) keys, (ion_byte_t *) values, 2000, 80).error);
+
+	/* Values read in batches while they follow one another. */
+	bpptree_test_range(&test, tc, 0, 3998, 2, 2000, boolean_false);
+	bpptree_test_range(&test, tc, 1, 2, 2, 1, boolean_false);
+	bpptree_test_range(&test, tc, 1001, 3001, 2, 1000, boolean_false);
+	bpptree_test_range(&test, tc, 3999, 5000, 2, 0, boolean_false);
+
+	/* Values scattered by later inserts. */
+	for (i = 1; i < 4000; i += 2) {
+		dictionary_insert(&test.dictionary, &i, IONIZE(i + 1, int));
+	}
+
+	bpptree_test_range(&test, tc, 0, 3999, 1, 4000, boolean_false);
+	bpptree_test_range(&test, tc, 777, 1555, 1, 779, boolean_false);
+
+	/* Cursors walk the leaves independently of each other. */
+	first_record.key		= &first_key;
+	first_record.value		= &value;
+	second_record.key		= &second_key;
+	second_record.value		= &value;
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test.dictionary, &predicate, &first));
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test.dictionary, &predicate, &second));
+
+	for (i = 0; i < 4000; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, first->next(first, &first_record));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i, first_key);
+
+		if (0 == i % 2) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, second->next(second, &second_record));
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i / 2, second_key);
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_end_of_results, first->next(first, &first_record));
+
+	first->destroy(&first);
+	second->destroy(&second);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_duplicate_chains(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	int					key;
+	int					i;
+
+	/* A small pool evicts leaves between the inserts of the same key, so
+	   the updated chain heads must reach the disk. */
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (i = 0; i < 1000; i++) {
+		key = (i * 7) % 500;
+		dictionary_insert(&test.dictionary, &key, &i);
+	}
+
+	dictionary_test_all_records(&test, 1000, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Checks that an equality cursor returns @p count values for
+			@p key, and that they add up to @p sum.
+*/
+void
+bpptree_test_duplicates(
+	ion_generic_test_t	*test,
+	planck_unit_test_t	*tc,
+	int					key,
+	int					count,
+	int					sum
+) {
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_record_t		record;
+	int					found_key;
+	int					value;
+	int					found;
+	int					total;
+
+	record.key		= &found_key;
+	record.value	= &value;
+
+	dictionary_build_predicate(&predicate, predicate_equality, &key);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test->dictionary, &predicate, &cursor));
+
+	found	= 0;
+	total	= 0;
+
+	while (cs_cursor_active == cursor->next(cursor, &record)) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key, found_key);
+		total += value;
+		found++;
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, count, found);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, sum, total);
+
+	cursor->destroy(&cursor);
+}
+
+void
+run_bpptreehandler_duplicate_keys(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	int					key;
+	int					value;
+	int					i;
+
+	/* A small pool, so the copies of a key are read back from disk. */
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_write_concern, bpptree_set_write_concern(&test.dictionary, wc_insert_unique));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_set_write_concern(&test.dictionary, wc_duplicate));
+
+	/* Each key gets 12 values, more than fit in a leaf. */
+	for (i = 0; i < 1200; i++) {
+		key		= i % 100;
+		status	= dictionary_insert(&test.dictionary, &key, &i);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, status.count);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, bpptree_set_write_concern(&test.dictionary, wc_update));
+
+	for (key = 0; key < 100; key++) {
+		bpptree_test_duplicates(&test, tc, key, 12, 12 * key + 6600);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_get(&test.dictionary, &key, &value).error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, key, value % 100);
+	}
+
+	bpptree_test_duplicates(&test, tc, 100, 0, 0);
+	dictionary_test_all_records(&test, 1200, tc);
+
+	key		= 5;
+	value	= 777;
+	status	= dictionary_update(&test.dictionary, &key, &value);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 12, status.count);
+	bpptree_test_duplicates(&test, tc, 5, 12, 12 * 777);
+
+	key		= 7;
+	status	= dictionary_delete(&test.dictionary, &key);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 12, status.count);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&test.dictionary, &key, &value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_delete(&test.dictionary, &key).error);
+	bpptree_test_duplicates(&test, tc, 7, 0, 0);
+	bpptree_test_duplicates(&test, tc, 6, 12, 12 * 6 + 6600);
+	bpptree_test_duplicates(&test, tc, 8, 12, 12 * 8 + 6600);
+
+	/* The mode is kept by the index file, and by compaction. */
+	dictionary_test_open_close(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, wc_duplicate, ((ion_bpptree_t *) test.dictionary.instance)->write_concern);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_compact(&test.dictionary));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, wc_duplicate, ((ion_bpptree_t *) test.dictionary.instance)->write_concern);
+
+	bpptree_test_duplicates(&test, tc, 5, 12, 12 * 777);
+	bpptree_test_duplicates(&test, tc, 99, 12, 12 * 99 + 6600);
+	dictionary_test_all_records(&test, 1189, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Writes the zero padded name of sensor @p i to @p key.
+*/
+void
+bpptree_test_sensor_key(
+	char	*key,
+	int		i
+) {
+	memset(key, 0, 40);
+	sprintf(key, "sensor/building-%02d/room-%04d", i % 10, i);
+}
+
+/**
+@brief		Stores, deletes and finds char array keys that share long
+			prefixes, through a reopen and a compaction.
+@param		tc
+				Test case.
+@param		compress
+				Whether the index prefix compresses its keys.
+*/
+void
+bpptree_test_string_keys(
+	planck_unit_test_t	*tc,
+	ion_boolean_t		compress
+) {
+	ion_generic_test_t	test;
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_record_t		record;
+	ion_status_t		status;
+	char				key[40];
+	char				lower[40];
+	char				upper[40];
+	int					value;
+	int					expected;
+	int					i;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_char_array, sizeof(key), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_set_compress(&test.dictionary, compress));
+
+	for (i = 0; i < 600; i++) {
+		value	= (i * 7) % 600;
+		bpptree_test_sensor_key(key, value);
+		status	= dictionary_insert(&test.dictionary, key, &value);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	for (i = 0; i < 600; i += 5) {
+		bpptree_test_sensor_key(key, i);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, dictionary_delete(&test.dictionary, key).count);
+	}
+
+	bpptree_test_reopen(&test, tc);
+
+	for (i = 0; i < 600; i++) {
+		bpptree_test_sensor_key(key, i);
+		status = dictionary_get(&test.dictionary, key, &value);
+
+		if (0 == i % 5) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i, value);
+		}
+	}
+
+	/* Every room of one building, none of which were deleted. */
+	memset(lower, 0, sizeof(lower));
+	memset(upper, 0, sizeof(upper));
+	strcpy(lower, "sensor/building-03/");
+	strcpy(upper, "sensor/building-04");
+
+	record.key		= key;
+	record.value	= &value;
+
+	dictionary_build_predicate(&predicate, predicate_range, lower, upper);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test.dictionary, &predicate, &cursor));
+
+	for (expected = 3; cs_cursor_active == cursor->next(cursor, &record); expected += 10) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected, value);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 603, expected);
+
+	cursor->destroy(&cursor);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_compact(&test.dictionary));
+	dictionary_test_all_records(&test, 480, tc);
+
+	/* The format chosen at creation outlives the reopen and compaction. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, compress, ((ion_bpptree_t *) test.dictionary.instance)->compress);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, bpptree_set_compress(&test.dictionary, !compress));
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_string_keys(
+	planck_unit_test_t *tc
+) {
+	bpptree_test_string_keys(tc, boolean_false);
+}
+
+void
+run_bpptreehandler_string_keys_compressed(
+	planck_unit_test_t *tc
+) {
+	bpptree_test_string_keys(tc, boolean_true);
+}
+
+void
+run_bpptreehandler_sector_size(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	int					key;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), -1);
+
+	dictionary_test_init(&test, tc);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_BPP_DEFAULT_SECTOR_SIZE, ((ion_bpptree_t *) test.dictionary.instance)->sector_size);
+
+	/* Too few keys fit, too large, and not a multiple of 4. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_invalid_initial_size, bpptree_set_sector_size(&test.dictionary, 64));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_invalid_initial_size, bpptree_set_sector_size(&test.dictionary, 2 * ION_BPP_MAX_SECTOR_SIZE));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_invalid_initial_size, bpptree_set_sector_size(&test.dictionary, 1022));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_set_sector_size(&test.dictionary, 16384));
+
+	for (key = 0; key < 3000; key++) {
+		status = dictionary_insert(&test.dictionary, &key, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, bpptree_set_sector_size(&test.dictionary, 4096));
+
+	/* The size is kept by the index file, which holds whole aligned nodes. */
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 16384, ((ion_bpptree_t *) test.dictionary.instance)->sector_size);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, bpptree_test_file_size(&test.dictionary, "bpt") % 16384);
+
+	dictionary_test_all_records(&test, 3000, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+/**
+@brief		Reads the whole of one of the files of the test dictionary
+			into @p contents, which must be freed.
+*/
+long
+bpptree_test_file_contents(
+	ion_dictionary_t	*dictionary,
+	char				*ext,
+	char				**contents
+) {
+	char	filename[ION_MAX_FILENAME_LENGTH];
+	FILE	*file;
+	long	size;
+
+	size		= bpptree_test_file_size(dictionary, ext);
+	*contents	= malloc(size);
+	dictionary_get_filename(dictionary->instance->id, ext, filename);
+	file		= fopen(filename, "rb");
+
+	if ((NULL == file) || (NULL == *contents) || (1 != fread(*contents, size, 1, file))) {
+		size = -1;
+	}
+
+	if (NULL != file) {
+		fclose(file);
+	}
+
+	return size;
+}
+
+void
+run_bpptreehandler_write_back(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	int					key;
+	int					i;
+	long				size;
+	char				*flushed;
+	char				*closed;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 16);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_set_dirty_max(&test.dictionary, 4));
+
+	for (i = 0; i < 2000; i++) {
+		key		= (i * 7) % 2000;
+		status	= dictionary_insert(&test.dictionary, &key, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	/* A flushed index is already what closing it would leave. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_flush(&test.dictionary));
+	size = bpptree_test_file_contents(&test.dictionary, "bpt", &flushed);
+	PLANCK_UNIT_ASSERT_TRUE(tc, size > 0);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, size % 256);
+
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, size, bpptree_test_file_contents(&test.dictionary, "bpt", &closed));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, memcmp(flushed, closed, size));
+	free(flushed);
+	free(closed);
+
+	dictionary_test_all_records(&test, 2000, tc);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_stats(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_status_t		status;
+	ion_bpp_stats_t		stats;
+	int					key;
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	for (key = 0; key < 500; key++) {
+		status = dictionary_insert(&test.dictionary, &key, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_get_stats(&test.dictionary, &stats));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 500, stats.nKeysIns);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.maxHeight >= 2);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.nSplits > 0);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.nBufHits > 0);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.nEvictions > 0);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.nDiskWrites > 0);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, stats.nJoins);
+
+	for (key = 0; key < 500; key++) {
+		status = dictionary_delete(&test.dictionary, &key);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_get_stats(&test.dictionary, &stats));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 500, stats.nKeysDel);
+	PLANCK_UNIT_ASSERT_TRUE(tc, stats.nJoins > 0);
+
+	/* Counts belong to the open index, and start again when it is reopened. */
+	bpptree_test_reopen(&test, tc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_get_stats(&test.dictionary, &stats));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, stats.nKeysIns);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, stats.nKeysDel);
+
+	cleanup_generic_dictionary_test(&test);
+}
+
+void
+run_bpptreehandler_descending_cursor(
+	planck_unit_test_t *tc
+) {
+	ion_generic_test_t	test;
+	ion_predicate_t		predicate;
+	ion_dict_cursor_t	*cursor;
+	ion_record_t		record;
+	ion_bpp_stats_t		before;
+	ion_bpp_stats_t		after;
+	int					keys[2000];
+	int					values[2000];
+	int					key;
+	int					value;
+	int					i;
+
+	for (i = 0; i < 2000; i++) {
+		keys[i]		= 2 * i;
+		values[i]	= 2 * i + 1;
+	}
+
+	init_generic_dictionary_test(&test, bpptree_init, key_type_numeric_signed, sizeof(int), sizeof(int), 7);
+
+	dictionary_test_init(&test, tc);
+	bpptree_test_small_nodes(&test, tc);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, bpptree_bulk_load_array(&test.dictionary, (ion_byte_t *) keys, (ion_byte_t *) values, 2000, 80).error);
+
+	bpptree_test_range(&test, tc, 0, 3998, 2, 2000, boolean_true);
+	bpptree_test_range(&test, tc, 1, 2, 2, 1, boolean_true);
+	bpptree_test_range(&test, tc, 1001, 3001, 2, 1000, boolean_true);
+	bpptree_test_range(&test, tc, 3997, 3998, 2, 1, boolean_true);
+	bpptree_test_range(&test, tc, -100, -1, 2, 0, boolean_true);
+
+	/* Values scattered by later inserts, and leaves split out of order. */
+	for (i = 1; i < 4000; i += 2) {
+		dictionary_insert(&test.dictionary, &i, IONIZE(i + 1, int));
+	}
+
+	bpptree_test_range(&test, tc, 0, 3999, 1, 4000, boolean_true);
+	bpptree_test_range(&test, tc, 777, 1555, 1, 779, boolean_true);
+
+	/* The greatest keys are found without reading the rest of the tree. */
+	record.key		= &key;
+	record.value	= &value;
+
+	bpptree_get_stats(&test.dictionary, &before);
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_set_predicate_descending(&predicate, boolean_true));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&test.dictionary, &predicate, &cursor));
+
+	for (i = 3999; i > 3989; i--) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, cursor->next(cursor, &record));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i, key);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i + 1, value);
+	}
+
+	cursor->destroy(&cursor);
+
+	bpptree_get_stats(&test.dictionary, &after);
+	PLANCK_UNIT_ASSERT_TRUE(tc, after.nDiskReads - before.nDiskReads <= (unsigned long) after.maxHeight + 2);
+
+	dictionary_build_predicate(&predicate, predicate_equality, &key);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_invalid_predicate, dictionary_set_predicate_descending(&predicate, boolean_true));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, boolean_false, dictionary_predicate_is_descending(&predicate));
+
+	cleanup_generic_dictionary_test(&test);
+}
+
 planck_unit_suite_t *
 bpptreehandler_get_suite(
 ) {
 	planck_unit_suite_t *suite = planck_unit_new_suite();
 
 	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_generic_test_set_1);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_small_buffer_pool);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_large_buffer_pool);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_reuse_space);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_compact);
+#if !defined(ARDUINO)
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_compact_swap_failure);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_open_short_index);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_remake_failure);
+#endif
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_bulk_load_array);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_bulk_load_cursor);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_bulk_load_unsorted_cursor);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_range_cursor);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_duplicate_chains);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_duplicate_keys);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_string_keys);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_string_keys_compressed);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_sector_size);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_write_back);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_stats);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, run_bpptreehandler_descending_cursor);
 
 	return suite;
 }
@@ -22,6 +22,7 @@
 /******************************************************************************/
 
 #include "test_flat_file.h"
+#include <stddef.h>
 
 /********* PRIVATE METHOD DECLARATIONS **********/
 
@@ -98,6 +99,24 @@ ftest_takedown(
 	ftest_destroy(tc, flat_file);
 }
 
+/**
+@brief		Closes the data file the way a crash would, after writing out the rows
+			held in memory, but without marking the header clean.
+*/
+void
+ftest_crash(
+	planck_unit_test_t	*tc,
+	ion_flat_file_t		*flat_file
+) {
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_flush(flat_file));
+	fclose(flat_file->data_file);
+	free(flat_file->buffer);
+	free(flat_file->append_buffer);
+	free(flat_file->block_buffer);
+	free(flat_file->fence_keys);
+	free(flat_file->zone_keys);
+}
+
 /**
 @brief		Inserts into the flat file and optionally checks if the insert was OK
 			by reading the data file. Don't turn on check_result unless you expect
@@ -128,6 +147,8 @@ ftest_insert(
 
 		ion_byte_t read_buffer[flat_file->row_size];
 
+		/* The row is only in the data file once the append buffer is written out. */
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_flush(flat_file));
 		fseek(flat_file->data_file, flat_file->start_of_data, SEEK_SET);
 
 		ion_fpos_t cur_index = 0;
@@ -449,6 +470,443 @@ test_flat_file_scan_cases_large_buf(
 	ftest_takedown(tc, &flat_file);
 }
 
+/**
+@brief		Tests that long scans read more rows at a time as they go, in both directions.
+*/
+void
+test_flat_file_scan_grows_buffer(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t flat_file;
+	int				i;
+
+	ftest_create(tc, &flat_file, key_type_numeric_signed, sizeof(int), sizeof(int), 1);
+
+	for (i = 0; i < 300; i++) {
+		ftest_insert(tc, &flat_file, IONIZE(i, int), IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	/* A scan starts with a single row, and the rows read double each time it runs on. */
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, -1, IONIZE(0, int), err_ok, 0);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, flat_file.num_in_buffer);
+
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, -1, IONIZE(299, int), err_ok, 299);
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.num_in_buffer > 1);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 300, flat_file.current_loaded_region + flat_file.num_in_buffer);
+
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, 150, IONIZE(150, int), err_ok, 150);
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, 151, IONIZE(150, int), err_file_hit_eof, 300);
+
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_BACKWARDS, -1, IONIZE(0, int), err_ok, 0);
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.num_in_buffer > 1);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.current_loaded_region);
+
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_BACKWARDS, 299, IONIZE(100, int), err_ok, 100);
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_BACKWARDS, 99, IONIZE(100, int), err_file_hit_eof, 300);
+
+	/* The rows seen through the larger reads are intact. */
+	for (i = 0; i < 300; i += 37) {
+		ftest_get(tc, &flat_file, IONIZE(i, int), err_ok, IONIZE(i * 2, int));
+	}
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests key match scans over unsigned keys of the given size, in the
+			PAX layout with @p block_rows rows in each block if it is not 0.
+*/
+void
+ftest_scan_key_size(
+	planck_unit_test_t	*tc,
+	ion_key_size_t		key_size,
+	ion_fpos_t			block_rows
+) {
+	ion_flat_file_t flat_file;
+	ion_byte_t		key[key_size];
+	int				i;
+
+	ftest_create(tc, &flat_file, key_type_numeric_unsigned, key_size, sizeof(int), 4);
+	flat_file.super.compare = dictionary_compare_unsigned_value;
+
+	if (0 < block_rows) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_use_pax_layout(&flat_file, block_rows));
+	}
+
+	for (i = 0; i < 50; i++) {
+		memset(key, 0, key_size);
+		key[0]				= i;
+		key[key_size - 1]	|= 0x80;
+		/* The check reads the data file as whole rows. */
+		ftest_insert(tc, &flat_file, key, IONIZE(i, int), err_ok, 1, 0 == block_rows);
+	}
+
+	key[0] = 37;
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, -1, key, err_ok, 37);
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_BACKWARDS, -1, key, err_ok, 37);
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, 38, key, err_file_hit_eof, 50);
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_BACKWARDS, 36, key, err_file_hit_eof, 50);
+
+	/* Only the high byte differs from a stored key. */
+	key[key_size - 1] ^= 0x80;
+	ftest_file_scan(tc, &flat_file, ION_FLAT_FILE_SCAN_FORWARDS, -1, key, err_file_hit_eof, 50);
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests key match scans for keys that are and are not compared a machine word at a time.
+*/
+void
+test_flat_file_scan_key_sizes(
+	planck_unit_test_t *tc
+) {
+	ion_key_size_t	key_sizes[] = { 2, 3, 4, 8, 12 };
+	int				i;
+
+	for (i = 0; i < (int) (sizeof(key_sizes) / sizeof(key_sizes[0])); i++) {
+		ftest_scan_key_size(tc, key_sizes[i], 0);
+		/* Blocks of 20 rows hold a full group of 16 and a shorter tail. */
+		ftest_scan_key_size(tc, key_sizes[i], 20);
+	}
+}
+
+/**
+@brief		Tests searching the status and key stripes of a PAX block, for keys
+			that are and are not tested several rows at a time.
+*/
+void
+test_flat_file_match_key_in_stripe(
+	planck_unit_test_t *tc
+) {
+	ion_key_size_t	key_sizes[] = { 2, 3, 4, 8 };
+	ion_byte_t		statuses[40];
+	ion_byte_t		keys[40 * 8];
+	ion_byte_t		key[8];
+	ion_key_size_t	key_size;
+	int				i;
+	int				j;
+
+	for (j = 0; j < (int) (sizeof(key_sizes) / sizeof(key_sizes[0])); j++) {
+		key_size = key_sizes[j];
+
+		for (i = 0; i < 40; i++) {
+			statuses[i] = ION_FLAT_FILE_STATUS_OCCUPIED;
+			memset(keys + i * key_size, 0x5A, key_size);
+			keys[i * key_size] = i;
+		}
+
+		memset(key, 0x5A, key_size);
+		key[0] = 21;
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 21, flat_file_match_key_in_stripe(statuses, keys, key_size, 40, key));
+
+		/* A deleted row is passed over, and a later row with the key is found. */
+		statuses[21] = ION_FLAT_FILE_STATUS_EMPTY;
+		memcpy(keys + 35 * key_size, key, key_size);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 35, flat_file_match_key_in_stripe(statuses, keys, key_size, 40, key));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 35, flat_file_match_key_in_stripe(statuses, keys, key_size, 35, key));
+
+		/* Only the last byte differs from a stored key. */
+		key[0]				= 5;
+		key[key_size - 1]	^= 0x01;
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 40, flat_file_match_key_in_stripe(statuses, keys, key_size, 40, key));
+
+		key[key_size - 1] ^= 0x01;
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 5, flat_file_match_key_in_stripe(statuses, keys, key_size, 40, key));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file_match_key_in_stripe(statuses + 5, keys + 5 * key_size, key_size, 35, key));
+	}
+}
+
+/**
+@brief		Tests that inserts are held in memory until the append buffer fills
+			or is flushed, and that a torn row at the end of the file is dropped
+			when it is opened again.
+*/
+void
+test_flat_file_append_buffer_torn_tail(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t		flat_file;
+	ion_flat_file_row_t row;
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	FILE				*file;
+	int					i;
+
+	ftest_setup(tc, &flat_file);
+
+	if (0 == flat_file.max_appended) {
+		/* Inserts are written as they come. */
+		ftest_takedown(tc, &flat_file);
+		return;
+	}
+
+	for (i = 0; i < 3; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3, flat_file.num_appended);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 3 * flat_file.row_size, flat_file.eof_position);
+	fseek(flat_file.data_file, 0, SEEK_END);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data, ftell(flat_file.data_file));
+
+	/* Reads write the held rows out first. */
+	ftest_get(tc, &flat_file, IONIZE(2, int), err_ok, IONIZE(4, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_appended);
+
+	/* A full buffer is written out by the next insert. */
+	for (i = 3; i < (int) flat_file.max_appended + 4; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, flat_file.num_appended);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_flush(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_appended);
+	ftest_crash(tc, &flat_file);
+
+	/* Leave part of a row at the end of the file, as a crash during a write would. */
+	dictionary_get_filename(0, "ffs", filename);
+	file = fopen(filename, "ab");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	fwrite(&(ion_flat_file_row_status_t) { ION_FLAT_FILE_STATUS_OCCUPIED }, sizeof(ion_flat_file_row_status_t), 1, file);
+	fwrite(IONIZE(-1, int), sizeof(int), 1, file);
+	fclose(file);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + i * flat_file.row_size, flat_file.eof_position);
+	ftest_get(tc, &flat_file, IONIZE(-1, int), err_item_not_found, NULL);
+
+	/* The next row is written over the torn one. */
+	ftest_insert(tc, &flat_file, IONIZE(-5, int), IONIZE(7, int), err_ok, 1, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_read_row(&flat_file, i, &row));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, -5, NEUTRALIZE(row.key, int));
+	fseek(flat_file.data_file, 0, SEEK_END);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.eof_position, ftell(flat_file.data_file));
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests that a cleanly closed flat file is opened from the row count in its
+			header, and that one that was not is scanned for the end of its rows.
+*/
+void
+test_flat_file_header_clean_open(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t			flat_file;
+	ion_flat_file_header_t	header;
+	char					filename[ION_MAX_FILENAME_LENGTH];
+	FILE					*file;
+	int						i;
+
+	ftest_setup(tc, &flat_file);
+
+	for (i = 0; i < 5; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+
+	dictionary_get_filename(0, "ffs", filename);
+	file = fopen(filename, "r+b");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, fread(&header, sizeof(header), 1, file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_HEADER_MAGIC, header.magic);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_HEADER_VERSION, header.version);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1 + 2 * sizeof(int), header.row_size);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_HEADER_FLAG_CLEAN, header.flags);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 5, header.num_rows);
+
+	/* A clean header is trusted without a scan, so a smaller row count hides the rows past it. */
+	header.num_rows = 3;
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_dictionary_initialization_failed, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), 2 * sizeof(int), 15));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 3 * flat_file.row_size, flat_file.eof_position);
+	ftest_get(tc, &flat_file, IONIZE(4, int), err_item_not_found, NULL);
+
+	/* The header stays unclean while the file is open, so a crash leaves the end to be found by a scan. */
+	ftest_insert(tc, &flat_file, IONIZE(7, int), IONIZE(14, int), err_ok, 1, boolean_false);
+	ftest_crash(tc, &flat_file);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 5 * flat_file.row_size, flat_file.eof_position);
+	ftest_get(tc, &flat_file, IONIZE(2, int), err_ok, IONIZE(4, int));
+	ftest_get(tc, &flat_file, IONIZE(7, int), err_ok, IONIZE(14, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+
+	/* Version 1 headers end before the dead row count, and keep their version when rewritten. */
+	header.version		= 1;
+	header.flags		= ION_FLAT_FILE_HEADER_FLAG_CLEAN;
+	header.num_rows		= 2;
+	file				= fopen(filename, "wb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, fwrite(&header, offsetof(ion_flat_file_header_t, num_dead_rows), 1, file));
+
+	for (i = 0; i < 2; i++) {
+		fputc(ION_FLAT_FILE_STATUS_OCCUPIED, file);
+		fwrite(&i, sizeof(int), 1, file);
+		fwrite(IONIZE(i * 3, int), sizeof(int), 1, file);
+	}
+
+	fclose(file);
+
+	ftest_setup(tc, &flat_file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, flat_file.header_version);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, offsetof(ion_flat_file_header_t, num_dead_rows), flat_file.start_of_data);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, -1, flat_file.num_dead_rows);
+	ftest_get(tc, &flat_file, IONIZE(1, int), err_ok, IONIZE(3, int));
+	ftest_insert(tc, &flat_file, IONIZE(2, int), IONIZE(6, int), err_ok, 1, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+
+	file = fopen(filename, "rb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, fread(&header, offsetof(ion_flat_file_header_t, num_dead_rows), 1, file));
+	fclose(file);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, header.version);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3, header.num_rows);
+
+	ftest_setup(tc, &flat_file);
+	ftest_get(tc, &flat_file, IONIZE(2, int), err_ok, IONIZE(6, int));
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests the PAX layout, where each block keeps the statuses, keys and
+			values of its rows in separate stripes.
+*/
+void
+test_flat_file_pax_layout(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t flat_file;
+	ion_byte_t		block[4 * (1 + 2 * sizeof(int))];
+	int				field;
+	int				i;
+
+	ftest_setup(tc, &flat_file);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_invalid_initial_size, flat_file_use_pax_layout(&flat_file, 0));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_use_pax_layout(&flat_file, 4));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, flat_file_use_pax_layout(&flat_file, 4));
+
+	for (i = 0; i < 10; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 3, int), err_ok, 1, boolean_false);
+	}
+
+	/* The first block holds four statuses, then four keys, then four values. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_flush(&flat_file));
+	fseek(flat_file.data_file, flat_file.start_of_data, SEEK_SET);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, fread(block, sizeof(block), 1, flat_file.data_file));
+
+	for (i = 0; i < 4; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_STATUS_OCCUPIED, block[i]);
+		memcpy(&field, block + 4 + i * sizeof(int), sizeof(int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i, field);
+		memcpy(&field, block + 4 + 4 * sizeof(int) + i * sizeof(int), sizeof(int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i * 3, field);
+	}
+
+	/* Key scans leave the values out, and read only the value of the row found. */
+	ftest_get(tc, &flat_file, IONIZE(6, int), err_ok, IONIZE(18, int));
+	PLANCK_UNIT_ASSERT_TRUE(tc, !flat_file.region_has_values);
+	ftest_get(tc, &flat_file, IONIZE(10, int), err_item_not_found, NULL);
+	ftest_update(tc, &flat_file, IONIZE(5, int), IONIZE(50, int), err_ok, 1);
+	ftest_delete(tc, &flat_file, IONIZE(2, int), err_ok, 1, boolean_true);
+	ftest_get(tc, &flat_file, IONIZE(9, int), err_ok, IONIZE(27, int));
+
+	/* The header keeps the layout once the file is reopened. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, flat_file.block_rows);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 9 * flat_file.row_size, flat_file.eof_position);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, flat_file_use_pax_layout(&flat_file, 8));
+
+	ftest_get(tc, &flat_file, IONIZE(9, int), err_ok, IONIZE(27, int));
+	ftest_get(tc, &flat_file, IONIZE(5, int), err_ok, IONIZE(50, int));
+	ftest_get(tc, &flat_file, IONIZE(2, int), err_item_not_found, NULL);
+
+	/* Sealing keeps the layout too. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_seal(&flat_file, 5 * flat_file.row_size));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, flat_file.block_rows);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(3, int), err_ok, 2);
+	ftest_get(tc, &flat_file, IONIZE(8, int), err_ok, IONIZE(24, int));
+	ftest_insert(tc, &flat_file, IONIZE(12, int), IONIZE(36, int), err_ok, 1, boolean_false);
+	ftest_get(tc, &flat_file, IONIZE(12, int), err_ok, IONIZE(36, int));
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests a flat file with its data file mapped into memory, as the mapping
+			grows, and once it is closed and opened again without it.
+*/
+void
+test_flat_file_mmap(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t		flat_file;
+	ion_flat_file_row_t row;
+	ion_fpos_t			loc;
+	ion_fpos_t			map_size;
+	int					i;
+
+	ftest_setup(tc, &flat_file);
+
+	ion_err_t err = flat_file_use_mmap(&flat_file);
+
+	if (err_not_implemented == err) {
+		/* The data file can not be mapped here. */
+		ftest_takedown(tc, &flat_file);
+		return;
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, err);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, flat_file_use_mmap(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_illegal_state, flat_file_use_pax_layout(&flat_file, 4));
+	map_size = flat_file.map_size;
+
+	for (i = 0; i < 1000; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	ftest_get(tc, &flat_file, IONIZE(500, int), err_ok, IONIZE(1000, int));
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.map_size > map_size);
+
+	/* Scans test the rows in place in the mapping. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_scan(&flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_key_match, IONIZE(999, int)));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 999, loc);
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.region != flat_file.buffer);
+	PLANCK_UNIT_ASSERT_TRUE(tc, (ion_byte_t *) row.key == flat_file.map + flat_file.start_of_data + 999 * flat_file.row_size + sizeof(ion_flat_file_row_status_t));
+
+	ftest_update(tc, &flat_file, IONIZE(7, int), IONIZE(70, int), err_ok, 1);
+	ftest_delete(tc, &flat_file, IONIZE(3, int), err_ok, 1, boolean_true);
+	ftest_get(tc, &flat_file, IONIZE(999, int), err_ok, IONIZE(1998, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_flush(&flat_file));
+
+	/* Closing cuts the data file back to its rows. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 999 * flat_file.row_size, flat_file.eof_position);
+	fseek(flat_file.data_file, 0, SEEK_END);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.eof_position, ftell(flat_file.data_file));
+
+	ftest_get(tc, &flat_file, IONIZE(3, int), err_item_not_found, NULL);
+	ftest_get(tc, &flat_file, IONIZE(7, int), err_ok, IONIZE(70, int));
+	ftest_get(tc, &flat_file, IONIZE(999, int), err_ok, IONIZE(1998, int));
+
+	ftest_takedown(tc, &flat_file);
+}
+
 /**
 @brief		Tests the deletion edge case of deleting the last thing in the flat file.
 */
@@ -471,6 +929,251 @@ test_flat_file_delete_edge_case(
 	ftest_takedown(tc, &flat_file);
 }
 
+/**
+@brief		Tests that unsorted range scans pass over the zones whose keys are all
+			out of range, with the zones kept up by inserts and deletes.
+*/
+void
+test_flat_file_zone_range_scan(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t		flat_file;
+	ion_flat_file_row_t row;
+	ion_fpos_t			loc;
+	int					zone_rows;
+	int					i;
+
+	ftest_setup(tc, &flat_file);
+	zone_rows = flat_file.zone_rows;
+
+	if (3 > zone_rows) {
+		/* Range scans test every row, or the zones are too small for the keys used here. */
+		ftest_takedown(tc, &flat_file);
+		return;
+	}
+
+	/* The keys of the second zone are well above the first, and the third above both. */
+	for (i = 0; i < 3 * zone_rows; i++) {
+		ftest_insert(tc, &flat_file, IONIZE(i / zone_rows * 1000 + i % zone_rows, int), &i, err_ok, 1, boolean_false);
+	}
+
+	/* Once reopened, the first range scan builds the zones. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 15));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_zoned_rows);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_scan(&flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, IONIZE(1000 + zone_rows - 1, int), IONIZE(1999, int)));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2 * zone_rows - 1, loc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3 * zone_rows, flat_file.num_zoned_rows);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1000, NEUTRALIZE(&flat_file.zone_keys[2 * sizeof(int)], int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1000 + zone_rows - 1, NEUTRALIZE(&flat_file.zone_keys[3 * sizeof(int)], int));
+
+	/* A key written behind the zones' back is not found in a zone that is passed over. */
+	fseek(flat_file.data_file, flat_file.start_of_data + sizeof(ion_flat_file_row_status_t), SEEK_SET);
+	fwrite(IONIZE(1000, int), sizeof(int), 1, flat_file.data_file);
+	flat_file.current_loaded_region = -1;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_scan(&flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, IONIZE(1000, int), IONIZE(1000, int)));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, zone_rows, loc);
+	ftest_delete(tc, &flat_file, IONIZE(1000, int), err_ok, 2, boolean_true);
+
+	/* A delete moves the last row, with a key from the third zone, into the first. */
+	ftest_delete(tc, &flat_file, IONIZE(1, int), err_ok, 1, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_scan(&flat_file, -1, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, IONIZE(2000 + zone_rows - 3, int), IONIZE(2000 + zone_rows - 3, int)));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, loc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2000 + zone_rows - 3, NEUTRALIZE(row.key, int));
+
+	/* An insert widens the last zone. */
+	ftest_insert(tc, &flat_file, IONIZE(-50, int), IONIZE(5, int), err_ok, 1, boolean_false);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_scan(&flat_file, 2 * zone_rows, &loc, &row, ION_FLAT_FILE_SCAN_FORWARDS, flat_file_predicate_within_bounds, IONIZE(-100, int), IONIZE(-1, int)));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3 * zone_rows - 3, loc);
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests that tombstone deletes keep the order of the other rows, and
+			that the file is compacted once enough of its rows are dead.
+*/
+void
+test_flat_file_tombstone_delete_compact(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t		flat_file;
+	ion_flat_file_row_t row;
+	ion_fpos_t			loc;
+	int					expected[7] = { 1, 2, 4, 5, 6, 8, 9 };
+	int					i;
+
+	ftest_setup(tc, &flat_file);
+	flat_file.tombstone_deletes = boolean_true;
+
+	for (i = 0; i < 10; i++) {
+		ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+	}
+
+	ftest_delete(tc, &flat_file, IONIZE(3, int), err_ok, 1, boolean_true);
+	ftest_delete(tc, &flat_file, IONIZE(7, int), err_ok, 1, boolean_true);
+	ftest_delete(tc, &flat_file, IONIZE(7, int), err_item_not_found, 0, boolean_false);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, flat_file.num_dead_rows);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 10 * flat_file.row_size, flat_file.eof_position);
+	ftest_get(tc, &flat_file, IONIZE(9, int), err_ok, IONIZE(18, int));
+
+	/* The third dead row of ten passes the threshold. */
+	ftest_delete(tc, &flat_file, IONIZE(0, int), err_ok, 1, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_dead_rows);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 7 * flat_file.row_size, flat_file.eof_position);
+
+	for (i = 0; i < 7; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_read_row(&flat_file, i, &row));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_STATUS_OCCUPIED, row.row_status);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected[i], NEUTRALIZE(row.key, int));
+	}
+
+	ftest_insert(tc, &flat_file, IONIZE(11, int), IONIZE(22, int), err_ok, 1, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 8 * flat_file.row_size, flat_file.eof_position);
+
+	ftest_takedown(tc, &flat_file);
+
+	/* In sorted mode, searches skip over the dead rows, including a run of duplicates. */
+	ftest_setup_sorted(tc, &flat_file);
+
+	for (i = 0; i < 30; i++) {
+		ftest_insert(tc, &flat_file, IONIZE(i / 3, int), &i, err_ok, 1, boolean_false);
+	}
+
+	ftest_delete(tc, &flat_file, IONIZE(1, int), err_ok, 3, boolean_true);
+	ftest_delete(tc, &flat_file, IONIZE(3, int), err_ok, 3, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 30 * flat_file.row_size, flat_file.eof_position);
+
+	ftest_file_binary_search(tc, &flat_file, IONIZE(0, int), err_ok, 0);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(2, int), err_ok, 6);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_binary_search(&flat_file, IONIZE(1, int), &loc));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, loc);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_binary_search(&flat_file, IONIZE(3, int), &loc));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 8, loc);
+	ftest_get(tc, &flat_file, IONIZE(1, int), err_item_not_found, NULL);
+	ftest_get(tc, &flat_file, IONIZE(2, int), err_ok, IONIZE(6, int));
+	ftest_insert(tc, &flat_file, IONIZE(8, int), IONIZE(30, int), err_sorted_order_violation, 0, boolean_false);
+
+	/* Compacting by hand keeps the live rows in key order. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_compact(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 24 * flat_file.row_size, flat_file.eof_position);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(2, int), err_ok, 3);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(4, int), err_ok, 6);
+	ftest_insert(tc, &flat_file, IONIZE(9, int), IONIZE(30, int), err_ok, 1, boolean_true);
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Opens the flat file left by @ref test_flat_file_dead_rows_reopen with
+			tombstone deletes, mapped into memory for @p layout 2.
+@param		opened
+				Set to whether the file could be opened in that layout.
+*/
+void
+ftest_open_tombstones(
+	planck_unit_test_t	*tc,
+	ion_flat_file_t		*flat_file,
+	int					layout,
+	ion_boolean_t		*opened
+) {
+	*opened = boolean_false;
+	ftest_setup(tc, flat_file);
+	flat_file->tombstone_deletes = boolean_true;
+
+	if ((1 == layout) && (0 == flat_file->block_rows)) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_use_pax_layout(flat_file, 4));
+	}
+
+	if ((2 == layout) && (err_not_implemented == flat_file_use_mmap(flat_file))) {
+		/* The data file can not be mapped here. */
+		ftest_takedown(tc, flat_file);
+		return;
+	}
+
+	*opened = boolean_true;
+}
+
+/**
+@brief		Tests that compaction cuts the data file down to the live rows, and that
+			the dead rows still count toward compaction after the file is reopened,
+			in the row and PAX layouts and while mapped.
+*/
+void
+test_flat_file_dead_rows_reopen(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t flat_file;
+	ion_boolean_t	opened;
+	int				layout;
+	int				i;
+
+	for (layout = 0; layout < 3; layout++) {
+		ftest_open_tombstones(tc, &flat_file, layout, &opened);
+
+		if (!opened) {
+			continue;
+		}
+
+		for (i = 0; i < 20; i++) {
+			ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+		}
+
+		for (i = 0; i < 20; i += 5) {
+			ftest_delete(tc, &flat_file, &i, err_ok, 1, boolean_true);
+		}
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+
+		/* A clean header keeps the dead row count, so the fifth dead row of twenty passes the threshold. */
+		ftest_open_tombstones(tc, &flat_file, layout, &opened);
+		PLANCK_UNIT_ASSERT_TRUE(tc, opened);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, flat_file.num_dead_rows);
+
+		ftest_delete(tc, &flat_file, IONIZE(1, int), err_ok, 1, boolean_true);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_dead_rows);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 15 * flat_file.row_size, flat_file.eof_position);
+
+#if !defined(ARDUINO)
+
+		/* The PAX layout keeps the whole block holding the last row, and a mapped file keeps its mapped size. */
+		if (2 != layout) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, fseek(flat_file.data_file, 0, SEEK_END));
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + (0 == layout ? 15 : 16) * flat_file.row_size, ftell(flat_file.data_file));
+		}
+
+#endif
+
+		/* After a crash the header does not say, so the dead rows are counted at the next delete.
+		   The rows cut off by the compaction are not found again. */
+		ftest_delete(tc, &flat_file, IONIZE(2, int), err_ok, 1, boolean_true);
+		ftest_delete(tc, &flat_file, IONIZE(3, int), err_ok, 1, boolean_true);
+		ftest_crash(tc, &flat_file);
+
+		ftest_open_tombstones(tc, &flat_file, layout, &opened);
+		PLANCK_UNIT_ASSERT_TRUE(tc, opened);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, -1, flat_file.num_dead_rows);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 15 * flat_file.row_size, flat_file.eof_position);
+
+		ftest_delete(tc, &flat_file, IONIZE(4, int), err_ok, 1, boolean_true);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3, flat_file.num_dead_rows);
+
+		ftest_delete(tc, &flat_file, IONIZE(6, int), err_ok, 1, boolean_true);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_dead_rows);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 11 * flat_file.row_size, flat_file.eof_position);
+
+		for (i = 7; i < 20; i++) {
+			if (0 != i % 5) {
+				ftest_get(tc, &flat_file, &i, err_ok, IONIZE(i * 2, int));
+			}
+		}
+
+		ftest_takedown(tc, &flat_file);
+	}
+}
+
 /**
 @brief		Tests an invalid insertion that would violate sorted order.
 */
@@ -521,6 +1224,162 @@ test_flat_file_sort_binary_search_cases(
 	ftest_takedown(tc, &flat_file);
 }
 
+/**
+@brief		Searches for every key around the rows inserted by @ref test_flat_file_sort_fence_search,
+			where rows @c 3k to @c 3k+2 all have the key @c 2k.
+*/
+void
+ftest_fence_search_all(
+	planck_unit_test_t	*tc,
+	ion_flat_file_t		*flat_file,
+	int					num_rows
+) {
+	int key;
+
+	ftest_file_binary_search(tc, flat_file, IONIZE(-1, int), err_item_not_found, -1);
+
+	for (key = 0; key < 2 * (num_rows / 3); key++) {
+		ftest_file_binary_search(tc, flat_file, IONIZE(key, int), err_ok, 0 == key % 2 ? 3 * (key / 2) : 3 * (key / 2) + 2);
+	}
+
+	ftest_file_binary_search(tc, flat_file, IONIZE(2 * num_rows, int), err_ok, num_rows - 1);
+}
+
+/**
+@brief		Tests sorted searches through the fences, with duplicates running across fences,
+			fences kept up by inserts, and fences rebuilt after reopening.
+*/
+void
+test_flat_file_sort_fence_search(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t flat_file;
+	int				i;
+
+	ftest_create(tc, &flat_file, key_type_numeric_signed, sizeof(int), sizeof(int), 1);
+	flat_file.sorted_mode = boolean_true;
+
+	for (i = 0; i < 501; i++) {
+		ftest_insert(tc, &flat_file, IONIZE(2 * (i / 3), int), IONIZE(i, int), err_ok, 1, boolean_false);
+	}
+
+	ftest_fence_search_all(tc, &flat_file, 501);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, (501 + ION_FLAT_FILE_FENCE_ROWS - 1) / ION_FLAT_FILE_FENCE_ROWS, flat_file.num_fences);
+
+	for (; i < 600; i++) {
+		ftest_insert(tc, &flat_file, IONIZE(2 * (i / 3), int), IONIZE(i, int), err_ok, 1, boolean_false);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, (600 + ION_FLAT_FILE_FENCE_ROWS - 1) / ION_FLAT_FILE_FENCE_ROWS, flat_file.num_fences);
+	ftest_fence_search_all(tc, &flat_file, 600);
+
+	/* The header keeps sorted mode once the file is reopened. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_close(&flat_file));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_initialize(&flat_file, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 1));
+	flat_file.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, boolean_true, flat_file.sorted_mode);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_fences);
+	ftest_fence_search_all(tc, &flat_file, 600);
+	ftest_get(tc, &flat_file, IONIZE(256, int), err_ok, IONIZE(384, int));
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests sealing an empty flat file, then one that sorts in a single memory load.
+*/
+void
+test_flat_file_seal_in_memory(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t flat_file;
+
+	ftest_setup(tc, &flat_file);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_seal(&flat_file, 1024));
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.sorted_mode);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(3, int), err_item_not_found, -1);
+	ftest_takedown(tc, &flat_file);
+
+	ftest_setup(tc, &flat_file);
+
+	ftest_insert(tc, &flat_file, IONIZE(9, int), IONIZE(0, int), err_ok, 1, boolean_true);
+	ftest_insert(tc, &flat_file, IONIZE(2, int), IONIZE(1, int), err_ok, 1, boolean_true);
+	ftest_insert(tc, &flat_file, IONIZE(7, int), IONIZE(2, int), err_ok, 1, boolean_true);
+	ftest_insert(tc, &flat_file, IONIZE(-4, int), IONIZE(3, int), err_ok, 1, boolean_true);
+	ftest_insert(tc, &flat_file, IONIZE(7, int), IONIZE(4, int), err_ok, 1, boolean_true);
+	ftest_delete(tc, &flat_file, IONIZE(2, int), err_ok, 1, boolean_true);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_seal(&flat_file, 1024));
+	PLANCK_UNIT_ASSERT_TRUE(tc, flat_file.sorted_mode);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 4 * flat_file.row_size, flat_file.eof_position);
+
+	ftest_file_binary_search(tc, &flat_file, IONIZE(-4, int), err_ok, 0);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(7, int), err_ok, 1);
+	ftest_file_binary_search(tc, &flat_file, IONIZE(9, int), err_ok, 3);
+	ftest_get(tc, &flat_file, IONIZE(9, int), err_ok, IONIZE(0, int));
+	ftest_insert(tc, &flat_file, IONIZE(8, int), IONIZE(5, int), err_sorted_order_violation, 0, boolean_false);
+
+	ftest_takedown(tc, &flat_file);
+}
+
+/**
+@brief		Tests that sealing leaves the rows emptied by tombstone deletes out,
+			both when the rows sort in memory and when the runs are merged.
+*/
+void
+test_flat_file_seal_tombstones(
+	planck_unit_test_t *tc
+) {
+	ion_flat_file_t		flat_file;
+	ion_flat_file_row_t row;
+	size_t				budgets[2];
+	int					budget;
+	int					i;
+
+	for (budget = 0; budget < 2; budget++) {
+		ftest_setup(tc, &flat_file);
+		flat_file.tombstone_deletes = boolean_true;
+
+		budgets[0]	= 5 * flat_file.row_size;
+		budgets[1]	= 1024;
+
+		for (i = 19; i >= 0; i--) {
+			ftest_insert(tc, &flat_file, &i, IONIZE(i * 2, int), err_ok, 1, boolean_false);
+		}
+
+		/* Too few dead rows for a compaction, so they are still in the file. */
+		for (i = 0; i < 20; i += 5) {
+			ftest_delete(tc, &flat_file, &i, err_ok, 1, boolean_true);
+		}
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, flat_file.num_dead_rows);
+
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_seal(&flat_file, budgets[budget]));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, flat_file.num_dead_rows);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, flat_file.start_of_data + 16 * flat_file.row_size, flat_file.eof_position);
+
+		for (i = 0; i < 16; i++) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, flat_file_read_row(&flat_file, i, &row));
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_FLAT_FILE_STATUS_OCCUPIED, row.row_status);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i / 4 * 5 + i % 4 + 1, NEUTRALIZE(row.key, int));
+		}
+
+		for (i = 0; i < 20; i++) {
+			if (0 == i % 5) {
+				ftest_get(tc, &flat_file, &i, err_item_not_found, NULL);
+			}
+			else {
+				ftest_file_binary_search(tc, &flat_file, &i, err_ok, i / 5 * 4 + i % 5 - 1);
+				ftest_get(tc, &flat_file, &i, err_ok, IONIZE(i * 2, int));
+			}
+		}
+
+		ftest_takedown(tc, &flat_file);
+	}
+}
+
 /**
 @brief		Tests a sorted get on an empty store.
 */
@@ -773,11 +1632,24 @@ flat_file_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_insert_many);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_scan_cases_small_buf);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_scan_cases_large_buf);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_scan_grows_buffer);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_scan_key_sizes);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_match_key_in_stripe);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_delete_edge_case);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_append_buffer_torn_tail);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_pax_layout);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_header_clean_open);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_mmap);
 
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_insert_bad_sort);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_insert_good_sort);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_sort_binary_search_cases);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_sort_fence_search);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_seal_in_memory);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_seal_tombstones);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_tombstone_delete_compact);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_dead_rows_reopen);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_zone_range_scan);
 
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_sort_get_empty);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_sort_get_single_nonexist);
@@ -23,11 +23,194 @@
 
 #include "test_flat_file_dictionary_handler.h"
 
+/**
+@brief		Checks that a cursor in the given order returns the keys of
+			@p expected in order, each with a value one greater than its key.
+*/
+void
+ffhtest_cursor(
+	planck_unit_test_t	*tc,
+	ion_dictionary_t	*dictionary,
+	ion_predicate_t		*predicate,
+	ion_boolean_t		descending,
+	int					*expected,
+	int					num_expected
+) {
+	ion_dict_cursor_t	*cursor;
+	ion_record_t		record;
+	int					key;
+	int					value;
+	int					i;
+
+	record.key		= &key;
+	record.value	= &value;
+
+	if (descending) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_set_predicate_descending(predicate, boolean_true));
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(dictionary, predicate, &cursor));
+
+	for (i = 0; i < num_expected; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, cursor->next(cursor, &record));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected[i], key);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected[i] + 1, value);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_end_of_results, cursor->next(cursor, &record));
+
+	cursor->destroy(&cursor);
+}
+
+/**
+@brief		Tests descending range and all records cursors on a sorted
+			flat file, whose rows span several buffer loads.
+*/
+void
+test_flat_file_handler_descending_cursor(
+	planck_unit_test_t *tc
+) {
+	ion_dictionary_handler_t	handler;
+	ion_dictionary_t			dictionary;
+	ion_predicate_t				predicate;
+	ion_dict_cursor_t			*cursor;
+	int							expected[100];
+	int							key;
+	int							i;
+
+	ffdict_init(&handler);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_create(&handler, &dictionary, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 4));
+
+	/* Rows are only in key order in sorted mode. */
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	dictionary_set_predicate_descending(&predicate, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_not_implemented, dictionary_find(&dictionary, &predicate, &cursor));
+
+	((ion_flat_file_t *) dictionary.instance)->sorted_mode = boolean_true;
+
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected, 0);
+
+	/* Three copies of 0, then the even keys up to 60. */
+	for (i = 0; i < 3; i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_insert(&dictionary, IONIZE(0, int), IONIZE(1, int)).error);
+	}
+
+	for (key = 2; key <= 60; key += 2) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_insert(&dictionary, &key, IONIZE(key + 1, int)).error);
+	}
+
+	for (i = 0; i < 30; i++) {
+		expected[i] = 60 - 2 * i;
+	}
+
+	expected[30]	= 0;
+	expected[31]	= 0;
+	expected[32]	= 0;
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected, 33);
+
+	/* Upper bounds on a key, between keys, and past the end. */
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(10, int), IONIZE(20, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected + 20, 6);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(9, int), IONIZE(21, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected + 20, 6);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(55, int), IONIZE(1000, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected, 3);
+
+	/* The duplicates at the start of the file, and empty ranges. */
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(-10, int), IONIZE(1, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected + 30, 3);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(-10, int), IONIZE(-1, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected, 0);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(13, int), IONIZE(13, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, expected, 0);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_delete_dictionary(&dictionary));
+}
+
+/**
+@brief		Tests sealing a flat file written out of order, with too little
+			memory to sort it in one go, then reopening it in sorted mode.
+*/
+void
+test_flat_file_handler_seal(
+	planck_unit_test_t *tc
+) {
+	ion_dictionary_handler_t	handler;
+	ion_dictionary_t			dictionary;
+	ion_predicate_t				predicate;
+	int							expected[202];
+	int							key;
+	int							i;
+
+	ffdict_init(&handler);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_create(&handler, &dictionary, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 4));
+
+	/* Every key from 0 to 100 twice, in no particular order. */
+	for (i = 0; i < 202; i++) {
+		key = (i * 37) % 101;
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_insert(&dictionary, &key, IONIZE(key + 1, int)).error);
+		expected[i] = i / 2;
+	}
+
+	/* Eleven rows at a time makes 19 runs, which takes two merge passes. */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, ffdict_seal(&dictionary, 11 * ((ion_flat_file_t *) dictionary.instance)->row_size));
+	PLANCK_UNIT_ASSERT_TRUE(tc, ((ion_flat_file_t *) dictionary.instance)->sorted_mode);
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected, 202);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(10, int), IONIZE(20, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected + 20, 22);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(-5, int), IONIZE(0, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected, 2);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(101, int), IONIZE(200, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected, 0);
+	dictionary_build_predicate(&predicate, predicate_equality, IONIZE(50, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected + 100, 2);
+	dictionary_build_predicate(&predicate, predicate_equality, IONIZE(-1, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected, 0);
+
+	/* The header keeps the file in sorted mode once it is reopened. */
+	ion_dictionary_config_info_t config = {
+		dictionary.instance->id, 0, key_type_numeric_signed, sizeof(int), sizeof(int), 4
+	};
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_close(&dictionary));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_open(&handler, &dictionary, &config));
+	PLANCK_UNIT_ASSERT_TRUE(tc, ((ion_flat_file_t *) dictionary.instance)->sorted_mode);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_sorted_order_violation, dictionary_insert(&dictionary, IONIZE(5, int), IONIZE(6, int)).error);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(99, int), IONIZE(1000, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, expected + 202 - 4, 4);
+
+	/* Deletes in sorted mode leave empty rows that every cursor steps over. */
+	int around_deleted[4] = { 4, 4, 6, 6 };
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, dictionary_delete(&dictionary, IONIZE(5, int)).count);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, dictionary_get(&dictionary, IONIZE(5, int), IONIZE(0, int)).error);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(4, int), IONIZE(6, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, around_deleted, 4);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(5, int), IONIZE(6, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, around_deleted + 2, 2);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(4, int), IONIZE(5, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_true, around_deleted, 2);
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(5, int), IONIZE(5, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, around_deleted, 0);
+	dictionary_build_predicate(&predicate, predicate_equality, IONIZE(5, int));
+	ffhtest_cursor(tc, &dictionary, &predicate, boolean_false, around_deleted, 0);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_delete_dictionary(&dictionary));
+}
+
 planck_unit_suite_t *
 flat_file_handler_getsuite(
 ) {
 	planck_unit_suite_t *suite = planck_unit_new_suite();
 
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_handler_descending_cursor);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_flat_file_handler_seal);
+
 	return suite;
 }
 
@@ -0,0 +1,636 @@
+/******************************************************************************/
+/**
+@file
+@author		IonDB Project Contributors
+@brief		Implementation unit tests for the linear hash.
+@copyright	Copyright 2016
+				The University of British Columbia,
+				IonDB Project Contributors (see AUTHORS.md)
+@par
+			Licensed under the Apache License, Version 2.0 (the "License");
+			you may not use this file except in compliance with the License.
+			You may obtain a copy of the License at
+					http://www.apache.org/licenses/LICENSE-2.0
+@par
+			Unless required by applicable law or agreed to in writing,
+			software distributed under the License is distributed on an
+			"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+			either express or implied. See the License for the specific
+			language governing permissions and limitations under the
+			License.
+*/
+/******************************************************************************/
+
+#include "test_linear_hash.h"
+
+/**
+@brief		Initializes a test linear hash instance with integer keys and values.
+*/
+void
+lhtest_create(
+	planck_unit_test_t		*tc,
+	ion_linear_hash_t		*linear_hash,
+	ion_dictionary_size_t	dictionary_size
+) {
+	linear_hash->super.compare = dictionary_compare_signed_value;
+
+	ion_err_t err = linear_hash_initialize(linear_hash, 0, key_type_numeric_signed, sizeof(int), sizeof(int), dictionary_size);
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, err);
+}
+
+/**
+@brief		Destroys a linear hash instance and checks that its files are gone.
+*/
+void
+lhtest_destroy(
+	planck_unit_test_t	*tc,
+	ion_linear_hash_t	*linear_hash
+) {
+	char filename[ION_MAX_FILENAME_LENGTH];
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_destroy(linear_hash));
+
+	dictionary_get_filename(0, "lhb", filename);
+	PLANCK_UNIT_ASSERT_TRUE(tc, !ion_fexists(filename));
+	dictionary_get_filename(0, "lho", filename);
+	PLANCK_UNIT_ASSERT_TRUE(tc, !ion_fexists(filename));
+}
+
+/**
+@brief		Checks that each key below @p num_keys is stored with three times
+			its value exactly when @p stored says so.
+*/
+void
+lhtest_check_keys(
+	planck_unit_test_t	*tc,
+	ion_linear_hash_t	*linear_hash,
+	int					num_keys,
+	ion_boolean_t (*stored)(int)
+) {
+	int				i;
+	int				value;
+	ion_status_t	status;
+
+	for (i = 0; i < num_keys; i++) {
+		status = linear_hash_get(linear_hash, &i, &value);
+
+		if (stored(i)) {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, i * 3, value);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+		}
+	}
+}
+
+/**
+@brief		Every key is stored.
+*/
+ion_boolean_t
+lhtest_all_keys(
+	int key
+) {
+	UNUSED(key);
+	return boolean_true;
+}
+
+/**
+@brief		Only odd keys are stored.
+*/
+ion_boolean_t
+lhtest_odd_keys(
+	int key
+) {
+	return 0 != key % 2;
+}
+
+/**
+@brief		Tests that a new hash is sized for the dictionary size, and that
+			its files are removed.
+*/
+void
+test_linear_hash_create_destroy(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	int					page_slots;
+
+	lhtest_create(tc, &linear_hash, 1);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash_num_buckets(&linear_hash));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, linear_hash.header.num_records);
+	page_slots = linear_hash.header.page_slots;
+	lhtest_destroy(tc, &linear_hash);
+
+	/* Enough buckets for the records asked for, rounded up to a power of two */
+	lhtest_create(tc, &linear_hash, 0);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash_num_buckets(&linear_hash));
+	lhtest_destroy(tc, &linear_hash);
+
+	lhtest_create(tc, &linear_hash, 3 * page_slots);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, linear_hash_num_buckets(&linear_hash));
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests inserts, duplicate inserts, updates and deletes on a few records.
+*/
+void
+test_linear_hash_insert_update_delete(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	ion_status_t		status;
+	int					value;
+
+	lhtest_create(tc, &linear_hash, 16);
+
+	status = linear_hash_insert(&linear_hash, IONIZE(5, int), IONIZE(10, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, status.count);
+
+	status = linear_hash_insert(&linear_hash, IONIZE(5, int), IONIZE(11, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_duplicate_key, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, status.count);
+
+	status = linear_hash_get(&linear_hash, IONIZE(5, int), &value);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 10, value);
+
+	/* An update of a missing key inserts it */
+	status = linear_hash_update(&linear_hash, IONIZE(6, int), IONIZE(12, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	status = linear_hash_update(&linear_hash, IONIZE(5, int), IONIZE(-1, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, linear_hash.header.num_records);
+
+	status = linear_hash_get(&linear_hash, IONIZE(5, int), &value);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, -1, value);
+	status = linear_hash_get(&linear_hash, IONIZE(6, int), &value);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 12, value);
+
+	status = linear_hash_delete(&linear_hash, IONIZE(5, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, status.count);
+	status = linear_hash_delete(&linear_hash, IONIZE(5, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+	status = linear_hash_get(&linear_hash, IONIZE(5, int), &value);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash.header.num_records);
+
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests that a hash started with a single bucket grows one bucket at a
+			time, and that every record can still be found and deleted.
+*/
+void
+test_linear_hash_grow(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	ion_status_t		status;
+	int					num_keys;
+	int					buckets;
+	int					i;
+
+	lhtest_create(tc, &linear_hash, 1);
+
+	num_keys	= 20 * linear_hash.header.page_slots;
+	buckets		= linear_hash_num_buckets(&linear_hash);
+
+	for (i = 0; i < num_keys; i++) {
+		status = linear_hash_insert(&linear_hash, &i, IONIZE(i * 3, int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+
+		/* Never more than one split per insert */
+		PLANCK_UNIT_ASSERT_TRUE(tc, linear_hash_num_buckets(&linear_hash) - buckets <= 1);
+		buckets = linear_hash_num_buckets(&linear_hash);
+	}
+
+	/* The buckets are kept within the split load */
+	PLANCK_UNIT_ASSERT_TRUE(tc, (long) num_keys * 100 <= (long) ION_LINEAR_HASH_SPLIT_LOAD * buckets * linear_hash.header.page_slots);
+	PLANCK_UNIT_ASSERT_TRUE(tc, buckets >= 20);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, num_keys, linear_hash.header.num_records);
+
+	lhtest_check_keys(tc, &linear_hash, num_keys, lhtest_all_keys);
+
+	for (i = 0; i < num_keys; i += 2) {
+		status = linear_hash_delete(&linear_hash, &i);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	lhtest_check_keys(tc, &linear_hash, num_keys, lhtest_odd_keys);
+
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests that a scan of the slots returns every record once.
+*/
+void
+test_linear_hash_next(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t			linear_hash;
+	ion_linear_hash_location_t	location;
+	int							num_keys;
+	int							count	= 0;
+	long						sum		= 0;
+	int							i;
+
+	lhtest_create(tc, &linear_hash, 1);
+
+	num_keys = 5 * linear_hash.header.page_slots;
+
+	for (i = 0; i < num_keys; i++) {
+		linear_hash_insert(&linear_hash, &i, IONIZE(i * 3, int));
+	}
+
+	location.bucket = ION_LINEAR_HASH_NO_PAGE;
+
+	while (err_ok == linear_hash_next(&linear_hash, &location)) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, *(int *) location.key * 3, *(int *) location.value);
+		sum += *(int *) location.key;
+		count++;
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, num_keys, count);
+	PLANCK_UNIT_ASSERT_TRUE(tc, (long) num_keys * (num_keys - 1) / 2 == sum);
+
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests that keys that all land in one bucket are kept in a chain of
+			overflow pages, whose slots are reused after deletes.
+*/
+void
+test_linear_hash_overflow(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	ion_status_t		status;
+	int					num_keys;
+	int					i;
+
+	/* Plenty of buckets, so the records below do not cause a split */
+	lhtest_create(tc, &linear_hash, 64 * 1024);
+
+	num_keys = 3 * linear_hash.header.page_slots;
+
+	/* Keys with the same low bits of their hash share a bucket */
+	int			*keys	= malloc(num_keys * sizeof(int));
+	uint32_t	mask	= linear_hash_num_buckets(&linear_hash) - 1;
+	uint32_t	target	= dictionary_hash_key(IONIZE(0, int), key_type_numeric_signed, sizeof(int)) & mask;
+	int			key		= 0;
+
+	for (i = 0; i < num_keys; key++) {
+		if ((dictionary_hash_key(&key, key_type_numeric_signed, sizeof(int)) & mask) == target) {
+			keys[i++] = key;
+		}
+	}
+
+	for (i = 0; i < num_keys; i++) {
+		status = linear_hash_insert(&linear_hash, &keys[i], IONIZE(keys[i] * 3, int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, linear_hash.header.split);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, linear_hash.header.overflow_pages);
+
+	for (i = 0; i < num_keys; i++) {
+		int value;
+
+		status = linear_hash_get(&linear_hash, &keys[i], &value);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, keys[i] * 3, value);
+	}
+
+	/* Freed slots in the chain are used again before the chain grows */
+	int overflow_pages = linear_hash.header.overflow_pages;
+
+	for (i = 0; i < num_keys; i++) {
+		linear_hash_delete(&linear_hash, &keys[i]);
+	}
+
+	for (i = 0; i < num_keys; i++) {
+		status = linear_hash_insert(&linear_hash, &keys[i], IONIZE(keys[i] * 3, int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, overflow_pages, linear_hash.header.overflow_pages);
+
+	free(keys);
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests that a hash closed after growing opens with all its buckets and
+			records.
+*/
+void
+test_linear_hash_reopen(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	int					num_keys;
+	int					buckets;
+	int					i;
+
+	lhtest_create(tc, &linear_hash, 1);
+
+	num_keys = 7 * linear_hash.header.page_slots;
+
+	for (i = 0; i < num_keys; i++) {
+		linear_hash_insert(&linear_hash, &i, IONIZE(i * 3, int));
+	}
+
+	for (i = 0; i < num_keys; i += 2) {
+		linear_hash_delete(&linear_hash, &i);
+	}
+
+	buckets = linear_hash_num_buckets(&linear_hash);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_close(&linear_hash));
+
+	/* The dictionary size is only used for new files */
+	lhtest_create(tc, &linear_hash, 1000);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, buckets, linear_hash_num_buckets(&linear_hash));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, num_keys / 2, linear_hash.header.num_records);
+	lhtest_check_keys(tc, &linear_hash, num_keys, lhtest_odd_keys);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_close(&linear_hash));
+
+	/* Files of other records are refused */
+	linear_hash.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_dictionary_initialization_failed, linear_hash_initialize(&linear_hash, 0, key_type_numeric_signed, sizeof(int), sizeof(long long), 1));
+
+	lhtest_create(tc, &linear_hash, 1);
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Opens one of the files of the test linear hash so that reads work but
+			writes fail.
+*/
+ion_file_handle_t
+lhtest_open_read_only(
+	char *ext
+) {
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	ion_file_handle_t	file;
+
+	dictionary_get_filename(0, ext, filename);
+#if defined(ARDUINO)
+	file.file	= fopen(filename, "r");
+#else
+	file		= fopen(filename, "rb");
+#endif
+	return file;
+}
+
+/**
+@brief		Counts the records a scan of the slots returns.
+*/
+int
+lhtest_scan_count(
+	ion_linear_hash_t *linear_hash
+) {
+	ion_linear_hash_location_t	location;
+	int							count = 0;
+
+	location.bucket = ION_LINEAR_HASH_NO_PAGE;
+
+	while (err_ok == linear_hash_next(linear_hash, &location)) {
+		count++;
+	}
+
+	return count;
+}
+
+/**
+@brief		Checks that each of @p keys is stored, with the key at the start of
+			its value.
+*/
+void
+lhtest_check_split_keys(
+	planck_unit_test_t	*tc,
+	ion_linear_hash_t	*linear_hash,
+	int					*keys,
+	int					num_keys
+) {
+	ion_byte_t		value[ION_LINEAR_HASH_PAGE_SIZE];
+	ion_status_t	status;
+	int				i;
+
+	for (i = 0; i < num_keys; i++) {
+		status = linear_hash_get(linear_hash, &keys[i], value);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, status.error);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, keys[i], *(int *) value);
+	}
+}
+
+/**
+@brief		Tests that every record can still be found when a write fails
+			during a split, both before and after the new bucket is committed.
+*/
+void
+test_linear_hash_split_failure(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	ion_file_handle_t	file;
+	ion_status_t		status;
+	ion_byte_t			value[ION_LINEAR_HASH_PAGE_SIZE];
+	/* Values sized so that a page holds four records */
+	int					value_size = (ION_LINEAR_HASH_PAGE_SIZE - (int) sizeof(int)) / 4 - (int) sizeof(ion_linear_hash_slot_status_t) - (int) sizeof(int);
+	int					keys[9];
+	int					stay	= 0;
+	int					move	= 5;
+	int					key;
+	int					i;
+
+	linear_hash.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_initialize(&linear_hash, 0, key_type_numeric_signed, sizeof(int), value_size, 1));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, linear_hash.header.page_slots);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash_num_buckets(&linear_hash));
+
+	/* Five keys that stay in bucket 0 when it is split, then three that move to bucket 1 */
+	for (key = 0; (stay < 5) || (move < 8); key++) {
+		if (0 != (dictionary_hash_key(&key, key_type_numeric_signed, sizeof(int)) & 1)) {
+			if (move < 8) {
+				keys[move++] = key;
+			}
+		}
+		else if (stay < 5) {
+			keys[stay++] = key;
+		}
+	}
+
+	/* An unused key to insert last */
+	keys[8] = key;
+
+	memset(value, 0, sizeof(value));
+
+	/* Hold off splits while four staying keys fill the bucket page and two moving keys go on an overflow page */
+	linear_hash.header.num_records = -100;
+
+	for (i = 0; i < 7; i++) {
+		if (4 != i) {
+			memcpy(value, &keys[i], sizeof(int));
+			PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_insert(&linear_hash, &keys[i], value).error);
+		}
+	}
+
+	linear_hash.header.num_records = 6;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash.header.overflow_pages);
+
+	/* The new bucket page cannot be written, so the split fails before the new bucket exists */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_flush(&linear_hash));
+	file					= linear_hash.bucket_file;
+	linear_hash.bucket_file = lhtest_open_read_only("lhb");
+
+	memcpy(value, &keys[7], sizeof(int));
+	status					= linear_hash_insert(&linear_hash, &keys[7], value);
+
+	ion_fclose(linear_hash.bucket_file);
+	linear_hash.bucket_file = file;
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash_num_buckets(&linear_hash));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_LINEAR_HASH_NO_PAGE, linear_hash.header.stale_bucket);
+	lhtest_check_split_keys(tc, &linear_hash, keys, 4);
+	lhtest_check_split_keys(tc, &linear_hash, keys + 5, 3);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 7, lhtest_scan_count(&linear_hash));
+
+	/* Make room on the bucket page, so the next insert is written to the bucket file */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_delete(&linear_hash, &keys[0]).error);
+
+	/* The split commits the new bucket, but the moved records on the overflow page cannot be cleared */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_flush(&linear_hash));
+	file						= linear_hash.overflow_file;
+	linear_hash.overflow_file	= lhtest_open_read_only("lho");
+
+	memcpy(value, &keys[4], sizeof(int));
+	status						= linear_hash_insert(&linear_hash, &keys[4], value);
+
+	ion_fclose(linear_hash.overflow_file);
+	linear_hash.overflow_file	= file;
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != status.error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 2, linear_hash_num_buckets(&linear_hash));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, linear_hash.header.stale_bucket);
+	lhtest_check_split_keys(tc, &linear_hash, keys + 1, 7);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 7, lhtest_scan_count(&linear_hash));
+
+	/* The next split clears the copies first */
+	memcpy(value, &keys[8], sizeof(int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_insert(&linear_hash, &keys[8], value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 3, linear_hash_num_buckets(&linear_hash));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, ION_LINEAR_HASH_NO_PAGE, linear_hash.header.stale_bucket);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash.header.overflow_pages);
+	lhtest_check_split_keys(tc, &linear_hash, keys + 1, 8);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 8, lhtest_scan_count(&linear_hash));
+
+	lhtest_destroy(tc, &linear_hash);
+}
+
+/**
+@brief		Tests that a freed overflow page, which still holds the records it
+			had, cannot bring them back when it is reused and a write fails.
+*/
+void
+test_linear_hash_reuse_overflow(
+	planck_unit_test_t *tc
+) {
+	ion_linear_hash_t	linear_hash;
+	ion_file_handle_t	file;
+	ion_status_t		status;
+	ion_byte_t			value[ION_LINEAR_HASH_PAGE_SIZE];
+	/* Values sized so that a page holds four records */
+	int					value_size	= (ION_LINEAR_HASH_PAGE_SIZE - (int) sizeof(int)) / 4 - (int) sizeof(ion_linear_hash_slot_status_t) - (int) sizeof(int);
+	int					keys[7]		= { 0, 1, 2, 3, 4, 5, 6 };
+	int					no_page		= ION_LINEAR_HASH_NO_PAGE;
+	int					overflow;
+	int					i;
+
+	linear_hash.super.compare = dictionary_compare_signed_value;
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_initialize(&linear_hash, 0, key_type_numeric_signed, sizeof(int), value_size, 1));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, linear_hash.header.page_slots);
+
+	memset(value, 0, sizeof(value));
+
+	/* Hold off splits while four keys fill the bucket page and two go on an overflow page */
+	linear_hash.header.num_records = -100;
+
+	for (i = 0; i < 6; i++) {
+		memcpy(value, &keys[i], sizeof(int));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_insert(&linear_hash, &keys[i], value).error);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 1, linear_hash.header.overflow_pages);
+
+	/* Free the overflow page as a cut short split leaves it, with only the links changed and its records still in place */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, ion_fread_at(linear_hash.bucket_file, sizeof(ion_linear_hash_header_t), sizeof(int), (ion_byte_t *) &overflow));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, ion_fwrite_at(linear_hash.bucket_file, sizeof(ion_linear_hash_header_t), sizeof(int), (ion_byte_t *) &no_page));
+	linear_hash.header.free_page	= overflow;
+	linear_hash.page.bucket			= ION_LINEAR_HASH_NO_PAGE;
+	linear_hash.page.overflow		= ION_LINEAR_HASH_NO_PAGE;
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, lhtest_scan_count(&linear_hash));
+
+	/* The reused page cannot be written, so the chain must not be linked to it */
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_flush(&linear_hash));
+	file						= linear_hash.overflow_file;
+	linear_hash.overflow_file	= lhtest_open_read_only("lho");
+
+	memcpy(value, &keys[6], sizeof(int));
+	status						= linear_hash_insert(&linear_hash, &keys[6], value);
+
+	ion_fclose(linear_hash.overflow_file);
+	linear_hash.overflow_file	= file;
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != status.error);
+	lhtest_check_split_keys(tc, &linear_hash, keys, 4);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, linear_hash_get(&linear_hash, &keys[4], value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, linear_hash_get(&linear_hash, &keys[5], value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 4, lhtest_scan_count(&linear_hash));
+
+	/* Once written, the new page holds only the new record */
+	memcpy(value, &keys[6], sizeof(int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, linear_hash_insert(&linear_hash, &keys[6], value).error);
+	lhtest_check_split_keys(tc, &linear_hash, keys, 4);
+	lhtest_check_split_keys(tc, &linear_hash, keys + 6, 1);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, linear_hash_get(&linear_hash, &keys[4], value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_item_not_found, linear_hash_get(&linear_hash, &keys[5], value).error);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 5, lhtest_scan_count(&linear_hash));
+
+	lhtest_destroy(tc, &linear_hash);
+}
+
+planck_unit_suite_t *
+linear_hash_getsuite(
+) {
+	planck_unit_suite_t *suite = planck_unit_new_suite();
+
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_create_destroy);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_insert_update_delete);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_grow);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_next);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_overflow);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_reopen);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_split_failure);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_linear_hash_reuse_overflow);
+
+	return suite;
+}
+
+void
+runalltests_linear_hash(
+) {
+	planck_unit_suite_t *suite = linear_hash_getsuite();
+
+	planck_unit_run_suite(suite);
+	planck_unit_destroy_suite(suite);
+}
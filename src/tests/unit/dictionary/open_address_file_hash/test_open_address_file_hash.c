@@ -25,7 +25,8 @@ check_file_map(
 	int i;
 	int bucket_size = map->super.record.key_size + map->super.record.value_size + sizeof(char);
 
-	frewind(map->file);
+	oafh_flush(map);
+	fseek(map->file, sizeof(ion_oafh_header_t), SEEK_SET);
 
 	ion_hash_bucket_t *record;
 
@@ -149,6 +150,53 @@ test_open_address_file_hashmap_get_location(
 	}
 }
 
+/**
+@brief		Tests that the key type aware hash handles char array keys that share
+			a prefix, and that a power of two map masks instead of dividing.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_file_hashmap_compute_hash(
+	planck_unit_test_t *tc
+) {
+	ion_file_hashmap_t	map;
+	int					i;
+	ion_status_t			status;
+	char				key[9];
+	char				value[10];
+
+	for (i = 0; i < ION_MAX_HASH_TEST; i++) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, (i & 15) == oafh_get_location((ion_hash_t) i, 16));
+	}
+
+	map.super.compare	= dictionary_compare_unsigned_value;
+	map.super.key_type	= key_type_char_array;
+	map.super.id		= 0;
+	oafh_initialize(&map, oafh_compute_hash, key_type_char_array, sizeof(key), sizeof(value), 16, 0);
+
+	for (i = 0; i < 16; i++) {
+		sprintf(key, "key_%04d", i);
+		sprintf(value, "%02i is key", i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, oafh_compute_hash(&map, key, sizeof(key)) >= 0);
+		status = oafh_insert(&map, key, value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < 16; i++) {
+		char expected[10];
+
+		sprintf(key, "key_%04d", i);
+		sprintf(expected, "%02i is key", i);
+		status = oafh_query(&map, key, value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_STR_ARE_EQUAL(tc, expected, value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_destroy(&map));
+}
+
 /**
 @brief		Test locating an element in the hashmap and returns the physical
 			address of the item.
@@ -199,7 +247,7 @@ test_open_address_file_hashmap_find_item_location(
 
 		/* printf("writing to %i\n",(offset*bucket_size)%(map.map_size*bucket_size)); */
 
-		fseek(map.file, (offset * bucket_size) % (map.map_size * bucket_size), SEEK_SET);
+		fseek(map.file, sizeof(ion_oafh_header_t) + (offset * bucket_size) % (map.map_size * bucket_size), SEEK_SET);
 
 		for (i = 0; i < map.map_size; i++) {
 			item_ptr->status = ION_IN_USE;
@@ -217,10 +265,13 @@ test_open_address_file_hashmap_find_item_location(
 			fwrite(item_ptr, bucket_size, 1, map.file);
 			/* printf("Moving to position %i\n", ((((i+1+offset)%map.map_size)*bucket_size )%(map.map_size*bucket_size))); */
 			/* pos_ptr = map.entry + ((((i+1+offset)%map.map_size)*bucket_size )%(map.map_size*bucket_size)); */
-			fseek(map.file, ((((i + 1 + offset) % map.map_size) * bucket_size) % (map.map_size * bucket_size)), SEEK_SET);
+			fseek(map.file, sizeof(ion_oafh_header_t) + ((((i + 1 + offset) % map.map_size) * bucket_size) % (map.map_size * bucket_size)), SEEK_SET);
 			/* printf("current file pos: %i\n",(int)	ftell(map.file)); */
 		}
 
+		/* drop any pages cached before the file was written directly */
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_drop_pages(&map));
+
 		/* and now check key positions */
 		for (i = 0; i < map.map_size; i++) {
 			int location;
@@ -276,9 +327,12 @@ test_open_address_file_hashmap_simple_insert(
 			}
 		}
 
+		/* write the cached pages out so the file can be read directly */
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_flush(&map));
+
 		for (i = 0; i < map.map_size; i++) {
 			/* set the position in the file */
-			fseek(map.file, ((((i + offset) % map.map_size) * bucket_size) % (map.map_size * bucket_size)), SEEK_SET);
+			fseek(map.file, sizeof(ion_oafh_header_t) + ((((i + offset) % map.map_size) * bucket_size) % (map.map_size * bucket_size)), SEEK_SET);
 
 			ion_record_status_t record_status;	/* = ((ion_hash_bucket_t *)(map.entry + ((((i+offset)%map.map_size)*bucket_size )%(map.map_size*bucket_size))))->status; */
 			int					key;	/* = *(int *)(((ion_hash_bucket_t *)(map.entry + ((((i+offset)%map.map_size)*bucket_size )%(map.map_size*bucket_size))))->data ); */
@@ -979,6 +1033,219 @@ test_open_address_file_hashmap_capacity(
 	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_destroy(&map));
 }
 
+/**
+@brief	  Tests a map larger than the page cache, so pages are evicted and
+			read back while records are inserted, deleted and queried.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_file_hashmap_page_cache(
+	planck_unit_test_t *tc
+) {
+	ion_file_hashmap_t	map;
+	ion_record_info_t	record;
+	ion_status_t		status;
+	int					i;
+	int					value;
+	int					map_size;
+
+	record.key_size		= sizeof(int);
+	record.value_size	= sizeof(int);
+	map.super.key_type	= key_type_numeric_signed;
+
+	/* twice as many buckets as the cache holds */
+	map_size			= 2 * ION_OAFH_CACHE_PAGES * (ION_OAFH_PAGE_SIZE / (SIZEOF(STATUS) + 2 * sizeof(int)));
+	initialize_file_hash_map(map_size, &record, &map);
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, map.map_size > map.num_pages * map.page_buckets);
+
+	for (i = 0; i < map_size / 2; i++) {
+		value	= i * 3;
+		status	= oafh_insert(&map, &i, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < map_size / 2; i += 2) {
+		status = oafh_delete(&map, &i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < map_size / 2; i++) {
+		status = oafh_query(&map, &i, &value);
+
+		if (0 == i % 2) {
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_item_not_found == status.error);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+			PLANCK_UNIT_ASSERT_TRUE(tc, i * 3 == value);
+		}
+	}
+
+	/* after the cache is dropped every record is read back from the file */
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_drop_pages(&map));
+
+	for (i = 1; i < map_size / 2; i += 2) {
+		status = oafh_query(&map, &i, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_TRUE(tc, i * 3 == value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_destroy(&map));
+}
+
+#if !defined(ARDUINO)
+
+/**
+@brief	  Tests that a flush keeps its pages cached, that a page which could
+			not be written keeps its changes, and that read errors are
+			returned by lookups rather than taken as missing keys.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_file_hashmap_flush_errors(
+	planck_unit_test_t *tc
+) {
+	ion_file_hashmap_t	map;
+	ion_record_info_t	record;
+	ion_status_t		status;
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	FILE				*file;
+	int					location;
+	int					value;
+	int					i;
+
+	record.key_size		= sizeof(int);
+	record.value_size	= sizeof(int);
+	map.super.key_type	= key_type_numeric_signed;
+	initialize_file_hash_map(ION_STD_MAP_SIZE, &record, &map);
+	dictionary_get_filename(map.super.id, "oaf", filename);
+
+	for (i = 0; i < 5; i++) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_insert(&map, &i, IONIZE(i * 3, int)).error);
+	}
+
+	/* A flush leaves the pages cached and clean */
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_flush(&map));
+	PLANCK_UNIT_ASSERT_TRUE(tc, -1 != map.pages[0].page);
+	PLANCK_UNIT_ASSERT_TRUE(tc, !map.pages[0].dirty);
+
+	/* A file that can not be written fails the flush, and the changed page is kept */
+	file		= map.file;
+	map.file	= fopen(filename, "rb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != map.file);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_insert(&map, IONIZE(5, int), IONIZE(15, int)).error);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok != oafh_drop_pages(&map));
+	PLANCK_UNIT_ASSERT_TRUE(tc, -1 != map.pages[0].page);
+	PLANCK_UNIT_ASSERT_TRUE(tc, map.pages[0].dirty);
+	fclose(map.file);
+	map.file = file;
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_drop_pages(&map));
+	PLANCK_UNIT_ASSERT_TRUE(tc, -1 == map.pages[0].page);
+
+	status = oafh_query(&map, IONIZE(5, int), &value);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	PLANCK_UNIT_ASSERT_TRUE(tc, 15 == value);
+
+	/* With nothing cached and a file that can not be read, lookups report the read error */
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_drop_pages(&map));
+	map.file = fopen(filename, "ab");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != map.file);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_file_read_error == oafh_find_item_loc(&map, IONIZE(2, int), &location));
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_file_read_error == oafh_query(&map, IONIZE(2, int), &value).error);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_file_read_error == oafh_delete(&map, IONIZE(2, int)).error);
+	fclose(map.file);
+	map.file = file;
+
+	for (i = 0; i < 6; i++) {
+		status = oafh_query(&map, &i, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_TRUE(tc, i * 3 == value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_destroy(&map));
+}
+
+/**
+@brief	  Tests that a file written before the file header is rebuilt when
+			opened, so its records are found with the current hash, and that
+			a file of another version is refused.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_file_hashmap_old_file(
+	planck_unit_test_t *tc
+) {
+	ion_file_hashmap_t	map;
+	ion_oafh_header_t	header;
+	ion_byte_t			bucket[1 + 2 * sizeof(int)];
+	char				filename[ION_MAX_FILENAME_LENGTH];
+	char				old_filename[ION_MAX_FILENAME_LENGTH];
+	FILE				*file;
+	int					value;
+	int					i;
+
+	dictionary_get_filename(0, "oaf", filename);
+	dictionary_get_filename(0, "oao", old_filename);
+
+	/* The old layout: buckets from the start of the file, key i in bucket i, and key 20 deleted */
+	file = fopen(filename, "wb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+
+	for (i = 0; i < ION_STD_MAP_SIZE; i++) {
+		memset(bucket, 0, sizeof(bucket));
+		((ion_hash_bucket_t *) bucket)->status = i < 10 ? ION_IN_USE : (10 == i ? ION_DELETED : ION_EMPTY);
+		memcpy(bucket + 1, IONIZE(10 == i ? 20 : i, int), sizeof(int));
+		memcpy(bucket + 1 + sizeof(int), IONIZE(i * 3, int), sizeof(int));
+		PLANCK_UNIT_ASSERT_TRUE(tc, 1 == fwrite(bucket, sizeof(bucket), 1, file));
+	}
+
+	fclose(file);
+
+	map.super.compare	= dictionary_compare_signed_value;
+	map.super.id		= 0;
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_initialize(&map, oafh_compute_hash, key_type_numeric_signed, sizeof(int), sizeof(int), ION_STD_MAP_SIZE, 0));
+
+	for (i = 0; i < 10; i++) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_query(&map, &i, &value).error);
+		PLANCK_UNIT_ASSERT_TRUE(tc, i * 3 == value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_item_not_found == oafh_query(&map, IONIZE(20, int), &value).error);
+
+	/* The rebuilt file has the header, and the old one is gone */
+	file = fopen(filename, "rb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_TRUE(tc, 1 == fread(&header, sizeof(header), 1, file));
+	fclose(file);
+	PLANCK_UNIT_ASSERT_TRUE(tc, ION_OAFH_MAGIC == header.magic);
+	PLANCK_UNIT_ASSERT_TRUE(tc, ION_OAFH_FILE_VERSION == header.version);
+
+	file = fopen(old_filename, "rb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL == file);
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oafh_destroy(&map));
+
+	/* A file of another version is left alone */
+	header.version	= ION_OAFH_FILE_VERSION + 1;
+	file			= fopen(filename, "wb");
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != file);
+	PLANCK_UNIT_ASSERT_TRUE(tc, 1 == fwrite(&header, sizeof(header), 1, file));
+	fclose(file);
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_file_open_error == oafh_initialize(&map, oafh_compute_hash, key_type_numeric_signed, sizeof(int), sizeof(int), ION_STD_MAP_SIZE, 0));
+	PLANCK_UNIT_ASSERT_TRUE(tc, 0 == fremove(filename));
+}
+
+#endif
+
 planck_unit_suite_t *
 open_address_file_hashmap_getsuite(
 ) {
@@ -987,6 +1254,7 @@ open_address_file_hashmap_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_initialize);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_compute_simple_hash);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_get_location);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_compute_hash);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_find_item_location);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_simple_insert);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_simple_insert_and_query);
@@ -998,6 +1266,11 @@ open_address_file_hashmap_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_delete_1);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_delete_2);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_capacity);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_page_cache);
+#if !defined(ARDUINO)
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_flush_errors);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_file_hashmap_old_file);
+#endif
 
 	return suite;
 }
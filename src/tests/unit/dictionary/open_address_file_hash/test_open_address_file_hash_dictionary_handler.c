@@ -101,7 +101,7 @@ test_open_address_file_hashmap_handler_create_destroy(
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->super.record.key_size) == record.key_size);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->super.record.value_size) == record.value_size);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->map_size) == size);
-	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->compute_hash) == &oafh_compute_simple_hash);
+	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->compute_hash) == &oafh_compute_hash);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_file_hashmap_t *) test_dictionary.instance)->write_concern) == wc_insert_unique);
 	PLANCK_UNIT_ASSERT_TRUE(tc, test_dictionary.handler->delete_dictionary(&test_dictionary) == err_ok);
 	PLANCK_UNIT_ASSERT_TRUE(tc, test_dictionary.instance == NULL);
@@ -494,7 +494,7 @@ test_open_address_file_dictionary_cursor_range(
 		ion_value_t str;
 
 		str = malloc(record_info.value_size);
-		sprintf((char *) str, "value : %i", (*(int *) predicate.statement.range.lower_bound) + result_count);
+		sprintf((char *) str, "value : %i", *(int *) record.key);
 
 		PLANCK_UNIT_ASSERT_TRUE(tc, ION_IS_EQUAL == memcmp(record.value, str, record_info.value_size));
 		result_count++;
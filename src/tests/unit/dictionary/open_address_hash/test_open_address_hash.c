@@ -133,6 +133,52 @@ test_open_address_hashmap_get_location(
 	}
 }
 
+/**
+@brief		Tests that the key type aware hash handles char array keys that share
+			a prefix, and that a power of two map masks instead of dividing.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_hashmap_compute_hash(
+	planck_unit_test_t *tc
+) {
+	ion_hashmap_t		map;
+	int				i;
+	ion_status_t	status;
+	char			key[9];
+	char			value[10];
+
+	for (i = 0; i < ION_MAX_HASH_TEST; i++) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, (i & 15) == oah_get_location((ion_hash_t) i, 16));
+	}
+
+	map.super.compare	= dictionary_compare_unsigned_value;
+	map.super.key_type	= key_type_char_array;
+	oah_initialize(&map, oah_compute_hash, key_type_char_array, sizeof(key), sizeof(value), 16);
+
+	for (i = 0; i < 16; i++) {
+		sprintf(key, "key_%04d", i);
+		sprintf(value, "%02i is key", i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, oah_compute_hash(&map, key, sizeof(key)) >= 0);
+		status = oah_insert(&map, key, value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < 16; i++) {
+		char expected[10];
+
+		sprintf(key, "key_%04d", i);
+		sprintf(expected, "%02i is key", i);
+		status = oah_query(&map, key, value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_STR_ARE_EQUAL(tc, expected, value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+}
+
 /**
 @brief		Test locating an element in the hashmap and returns the physical
 			address of the item.
@@ -188,6 +234,8 @@ test_open_address_hashmap_find_item_location(
 			/* Copy it directly into the slot */
 			memcpy((item_ptr->data + record.key_size), str, 10);
 			memcpy(pos_ptr, item_ptr, bucket_size);
+			/* Probes read the control bytes before the buckets */
+			map.control[(i + offset) % map.map_size] = ION_OAH_CONTROL_HASH(oah_compute_simple_hash(&map, &i, sizeof(i)));
 			pos_ptr = map.entry + ((((i + 1 + offset) % map.map_size) * bucket_size) % (map.map_size * bucket_size));
 		}
 
@@ -973,6 +1021,230 @@ test_open_address_hashmap_capacity(
 	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
 }
 
+/**
+@brief		Tests probes that run across several groups of control bytes and
+			wrap around the end of the map, with deletions along the way.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_hashmap_control_groups(
+	planck_unit_test_t *tc
+) {
+	ion_hashmap_t	map;
+	int				i;
+	int				key;
+	int				value;
+	ion_status_t	status;
+
+	map.super.compare	= dictionary_compare_signed_value;
+	map.super.key_type	= key_type_numeric_signed;
+	oah_initialize(&map, oah_compute_simple_hash, key_type_numeric_signed, sizeof(int), sizeof(int), 64);
+
+	/* Every key hashes to the same home, 60, so the probes wrap around. */
+	for (i = 0; i < 64; i++) {
+		key		= 60 + i * 64;
+		status	= oah_insert(&map, &key, &i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	key		= 60 + 64 * 64;
+	status	= oah_insert(&map, &key, &i);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_max_capacity == status.error);
+
+	for (i = 0; i < 64; i += 3) {
+		key		= 60 + i * 64;
+		status	= oah_delete(&map, &key);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < 64; i++) {
+		key		= 60 + i * 64;
+		status	= oah_query(&map, &key, &value);
+
+		if (0 == i % 3) {
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_item_not_found == status.error);
+		}
+		else {
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+			PLANCK_UNIT_ASSERT_TRUE(tc, i == value);
+		}
+	}
+
+	/* Deleted slots are reused, and keys further along are not duplicated. */
+	for (i = 0; i < 64; i++) {
+		key		= 60 + i * 64;
+		status	= oah_insert(&map, &key, &i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, (0 == i % 3 ? err_ok : err_duplicate_key) == status.error);
+	}
+
+	for (i = 0; i < 64; i++) {
+		key		= 60 + i * 64;
+		status	= oah_query(&map, &key, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_TRUE(tc, i == value);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+}
+
+/**
+@brief		Tests that a map with a load factor grows past its initial size,
+			and that every record stays reachable while rehashing runs.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_hashmap_grow(
+	planck_unit_test_t *tc
+) {
+	ion_hashmap_t	map;
+	int				i;
+	int				j;
+	int				value;
+	ion_status_t	status;
+
+	map.super.compare	= dictionary_compare_signed_value;
+	map.super.key_type	= key_type_numeric_signed;
+	oah_initialize(&map, oah_compute_simple_hash, key_type_numeric_signed, sizeof(int), sizeof(int), 8);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_illegal_state == oah_set_load_factor(&map, ION_OAH_DEFAULT_LOAD_FACTOR));
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+
+	oah_initialize(&map, oah_compute_hash, key_type_numeric_signed, sizeof(int), sizeof(int), 8);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_out_of_bounds == oah_set_load_factor(&map, 101));
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_set_load_factor(&map, ION_OAH_DEFAULT_LOAD_FACTOR));
+
+	for (i = 0; i < 200; i++) {
+		value	= i * 2;
+		status	= oah_insert(&map, &i, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+
+		for (j = 0; j <= i; j++) {
+			status = oah_query(&map, &j, &value);
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+			PLANCK_UNIT_ASSERT_TRUE(tc, j * 2 == value);
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 200 == map.num_items);
+	PLANCK_UNIT_ASSERT_TRUE(tc, map.map_size >= 256);
+
+	/* Records not yet moved must still be found as duplicates. */
+	i		= 0;
+	status	= oah_insert(&map, &i, &value);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_duplicate_key == status.error);
+
+	for (i = 0; i < 200; i += 2) {
+		status = oah_delete(&map, &i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+	}
+
+	for (i = 0; i < 200; i++) {
+		status = oah_query(&map, &i, &value);
+		PLANCK_UNIT_ASSERT_TRUE(tc, (i % 2 == 0 ? err_item_not_found : err_ok) == status.error);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 100 == map.num_items);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+}
+
+/**
+@brief		Tests that inserting and deleting fresh keys does not grow a
+			map whose live record count stays the same.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_hashmap_rehash_clears_deleted(
+	planck_unit_test_t *tc
+) {
+	ion_hashmap_t	map;
+	int				i;
+	int				key;
+	ion_status_t	status;
+
+	map.super.compare	= dictionary_compare_signed_value;
+	map.super.key_type	= key_type_numeric_signed;
+	oah_initialize(&map, oah_compute_hash, key_type_numeric_signed, sizeof(int), sizeof(int), 16);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_set_load_factor(&map, ION_OAH_DEFAULT_LOAD_FACTOR));
+
+	for (i = 0; i < 1000; i++) {
+		status = oah_insert(&map, &i, &i);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+
+		if (i >= 4) {
+			key		= i - 4;
+			status	= oah_delete(&map, &key);
+			PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 16 == map.map_size);
+	PLANCK_UNIT_ASSERT_TRUE(tc, 4 == map.num_items);
+
+	for (i = 996; i < 1000; i++) {
+		status = oah_query(&map, &i, &key);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+		PLANCK_UNIT_ASSERT_TRUE(tc, i == key);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+}
+
+/**
+@brief		Tests that each rehash is done before the next one starts, even
+			at a low load factor, and that records still in the old table are
+			found by location.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_hashmap_rehash_bounded(
+	planck_unit_test_t *tc
+) {
+	ion_hashmap_t	map;
+	int				i;
+	int				j;
+	int				location;
+	int				remaining;
+	int				step;
+	int				num_rehashes = 0;
+	ion_status_t	status;
+
+	map.super.compare	= dictionary_compare_signed_value;
+	map.super.key_type	= key_type_numeric_signed;
+	oah_initialize(&map, oah_compute_hash, key_type_numeric_signed, sizeof(int), sizeof(int), 8);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_set_load_factor(&map, 10));
+
+	for (i = 0; i < 300; i++) {
+		remaining	= NULL == map.old_entry ? 0 : map.old_map_size - map.rehash_index;
+		step		= map.rehash_step;
+		status		= oah_insert(&map, &i, IONIZE(i * 3, int));
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == status.error);
+
+		if ((NULL != map.old_entry) && (0 == map.rehash_index)) {
+			/* A rehash started here, so the one before it was done by this insert's own step. */
+			PLANCK_UNIT_ASSERT_TRUE(tc, remaining <= step);
+			num_rehashes++;
+
+			for (j = 0; j <= i; j++) {
+				PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_find_item_loc(&map, &j, &location));
+				PLANCK_UNIT_ASSERT_TRUE(tc, location < map.map_size);
+				PLANCK_UNIT_ASSERT_TRUE(tc, j == *(int *) oah_bucket_at(&map, location)->data);
+				PLANCK_UNIT_ASSERT_TRUE(tc, j * 3 == *(int *) (oah_bucket_at(&map, location)->data + sizeof(int)));
+			}
+		}
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, num_rehashes >= 5);
+	PLANCK_UNIT_ASSERT_TRUE(tc, 300 == map.num_items);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == oah_destroy(&map));
+}
+
 planck_unit_suite_t *
 open_address_hashmap_getsuite(
 ) {
@@ -981,6 +1253,7 @@ open_address_hashmap_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_initialize);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_compute_simple_hash);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_get_location);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_compute_hash);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_find_item_location);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_simple_insert);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_simple_insert_and_query);
@@ -992,6 +1265,10 @@ open_address_hashmap_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_delete_1);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_delete_2);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_capacity);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_control_groups);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_grow);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_rehash_clears_deleted);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_hashmap_rehash_bounded);
 
 	return suite;
 }
@@ -101,7 +101,7 @@ test_open_address_hashmap_handler_create_destroy(
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->super.record.key_size) == record.key_size);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->super.record.value_size) == record.value_size);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->map_size) == size);
-	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->compute_hash) == &oah_compute_simple_hash);
+	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->compute_hash) == &oah_compute_hash);
 	PLANCK_UNIT_ASSERT_TRUE(tc, (((ion_hashmap_t *) test_dictionary.instance)->write_concern) == wc_insert_unique);
 	PLANCK_UNIT_ASSERT_TRUE(tc, test_dictionary.handler->delete_dictionary(&test_dictionary) == err_ok);
 	PLANCK_UNIT_ASSERT_TRUE(tc, test_dictionary.instance == NULL);
@@ -483,7 +483,7 @@ test_open_address_dictionary_cursor_range(
 		ion_value_t str;
 
 		str = malloc(record_info.value_size);
-		sprintf((char *) str, "value : %i", (*(int *) predicate.statement.range.lower_bound) + result_count);
+		sprintf((char *) str, "value : %i", *(int *) record.key);
 
 		PLANCK_UNIT_ASSERT_TRUE(tc, ION_IS_EQUAL == memcmp(record.value, str, record_info.value_size));
 		PLANCK_UNIT_ASSERT_TRUE(tc, *(int *) (record.key) >= *(int *) (cursor->predicate->statement.range.lower_bound));
@@ -510,6 +510,75 @@ test_open_address_dictionary_cursor_range(
 	dictionary_delete_dictionary(&test_dictionary);
 }
 
+/**
+@brief		Tests that cursors find every record while a rehash is running,
+			without finishing it first.
+
+@param	  tc
+				Test case.
+*/
+void
+test_open_address_dictionary_cursor_during_rehash(
+	planck_unit_test_t *tc
+) {
+	ion_dictionary_handler_t	map_handler;
+	ion_dictionary_t			test_dictionary;
+	ion_hashmap_t				*hash_map;
+	ion_dict_cursor_t			*cursor;
+	ion_predicate_t				predicate;
+	ion_record_t				record;
+	int							key;
+	int							value;
+	int							seen[64];
+	int							num_keys;
+	int							result_count;
+
+	oadict_init(&map_handler);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == dictionary_create(&map_handler, &test_dictionary, 1, key_type_numeric_signed, sizeof(int), sizeof(int), 16));
+	hash_map = (ion_hashmap_t *) test_dictionary.instance;
+
+	/* Insert until a rehash starts, leaving every record in the old table. */
+	for (num_keys = 0; (num_keys < 64) && (NULL == hash_map->old_entry); num_keys++) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == dictionary_insert(&test_dictionary, &num_keys, IONIZE(num_keys * 3, int)).error);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != hash_map->old_entry);
+
+	record.key		= &key;
+	record.value	= &value;
+	result_count	= 0;
+	memset(seen, 0, sizeof(seen));
+
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == dictionary_find(&test_dictionary, &predicate, &cursor));
+
+	while (cs_cursor_active == cursor->next(cursor, &record)) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, (key >= 0) && (key < num_keys) && !seen[key]);
+		PLANCK_UNIT_ASSERT_TRUE(tc, key * 3 == value);
+		seen[key] = 1;
+		result_count++;
+	}
+
+	cursor->destroy(&cursor);
+	PLANCK_UNIT_ASSERT_TRUE(tc, num_keys == result_count);
+	PLANCK_UNIT_ASSERT_TRUE(tc, NULL != hash_map->old_entry);
+
+	/* An equality cursor finds a record that has not been moved yet. */
+	for (key = 0; key < num_keys; key++) {
+		int target = key;
+
+		dictionary_build_predicate(&predicate, predicate_equality, &target);
+		PLANCK_UNIT_ASSERT_TRUE(tc, err_ok == dictionary_find(&test_dictionary, &predicate, &cursor));
+		PLANCK_UNIT_ASSERT_TRUE(tc, cs_cursor_active == cursor->next(cursor, &record));
+		PLANCK_UNIT_ASSERT_TRUE(tc, target == key);
+		PLANCK_UNIT_ASSERT_TRUE(tc, target * 3 == value);
+		cursor->destroy(&cursor);
+		key = target;
+	}
+
+	dictionary_delete_dictionary(&test_dictionary);
+}
+
 planck_unit_suite_t *
 open_address_hashmap_handler_getsuite(
 ) {
@@ -524,6 +593,7 @@ open_address_hashmap_handler_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_dictionary_handler_query_with_results);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_dictionary_handler_query_no_results);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_dictionary_cursor_range);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_open_address_dictionary_cursor_during_rehash);
 
 	return suite;
 }
@@ -455,6 +455,100 @@ test_slhandler_cursor_range_exact_results(
 	dictionary_delete_dictionary(&dict);
 }
 
+/**
+@brief	  Tests descending range and all records cursors on the std
+			conditions skiplist, which holds blocks of duplicate keys.
+
+@param	  tc
+				Test case.
+*/
+void
+test_slhandler_cursor_descending(
+	planck_unit_test_t *tc
+) {
+	PRINT_HEADER();
+
+	ion_dictionary_t			dict;
+	ion_dictionary_handler_t	handler;
+
+	create_test_dictionary_std_conditions(&dict, &handler);
+
+	int extra_keys[]	= { 503, 504, 504, 504, 509, 542 };
+	int num_extra		= sizeof(extra_keys) / sizeof(int);
+
+	int i;
+
+	for (i = 0; i < num_extra; i++) {
+		dictionary_insert(&dict, &extra_keys[i], "test");
+	}
+
+	ion_dict_cursor_t	*cursor;
+	ion_predicate_t		predicate;
+	ion_record_t		record;
+	ion_cursor_status_t c_status;
+	int					key;
+
+	record.key		= &key;
+	record.value	= malloc(dict.instance->record.value_size);
+
+	/* The extra keys, from the greatest down. */
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(500, int), IONIZE(600, int));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_set_predicate_descending(&predicate, boolean_true));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&dict, &predicate, &cursor));
+
+	for (i = num_extra - 1; i >= 0; i--) {
+		c_status = cursor->next(cursor, &record);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, c_status);
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, extra_keys[i], key);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_end_of_results, cursor->next(cursor, &record));
+	cursor->destroy(&cursor);
+
+	/* Keys 14 and 13 have two copies and one copy, 12 has none. */
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(5, int), IONIZE(14, int));
+	dictionary_set_predicate_descending(&predicate, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&dict, &predicate, &cursor));
+
+	int expected_keys[] = { 14, 14, 13, 11, 10, 9, 8, 7, 6, 5 };
+
+	for (i = 0; i < (int) (sizeof(expected_keys) / sizeof(int)); i++) {
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_cursor_active, cursor->next(cursor, &record));
+		PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, expected_keys[i], key);
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_end_of_results, cursor->next(cursor, &record));
+	cursor->destroy(&cursor);
+
+	/* Nothing lies between the data and the extra keys. */
+	dictionary_build_predicate(&predicate, predicate_range, IONIZE(100, int), IONIZE(500, int));
+	dictionary_set_predicate_descending(&predicate, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&dict, &predicate, &cursor));
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, cs_end_of_results, cursor->status);
+	cursor->destroy(&cursor);
+
+	/* Every record, never going up. */
+	dictionary_build_predicate(&predicate, predicate_all_records);
+	dictionary_set_predicate_descending(&predicate, boolean_true);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, err_ok, dictionary_find(&dict, &predicate, &cursor));
+
+	int last_key	= 542;
+	int count		= 0;
+
+	while (cs_cursor_active == cursor->next(cursor, &record)) {
+		PLANCK_UNIT_ASSERT_TRUE(tc, key <= last_key);
+		last_key = key;
+		count++;
+	}
+
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 0, last_key);
+	PLANCK_UNIT_ASSERT_INT_ARE_EQUAL(tc, 96, count);
+	cursor->destroy(&cursor);
+
+	free(record.value);
+	dictionary_delete_dictionary(&dict);
+}
+
 /**
 @brief	  Creates the suite to test using PlanckUnit test cases.
 @return	 Pointer to a PlanckUnit test suite.
@@ -477,6 +571,7 @@ skiplist_handler_getsuite(
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_slhandler_cursor_range_with_results);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_slhandler_cursor_range_lower_missing);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_slhandler_cursor_range_exact_results);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_slhandler_cursor_descending);
 
 	return suite;
 }
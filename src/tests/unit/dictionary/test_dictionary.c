@@ -148,6 +148,72 @@ test_dictionary_compare_numerics(
 	}
 }
 
+/**
+@brief		Counts how many of @c 64 buckets a run of keys lands in when the
+			hash is masked down to the low six bits.
+*/
+int
+dictionary_test_count_buckets(
+	ion_byte_t		*keys,
+	ion_key_type_t	key_type,
+	ion_key_size_t	key_size
+) {
+	char	used[64];
+	int		count;
+	int		i;
+
+	memset(used, 0, sizeof(used));
+	count = 0;
+
+	for (i = 0; i < 64; i++) {
+		uint32_t bucket = dictionary_hash_key(keys + i * key_size, key_type, key_size) & 63;
+
+		if (!used[bucket]) {
+			used[bucket] = 1;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void
+test_dictionary_hash_key(
+	planck_unit_test_t *tc
+) {
+	ion_byte_t	keys[64 * 9];
+	int			i;
+
+	/* Sequential integers must not all fall in a few masked buckets. */
+	for (i = 0; i < 64; i++) {
+		memcpy(keys + i * sizeof(int), &i, sizeof(int));
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 32 <= dictionary_test_count_buckets(keys, key_type_numeric_signed, sizeof(int)));
+
+	for (i = 0; i < 64; i++) {
+		int64_t wide = i;
+
+		memcpy(keys + i * sizeof(int64_t), &wide, sizeof(int64_t));
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 32 <= dictionary_test_count_buckets(keys, key_type_numeric_signed, sizeof(int64_t)));
+
+	/* Strings that share a long prefix still spread out. */
+	for (i = 0; i < 64; i++) {
+		sprintf((char *) keys + i * 9, "key_%04d", i);
+	}
+
+	PLANCK_UNIT_ASSERT_TRUE(tc, 32 <= dictionary_test_count_buckets(keys, key_type_null_terminated_string, 9));
+	PLANCK_UNIT_ASSERT_TRUE(tc, 32 <= dictionary_test_count_buckets(keys, key_type_char_array, 9));
+
+	/* Keys that compare equal must hash equal, so bytes after the terminator are ignored. */
+	memcpy(keys, "ab\0x", 4);
+	memcpy(keys + 4, "ab\0y", 4);
+	PLANCK_UNIT_ASSERT_TRUE(tc, dictionary_hash_key(keys, key_type_null_terminated_string, 4) == dictionary_hash_key(keys + 4, key_type_null_terminated_string, 4));
+	PLANCK_UNIT_ASSERT_TRUE(tc, dictionary_hash_key(keys, key_type_char_array, 4) == dictionary_hash_key(keys + 4, key_type_char_array, 4));
+}
+
 void
 test_dictionary_master_table(
 	planck_unit_test_t *tc
@@ -261,6 +327,7 @@ dictionary_getsuite(
 	planck_unit_suite_t *suite = planck_unit_new_suite();
 
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_dictionary_compare_numerics);
+	PLANCK_UNIT_ADD_TO_SUITE(suite, test_dictionary_hash_key);
 	PLANCK_UNIT_ADD_TO_SUITE(suite, test_dictionary_master_table);
 
 	return suite;